@@ -0,0 +1,265 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "wperf-common\samplering.h"
+#include "bench.h"
+
+// SYSTEM_CACHE_ALIGNMENT_SIZE on ARM64, groups of driver `CoreInfo` start on this boundary
+constexpr size_t cache_line = 128;
+
+// Models of driver per-core state (wperf-driver/coreinfo.h) with fields written by PMI ISR
+// and timer DPC, and configuration read from other cores.
+//
+// Old layout: hot fields packed next to configuration, and fixed counter readings
+// kept in separate array indexed by core.
+struct core_packed
+{
+    UINT64 idx;
+    UINT32 events_num;
+    UINT64 sample_generated;    // PMI ISR
+    UINT64 timer_round;         // Timer DPC
+    UINT64 dpc_count;
+};
+
+#pragma warning(push)
+#pragma warning(disable:4324)   // Structure was padded due to alignment specifier
+// Current layout: every group starts on its own cache line
+struct alignas(cache_line) core_aligned
+{
+    UINT64 idx;
+    UINT32 events_num;
+    alignas(cache_line) UINT64 sample_generated;
+    alignas(cache_line) UINT64 timer_round;
+    UINT64 last_fpc_read;
+    UINT64 dpc_count;
+};
+#pragma warning(pop)
+
+static_assert(sizeof(core_aligned) % cache_line == 0, "Neighbouring core_aligned elements share cache line");
+static_assert(sizeof(core_packed) < cache_line, "core_packed neighbours are expected to share cache line");
+
+// Threads play the role of cores: every iteration is one PMI and every 8th also a timer DPC.
+// One more thread plays IOCTL path which reads configuration of all cores.
+// Returns nanoseconds per iteration.
+template <typename Core>
+static double simulate_cores(std::vector<Core>& cores, std::vector<UINT64*>& fpc, UINT64 iterations)
+{
+    std::atomic<bool> go{ false }, done{ false };
+    std::atomic<size_t> ready{ 0 };
+    std::vector<std::thread> threads;
+    volatile UINT64 config_sum = 0;
+
+    for (size_t i = 0; i < cores.size(); i++)
+    {
+        threads.emplace_back([&, i]() {
+            volatile UINT64* generated = &cores[i].sample_generated;
+            volatile UINT64* round = &cores[i].timer_round;
+            volatile UINT64* count = &cores[i].dpc_count;
+            volatile UINT64* last = fpc[i];
+
+            ready++;
+            while (!go)
+                std::this_thread::yield();
+
+            for (UINT64 n = 0; n < iterations; n++)
+            {
+                *generated = *generated + 1;
+                if ((n & 7) == 0)
+                {
+                    *round = *round + 1;
+                    *last = n;
+                    *count = *count + 1;
+                }
+            }
+        });
+    }
+
+    std::thread reader([&]() {
+        UINT64 sum = 0;
+        while (!done)
+        {
+            for (auto& core : cores)
+                sum += *(volatile UINT64*)&core.idx + *(volatile UINT32*)&core.events_num;
+        }
+        config_sum = sum;
+    });
+
+    while (ready < cores.size())
+        std::this_thread::yield();
+
+    double us = bench::time_us([&]() {
+        go = true;
+        for (auto& t : threads)
+            t.join();
+    });
+
+    done = true;
+    reader.join();
+
+    return us * 1000.0 / (double)iterations;
+}
+
+template <typename Core>
+static bool counts_match(const std::vector<Core>& cores, UINT64 iterations)
+{
+    for (auto& core : cores)
+        if (core.sample_generated != iterations || core.timer_round != (iterations + 7) / 8 || core.dpc_count != (iterations + 7) / 8)
+            return false;
+    return true;
+}
+
+// Compare ISR / timer DPC write pattern on packed and cache aligned per-core state
+WPERF_BENCH(coreinfo_false_sharing)
+{
+    const size_t cores_num = (std::max)(2u, (std::min)(8u, std::thread::hardware_concurrency()));
+    const UINT64 iterations = 2000000;
+
+    std::vector<core_packed> packed(cores_num);
+    std::vector<UINT64> last_fpc_read(cores_num);
+    std::vector<UINT64*> packed_fpc;
+    for (size_t i = 0; i < cores_num; i++)
+    {
+        packed[i] = { i, 7, 0, 0, 0 };
+        packed_fpc.push_back(&last_fpc_read[i]);
+    }
+
+    std::vector<core_aligned> aligned(cores_num);
+    std::vector<UINT64*> aligned_fpc;
+    for (size_t i = 0; i < cores_num; i++)
+    {
+        aligned[i].idx = i;
+        aligned[i].events_num = 7;
+        aligned_fpc.push_back(&aligned[i].last_fpc_read);
+    }
+
+    double packed_ns = simulate_cores(packed, packed_fpc, iterations);
+    double aligned_ns = simulate_cores(aligned, aligned_fpc, iterations);
+
+    std::wcout << cores_num << L" cores x " << iterations << L" PMIs: packed " << packed_ns << L" ns, cache aligned "
+        << aligned_ns << L" ns per PMI" << std::endl;
+
+    for (size_t i = 0; i < cores_num; i++)
+        if (last_fpc_read[i] != iterations - 8 || aligned[i].last_fpc_read != iterations - 8)
+            return false;
+    return counts_match(packed, iterations) && counts_match(aligned, iterations);
+}
+
+// Push as it was before producer cached `tail`: shared `tail` is read on every frame
+static bool sample_ring_push_uncached(struct sample_ring* ring, const FrameChain* frame)
+{
+    LONG64 head = ring->head;
+    if ((UINT64)(head - ReadAcquire64(&ring->shared->tail)) >= ring->capacity)
+        return false;
+
+    ring->shared->frames[(UINT64)head & (ring->capacity - 1)] = *frame;
+    ring->head = head + 1;
+    WriteRelease64(&ring->shared->head, ring->head);
+    return true;
+}
+
+// PMI ISR producer and wperf consumer on two cores, returns nanoseconds per frame.
+// Producer spins between frames so consumer can keep up, like PMIs spread over time.
+template <typename Push>
+static double simulate_sample_ring(struct sample_ring* ring, UINT64 total, Push push, UINT64& consumed, UINT64& dropped, bool& ordered)
+{
+    std::atomic<bool> done{ false };
+    std::vector<FrameChain> out(SAMPLE_CHAIN_BUFFER_SIZE);
+    consumed = dropped = 0;
+    ordered = true;
+
+    double us = bench::time_us([&]() {
+        std::thread producer([&]() {
+            FrameChain fc = { 0 };
+            for (UINT64 i = 0; i < total; i++)
+            {
+                fc.pc = i;
+                if (!push(ring, &fc))
+                    dropped++;
+                for (volatile int spin = 0; spin < 64; spin = spin + 1)
+                    ;
+            }
+            done = true;
+        });
+
+        UINT64 last_pc = 0;
+        for (;;)
+        {
+            bool finished = done;
+            UINT64 n = sample_ring_pop_bulk(ring, out.data(), out.size());
+            for (UINT64 i = 0; i < n; i++)
+            {
+                if (consumed && out[i].pc <= last_pc)
+                    ordered = false;
+                last_pc = out[i].pc;
+                consumed++;
+            }
+            if (finished && n == 0)
+                break;
+        }
+
+        producer.join();
+    });
+
+    return us * 1000.0 / (double)total;
+}
+
+// Producer re-reading consumer's `tail` on every push against cached `tail`
+WPERF_BENCH(sample_ring_cached_tail)
+{
+    const UINT64 total = 5000000;
+    std::vector<UINT8> mem(SAMPLE_RING_SHARED_SIZE(SAMPLE_RING_BUFFER_SIZE) + SYSTEM_CACHE_ALIGNMENT_SIZE);
+    UINT_PTR addr = (reinterpret_cast<UINT_PTR>(mem.data()) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) & ~UINT_PTR(SYSTEM_CACHE_ALIGNMENT_SIZE - 1);
+    struct sample_ring_shared* shared = reinterpret_cast<struct sample_ring_shared*>(addr);
+    struct sample_ring ring;
+    bool ok = true;
+
+    for (bool cached : { false, true })
+    {
+        UINT64 consumed, dropped;
+        bool ordered;
+
+        sample_ring_init(&ring, shared, SAMPLE_RING_BUFFER_SIZE);
+        double ns = cached ? simulate_sample_ring(&ring, total, sample_ring_push, consumed, dropped, ordered)
+                           : simulate_sample_ring(&ring, total, sample_ring_push_uncached, consumed, dropped, ordered);
+
+        std::wcout << (cached ? L"cached tail: " : L"shared tail: ") << total << L" frames, " << ns << L" ns per frame, "
+            << dropped << L" dropped" << std::endl;
+        ok = ok && ordered && consumed + dropped == total;
+    }
+
+    return ok;
+}
@@ -0,0 +1,114 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "wperf/json.h"
+#include "bench.h"
+
+// Escapes backslashes of the whole serialized document, this is what `--json` output did before `JSONWriter`
+static std::wstring escape_document(const std::wstring& str)
+{
+    std::wstring res;
+    size_t n = str.find(L'\\'), lastn = 0;
+    while (n != std::wstring::npos)
+    {
+        res += str.substr(lastn, n - lastn) + L"\\";
+        lastn = n;
+        n = str.find(L'\\', lastn + 1);
+    }
+    res += str.substr(lastn, str.size() - lastn);
+    return res;
+}
+
+static size_t count_of(const std::wstring& str, const std::wstring& what)
+{
+    size_t n = 0;
+    for (size_t pos = str.find(what); pos != std::wstring::npos; pos = str.find(what, pos + what.size()))
+        n++;
+    return n;
+}
+
+// `--json` sampling report: document built in a `std::wstringstream` and escaped as a whole vs `JSONWriter` streaming
+WPERF_BENCH(json_writer_vs_stringstream)
+{
+    // Sampling report with symbols from a module under a Windows path
+    const size_t records = 50000;
+    const std::wstring module = L"C:\\Windows\\System32\\ntdll.dll";
+
+    std::wstringstream old_out, new_out;
+
+    double old_us = bench::time_us([&]() {
+        std::wstringstream doc;
+        doc << L"{\"sampling\": {\"samples\": [";
+        for (size_t i = 0; i < records; i++)
+        {
+            if (i)
+                doc << L",";
+            doc << L"{\"symbol\": \"RtlUserThreadStart+" << i << L"\", \"module\": \"" << module
+                << L"\", \"count\": " << i * 3 << L", \"overhead\": " << double(i) / records << L"}";
+        }
+        doc << L"]}}";
+        old_out << escape_document(doc.str());
+    });
+
+    double new_us = bench::time_us([&]() {
+        JSONWriter<wchar_t> json(new_out, true);
+        json.BeginObject();
+        json.Key(L"sampling");
+        json.BeginObject();
+        json.Key(L"samples");
+        json.BeginArray();
+        for (size_t i = 0; i < records; i++)
+        {
+            json.BeginObject();
+            json.Member(L"symbol", L"RtlUserThreadStart+" + std::to_wstring(i));
+            json.Member(L"module", module);
+            json.Member(L"count", i * 3);
+            json.Member(L"overhead", double(i) / records);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+        json.EndObject();
+        json.Flush();
+    });
+
+    const std::wstring old_doc = old_out.str(), new_doc = new_out.str();
+
+    std::wcout << L"stringstream + escape: " << old_doc.size() << L" characters, " << old_us / 1000.0 << L" ms" << std::endl;
+    std::wcout << L"JSONWriter: " << new_doc.size() << L" characters, " << new_us / 1000.0 << L" ms" << std::endl;
+
+    // Both documents have every record and the same escaped module path
+    const std::wstring escaped_module = L"\"C:\\\\Windows\\\\System32\\\\ntdll.dll\"";
+    return count_of(old_doc, L"\"symbol\"") == records && count_of(new_doc, L"\"symbol\"") == records
+        && count_of(old_doc, escaped_module) == records && count_of(new_doc, escaped_module) == records;
+}
@@ -0,0 +1,174 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <windows.h>
+#include "wperf/events.h"
+#include "wperf/metric.h"
+#include "bench.h"
+
+struct ts_metric
+{
+    std::wstring events_raw;
+    std::wstring formula_sy;
+};
+
+// Formulas of all Telemetry Solution metrics of Neoverse cores
+static std::vector<ts_metric> get_all_ts_metrics()
+{
+    std::vector<ts_metric> result;
+#   define WPERF_TS_EVENTS(...)
+#   define WPERF_TS_METRICS(A,B,C,D,E,F,G,H) result.push_back({ std::wstring(L##C), std::wstring(L##E) });
+#   define WPERF_TS_PRODUCT_CONFIGURATION(...)
+#   define WPERF_TS_ALIAS(...)
+#   define WPERF_TS_GROUPS_METRICS(...)
+#include "wperf-common/neoverse-n1.def"
+#include "wperf-common/neoverse-n2-r0p0.def"
+#include "wperf-common/neoverse-n2-r0p1.def"
+#include "wperf-common/neoverse-n2-r0p3.def"
+#include "wperf-common/neoverse-n2.def"
+#include "wperf-common/neoverse-n3.def"
+#include "wperf-common/neoverse-v1.def"
+#include "wperf-common/neoverse-v2.def"
+#include "wperf-common/neoverse-v3.def"
+#   undef WPERF_TS_EVENTS
+#   undef WPERF_TS_METRICS
+#   undef WPERF_TS_PRODUCT_CONFIGURATION
+#   undef WPERF_TS_ALIAS
+#   undef WPERF_TS_GROUPS_METRICS
+    return result;
+}
+
+static std::vector<std::wstring> split_events(const std::wstring& events_raw)
+{
+    std::vector<std::wstring> result;
+    std::wstring token;
+    std::wistringstream ss(events_raw);
+    while (std::getline(ss, token, L','))
+        result.push_back(token);
+    return result;
+}
+
+// Compiled formulas against metric_calculate_shunting_yard_expression() for all Neoverse metrics
+WPERF_BENCH(metric_compiled_vs_shunting_yard)
+{
+    const int rounds = 1000;
+    std::mt19937_64 rng(2024);
+    std::uniform_int_distribution<uint64_t> dist(0, 1000000);
+
+    auto metrics = get_all_ts_metrics();
+    std::vector<metric_program> programs;
+    std::vector<std::map<std::wstring, double>> vars(metrics.size());
+    std::vector<std::vector<double>> slots(metrics.size());
+
+    for (size_t m = 0; m < metrics.size(); m++)
+    {
+        programs.push_back(metric_compile_shunting_yard_expression(metrics[m].formula_sy));
+        slots[m].assign(programs[m].vars.size(), 0.0);
+
+        for (const auto& event : split_events(metrics[m].events_raw))
+        {
+            double value = static_cast<double>(dist(rng));
+            vars[m][event] = value;
+            int slot = programs[m].get_slot(event);
+            if (slot >= 0)
+                slots[m][slot] = value;
+        }
+    }
+
+    double sum_sy = 0, sum_compiled = 0;
+
+    double sy_us = bench::time_us([&]() {
+        for (int r = 0; r < rounds; r++)
+            for (size_t m = 0; m < metrics.size(); m++)
+                sum_sy += metric_calculate_shunting_yard_expression(vars[m], metrics[m].formula_sy);
+    });
+    double compiled_us = bench::time_us([&]() {
+        for (int r = 0; r < rounds; r++)
+            for (size_t m = 0; m < metrics.size(); m++)
+                sum_compiled += metric_evaluate(programs[m], slots[m].data());
+    });
+
+    std::wcout << metrics.size() << L" metrics x " << rounds << L" evaluations: shunting yard " << sy_us
+        << L" us, compiled " << compiled_us << L" us" << std::endl;
+
+    return metrics.size() > 0 && sum_sy == sum_compiled;
+}
+
+// Batch evaluation on 128 cores against per core evaluation for all Neoverse metrics
+WPERF_BENCH(metric_batch_vs_per_core)
+{
+    const size_t cores = 128;
+    const int rounds = 100;
+    std::mt19937_64 rng(128);
+    std::uniform_int_distribution<uint64_t> dist(0, 1000000);
+
+    auto metrics = get_all_ts_metrics();
+    std::vector<double> slots, row(cores), out(cores), expected(cores), scratch;
+    double scalar_us = 0, batch_us = 0;
+    bool ok = true;
+
+    for (const auto& metric : metrics)
+    {
+        metric_program program = metric_compile_shunting_yard_expression(metric.formula_sy);
+        const size_t slots_num = program.vars.size();
+
+        slots.resize(slots_num * cores);
+        for (size_t i = 0; i < slots.size(); i++)
+            slots[i] = (i % 17 == 0) ? 0.0 : static_cast<double>(dist(rng));  // Some cores will divide by zero
+
+        scalar_us += bench::time_us([&]() {
+            for (int r = 0; r < rounds; r++)
+                for (size_t c = 0; c < cores; c++)
+                {
+                    for (size_t s = 0; s < slots_num; s++)
+                        row[s] = slots[s * cores + c];
+                    expected[c] = metric_evaluate(program, row.data());
+                }
+        });
+        batch_us += bench::time_us([&]() {
+            for (int r = 0; r < rounds; r++)
+                metric_evaluate_batch(program, slots.data(), cores, out.data(), scratch);
+        });
+
+        for (size_t c = 0; c < cores; c++)
+            ok = ok && expected[c] == out[c];
+    }
+
+    std::wcout << metrics.size() << L" metrics x " << cores << L" cores x " << rounds << L" intervals: per core "
+        << scalar_us << L" us, batch " << batch_us << L" us" << std::endl;
+
+    return ok;
+}
@@ -0,0 +1,184 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <windows.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "wperf-common\mpxsched.h"
+#include "bench.h"
+
+// Round-robin rotation driver used before `mpx_sched_next()`, padding takes counters too
+static std::vector<UINT16> legacy_next(UINT32 counters, UINT32 events_num, UINT64 round)
+{
+    std::vector<UINT16> slots;
+    UINT32 start = (UINT32)((counters * round) % events_num);
+
+    for (UINT32 i = 0; i < counters && i < events_num; i++)
+        slots.push_back((UINT16)((start + i) % events_num));
+    return slots;
+}
+
+static std::vector<UINT16> sched_next(struct mpx_sched* sched)
+{
+    UINT16 slots[MAX_MANAGED_CORE_EVENTS];
+    UINT32 used = mpx_sched_next(sched, slots, MAX_MANAGED_CORE_EVENTS);
+    return std::vector<UINT16>(slots, slots + used);
+}
+
+// Synthetic counter stream: every event has its own base rate and
+// workload phases change the rate over time.
+static UINT64 synthetic_delta(size_t event, UINT64 round)
+{
+    const double base = 1000.0 * (event + 1);
+    const double phase = std::sin(2.0 * 3.14159265358979 * round / (17.0 + 3 * event));
+    const UINT64 burst = (round / 40) % 2 ? (event % 3) * 400 : 0;
+    return (UINT64)(base * (1.5 + phase)) + burst;
+}
+
+struct replay_result
+{
+    double error;           // Mean relative scaling error
+    double width;           // Mean width of `mpx_scale_range()` relative to real count
+    size_t out_of_range;    // Events with real count outside `mpx_scale_range()`
+};
+
+// Replay synthetic stream, `next` picks counted events for each round
+template <typename F>
+static struct replay_result replay(const struct evt_sched_attr* attrs, size_t events_num, UINT64 rounds, F next)
+{
+    std::vector<UINT64> truth(events_num), value(events_num), scheduled(events_num), dmin(events_num), dmax(events_num);
+    struct replay_result res = { 0.0, 0.0, 0 };
+    size_t counted = 0;
+
+    for (UINT64 round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < events_num; i++)
+            truth[i] += synthetic_delta(i, round);
+        for (UINT16 s : next(round))
+            mpx_sched_account(synthetic_delta(s, round), &value[s], &scheduled[s], &dmin[s], &dmax[s]);
+    }
+
+    for (size_t i = 0; i < events_num; i++)
+    {
+        if (!attrs[i].weight)
+            continue;       // Padding
+
+        UINT64 lo, hi;
+        UINT64 scaled = mpx_scale(value[i], scheduled[i], rounds);
+        mpx_scale_range(value[i], scheduled[i], rounds, dmin[i], dmax[i], &lo, &hi);
+
+        res.error += std::fabs((double)scaled - truth[i]) / truth[i];
+        res.width += (double)(hi - lo) / truth[i];
+        if (truth[i] < lo || truth[i] > hi)
+            res.out_of_range++;
+        counted++;
+    }
+
+    res.error /= counted;
+    res.width /= counted;
+    return res;
+}
+
+static void print_replay(const wchar_t* name, const struct replay_result& res)
+{
+    std::wcout << name << L": mean scaling error " << res.error * 100.0 << L"%, mean range width " << res.width * 100.0
+        << L"%, " << res.out_of_range << L" events outside range" << std::endl;
+}
+
+// Replay phase-varying counter streams through old rotation and stride scheduler
+WPERF_BENCH(mpxsched_replay)
+{
+    // Event list as `set_event_padding()` builds it for 5 counters:
+    //   {g0, g0, g0}, e, e, {g1, g1, g1}, e, e, e, e, pad, pad, pad
+    const struct evt_sched_attr attrs[] = {
+        {1, 1}, {1, 1}, {1, 1}, {0, 1}, {0, 1},
+        {2, 1}, {2, 1}, {2, 1}, {0, 1}, {0, 1},
+        {0, 1}, {0, 1}, {0, 0}, {0, 0}, {0, 0},
+    };
+    const UINT32 events_num = _countof(attrs);
+    const UINT32 counters = 5;
+    bool ok = true;
+
+    for (UINT64 rounds : { 60ull, 240ull, 1000ull })
+    {
+        struct mpx_sched sched;
+        struct mpx_sched_unit units[MAX_MANAGED_CORE_EVENTS];
+        if (!mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, counters, attrs, events_num))
+            return false;
+
+        struct replay_result legacy = replay(attrs, events_num, rounds,
+            [&](UINT64 round) { return legacy_next(counters, events_num, round); });
+        struct replay_result weighted = replay(attrs, events_num, rounds,
+            [&](UINT64) { return sched_next(&sched); });
+
+        std::wcout << rounds << L" rounds" << std::endl;
+        print_replay(L"  legacy rotation", legacy);
+        print_replay(L"  stride scheduler", weighted);
+
+        // Counters are not wasted on padding, so each event is counted in more rounds and its range is narrower.
+        // Scaling error depends on which phases rounds hit and is only reported.
+        ok = ok && weighted.width < legacy.width && weighted.out_of_range == 0;
+    }
+
+    return ok;
+}
+
+// Cost of picking events for one round in timer DPC
+WPERF_BENCH(mpxsched_next)
+{
+    struct evt_sched_attr attrs[MAX_MANAGED_CORE_EVENTS];
+    const UINT32 counters = 6;
+    const UINT64 rounds = 1000000;
+
+    // Worst case: all events, every 4th pair is a group and weights differ
+    for (UINT32 i = 0; i < MAX_MANAGED_CORE_EVENTS; i++)
+    {
+        attrs[i].group = (i / 2) % 4 == 0 ? (UINT16)(i / 2 + 1) : 0;
+        attrs[i].weight = (UINT16)(1 + i % 3);
+    }
+
+    struct mpx_sched sched;
+    struct mpx_sched_unit units[MAX_MANAGED_CORE_EVENTS];
+    if (!mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, counters, attrs, MAX_MANAGED_CORE_EVENTS))
+        return false;
+
+    UINT16 slots[MAX_MANAGED_CORE_EVENTS];
+    UINT64 used = 0;
+    double us = bench::time_us([&]() {
+        for (UINT64 round = 0; round < rounds; round++)
+            used += mpx_sched_next(&sched, slots, MAX_MANAGED_CORE_EVENTS);
+    });
+
+    std::wcout << MAX_MANAGED_CORE_EVENTS << L" events on " << counters << L" counters: "
+        << us * 1000.0 / (double)rounds << L" ns per round" << std::endl;
+
+    return used == rounds * counters;
+}
@@ -0,0 +1,103 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <windows.h>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "wperf-common\snapshot.h"
+#include "bench.h"
+
+// Counting read of all cores: one `ReadOut` per core and IOCTL against one `PMU_CTL_READ_COUNTING_BATCH` snapshot
+WPERF_BENCH(snapshot_batch_vs_per_core)
+{
+    // 128 cores with cycle counter and 6 events, driver side is modelled by filling the output buffers
+    const UINT32 cores = 128, evt_num = 7, reads = 2000;
+
+    std::vector<ReadOut> driver(cores);
+    for (UINT32 i = 0; i < cores; i++)
+    {
+        driver[i].evt_num = evt_num;
+        driver[i].round = 100 + i;
+        for (UINT32 j = 0; j < evt_num; j++)
+            driver[i].evts[j] = { j, 0, 1000000ull * i + j, 100, 10, 20 };
+    }
+
+    std::vector<ReadOut> per_core(cores), batch(cores);
+    std::vector<UINT8> buf(COUNTING_SNAPSHOT_MAX_SIZE(cores, MAX_MANAGED_CORE_EVENTS));
+    UINT64 per_core_bytes = 0, batch_bytes = 0, per_core_calls = 0, batch_calls = 0;
+    bool valid = true;
+
+    double per_core_us = bench::time_us([&]() {
+        for (UINT32 n = 0; n < reads; n++)
+        {
+            for (UINT32 i = 0; i < cores; i++)
+            {
+                ReadOut out;
+                std::memcpy(&out, &driver[i], sizeof(ReadOut));     // Driver copies fixed size `ReadOut`
+                per_core[i] = out;
+                per_core_bytes += sizeof(ReadOut);
+                per_core_calls++;
+            }
+        }
+    });
+
+    double batch_us = bench::time_us([&]() {
+        for (UINT32 n = 0; n < reads; n++)
+        {
+            struct counting_snapshot_hdr* hdr = counting_snapshot_init(buf.data(), (UINT32)buf.size());
+            for (UINT32 i = 0; i < cores; i++)
+            {
+                struct counting_snapshot_entry* entry = counting_snapshot_add(hdr, (UINT32)buf.size(), i, driver[i].evt_num, driver[i].round);
+                for (UINT32 j = 0; j < driver[i].evt_num; j++)
+                    entry->evts[j] = driver[i].evts[j];
+            }
+            batch_bytes += hdr->size;
+            batch_calls++;
+
+            if (!counting_snapshot_check(hdr, hdr->size, cores, MAX_MANAGED_CORE_EVENTS))
+            {
+                valid = false;
+                continue;
+            }
+            for (const struct counting_snapshot_entry* entry = counting_snapshot_next(hdr, NULL); entry; entry = counting_snapshot_next(hdr, entry))
+                counting_snapshot_copy(entry, &batch[entry->core_idx].evt_num, &batch[entry->core_idx].round, batch[entry->core_idx].evts);
+        }
+    });
+
+    std::wcout << L"per core: " << per_core_calls / reads << L" IOCTLs, " << per_core_bytes / reads << L" bytes, " << per_core_us / reads << L" us per read" << std::endl;
+    std::wcout << L"batch: " << batch_calls / reads << L" IOCTL, " << batch_bytes / reads << L" bytes, " << batch_us / reads << L" us per read" << std::endl;
+
+    for (UINT32 i = 0; i < cores && valid; i++)
+        valid = batch[i].evt_num == per_core[i].evt_num && batch[i].round == per_core[i].round
+            && !std::memcmp(batch[i].evts, per_core[i].evts, sizeof(struct pmu_event_usr) * evt_num);
+
+    return valid && batch_bytes < per_core_bytes;
+}
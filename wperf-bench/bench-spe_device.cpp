@@ -0,0 +1,118 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <windows.h>
+#include <initializer_list>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "wperf/spe_device.h"
+#include "bench.h"
+
+// Builds raw SPE packet stream, see wperf-test/wperf-test-spe_device.cpp
+struct spe_stream_builder
+{
+    std::vector<UINT8> buf;
+
+    spe_stream_builder& bytes(std::initializer_list<UINT8> b) { buf.insert(buf.end(), b); return *this; }
+    spe_stream_builder& payload(UINT64 value, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            buf.push_back(static_cast<UINT8>(value >> (i * 8)));
+        return *this;
+    }
+    spe_stream_builder& address(UINT8 index, UINT64 addr) { return bytes({ static_cast<UINT8>(0xB0 | index) }).payload(addr, 8); }
+    spe_stream_builder& counter(UINT8 index, UINT16 value) { return bytes({ static_cast<UINT8>(0x98 | index) }).payload(value, 2); }
+    spe_stream_builder& events(UINT16 value) { return bytes({ 0x52 }).payload(value, 2); }
+    spe_stream_builder& optype(UINT8 cls, UINT8 value) { return bytes({ static_cast<UINT8>(0x48 | cls), value }); }
+    spe_stream_builder& timestamp(UINT64 ts) { return bytes({ 0x71 }).payload(ts, 8); }
+
+    // Typical load record: PC, latencies, events, operation type, data address and timestamp
+    spe_stream_builder& load(UINT64 pc, UINT64 va, UINT16 lat, UINT64 ts)
+    {
+        return address(0, pc).events(0x0006).optype(1, 0x00).counter(0, lat).counter(1, lat / 2)
+            .address(2, va).counter(2, 3).address(3, va & 0xFFFFFFF).timestamp(ts);
+    }
+};
+
+// One million load records, about 60 MB of SPE buffer
+static spe_stream_builder make_load_stream(size_t records_num)
+{
+    spe_stream_builder sb;
+    sb.buf.reserve(records_num * 64);
+    for (size_t i = 0; i < records_num; i++)
+        sb.load(0x140001000 + (i % 4096) * 4, 0x7FF600000000 + i * 64, static_cast<UINT16>(i % 500), i);
+    return sb;
+}
+
+// Single threaded decoding of synthetic SPE buffer
+WPERF_BENCH(spe_decode)
+{
+    const size_t records_num = 1000000;
+    spe_stream_builder sb = make_load_stream(records_num);
+
+    std::vector<struct spe_record> records;
+    records.reserve(records_num);
+
+    size_t consumed = 0;
+    double us = bench::time_us([&]() {
+        consumed = spe_device::decode_records(sb.buf.data(), sb.buf.size(), records);
+    });
+
+    std::wcout << records_num << L" records, " << sb.buf.size() / (1024 * 1024) << L" MB in " << us << L" us" << std::endl;
+
+    return consumed == sb.buf.size() && records.size() == records_num && records.back().timestamp == records_num - 1;
+}
+
+// Parallel decoding of the same buffer in 1 MB chunks against single threaded decoding
+WPERF_BENCH(spe_decode_parallel)
+{
+    const size_t records_num = 1000000;
+    spe_stream_builder sb = make_load_stream(records_num);
+
+    std::vector<struct spe_record> serial, parallel;
+    serial.reserve(records_num);
+    parallel.reserve(records_num);
+
+    size_t consumed = 0;
+    double serial_us = bench::time_us([&]() {
+        spe_device::decode_records(sb.buf.data(), sb.buf.size(), serial);
+    });
+    double parallel_us = bench::time_us([&]() {
+        consumed = spe_device::decode_records_parallel(sb.buf.data(), sb.buf.size(), parallel, 0, 1024 * 1024);
+    });
+
+    std::wcout << sb.buf.size() / (1024 * 1024) << L" MB serial " << serial_us << L" us, parallel ("
+        << std::thread::hardware_concurrency() << L" threads) " << parallel_us << L" us" << std::endl;
+
+    return consumed == sb.buf.size() && parallel.size() == records_num
+        && std::memcmp(serial.data(), parallel.data(), records_num * sizeof(struct spe_record)) == 0;
+}
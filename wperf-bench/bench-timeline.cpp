@@ -0,0 +1,72 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "wperf/timeline.h"
+#include "bench.h"
+
+// Cost and size of one timeline interval in CSV and `--timeline-binary` formats
+WPERF_BENCH(timeline_binary_vs_csv)
+{
+    // 128 cores x (cycle + 6 events), 1 metric per core, counters change a little between intervals
+    const size_t intervals = 2000, columns = 128 * 7, metric_columns = 128;
+
+    std::vector<uint64_t> row(columns);
+    std::vector<double> metrics(metric_columns, 1.234);
+    for (size_t i = 0; i < columns; i++)
+        row[i] = 1000000 + i * 37;
+
+    std::string csv, bin;
+    std::vector<uint64_t> prev;
+    csv.reserve(intervals * columns * 12);
+    bin.reserve(intervals * columns * 4);
+
+    double csv_us = bench::time_us([&]() {
+        for (size_t n = 0; n < intervals; n++)
+        {
+            row[n % columns] += n;
+            timeline::format_csv_row(csv, row, metrics);
+        }
+    });
+    double bin_us = bench::time_us([&]() {
+        for (size_t n = 0; n < intervals; n++)
+        {
+            row[n % columns] += n;
+            timeline::format_binary_row(bin, row, metrics, prev);
+        }
+    });
+
+    std::wcout << L"CSV: " << csv.size() / intervals << L" bytes, " << csv_us / double(intervals) << L" us per interval" << std::endl;
+    std::wcout << L"binary: " << bin.size() / intervals << L" bytes, " << bin_us / double(intervals) << L" us per interval" << std::endl;
+
+    return bin.size() * 2 < csv.size();
+}
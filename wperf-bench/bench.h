@@ -0,0 +1,76 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <vector>
+
+/* Benchmarks of wperf and driver hot paths, see README.md.
+
+   They are too slow (and too noisy) for `wperf-test`, so they live in this
+   console application. Every benchmark registers itself with WPERF_BENCH(),
+   prints its measurements to the standard output and returns false if
+   results it computed are wrong.
+*/
+namespace bench
+{
+    typedef bool (*bench_fn)();
+
+    struct entry
+    {
+        const wchar_t* name;
+        bench_fn fn;
+    };
+
+    inline std::vector<entry>& registry()
+    {
+        static std::vector<entry> benches;
+        return benches;
+    }
+
+    struct registrar
+    {
+        registrar(const wchar_t* name, bench_fn fn) { registry().push_back({ name, fn }); }
+    };
+
+    // Wall clock microseconds spent in `f()`
+    template <typename F>
+    double time_us(F f)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    }
+}
+
+#define WPERF_BENCH(name) \
+    static bool name(); \
+    static bench::registrar name##_registrar(L## #name, name); \
+    static bool name()
@@ -0,0 +1,187 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __cplusplus
+#define bool                _Bool
+#define true                TRUE
+#define false               FALSE
+#endif
+
+//
+// Broadcast barrier: rendezvous of all cores taking part in a control action
+// (e.g. `PMU_CTL_START`) so that the action is executed on all cores at
+// (almost) the same time.
+//
+// Driver queues one targeted DPC per core. Each DPC calls
+// `broadcast_barrier_wait()`, spins until all cores have arrived, records its
+// timestamp with `broadcast_barrier_record()`, executes the action and calls
+// `broadcast_barrier_complete()`. Only the last core to complete gets TRUE
+// and signals the waiting thread. The spread between the earliest and latest
+// recorded timestamps is the start skew of the action.
+//
+// Spinning in a DPC blocks the core, so waiting is bounded by `spin_limit`.
+// A core which gives up still executes the action, it is only counted in
+// `timeouts` so the caller can tell that the skew is not meaningful.
+//
+// Core which will never arrive (e.g. its DPC could not be queued) must
+// `broadcast_barrier_leave()` so that the remaining cores do not wait for it.
+//
+// This header is portable (no kernel-only APIs) so it can be unit tested
+// (and simulated outside Windows, see `wperf-scripts/broadcast-sim`) with
+// threads playing the role of cores.
+//
+
+#if !defined(_WIN32)
+#include <sched.h>
+#include <stdint.h>
+typedef int32_t     LONG;
+typedef int64_t     LONG64;
+typedef uint64_t    UINT64;
+#ifndef TRUE
+#define TRUE        1
+#define FALSE       0
+#endif
+#define InterlockedIncrement(p)                 __atomic_add_fetch((p), 1, __ATOMIC_SEQ_CST)
+#define InterlockedDecrement(p)                 __atomic_sub_fetch((p), 1, __ATOMIC_SEQ_CST)
+#define InterlockedCompareExchange64(p, x, c)   __sync_val_compare_and_swap((p), (c), (x))
+#define ReadAcquire(p)                          __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ReadAcquire64(p)                        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define WriteRelease(p, v)                      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define WriteRelease64(p, v)                    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define YieldProcessor()                        sched_yield()
+#endif
+
+#define BROADCAST_SPIN_LIMIT    (1ULL << 20)
+#define BROADCAST_TS_NONE       ((LONG64)0x7FFFFFFFFFFFFFFFLL)
+
+struct broadcast_barrier
+{
+    volatile LONG arrived;      //!< Cores which reached the barrier
+    volatile LONG completed;    //!< Cores which executed the action
+    volatile LONG timeouts;     //!< Cores which stopped waiting after `spin_limit` spins
+    volatile LONG count;        //!< Number of cores taking part
+    volatile LONG64 first_ts;   //!< Earliest recorded timestamp, `BROADCAST_TS_NONE` if none
+    volatile LONG64 last_ts;    //!< Latest recorded timestamp
+};
+
+/// <summary>
+/// Prepare barrier for `count` cores. Call before any DPC is queued.
+/// </summary>
+static __inline void broadcast_barrier_init(struct broadcast_barrier* barrier, LONG count)
+{
+    barrier->count = count;
+    barrier->timeouts = 0;
+    barrier->completed = 0;
+    barrier->first_ts = BROADCAST_TS_NONE;
+    barrier->last_ts = 0;
+    WriteRelease(&barrier->arrived, 0);
+}
+
+/// <summary>
+/// Arrive at the barrier and wait until all `count` cores have arrived.
+/// </summary>
+/// <param name="spin_limit">Max number of spins before giving up</param>
+/// <returns>FALSE if waiting timed out</returns>
+static __inline bool broadcast_barrier_wait(struct broadcast_barrier* barrier, UINT64 spin_limit)
+{
+    InterlockedIncrement(&barrier->arrived);
+
+    for (UINT64 spin = 0; ReadAcquire(&barrier->arrived) < ReadAcquire(&barrier->count); spin++)
+    {
+        if (spin >= spin_limit)
+        {
+            InterlockedIncrement(&barrier->timeouts);
+            return false;
+        }
+        YieldProcessor();
+    }
+    return true;
+}
+
+/// <summary>
+/// Fold timestamp of the calling core into the barrier min/max.
+/// </summary>
+static __inline void broadcast_barrier_record(struct broadcast_barrier* barrier, LONG64 ts)
+{
+    LONG64 cur;
+
+    cur = ReadAcquire64(&barrier->first_ts);
+    while (ts < cur)
+    {
+        LONG64 prev = InterlockedCompareExchange64(&barrier->first_ts, ts, cur);
+        if (prev == cur)
+            break;
+        cur = prev;
+    }
+
+    cur = ReadAcquire64(&barrier->last_ts);
+    while (ts > cur)
+    {
+        LONG64 prev = InterlockedCompareExchange64(&barrier->last_ts, ts, cur);
+        if (prev == cur)
+            break;
+        cur = prev;
+    }
+}
+
+/// <summary>
+/// Mark action on the calling core as done.
+/// </summary>
+/// <returns>TRUE for the last core to complete</returns>
+static __inline bool broadcast_barrier_complete(struct broadcast_barrier* barrier)
+{
+    return InterlockedIncrement(&barrier->completed) == ReadAcquire(&barrier->count);
+}
+
+/// <summary>
+/// Remove one core which will never arrive from the barrier.
+/// </summary>
+/// <returns>TRUE if all remaining cores have already completed, nobody else signals completion then</returns>
+static __inline bool broadcast_barrier_leave(struct broadcast_barrier* barrier)
+{
+    LONG count = InterlockedDecrement(&barrier->count);
+    return ReadAcquire(&barrier->completed) >= count;
+}
+
+/// <summary>
+/// Spread between earliest and latest recorded timestamps.
+/// </summary>
+/// <returns>0 if no timestamp was recorded</returns>
+static __inline UINT64 broadcast_barrier_skew(struct broadcast_barrier* barrier)
+{
+    LONG64 first = ReadAcquire64(&barrier->first_ts);
+    LONG64 last = ReadAcquire64(&barrier->last_ts);
+
+    if (first == BROADCAST_TS_NONE || last < first)
+        return 0;
+    return (UINT64)(last - first);
+}
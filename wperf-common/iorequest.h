@@ -29,7 +29,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "wperf-common\macros.h"
+#include "macros.h"
 
 #define MAX_GITVER_SIZE 32
 #define MAX_FEATURESTRING_SIZE 128
@@ -61,6 +61,15 @@ struct evt_hdr
 {
     enum evt_class evt_class;
     UINT16 num;
+#define EVT_HDR_FLAG_SCHED (0x1 << 0)   // `num` x struct evt_sched_attr follow `num` event indexes
+    UINT16 flags;
+};
+
+// Multiplexing attributes of assigned event, see wperf-common/mpxsched.h
+struct evt_sched_attr
+{
+    UINT16 group;       //!< Non-zero for event group members, group members are consecutive
+    UINT16 weight;      //!< Share of counter time, 0 never counted (e.g. padding)
 };
 
 struct hw_cfg
@@ -122,6 +131,9 @@ enum pmu_ctl_action
     PMU_CTL_SPE_GET_BUFFER,
     PMU_CTL_SPE_START,
     PMU_CTL_SPE_STOP,
+    PMU_CTL_SAMPLE_MAP,
+    PMU_CTL_SAMPLE_UNMAP,
+    PMU_CTL_READ_COUNTING_BATCH,
 };
 
 #define IOCTL_PMU_CTL_START                     CTL_CODE(WPERF_TYPE,  PMU_CTL_START,                METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
@@ -147,6 +159,9 @@ enum pmu_ctl_action
 #define IOCTL_PMU_CTL_SPE_GET_BUFFER            CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_GET_BUFFER,       METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 #define IOCTL_PMU_CTL_SPE_START                 CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_START,            METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 #define IOCTL_PMU_CTL_SPE_STOP                  CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_STOP,             METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_SAMPLE_MAP                CTL_CODE(WPERF_TYPE,  PMU_CTL_SAMPLE_MAP,           METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_SAMPLE_UNMAP              CTL_CODE(WPERF_TYPE,  PMU_CTL_SAMPLE_UNMAP,         METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_READ_COUNTING_BATCH       CTL_CODE(WPERF_TYPE,  PMU_CTL_READ_COUNTING_BATCH,  METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 
 enum lock_flag
 {
@@ -180,6 +195,7 @@ struct PMUSampleSummary
 {
     UINT64 sample_generated;
     UINT64 sample_dropped;
+    UINT64 timer_freq;                          // Generic timer frequency (CNTFRQ_EL0) in Hz, unit of `FrameChain::timestamp`
 };
 
 typedef struct
@@ -188,6 +204,8 @@ typedef struct
     UINT64 pc;
     UINT64 ov_flags;
     UINT32 spe_event_idx;
+    UINT32 cpu;                                 // Core which generated this sample
+    UINT64 timestamp;                           // Generic timer (CNTVCT_EL0) value when PMI was taken, 0 if not known
 } FrameChain;
 
 struct PMUCtlGetSampleHdr
@@ -201,6 +219,20 @@ struct PMUSamplePayload
     FrameChain payload[SAMPLE_CHAIN_BUFFER_SIZE];   
 };
 
+// Input of PMU_CTL_SAMPLE_MAP
+struct PMUCtlSampleMapHdr
+{
+    UINT32 core_idx;
+    UINT32 capacity;                            // Ring capacity in frames, 0 for SAMPLE_RING_BUFFER_SIZE, see sample_ring_capacity_clamp()
+};
+
+// Output of PMU_CTL_SAMPLE_MAP, per-core sample ring mapped into caller process
+struct PMUSampleRingMap
+{
+    UINT64 address;                             // User address of `struct sample_ring_shared`
+    UINT64 size;                                // Size of mapping in bytes
+};
+
 struct pmu_ctl_ver_hdr
 {
     struct version_info version;
@@ -217,15 +249,32 @@ struct pmu_ctl_hdr
     struct pmu_ctl_cores_count_hdr cores_idx;
     LONG period;
 	UINT8 dmc_idx;
+#define CTL_PERIOD_ADAPTIVE (0x1 << 0)      // PMU_CTL_START: `period` is the longest period, driver picks shorter one
+	UINT8 period_flags;
 #define CTL_FLAG_CORE (0x1 << 0)
 #define CTL_FLAG_DSU  (0x1 << 1)
 #define CTL_FLAG_DMC  (0x1 << 2)
 #define CTL_FLAG_SPE  (0x1 << 3)
 #define CTL_FLAG_MAX  (0x1 << 4)
 #define CTRL_FLAG_VALID(flag_s) (flag_s < CTL_FLAG_MAX)
+#define CTL_FLAG_LIVE (0x1 << 8)            // PMU_CTL_READ_COUNTING_BATCH with CTL_FLAG_CORE: read counters while they keep counting
 	UINT32 flags;
 };
 
+// Optional output of PMU_CTL_START/STOP/RESET, filled if output buffer is big enough
+struct pmu_ctl_out
+{
+    UINT64 skew;            //!< Spread of per-core action timestamps, in generic timer ticks
+    UINT64 timer_freq;      //!< Generic timer frequency (CNTFRQ_EL0) in Hz
+    UINT32 cores_count;     //!< Cores which executed the action
+    UINT32 timeouts;        //!< Cores which did not wait for all other cores
+    UINT64 dpc_ticks;       //!< PMU_CTL_STOP: time spent in counting timer DPCs of all cores, in generic timer ticks
+    UINT64 dpc_max_ticks;   //!< PMU_CTL_STOP: longest counting timer DPC
+    UINT64 dpc_count;       //!< PMU_CTL_STOP: number of counting timer DPCs
+    UINT32 period_min;      //!< PMU_CTL_STOP: shortest timer period used, in ms
+    UINT32 period_max;      //!< PMU_CTL_STOP: longest timer period used, in ms
+};
+
 struct pmu_ctl_evt_assign_hdr
 {
     UINT32 core_idx;
@@ -239,6 +288,8 @@ struct pmu_event_usr
     UINT64 filter_bits;
     UINT64 value;
     UINT64 scheduled;
+    UINT64 delta_min;       //!< Smallest value counted in one multiplexing round
+    UINT64 delta_max;       //!< Largest value counted in one multiplexing round
 };
 
 typedef struct pmu_event_read_out
@@ -51,7 +51,14 @@
 
 #define AARCH64_MAX_HWC_SUPP                31
 
-#define SAMPLE_CHAIN_BUFFER_SIZE            128
+#define SAMPLE_CHAIN_BUFFER_SIZE            512     // Max frames returned by one PMU_CTL_SAMPLE_GET
+
+// Per-core sample ring capacity (frames), must be a power of two
+#ifndef SAMPLE_RING_BUFFER_SIZE
+#define SAMPLE_RING_BUFFER_SIZE             8192
+#endif
+#define SAMPLE_RING_MIN_SIZE                1024    // Capacities PMU_CTL_SAMPLE_MAP can request
+#define SAMPLE_RING_MAX_SIZE                65536
 
 #define MAX_PROCESSES					1024
 
@@ -62,7 +69,8 @@
 #define FILTER_BIT_EXCL_EL1                 (1U << 31)
 
 #define PMU_CTL_START_PERIOD                100     // Default (and max) value
-#define PMU_CTL_START_PERIOD_MIN            10      // Minimal value for period
+#define PMU_CTL_START_PERIOD_MIN            1       // Minimal value for period
+#define PMU_CTL_START_PERIOD_FINE           16      // Shorter periods need finer system timer resolution than default clock tick
 
 // Define how many fixed counters are now handled
 // Currently we are having "cycles" as 1 (only) fixed counter
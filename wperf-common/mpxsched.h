@@ -0,0 +1,311 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#if !defined(_WIN32)
+#include <stdint.h>
+#include <wchar.h>
+typedef uint8_t     UINT8;
+typedef uint16_t    UINT16;
+typedef uint32_t    UINT32;
+typedef uint64_t    UINT64;
+typedef int32_t     LONG;
+typedef wchar_t     WCHAR;
+#ifndef TRUE
+#define TRUE        1
+#define FALSE       0
+#endif
+#endif
+
+#include "iorequest.h"
+
+#ifndef __cplusplus
+#define bool                _Bool
+#define true                TRUE
+#define false               FALSE
+#endif
+
+//
+// Multiplexing scheduler: picks which events occupy the hardware counters
+// in the next multiplexing round.
+//
+// Events are scheduled in units. A unit is either a single event or an event
+// group (consecutive events with the same non-zero `evt_sched_attr::group`),
+// all members of a group are always counted together. Units are bin-packed
+// into `counters` slots with stride scheduling: every unit has a virtual
+// time `pass`, units are visited in ascending `pass` order and first-fit
+// packed, and each scheduled unit advances its `pass` by
+// `MPX_SCHED_STRIDE / weight`. So a unit with weight 2 is counted twice as
+// often as a unit with weight 1, and a unit with weight 0 (e.g. padding)
+// never takes a counter. The unit with the lowest `pass` always fits into
+// empty counters, so no unit starves.
+//
+// With no groups and equal weights this is the same round-robin rotation
+// as before, starting from the first event.
+//
+// Every event keeps `scheduled` (running) rounds next to the rounds it was
+// enabled, see `mpx_scale()` and `mpx_scale_range()`.
+//
+// This header is portable (no kernel-only APIs) so it can be unit tested
+// and replayed with synthetic counter streams in user space.
+//
+
+#define MPX_SCHED_STRIDE        (1ULL << 20)
+#define MPX_SCHED_MAX_WEIGHT    64
+#define MPX_SCHED_DEFAULT_WEIGHT 1
+
+struct mpx_sched_unit
+{
+    UINT64 pass;        //!< Virtual time, lowest `pass` is packed first
+    UINT16 first;       //!< Index of first event of the unit
+    UINT16 size;        //!< Number of events (counters) in the unit
+    UINT16 weight;      //!< Share of counter time, 0 never scheduled
+    UINT16 visited;     //!< Scratch flag used by `mpx_sched_next()`
+};
+
+struct mpx_sched
+{
+    UINT32 counters;                //!< Number of counters available each round
+    UINT32 units_num;
+    UINT32 units_max;               //!< Capacity of `units`
+    struct mpx_sched_unit* units;   //!< Caller provided storage
+};
+
+/// <summary>
+/// Build units of `events_num` events. `attrs` can be NULL, then each event
+/// is its own unit with default weight.
+/// </summary>
+/// <param name="sched">Scheduler to initialize</param>
+/// <param name="units">Storage for at least `events_num` units</param>
+/// <param name="units_max">Capacity of `units`</param>
+/// <param name="counters">Number of counters available each round</param>
+/// <param name="attrs">Optional group and weight of each event</param>
+/// <param name="events_num">Number of events</param>
+/// <returns>FALSE if arguments are invalid or a group does not fit into `counters`</returns>
+static __inline bool mpx_sched_init(struct mpx_sched* sched, struct mpx_sched_unit* units, UINT32 units_max,
+    UINT32 counters, const struct evt_sched_attr* attrs, UINT32 events_num)
+{
+    if (!sched || !units || !counters || events_num > units_max)
+        return false;
+
+    sched->counters = counters;
+    sched->units = units;
+    sched->units_max = units_max;
+    sched->units_num = 0;
+
+    for (UINT32 i = 0; i < events_num; i++)
+    {
+        UINT16 group = attrs ? attrs[i].group : 0;
+        UINT16 weight = attrs ? attrs[i].weight : MPX_SCHED_DEFAULT_WEIGHT;
+        struct mpx_sched_unit* last = sched->units_num ? &units[sched->units_num - 1] : NULL;
+
+        if (weight > MPX_SCHED_MAX_WEIGHT)
+            weight = MPX_SCHED_MAX_WEIGHT;
+
+        if (group && last && attrs[last->first].group == group)
+        {
+            // Group member: extend last unit, group runs as often as its heaviest member
+            if (last->size >= counters)
+                return false;
+            last->size++;
+            if (weight > last->weight)
+                last->weight = weight;
+            continue;
+        }
+
+        struct mpx_sched_unit* unit = &units[sched->units_num++];
+        unit->pass = 0;
+        unit->first = (UINT16)i;
+        unit->size = 1;
+        unit->weight = weight;
+        unit->visited = 0;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Choose events for the next round and advance virtual time of chosen units.
+/// </summary>
+/// <param name="sched">Scheduler</param>
+/// <param name="slots">Output, event index for each counter</param>
+/// <param name="slots_max">Capacity of `slots`, at least `sched->counters`</param>
+/// <returns>Number of counters used</returns>
+static __inline UINT32 mpx_sched_next(struct mpx_sched* sched, UINT16* slots, UINT32 slots_max)
+{
+    UINT32 free = sched->counters < slots_max ? sched->counters : slots_max;
+    UINT32 used = 0;
+
+    for (UINT32 u = 0; u < sched->units_num; u++)
+        sched->units[u].visited = 0;
+
+    while (free)
+    {
+        struct mpx_sched_unit* best = NULL;
+
+        // Lowest `pass` first, lower index on tie
+        for (UINT32 u = 0; u < sched->units_num; u++)
+        {
+            struct mpx_sched_unit* unit = &sched->units[u];
+            if (unit->visited || !unit->weight)
+                continue;
+            if (!best || unit->pass < best->pass)
+                best = unit;
+        }
+
+        if (!best)
+            break;
+
+        best->visited = 1;
+        if (best->size > free)
+            continue;
+
+        for (UINT16 k = 0; k < best->size; k++)
+            slots[used++] = best->first + k;
+        free -= best->size;
+        best->pass += MPX_SCHED_STRIDE / best->weight;
+    }
+
+    return used;
+}
+
+/// <summary>
+/// Update running statistics of event counted in the last round.
+/// </summary>
+/// <param name="delta">Counter value of the last round</param>
+/// <param name="scheduled">Rounds counted so far, incremented</param>
+static __inline void mpx_sched_account(UINT64 delta, UINT64* value, UINT64* scheduled, UINT64* delta_min, UINT64* delta_max)
+{
+    if (*scheduled == 0 || delta < *delta_min)
+        *delta_min = delta;
+    if (*scheduled == 0 || delta > *delta_max)
+        *delta_max = delta;
+    *value += delta;
+    *scheduled += 1;
+}
+
+/// <summary>
+/// Estimate event count over `enabled` rounds when it was counted in `running` rounds.
+/// </summary>
+/// <returns>0 if event was never counted</returns>
+static __inline UINT64 mpx_scale(UINT64 value, UINT64 running, UINT64 enabled)
+{
+    if (!running)
+        return 0;
+    if (running >= enabled)
+        return value;
+    return (UINT64)((double)value * (double)enabled / (double)running);
+}
+
+/// <summary>
+/// Bounds of event count over `enabled` rounds: each not counted round adds
+/// at least `delta_min` and at most `delta_max`, the smallest and largest
+/// delta of counted rounds. Bounds hold while the event rate of not counted
+/// rounds stays within what counted rounds saw. Scheduler spreads counted
+/// rounds of each unit evenly, so counted rounds sample every workload phase
+/// longer than one rotation, see wperf-bench/bench-mpxsched.cpp.
+/// </summary>
+static __inline void mpx_scale_range(UINT64 value, UINT64 running, UINT64 enabled, UINT64 delta_min, UINT64 delta_max, UINT64* lo, UINT64* hi)
+{
+    UINT64 missed = running < enabled ? enabled - running : 0;
+
+    *lo = value + missed * delta_min;
+    *hi = value + missed * delta_max;
+}
+
+//
+// Adaptive multiplexing period (`CTL_PERIOD_ADAPTIVE`).
+//
+// The period is picked so all events are counted at least once within the
+// longest period: 30 events on 6 counters need 5 rounds, so with 100 ms
+// longest period each round lasts 20 ms. While the core is idle its cycle
+// counter barely moves and there is nothing to sample, so the period is
+// doubled each round up to the longest period until the core is busy again.
+//
+
+#define MPX_PERIOD_IDLE_SHIFT   4   // Core is idle below 1/16 of peak cycle rate
+
+/// <summary>
+/// Number of rounds needed to count every scheduled event at least once.
+/// </summary>
+static __inline UINT32 mpx_sched_rotation(const struct mpx_sched* sched)
+{
+    UINT32 events = 0;
+
+    for (UINT32 u = 0; u < sched->units_num; u++)
+        if (sched->units[u].weight)
+            events += sched->units[u].size;
+
+    return events ? (events + sched->counters - 1) / sched->counters : 1;
+}
+
+/// <summary>
+/// Period of a busy core, see `mpx_sched_rotation()`.
+/// </summary>
+/// <param name="rotation">Rounds of one rotation</param>
+/// <param name="period_min">Shortest period allowed</param>
+/// <param name="period_max">Longest period, one rotation should fit into it</param>
+static __inline LONG mpx_period_target(UINT32 rotation, LONG period_min, LONG period_max)
+{
+    LONG period = rotation > 1 ? period_max / (LONG)rotation : period_max;
+
+    return period < period_min ? period_min : period;
+}
+
+/// <summary>
+/// Check if core was idle in the last round.
+/// </summary>
+/// <param name="cycles">Cycle counter delta of the last round</param>
+/// <param name="ticks">Generic timer delta of the last round</param>
+/// <param name="peak_rate">Highest cycle rate seen so far, updated</param>
+static __inline bool mpx_period_idle(UINT64 cycles, UINT64 ticks, UINT64* peak_rate)
+{
+    if (!ticks)
+        return false;
+
+    UINT64 rate = (cycles << MPX_PERIOD_IDLE_SHIFT) / ticks;
+
+    if (rate > *peak_rate)
+        *peak_rate = rate;
+
+    return rate < (*peak_rate >> MPX_PERIOD_IDLE_SHIFT);
+}
+
+/// <summary>
+/// Period of the next round: `target` when core is busy, backs off to `period_max` when idle.
+/// </summary>
+static __inline LONG mpx_period_next(LONG period, LONG target, LONG period_max, bool idle)
+{
+    if (!idle)
+        return target;
+
+    return period * 2 < period_max ? period * 2 : period_max;
+}
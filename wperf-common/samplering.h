@@ -0,0 +1,264 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "wperf-common\macros.h"
+#include "wperf-common\iorequest.h"
+
+#ifndef __cplusplus
+#define bool                _Bool
+#define true                TRUE
+#define false               FALSE
+#endif
+
+//
+// Per-core single-producer / single-consumer ring of sampled frames.
+//
+// Producer is `arm64_pmi_ISR` running on the sampled core. Consumer is either
+// the `PMU_CTL_SAMPLE_GET` handler (sequential IOCTL queue) or, when ring is
+// mapped with `PMU_CTL_SAMPLE_MAP`, wperf reading frames in place.
+// Indices are free running 64-bit counters, slot is `index & (capacity - 1)`.
+// Only producer writes `head` and only consumer writes `tail`, so no lock is
+// required.
+//
+// `struct sample_ring_shared` is what user space can see (and write!), so the
+// producer keeps its own copy of `head` and `capacity` in `struct sample_ring`
+// and never trusts values read back from shared memory.
+//
+// `head`, `tail` and frames are on separate cache lines. Producer also keeps
+// last `tail` it has seen and reads the shared one only when ring looks full,
+// so consumer's line is not pulled to the ISR core on every push.
+//
+// This header is portable (no kernel-only APIs) so it can be unit tested
+// together with a simulated ISR producer in user space.
+//
+
+#pragma warning(push)
+#pragma warning(disable:4200)
+struct sample_ring_shared
+{
+    DECLSPEC_CACHEALIGN volatile LONG64 head;       //!< Next slot to be written by producer
+    DECLSPEC_CACHEALIGN volatile LONG64 tail;       //!< Next slot to be read by consumer
+    UINT64 capacity;                                //!< Number of frames, power of two
+    UINT64 reserved;
+    DECLSPEC_CACHEALIGN FrameChain frames[0];
+};
+#pragma warning(pop)
+
+#define SAMPLE_RING_SHARED_SIZE(capacity)   (FIELD_OFFSET(struct sample_ring_shared, frames) + sizeof(FrameChain) * (capacity))
+
+struct sample_ring
+{
+    LONG64 head;                        //!< Producer private copy of `shared->head`
+    LONG64 tail;                        //!< Last `shared->tail` seen by producer, refreshed when ring looks full
+    UINT64 capacity;                    //!< Private copy of `shared->capacity`
+    struct sample_ring_shared* shared;  //!< Indices and storage, `SAMPLE_RING_SHARED_SIZE(capacity)` bytes
+};
+
+/// <summary>
+/// Check if `capacity` can be used as sample ring capacity (non-zero power of two).
+/// </summary>
+static __inline bool sample_ring_capacity_valid(UINT64 capacity)
+{
+    return capacity && !(capacity & (capacity - 1));
+}
+
+/// <summary>
+/// Capacity used for `requested` frames: rounded up to a power of two and
+/// clamped to SAMPLE_RING_MIN_SIZE..SAMPLE_RING_MAX_SIZE, 0 is SAMPLE_RING_BUFFER_SIZE.
+/// </summary>
+static __inline UINT64 sample_ring_capacity_clamp(UINT64 requested)
+{
+    UINT64 capacity = SAMPLE_RING_MIN_SIZE;
+
+    if (!requested)
+        return SAMPLE_RING_BUFFER_SIZE;
+
+    while (capacity < requested && capacity < SAMPLE_RING_MAX_SIZE)
+        capacity <<= 1;
+    return capacity;
+}
+
+/// <summary>
+/// Bind ring to `shared` storage and clear indices.
+/// </summary>
+/// <param name="ring">Ring to initialize</param>
+/// <param name="shared">Storage of `SAMPLE_RING_SHARED_SIZE(capacity)` bytes</param>
+/// <param name="capacity">Number of frames, must be power of two</param>
+/// <returns>FALSE if arguments are invalid</returns>
+static __inline bool sample_ring_init(struct sample_ring* ring, struct sample_ring_shared* shared, UINT64 capacity)
+{
+    if (!ring || !shared || !sample_ring_capacity_valid(capacity))
+        return false;
+
+    ring->shared = shared;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    shared->capacity = capacity;
+    shared->reserved = 0;
+    shared->head = 0;
+    shared->tail = 0;
+    return true;
+}
+
+/// <summary>
+/// Drop all frames in the ring. Call only when producer is quiescent.
+/// </summary>
+static __inline void sample_ring_reset(struct sample_ring* ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->shared->capacity = ring->capacity;
+    WriteRelease64(&ring->shared->tail, 0);
+    WriteRelease64(&ring->shared->head, 0);
+}
+
+/// <summary>
+/// Number of frames ready to be consumed.
+/// </summary>
+static __inline UINT64 sample_ring_count(struct sample_ring* ring)
+{
+    UINT64 n = (UINT64)(ReadAcquire64(&ring->shared->head) - ReadAcquire64(&ring->shared->tail));
+    return n < ring->capacity ? n : ring->capacity;
+}
+
+/// <summary>
+/// Producer side: store one frame. Never blocks.
+/// </summary>
+/// <returns>FALSE if ring is full and frame was dropped</returns>
+static __inline bool sample_ring_push(struct sample_ring* ring, const FrameChain* frame)
+{
+    LONG64 head = ring->head;
+
+    // Consumer only moves `tail` forward, so cached value is safe to use until ring looks full.
+    // Also catches bogus `tail` written by consumer (head - tail "negative")
+    if ((UINT64)(head - ring->tail) >= ring->capacity)
+    {
+        ring->tail = ReadAcquire64(&ring->shared->tail);
+        if ((UINT64)(head - ring->tail) >= ring->capacity)
+            return false;
+    }
+
+    ring->shared->frames[(UINT64)head & (ring->capacity - 1)] = *frame;
+    ring->head = head + 1;
+    WriteRelease64(&ring->shared->head, ring->head);    // Publish frame to consumer
+    return true;
+}
+
+/// <summary>
+/// Copy up to `max_frames` frames from `shared` to `out` and release them
+/// to the producer. `capacity` is the trusted ring capacity.
+/// </summary>
+static __inline UINT64 sample_ring_copy_out(struct sample_ring_shared* shared, UINT64 capacity, FrameChain* out, UINT64 max_frames)
+{
+    LONG64 tail = ReadNoFence64(&shared->tail);
+    LONG64 head = ReadAcquire64(&shared->head);
+    UINT64 avail = (UINT64)(head - tail);
+    UINT64 n = avail < max_frames ? avail : max_frames;
+    UINT64 mask = capacity - 1;
+
+    if (n > capacity)
+        n = capacity;
+
+    // Copy in at most two contiguous chunks (ring may wrap)
+    UINT64 first = (UINT64)tail & mask;
+    UINT64 chunk = (capacity - first) < n ? (capacity - first) : n;
+
+    for (UINT64 i = 0; i < chunk; i++)
+        out[i] = shared->frames[first + i];
+    for (UINT64 i = chunk; i < n; i++)
+        out[i] = shared->frames[i - chunk];
+
+    WriteRelease64(&shared->tail, tail + (LONG64)n); // Release slots to producer
+    return n;
+}
+
+/// <summary>
+/// Consumer side (driver): move up to `max_frames` frames from ring to `out`.
+/// </summary>
+/// <returns>Number of frames copied to `out`</returns>
+static __inline UINT64 sample_ring_pop_bulk(struct sample_ring* ring, FrameChain* out, UINT64 max_frames)
+{
+    return sample_ring_copy_out(ring->shared, ring->capacity, out, max_frames);
+}
+
+//
+// Consumer side for a ring mapped into user space. Frames can be processed
+// in place (zero-copy) with `sample_ring_shared_peek()` followed by
+// `sample_ring_shared_consume()`.
+//
+
+/// <summary>
+/// Check if mapped ring header looks sane.
+/// </summary>
+static __inline bool sample_ring_shared_valid(const struct sample_ring_shared* shared)
+{
+    return shared && sample_ring_capacity_valid(shared->capacity);
+}
+
+/// <summary>
+/// Get longest contiguous run of frames ready to be consumed.
+/// </summary>
+/// <param name="shared">Mapped ring</param>
+/// <param name="frames">Set to first ready frame</param>
+/// <returns>Number of contiguous frames at `*frames`, 0 if ring is empty</returns>
+static __inline UINT64 sample_ring_shared_peek(struct sample_ring_shared* shared, const FrameChain** frames)
+{
+    LONG64 tail = ReadNoFence64(&shared->tail);
+    LONG64 head = ReadAcquire64(&shared->head);
+    UINT64 avail = (UINT64)(head - tail);
+    UINT64 first = (UINT64)tail & (shared->capacity - 1);
+    UINT64 chunk = shared->capacity - first;
+
+    if (avail > shared->capacity)
+        avail = shared->capacity;
+
+    *frames = &shared->frames[first];
+    return avail < chunk ? avail : chunk;
+}
+
+/// <summary>
+/// Release `n` frames returned by `sample_ring_shared_peek()` to the producer.
+/// </summary>
+static __inline void sample_ring_shared_consume(struct sample_ring_shared* shared, UINT64 n)
+{
+    WriteRelease64(&shared->tail, ReadNoFence64(&shared->tail) + (LONG64)n);
+}
+
+/// <summary>
+/// Consumer side (mapped ring): move up to `max_frames` frames to `out`.
+/// </summary>
+/// <returns>Number of frames copied to `out`</returns>
+static __inline UINT64 sample_ring_shared_pop_bulk(struct sample_ring_shared* shared, FrameChain* out, UINT64 max_frames)
+{
+    return sample_ring_copy_out(shared, shared->capacity, out, max_frames);
+}
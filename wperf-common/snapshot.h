@@ -0,0 +1,240 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "wperf-common\macros.h"
+#include "wperf-common\iorequest.h"
+
+#ifndef __cplusplus
+#define bool                _Bool
+#define true                TRUE
+#define false               FALSE
+#endif
+
+//
+// Counting snapshot: output of `PMU_CTL_READ_COUNTING_BATCH`.
+//
+// One request returns counters of all requested cores. Instead of a fixed
+// size `ReadOut` / `DSUReadOut` per core, each core is stored as a variable
+// length entry with only `evt_num` used events:
+//
+// +---------------------------------------------------+
+// | struct counting_snapshot_hdr    size, entry_num   |
+// +---------------------------------------------------+
+// | struct counting_snapshot_entry  core_idx, evt_num |
+// |                                 round             |
+// | struct pmu_event_usr            evts[evt_num]     |
+// +---------------------------------------------------+
+// | ...                                               |
+//
+// Writer (driver) and reader (wperf) are portable (no kernel-only APIs) so
+// they can be unit tested in user space. Reader never trusts sizes stored in
+// the snapshot and checks every entry against the received buffer size.
+//
+
+#pragma warning(push)
+#pragma warning(disable:4200)
+struct counting_snapshot_hdr
+{
+    UINT32 size;                    //!< Bytes used by snapshot, including this header
+    UINT32 entry_num;               //!< Number of entries following the header
+};
+
+struct counting_snapshot_entry
+{
+    UINT32 core_idx;
+    UINT32 evt_num;                 //!< Number of `evts` following entry header
+    UINT64 round;
+    struct pmu_event_usr evts[0];
+};
+#pragma warning(pop)
+
+#define COUNTING_SNAPSHOT_ENTRY_SIZE(evt_num)   (FIELD_OFFSET(struct counting_snapshot_entry, evts) + sizeof(struct pmu_event_usr) * (evt_num))
+#define COUNTING_SNAPSHOT_MAX_SIZE(cores_num, max_evt_num) \
+    (sizeof(struct counting_snapshot_hdr) + (cores_num) * COUNTING_SNAPSHOT_ENTRY_SIZE(max_evt_num))
+
+/// <summary>
+/// Initialize empty snapshot in `buf`.
+/// </summary>
+/// <returns>Snapshot header or NULL if `buf_size` is too small</returns>
+static __inline struct counting_snapshot_hdr* counting_snapshot_init(void* buf, UINT32 buf_size)
+{
+    struct counting_snapshot_hdr* hdr = (struct counting_snapshot_hdr*)buf;
+
+    if (!buf || buf_size < sizeof(struct counting_snapshot_hdr))
+        return NULL;
+
+    hdr->size = sizeof(struct counting_snapshot_hdr);
+    hdr->entry_num = 0;
+    return hdr;
+}
+
+/// <summary>
+/// Writer side: reserve entry for `evt_num` events at the end of snapshot.
+/// Caller fills `evts` of returned entry.
+/// </summary>
+/// <returns>New entry or NULL if it does not fit in `buf_size` bytes</returns>
+static __inline struct counting_snapshot_entry* counting_snapshot_add(struct counting_snapshot_hdr* hdr, UINT32 buf_size,
+    UINT32 core_idx, UINT32 evt_num, UINT64 round)
+{
+    UINT64 entry_size = COUNTING_SNAPSHOT_ENTRY_SIZE((UINT64)evt_num);
+    struct counting_snapshot_entry* entry;
+
+    if (hdr->size > buf_size || entry_size > (UINT64)(buf_size - hdr->size))
+        return NULL;
+
+    entry = (struct counting_snapshot_entry*)((UINT8*)hdr + hdr->size);
+    entry->core_idx = core_idx;
+    entry->evt_num = evt_num;
+    entry->round = round;
+
+    hdr->size += (UINT32)entry_size;
+    hdr->entry_num++;
+    return entry;
+}
+
+/// <summary>
+/// Reader side: check header of snapshot received in `received` bytes.
+/// </summary>
+static __inline bool counting_snapshot_valid(const struct counting_snapshot_hdr* hdr, UINT64 received)
+{
+    return hdr && received >= sizeof(struct counting_snapshot_hdr)
+        && hdr->size >= sizeof(struct counting_snapshot_hdr) && hdr->size <= received;
+}
+
+/// <summary>
+/// Reader side: get entry following `prev` (or first entry if `prev` is NULL).
+/// Call only on snapshot accepted by `counting_snapshot_valid()`.
+/// </summary>
+/// <returns>Next entry or NULL if there are no more (or entry is malformed)</returns>
+static __inline const struct counting_snapshot_entry* counting_snapshot_next(const struct counting_snapshot_hdr* hdr,
+    const struct counting_snapshot_entry* prev)
+{
+    UINT64 offset = prev ? (UINT64)((const UINT8*)prev - (const UINT8*)hdr) + COUNTING_SNAPSHOT_ENTRY_SIZE((UINT64)prev->evt_num)
+                         : sizeof(struct counting_snapshot_hdr);
+    const struct counting_snapshot_entry* entry;
+
+    if (offset + FIELD_OFFSET(struct counting_snapshot_entry, evts) > hdr->size)
+        return NULL;
+
+    entry = (const struct counting_snapshot_entry*)((const UINT8*)hdr + offset);
+    if (offset + COUNTING_SNAPSHOT_ENTRY_SIZE((UINT64)entry->evt_num) > hdr->size)
+        return NULL;
+
+    return entry;
+}
+
+/// <summary>
+/// Reader side: check whole snapshot received in `received` bytes. Every entry
+/// must be within the snapshot, for core below `cores_num` with at most
+/// `max_evt_num` events, and there must be `entry_num` entries.
+/// </summary>
+static __inline bool counting_snapshot_check(const struct counting_snapshot_hdr* hdr, UINT64 received, UINT32 cores_num, UINT32 max_evt_num)
+{
+    const struct counting_snapshot_entry* entry;
+    UINT32 entry_num = 0;
+
+    if (!counting_snapshot_valid(hdr, received))
+        return false;
+
+    for (entry = counting_snapshot_next(hdr, NULL); entry; entry = counting_snapshot_next(hdr, entry), entry_num++)
+    {
+        if (entry->core_idx >= cores_num || entry->evt_num > max_evt_num)
+            return false;
+    }
+
+    return entry_num == hdr->entry_num;
+}
+
+/// <summary>
+/// Reader side: copy `entry` of snapshot accepted by `counting_snapshot_check()`
+/// to `ReadOut` / `DSUReadOut` fields.
+/// </summary>
+static __inline void counting_snapshot_copy(const struct counting_snapshot_entry* entry, UINT32* evt_num, UINT64* round, struct pmu_event_usr* evts)
+{
+    UINT32 j;
+
+    *evt_num = entry->evt_num;
+    *round = entry->round;
+    for (j = 0; j < entry->evt_num; j++)
+        evts[j] = entry->evts[j];
+}
+
+//
+// Live snapshot: `PMU_CTL_READ_COUNTING_BATCH` with `CTL_FLAG_LIVE`.
+//
+// Counters are not stopped. Each core adds values counted by its hardware
+// counters since the last timer DPC to values already folded in, so every
+// reading is a running total. Counting interval is the difference of two
+// readings, nothing counted between intervals is lost. The round in flight
+// is counted in `round` and in `scheduled` of events counting in it, the same
+// way the next timer DPC counts it, so values and their scaling cover the same
+// rounds. As that round is partial, scaled values of events not counting in it
+// are extrapolated over at most one round more than elapsed. `delta_min` and
+// `delta_max` stay as they are (since the counting started), a looser but
+// valid bound.
+//
+
+/// <summary>
+/// Difference of two readings of a running total. `cur` below `prev`
+/// means the total was reset in between, so all of `cur` is new.
+/// </summary>
+static __inline UINT64 counting_snapshot_delta(UINT64 cur, UINT64 prev)
+{
+    return cur >= prev ? cur - prev : cur;
+}
+
+/// <summary>
+/// Reader side: turn live reading `evts` (`evt_num` events, `*round`) into
+/// counts since live reading `base`. If events were reassigned or counting
+/// was reset in between, `evts` are counts since the reset and kept as they are.
+/// </summary>
+static __inline void counting_snapshot_diff(struct pmu_event_usr* evts, UINT32 evt_num, UINT64* round,
+    const struct pmu_event_usr* base, UINT32 base_num, UINT64 base_round)
+{
+    UINT32 j;
+
+    if (evt_num != base_num || *round < base_round)
+        return;
+
+    for (j = 0; j < evt_num; j++)
+    {
+        if (evts[j].event_idx != base[j].event_idx)
+            return;
+    }
+
+    for (j = 0; j < evt_num; j++)
+    {
+        evts[j].value = counting_snapshot_delta(evts[j].value, base[j].value);
+        evts[j].scheduled = counting_snapshot_delta(evts[j].scheduled, base[j].scheduled);
+    }
+    *round -= base_round;
+}
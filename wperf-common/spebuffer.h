@@ -0,0 +1,259 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "wperf-common\macros.h"
+
+#ifndef __cplusplus
+#define bool                _Bool
+#define true                TRUE
+#define false               FALSE
+#endif
+
+//
+// Per-core double-buffered SPE capture.
+//
+// Each core owns SPE_DBUF_COUNT profiling buffers. Hardware (PMBPTR_EL1) always
+// writes into the ACTIVE buffer. When the ACTIVE buffer is (nearly) full the
+// driver swaps hardware to a FREE buffer and the old one becomes FULL, waiting
+// for user space to drain it. If no FREE buffer is available capture is
+// paused (stalled) until a FULL buffer is drained, and then resumed.
+//
+//      FREE --activate--> ACTIVE --swap--> FULL --drained--> FREE
+//
+// Bytes are drained in capture order: FULL buffers (oldest first), then the
+// part of ACTIVE buffer written so far. The driver serializes all calls for
+// one core (SPE DPC and IOCTL handlers) with a per-core spin lock.
+//
+// This header is portable (no kernel-only APIs or system registers) so the
+// state machine can be unit tested with a simulated SPE writer in user space.
+//
+
+#define SPE_DBUF_COUNT      2
+#define SPE_DBUF_NONE       ((UINT32)-1)
+
+enum spe_dbuf_state
+{
+    SPE_DBUF_FREE = 0,      //!< Empty, can be given to hardware
+    SPE_DBUF_ACTIVE,        //!< Hardware writes to it
+    SPE_DBUF_FULL           //!< Filled, waiting to be drained
+};
+
+struct spe_dbuf
+{
+    UINT8* base[SPE_DBUF_COUNT];            //!< Buffer storage
+    UINT64 size;                            //!< Bytes in each buffer, hardware limit is `base + size`
+    UINT64 fill[SPE_DBUF_COUNT];            //!< Bytes written by hardware, for ACTIVE as of last spe_dbuf_pending()
+    UINT64 drained[SPE_DBUF_COUNT];         //!< Bytes already copied out
+    UINT64 seq[SPE_DBUF_COUNT];             //!< Activation order, lower is older
+    enum spe_dbuf_state state[SPE_DBUF_COUNT];
+    UINT32 active;                          //!< Buffer hardware writes to, SPE_DBUF_NONE when stalled
+    UINT64 next_seq;
+    UINT64 swaps;                           //!< Times hardware moved to a spare buffer
+    UINT64 stalls;                          //!< Times capture paused, no spare buffer
+};
+
+static __inline UINT8* spe_dbuf_activate(struct spe_dbuf* db, UINT32 idx)
+{
+    db->state[idx] = SPE_DBUF_ACTIVE;
+    db->fill[idx] = 0;
+    db->drained[idx] = 0;
+    db->seq[idx] = db->next_seq++;
+    db->active = idx;
+    return db->base[idx];
+}
+
+static __inline UINT32 spe_dbuf_find_free(const struct spe_dbuf* db)
+{
+    for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+        if (db->state[i] == SPE_DBUF_FREE)
+            return i;
+    return SPE_DBUF_NONE;
+}
+
+/// <summary>
+/// Bind `SPE_DBUF_COUNT` buffers of `size` bytes each and activate the first one.
+/// </summary>
+/// <returns>Address to program into PMBPTR_EL1, NULL if arguments are invalid</returns>
+static __inline UINT8* spe_dbuf_init(struct spe_dbuf* db, UINT8* const* base, UINT64 size)
+{
+    if (!db || !base || !size)
+        return NULL;
+
+    for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+    {
+        if (!base[i])
+            return NULL;
+        db->base[i] = base[i];
+        db->state[i] = SPE_DBUF_FREE;
+        db->fill[i] = 0;
+        db->drained[i] = 0;
+        db->seq[i] = 0;
+    }
+    db->size = size;
+    db->next_seq = 0;
+    db->swaps = 0;
+    db->stalls = 0;
+    return spe_dbuf_activate(db, 0);
+}
+
+/// <summary>
+/// Hardware limit (PMBLIMITR_EL1.LIMIT) of the ACTIVE buffer, 0 when stalled.
+/// </summary>
+static __inline UINT64 spe_dbuf_limit(const struct spe_dbuf* db)
+{
+    if (db->active == SPE_DBUF_NONE)
+        return 0;
+    return (UINT64)db->base[db->active] + db->size;
+}
+
+/// <summary>
+/// Bytes written to ACTIVE buffer when hardware pointer is `hw_ptr`.
+/// </summary>
+static __inline UINT64 spe_dbuf_offset(const struct spe_dbuf* db, UINT64 hw_ptr)
+{
+    const UINT64 base = (UINT64)db->base[db->active];
+    if (hw_ptr < base)
+        return db->drained[db->active];
+    if (hw_ptr - base > db->size)
+        return db->size;
+    return hw_ptr - base < db->drained[db->active] ? db->drained[db->active] : hw_ptr - base;
+}
+
+/// <summary>
+/// Check if hardware must move to another buffer: it stopped (buffer full
+/// event, PMBSR_EL1.S) or fewer than `threshold` bytes are left.
+/// </summary>
+static __inline bool spe_dbuf_should_swap(const struct spe_dbuf* db, UINT64 hw_ptr, UINT64 threshold, bool stopped)
+{
+    if (db->active == SPE_DBUF_NONE)
+        return false;
+    return stopped || db->size - spe_dbuf_offset(db, hw_ptr) <= threshold;
+}
+
+/// <summary>
+/// Mark ACTIVE buffer FULL (hardware stopped at `hw_ptr`) and activate a FREE buffer.
+/// Call with hardware writes to the buffer disabled.
+/// </summary>
+/// <returns>Address of the new ACTIVE buffer for PMBPTR_EL1, NULL if capture is stalled</returns>
+static __inline UINT8* spe_dbuf_swap(struct spe_dbuf* db, UINT64 hw_ptr)
+{
+    if (db->active == SPE_DBUF_NONE)
+        return NULL;
+
+    db->fill[db->active] = spe_dbuf_offset(db, hw_ptr);
+    db->state[db->active] = SPE_DBUF_FULL;
+    db->active = SPE_DBUF_NONE;
+
+    UINT32 idx = spe_dbuf_find_free(db);
+    if (idx == SPE_DBUF_NONE)
+    {
+        db->stalls++;
+        return NULL;
+    }
+
+    db->swaps++;
+    return spe_dbuf_activate(db, idx);
+}
+
+/// <summary>
+/// Restart stalled capture if a buffer was drained in the meantime.
+/// </summary>
+/// <returns>Address of the new ACTIVE buffer for PMBPTR_EL1, NULL if still stalled (or not stalled)</returns>
+static __inline UINT8* spe_dbuf_resume(struct spe_dbuf* db)
+{
+    if (db->active != SPE_DBUF_NONE)
+        return NULL;
+
+    UINT32 idx = spe_dbuf_find_free(db);
+    if (idx == SPE_DBUF_NONE)
+        return NULL;
+
+    return spe_dbuf_activate(db, idx);
+}
+
+/// <summary>
+/// Number of bytes ready to be drained. Takes snapshot of ACTIVE buffer
+/// fill level at hardware pointer `hw_ptr`, used by spe_dbuf_copy_out().
+/// </summary>
+static __inline UINT64 spe_dbuf_pending(struct spe_dbuf* db, UINT64 hw_ptr)
+{
+    UINT64 pending = 0;
+
+    if (db->active != SPE_DBUF_NONE)
+        db->fill[db->active] = spe_dbuf_offset(db, hw_ptr);
+
+    for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+        if (db->state[i] != SPE_DBUF_FREE)
+            pending += db->fill[i] - db->drained[i];
+    return pending;
+}
+
+/// <summary>
+/// Copy up to `max_bytes` of pending bytes to `out` in capture order.
+/// Fully drained FULL buffers become FREE.
+/// </summary>
+/// <returns>Number of bytes copied</returns>
+static __inline UINT64 spe_dbuf_copy_out(struct spe_dbuf* db, UINT8* out, UINT64 max_bytes)
+{
+    UINT64 copied = 0;
+
+    while (copied < max_bytes)
+    {
+        // Oldest buffer with data left
+        UINT32 idx = SPE_DBUF_NONE;
+        for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+            if (db->state[i] != SPE_DBUF_FREE && db->fill[i] > db->drained[i] &&
+                (idx == SPE_DBUF_NONE || db->seq[i] < db->seq[idx]))
+                idx = i;
+
+        if (idx == SPE_DBUF_NONE)
+            break;
+
+        UINT64 n = db->fill[idx] - db->drained[idx];
+        if (n > max_bytes - copied)
+            n = max_bytes - copied;
+
+        RtlCopyMemory(out + copied, db->base[idx] + db->drained[idx], (size_t)n);
+        db->drained[idx] += n;
+        copied += n;
+
+        if (db->state[idx] == SPE_DBUF_FULL && db->drained[idx] == db->fill[idx])
+            db->state[idx] = SPE_DBUF_FREE;
+    }
+
+    // FULL buffers with no data at all (swapped while empty) are free as well
+    for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+        if (db->state[i] == SPE_DBUF_FULL && db->drained[i] == db->fill[i])
+            db->state[i] = SPE_DBUF_FREE;
+
+    return copied;
+}
@@ -33,6 +33,8 @@
 #include "pmu.h"
 #include "queue.h"
 #include "wperf-common\iorequest.h"
+#include "wperf-common\samplering.h"
+#include "wperf-common\mpxsched.h"
 
 enum prof_action
 {
@@ -41,27 +43,86 @@ enum prof_action
     PROF_MULTIPLEX,
 };
 
-typedef struct core_info
+//
+// Per-core state, `core_info[]` holds one element per core.
+//
+// Fields are grouped by who writes them and every group starts on its own
+// cache line. Timer DPC and PMI ISR writes then do not invalidate lines with
+// configuration which other paths only read. Element size is a multiple of
+// the alignment, so neighbouring cores never share a line either. Sample
+// frames are stored outside, in `sample_rings`.
+//
+typedef struct DECLSPEC_CACHEALIGN core_info
 {
-    struct pmu_event_pseudo events[MAX_MANAGED_CORE_EVENTS];
-    struct pmu_event_pseudo dsu_events[MAX_MANAGED_DSU_EVENTS];
+    //
+    // Cold: configuration written by IOCTLs
+    //
+    UINT64 idx;
     UINT32 events_num;
     UINT32 dsu_events_num;
-    UINT64 timer_round;
-    KTIMER timer;
-    UINT8 timer_running;
-    UINT8 dmc_ch;
-    KDPC dpc_overflow, dpc_multiplex, dpc_queue, dpc_reset;
     enum prof_action prof_core;
     enum prof_action prof_dsu;
     enum prof_action prof_dmc;
-    KSPIN_LOCK SampleLock;
+    UINT8 dmc_ch;
+    LONG period_target;                 // CTL_PERIOD_ADAPTIVE: period of busy core, 0 when period is fixed
+    LONG period_max;
+    UINT64 ov_mask;
+    UINT32 sample_interval[AARCH64_MAX_HWC_SUPP + numFPC];
+    struct mpx_sched sched;                                     // Multiplexing of `events`
+    struct mpx_sched dsu_sched;                                 // Multiplexing of `dsu_events`
     PQUEUE_CONTEXT get_sample_irp;
-    FrameChain samples[SAMPLE_CHAIN_BUFFER_SIZE];
-    UINT16 sample_idx;
+    PMDL sample_ring_mdl;               // Non-NULL when ring is mapped into user space
+    PVOID sample_ring_user_va;
+    WDFFILEOBJECT sample_ring_owner;    // File object which mapped the ring
+    UINT8* sample_ring_storage;         // Ring storage of other than SAMPLE_RING_BUFFER_SIZE capacity, NULL when ring is in `sample_rings`
+    SIZE_T sample_ring_size;            // Page aligned size of ring storage
+    BOOLEAN sample_active;              // PMU_CTL_SAMPLE_SET_SRC to PMU_CTL_SAMPLE_STOP, PMI ISR may push to the ring
+
+    //
+    // Kernel objects: written by timer expiry and by KeInsertQueueDpc() on other cores
+    //
+    DECLSPEC_CACHEALIGN KTIMER timer;
+    KDPC dpc_overflow, dpc_multiplex, dpc_queue, dpc_reset, dpc_broadcast;
+
+    //
+    // Hot: PMI ISR, every overflow interrupt
+    //
+    DECLSPEC_CACHEALIGN struct sample_ring sample_ring;     // Lock-free, ISR is the only producer
     UINT64 sample_generated;
     UINT64 sample_dropped;
-    UINT32 sample_interval[AARCH64_MAX_HWC_SUPP + numFPC];
-    UINT64 ov_mask;
-    UINT64 idx;
+
+    //
+    // Hot: timer DPC, every period
+    //
+    DECLSPEC_CACHEALIGN UINT64 timer_round;
+    UINT64 last_fpc_read;               // PMCCNTR_EL0 at last read, fixed counter is not reset, see CoreCounterReset()
+    volatile UINT8 timer_running;
+    UINT32 sched_slots_num;
+    UINT32 dsu_sched_slots_num;
+    LONG period;                        // Current timer period in ms
+    LONG period_lo, period_hi;          // Range of periods used since PMU_CTL_START
+    UINT64 peak_rate;                   // Highest cycles per generic timer tick, see mpx_period_idle()
+    UINT64 last_vct;                    // CNTVCT_EL0 at last timer DPC
+    UINT64 dpc_ticks;                   // Time spent in timer DPCs since PMU_CTL_START, in CNTVCT_EL0 ticks
+    UINT64 dpc_max_ticks;
+    UINT64 dpc_count;
+    UINT16 sched_slots[AARCH64_MAX_HWC_SUPP];                   // `events` index (minus numFPC) counted by each GPC
+    UINT16 dsu_sched_slots[AARCH64_MAX_HWC_SUPP];
+    struct mpx_sched_unit sched_units[MAX_MANAGED_CORE_EVENTS];     // `pass` advances every round
+    struct mpx_sched_unit dsu_sched_units[MAX_MANAGED_DSU_EVENTS];
+
+    //
+    // Hot: counts, timer DPC
+    //
+    DECLSPEC_CACHEALIGN struct pmu_event_pseudo events[MAX_MANAGED_CORE_EVENTS];
+    struct pmu_event_pseudo dsu_events[MAX_MANAGED_DSU_EVENTS];
 } CoreInfo;
+
+static_assert(__alignof(CoreInfo) == SYSTEM_CACHE_ALIGNMENT_SIZE, "CoreInfo must be cache aligned");
+static_assert(sizeof(CoreInfo) % SYSTEM_CACHE_ALIGNMENT_SIZE == 0, "Neighbouring CoreInfo elements share cache line");
+static_assert(FIELD_OFFSET(CoreInfo, timer) % SYSTEM_CACHE_ALIGNMENT_SIZE == 0, "CoreInfo kernel objects share cache line");
+static_assert(FIELD_OFFSET(CoreInfo, sample_ring) % SYSTEM_CACHE_ALIGNMENT_SIZE == 0, "CoreInfo ISR state shares cache line");
+static_assert(FIELD_OFFSET(CoreInfo, sample_dropped) + sizeof(UINT64) - FIELD_OFFSET(CoreInfo, sample_ring) <= SYSTEM_CACHE_ALIGNMENT_SIZE,
+    "CoreInfo ISR state does not fit into one cache line");
+static_assert(FIELD_OFFSET(CoreInfo, timer_round) % SYSTEM_CACHE_ALIGNMENT_SIZE == 0, "CoreInfo timer DPC state shares cache line");
+static_assert(FIELD_OFFSET(CoreInfo, events) % SYSTEM_CACHE_ALIGNMENT_SIZE == 0, "CoreInfo counts share cache line");
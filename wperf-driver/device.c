@@ -73,9 +73,8 @@ HANDLE pmc_resource_handle = NULL;
 UINT8 counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
 CoreInfo* core_info = NULL;
 
-// Use this array to calculate the value for fixed counters via a delta approach as we are no longer resetting it.
-// See comment on CoreCounterReset() for an explanation.
-UINT64* last_fpc_read = NULL;
+UINT8* sample_rings = NULL;         // Storage for all per-core sample rings
+SIZE_T sample_ring_stride = 0;      // Page aligned size of one per-core ring
 extern KEVENT sync_reset_dpc;
 LOCK_STATUS   current_status;
 USHORT running = 1;
@@ -125,46 +124,38 @@ VOID arm64_pmi_ISR(PKTRAP_FRAME pTrapFrame)
 
     core->sample_generated++;
 
-    if (!KeTryToAcquireSpinLockAtDpcLevel(&core->SampleLock))
-    {
-        core->sample_dropped++;
-        return;
-    }
+    FrameChain frame = { 0 };
+    frame.lr = pTrapFrame->Lr;
+    frame.pc = pTrapFrame->Pc;
+    frame.ov_flags = ov_flags;
+    frame.cpu = core_idx;
+    frame.timestamp = (UINT64)_ReadStatusReg(CNTVCT_EL0);
 
-    if (core->sample_idx == SAMPLE_CHAIN_BUFFER_SIZE)
-    {
+    CoreCounterStop();
 
-        KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
+    if (!sample_ring_push(&core->sample_ring, &frame))
+    {
+        // Ring is full, user space is not draining fast enough
+        CoreCounterStart();
         core->sample_dropped++;
         return;
     }
-    else
-    {
-        CoreCounterStop();
-
-        core->samples[core->sample_idx].lr = pTrapFrame->Lr;
-        core->samples[core->sample_idx].pc = pTrapFrame->Pc;
-        core->samples[core->sample_idx].ov_flags = ov_flags;
-        core->sample_idx++;
-
-        KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
 
-        /* Here all the GPC indexes are raw indexes and do not need to be mapped. 
-        */
-        for (int i = 0; i < 32; i++)
-        {
-            if (!(ov_flags & (1ULL << i)))
-                continue;
+    /* Here all the GPC indexes are raw indexes and do not need to be mapped. 
+    */
+    for (int i = 0; i < 32; i++)
+    {
+        if (!(ov_flags & (1ULL << i)))
+            continue;
 
-            UINT32 val = 0xFFFFFFFF - core->sample_interval[i];
+        UINT32 val = 0xFFFFFFFF - core->sample_interval[i];
 
-            if (i == 31)
-                _WriteStatusReg(PMCCNTR_EL0, (__int64)val);
-            else
-                CoreWriteCounter(i, (__int64)val);
-        }
-        CoreCounterStart();
+        if (i == 31)
+            _WriteStatusReg(PMCCNTR_EL0, (__int64)val);
+        else
+            CoreWriteCounter(i, (__int64)val);
     }
+    CoreCounterStart();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -217,15 +208,18 @@ VOID free_pmu_resource(VOID)
     {
         CoreInfo* core = &core_info[i];
 
-        KeCancelTimer(&core->timer);
         core->timer_running = 0;
+        KeCancelTimer(&core->timer);
 
         KeRemoveQueueDpc(&core->dpc_queue);
         KeRemoveQueueDpc(&core->dpc_reset);
+        KeRemoveQueueDpc(&core->dpc_broadcast);
         KeRemoveQueueDpc(&core->dpc_multiplex);
         KeRemoveQueueDpc(&core->dpc_overflow);
     }
 
+    timer_resolution_release();
+
     if (pmc_resource_handle != NULL)
     {
         NTSTATUS status = HalFreeHardwareCounters(pmc_resource_handle);
@@ -389,6 +383,141 @@ static void FileCreate(
     WdfRequestComplete(Request, STATUS_SUCCESS);
 }
 
+/// <summary>
+/// Move per-core sample ring to storage for `capacity` frames, frames in the
+/// ring are dropped. Call only when the ring is not mapped and PMI ISR does not
+/// push to it. Rings of SAMPLE_RING_BUFFER_SIZE frames use `sample_rings`.
+/// </summary>
+static NTSTATUS sample_ring_resize(CoreInfo* core, UINT64 capacity)
+{
+    UINT8* storage = NULL;
+    SIZE_T size = sample_ring_stride;
+
+    if (capacity != SAMPLE_RING_BUFFER_SIZE)
+    {
+        size = ROUND_TO_PAGES(SAMPLE_RING_SHARED_SIZE(capacity));
+        storage = (UINT8*)ExAllocatePool2(POOL_FLAG_NON_PAGED, size, 'SMPL');
+        if (!storage)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s:%d - ExAllocatePool2: failed\n", __FUNCTION__, __LINE__));
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    if (core->sample_ring_storage)
+        ExFreePoolWithTag(core->sample_ring_storage, 'SMPL');
+
+    core->sample_ring_storage = storage;
+    core->sample_ring_size = size;
+    sample_ring_init(&core->sample_ring, (struct sample_ring_shared*)(storage ? storage : sample_rings + sample_ring_stride * core->idx), capacity);
+    return STATUS_SUCCESS;
+}
+
+/// <summary>
+/// Map per-core sample ring into the address space of the calling process.
+/// Must be called in the context of the process which will read the ring.
+/// </summary>
+/// <param name="core_idx">Core which ring we map</param>
+/// <param name="capacity">Requested ring capacity in frames, see sample_ring_capacity_clamp()</param>
+/// <param name="file_object">Owner of the mapping, see sample_ring_unmap_all()</param>
+/// <param name="out">User address and size of the mapping</param>
+/// <returns>STATUS_SUCCESS or reason of failure</returns>
+NTSTATUS sample_ring_map(UINT32 core_idx, UINT64 capacity, WDFFILEOBJECT file_object, struct PMUSampleRingMap* out)
+{
+    CoreInfo* core = &core_info[core_idx];
+
+    if (core->sample_ring_mdl)
+    {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s: ring of core %u already mapped\n", __FUNCTION__, core_idx));
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    // Ring is resized only while PMI ISR does not push to it, otherwise current ring is mapped
+    capacity = sample_ring_capacity_clamp(capacity);
+    if (capacity != core->sample_ring.capacity)
+    {
+        if (core->sample_active)
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%s: core %u is sampling, ring keeps %llu frames\n", __FUNCTION__, core_idx, core->sample_ring.capacity));
+        else if (sample_ring_resize(core, capacity) != STATUS_SUCCESS)
+            return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    PMDL mdl = IoAllocateMdl(core->sample_ring.shared, (ULONG)core->sample_ring_size, FALSE, FALSE, NULL);
+    if (!mdl)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    MmBuildMdlForNonPagedPool(mdl);
+
+    PVOID user_va = NULL;
+    __try
+    {
+        user_va = MmMapLockedPagesSpecifyCache(mdl, UserMode, MmCached, NULL, FALSE, NormalPagePriority | MdlMappingNoExecute);
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        user_va = NULL;
+    }
+
+    if (!user_va)
+    {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s: MmMapLockedPagesSpecifyCache failed\n", __FUNCTION__));
+        IoFreeMdl(mdl);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    core->sample_ring_mdl = mdl;
+    core->sample_ring_user_va = user_va;
+    core->sample_ring_owner = file_object;
+
+    out->address = (UINT64)user_va;
+    out->size = core->sample_ring_size;
+    return STATUS_SUCCESS;
+}
+
+/// <summary>
+/// Unmap per-core sample ring mapped with sample_ring_map().
+/// Must be called in the context of the process which mapped the ring.
+/// </summary>
+NTSTATUS sample_ring_unmap(UINT32 core_idx, WDFFILEOBJECT file_object)
+{
+    CoreInfo* core = &core_info[core_idx];
+
+    if (!core->sample_ring_mdl || core->sample_ring_owner != file_object)
+        return STATUS_INVALID_DEVICE_STATE;
+
+    MmUnmapLockedPages(core->sample_ring_user_va, core->sample_ring_mdl);
+    IoFreeMdl(core->sample_ring_mdl);
+
+    core->sample_ring_mdl = NULL;
+    core->sample_ring_user_va = NULL;
+    core->sample_ring_owner = NULL;
+    return STATUS_SUCCESS;
+}
+
+/// <summary>
+/// Unmap all sample rings mapped by `file_object`.
+/// </summary>
+VOID sample_ring_unmap_all(WDFFILEOBJECT file_object)
+{
+    if (!core_info)
+        return;
+
+    for (ULONG i = 0; i < numCores; i++)
+        if (core_info[i].sample_ring_mdl && core_info[i].sample_ring_owner == file_object)
+            sample_ring_unmap(i, file_object);
+}
+
+// Called in the context of the process closing its last handle, so we
+// can still unmap sample rings from its address space here.
+static void FileCleanup(
+    WDFFILEOBJECT FileObject
+)
+{
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_TRACE_LEVEL, "<====> FileCleanup\n"));
+
+    sample_ring_unmap_all(FileObject);
+}
+
 static void FileClose(
     WDFFILEOBJECT FileObject
 )
@@ -455,10 +584,16 @@ void WindowsPerfDeviceIOCleanup(
     free_pmu_resource();
 
     if (core_info)
+    {
+        for (ULONG i = 0; i < numCores; i++)
+            if (core_info[i].sample_ring_storage)
+                ExFreePoolWithTag(core_info[i].sample_ring_storage, 'SMPL');
+
         ExFreePoolWithTag(core_info, 'CORE');
+    }
 
-    if (last_fpc_read)
-        ExFreePoolWithTag(last_fpc_read, 'LAST');
+    if (sample_rings)
+        ExFreePoolWithTag(sample_rings, 'SMPL');
     
     spe_destroy();
 
@@ -525,7 +660,7 @@ WindowsPerfDeviceCreate(
     WdfDeviceInitSetPnpPowerEventCallbacks(DeviceInit, &pnpPowerCallbacks);
 
     // Register for file object creation, we dont need callbacks to file open and close etc
-    WDF_FILEOBJECT_CONFIG_INIT(&FileObjectConfig, FileCreate, FileClose, WDF_NO_EVENT_CALLBACK);
+    WDF_FILEOBJECT_CONFIG_INIT(&FileObjectConfig, FileCreate, FileClose, FileCleanup);
     WdfDeviceInitSetFileObjectConfig(DeviceInit, &FileObjectConfig, WDF_NO_OBJECT_ATTRIBUTES);
     
     //  create the FDO device
@@ -639,7 +774,8 @@ WindowsPerfDeviceCreate(
     numCores = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%d cores detected\n", numCores));
 
-    core_info = (CoreInfo*)ExAllocatePool2(POOL_FLAG_NON_PAGED, sizeof(CoreInfo) * numCores, 'CORE');
+    // Cache aligned, see CoreInfo layout
+    core_info = (CoreInfo*)ExAllocatePool2(POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED, sizeof(CoreInfo) * numCores, 'CORE');
     if (core_info == NULL)
     {
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "ExAllocatePoolWithTag: failed \n"));
@@ -654,13 +790,14 @@ WindowsPerfDeviceCreate(
             return st;
     }
 
-    last_fpc_read = (UINT64*)ExAllocatePool2(POOL_FLAG_NON_PAGED, sizeof(UINT64) * numCores, 'LAST');
-    if (!last_fpc_read)
+    // Each ring starts on its own page so it can be mapped into user space alone
+    sample_ring_stride = ROUND_TO_PAGES(SAMPLE_RING_SHARED_SIZE(SAMPLE_RING_BUFFER_SIZE));
+    sample_rings = (UINT8*)ExAllocatePool2(POOL_FLAG_NON_PAGED, sample_ring_stride * numCores, 'SMPL');
+    if (!sample_rings)
     {
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s:%d - ExAllocatePool2: failed\n", __FUNCTION__, __LINE__));
         return STATUS_INSUFFICIENT_RESOURCES;
     }
-    RtlSecureZeroMemory(last_fpc_read, sizeof(UINT64) * numCores);
 
     for (ULONG i = 0; i < numCores; i++)
     {
@@ -673,7 +810,8 @@ WindowsPerfDeviceCreate(
             return status;
 
         // Initialize fields for sampling;
-        KeInitializeSpinLock(&core->SampleLock);
+        sample_ring_init(&core->sample_ring, (struct sample_ring_shared*)(sample_rings + sample_ring_stride * i), SAMPLE_RING_BUFFER_SIZE);
+        core->sample_ring_size = sample_ring_stride;
 
         // Enable  events and counters
         PRKDPC dpc = &core_info[i].dpc_queue;
@@ -688,16 +826,20 @@ WindowsPerfDeviceCreate(
         PRKDPC dpc_overflow = &core_info[i].dpc_overflow;
         PRKDPC dpc_multiplex = &core_info[i].dpc_multiplex;
         PRKDPC dpc_reset = &core_info[i].dpc_reset;
+        PRKDPC dpc_broadcast = &core_info[i].dpc_broadcast;
 
         KeInitializeDpc(dpc_overflow, overflow_dpc, &core_info[i]);
         KeInitializeDpc(dpc_multiplex, multiplex_dpc, &core_info[i]);
         KeInitializeDpc(dpc_reset, reset_dpc, &core_info[i]);
+        KeInitializeDpc(dpc_broadcast, broadcast_dpc, &core_info[i]);
         KeSetTargetProcessorDpcEx(dpc_overflow, &ProcNumber);
         KeSetTargetProcessorDpcEx(dpc_multiplex, &ProcNumber);
         KeSetTargetProcessorDpcEx(dpc_reset, &ProcNumber);
+        KeSetTargetProcessorDpcEx(dpc_broadcast, &ProcNumber);
         KeSetImportanceDpc(dpc_overflow, HighImportance);
         KeSetImportanceDpc(dpc_multiplex, HighImportance);
         KeSetImportanceDpc(dpc_reset, HighImportance);
+        KeSetImportanceDpc(dpc_broadcast, HighImportance);
     }
 
     KeInitializeEvent(&sync_reset_dpc, NotificationEvent, FALSE);
@@ -29,7 +29,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "wperf-common\public.h"
+#include "wperf-common\broadcast.h"
 #include "queue.h"
+#include "pmu.h"
 
 //
 // The device context performs the same job as
@@ -66,8 +68,41 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
 VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
+#define BROADCAST_WAIT_TIMEOUT_MS   1000
+
+//
+// Control action executed by `broadcast_dpc` on all requested cores at once
+//
+struct broadcast_req
+{
+    struct broadcast_barrier barrier;
+    VOID(*core_func)(VOID);
+    VOID(*dsu_func)(VOID);                              // Executed only on cores queued with `dsu_head` set
+    VOID(*event_func)(struct pmu_event_kernel* event);  // PMU_CTL_ASSIGN_EVENTS, enables events scheduled for first round
+    BOOLEAN dsu_events;                                 // `event_func` enables DSU events on `dsu_head` cores
+    struct counting_snapshot_hdr* live;                 // PMU_CTL_READ_COUNTING_BATCH with CTL_FLAG_LIVE, each core fills its own entry
+    UINT32 live_offset[MAX_PMU_CTL_CORES_COUNT];        // Byte offset of core's entry in `live` by core index, 0 if core has no entry
+    KEVENT done;
+};
+
+VOID broadcast_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
+
+KIRQL broadcast_begin(struct broadcast_req* req, LONG cores_count);
+
+BOOLEAN broadcast_queue(struct broadcast_req* req, UINT32 core_idx, BOOLEAN dsu_head);
+
+VOID broadcast_end(struct broadcast_req* req, KIRQL old_irql, struct pmu_ctl_out* out);
+
+VOID timer_resolution_release(VOID);
+
 VOID arm64pmc_enable_default(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
 VOID free_pmu_resource(VOID);
 
 NTSTATUS get_pmu_resource(VOID);
+
+NTSTATUS sample_ring_map(UINT32 core_idx, UINT64 capacity, WDFFILEOBJECT file_object, struct PMUSampleRingMap* out);
+
+NTSTATUS sample_ring_unmap(UINT32 core_idx, WDFFILEOBJECT file_object);
+
+VOID sample_ring_unmap_all(WDFFILEOBJECT file_object);
@@ -38,8 +38,10 @@
 #include "dsu.h"
 #include "core.h"
 #include "spe.h"
+#include "sysregs.h"
 #include "wperf-common\gitver.h"
 #include "wperf-common\inline.h"
+#include "wperf-common\snapshot.h"
 
 static VOID(*dsu_ctl_funcs[3])(VOID) = { DSUCounterStart, DSUCounterStop, DSUCounterReset };
 static VOID(*dmc_ctl_funcs[3])(UINT8, UINT8, struct dmcs_desc*) = { DmcCounterStart, DmcCounterStop, DmcCounterReset };
@@ -77,7 +79,78 @@ extern size_t spe_bytesToCopy;
 // must sync with enum pmu_ctl_action
 static VOID(*core_ctl_funcs[3])(VOID) = { CoreCounterStart, CoreCounterStop, CoreCounterReset };
 
-static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, UINT32 core_end, UINT16 core_event_num, UINT16* core_events, UINT64 filter_bits)
+// Timer periods shorter than the system clock tick need finer system timer
+// resolution, it is requested only while counting
+static BOOLEAN timer_resolution_set = FALSE;
+
+VOID timer_resolution_release(VOID)
+{
+    if (timer_resolution_set)
+    {
+        ExSetTimerResolution(0, FALSE);
+        timer_resolution_set = FALSE;
+    }
+}
+
+static VOID timer_resolution_request(LONG period)
+{
+    timer_resolution_release();
+
+    if (period < PMU_CTL_START_PERIOD_FINE)
+    {
+        ExSetTimerResolution((ULONG)period * 10000, TRUE);     // In 100 ns units
+        timer_resolution_set = TRUE;
+    }
+}
+
+/// <summary>
+/// Enable events scheduled for the first round on cores `core_base` to `core_end` (exclusive) at once.
+/// </summary>
+static VOID evt_assign_broadcast(UINT32 core_base, UINT32 core_end, BOOLEAN dsu_events, VOID(*event_func)(struct pmu_event_kernel* event))
+{
+    struct broadcast_req req = { 0 };
+    req.event_func = event_func;
+    req.dsu_events = dsu_events;
+
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%s broadcasting to cores %u-%u\n", __FUNCTION__, core_base, core_end));
+    KIRQL old_irql = broadcast_begin(&req, (LONG)(core_end - core_base));
+    for (UINT32 i = core_base; i < core_end; i++)
+        broadcast_queue(&req, i, dsu_events && !((i - core_base) % dsu_sizeCluster));
+    broadcast_end(&req, old_irql, NULL);
+}
+
+/// <summary>
+/// Build multiplexing schedule of `event_num` events (`events` without fixed counters)
+/// and give counters to events counted in the first round.
+/// </summary>
+/// <returns>FALSE if `attrs` are invalid, e.g. group does not fit into `counters`</returns>
+static BOOLEAN evt_assign_sched(struct mpx_sched* sched, struct mpx_sched_unit* units, UINT32 units_max, UINT8 counters,
+    const struct evt_sched_attr* attrs, UINT16 event_num, struct pmu_event_pseudo* events, UINT16* slots, UINT32* slots_num)
+{
+    if (!mpx_sched_init(sched, units, units_max, counters, attrs, event_num))
+        return FALSE;
+
+    if (event_num <= counters)
+    {
+        // No multiplexing, every event has its own counter
+        for (UINT16 j = 0; j < event_num; j++)
+            slots[j] = j;
+        *slots_num = event_num;
+    }
+    else
+    {
+        *slots_num = mpx_sched_next(sched, slots, counters);
+    }
+
+    for (UINT32 j = 0; j < event_num; j++)
+        events[j].counter_idx = INVALID_COUNTER_IDX;
+    for (UINT32 k = 0; k < *slots_num; k++)
+        events[slots[k]].counter_idx = k;
+
+    return TRUE;
+}
+
+static NTSTATUS evt_assign_core(UINT32 core_base, UINT32 core_end, UINT16 core_event_num, UINT16* core_events, const struct evt_sched_attr* attrs, UINT64 filter_bits)
 {
     if ((core_event_num + numFPC) > MAX_MANAGED_CORE_EVENTS)
     {
@@ -93,7 +166,6 @@ static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, U
     {
         CoreInfo* core = &core_info[i];
         core->events_num = core_event_num + numFPC;
-        UINT32 init_num = core_event_num <= numFreeGPC ? core_event_num : numFreeGPC;
         struct pmu_event_pseudo* events = &core->events[0];
 
         RtlSecureZeroMemory(&events[numFPC], sizeof(struct pmu_event_pseudo) * (MAX_MANAGED_CORE_EVENTS - numFPC));
@@ -111,28 +183,24 @@ static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, U
             event->event_idx = core_events[j];
             event->filter_bits = filter_bits;
             event->enable_irq = 0;
-            if (j < init_num)
-                event->counter_idx = j;
-            else
-                event->counter_idx = INVALID_COUNTER_IDX;
+        }
+
+        if (!evt_assign_sched(&core->sched, core->sched_units, MAX_MANAGED_CORE_EVENTS, numFreeGPC, attrs, core_event_num,
+                &events[numFPC], core->sched_slots, &core->sched_slots_num))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid event groups for %d GPCs\n", numFreeGPC));
+            core->events_num = numFPC;
+            core->sched_slots_num = 0;
+            return STATUS_INVALID_PARAMETER;
         }
     }
 
-    PWORK_ITEM_CTXT context;
-    context = WdfObjectGet_WORK_ITEM_CTXT(queueContext->WorkItem);
-    context->action = PMU_CTL_ASSIGN_EVENTS;
-    context->isDSU = false;
-    context->core_base = core_base;
-    context->core_end = core_end;
-    context->event_num = core_event_num;
-    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%s enqueuing for action %d\n", __FUNCTION__, context->action));
-    WdfWorkItemEnqueue(queueContext->WorkItem);
-    WdfWorkItemFlush(queueContext->WorkItem);       // Wait for `WdfWorkItemEnqueue` to finish
+    evt_assign_broadcast(core_base, core_end, FALSE, event_enable);
 
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS evt_assign_dsu(PQUEUE_CONTEXT queueContext, UINT32 core_base, UINT32 core_end, UINT16 dsu_event_num, UINT16* dsu_events)
+static NTSTATUS evt_assign_dsu(UINT32 core_base, UINT32 core_end, UINT16 dsu_event_num, UINT16* dsu_events, const struct evt_sched_attr* attrs)
 {
     if ((dsu_event_num + dsu_numFPC) > MAX_MANAGED_DSU_EVENTS)
     {
@@ -148,7 +216,6 @@ static NTSTATUS evt_assign_dsu(PQUEUE_CONTEXT queueContext, UINT32 core_base, UI
     {
         CoreInfo* core = &core_info[i];
         core->dsu_events_num = dsu_event_num + dsu_numFPC;
-        UINT32 init_num = dsu_event_num <= dsu_numGPC ? dsu_event_num : dsu_numGPC;
         struct pmu_event_pseudo* events = &core->dsu_events[0];
 
         RtlSecureZeroMemory(&events[dsu_numFPC], sizeof(struct pmu_event_pseudo) * (MAX_MANAGED_DSU_EVENTS - dsu_numFPC));
@@ -165,23 +232,19 @@ static NTSTATUS evt_assign_dsu(PQUEUE_CONTEXT queueContext, UINT32 core_base, UI
 
             event->event_idx = dsu_events[j];
             event->enable_irq = 0;
-            if (j < init_num)
-                event->counter_idx = j;
-            else
-                event->counter_idx = INVALID_COUNTER_IDX;
+        }
+
+        if (!evt_assign_sched(&core->dsu_sched, core->dsu_sched_units, MAX_MANAGED_DSU_EVENTS, dsu_numGPC, attrs, dsu_event_num,
+                &events[dsu_numFPC], core->dsu_sched_slots, &core->dsu_sched_slots_num))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid DSU event groups for %d GPCs\n", dsu_numGPC));
+            core->dsu_events_num = dsu_numFPC;
+            core->dsu_sched_slots_num = 0;
+            return STATUS_INVALID_PARAMETER;
         }
     }
 
-    PWORK_ITEM_CTXT context;
-    context = WdfObjectGet_WORK_ITEM_CTXT(queueContext->WorkItem);
-    context->action = PMU_CTL_ASSIGN_EVENTS;
-    context->isDSU = true;
-    context->core_base = core_base;
-    context->core_end = core_end;
-    context->event_num = dsu_event_num;
-    KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s enqueuing for action %d\n", __FUNCTION__, context->action));
-    WdfWorkItemEnqueue(queueContext->WorkItem);
-    WdfWorkItemFlush(queueContext->WorkItem); // Wait for `WdfWorkItemEnqueue` to finish
+    evt_assign_broadcast(core_base, core_end, TRUE, DSUEventEnable);
 
     return STATUS_SUCCESS;
 }
@@ -386,7 +449,7 @@ clean_lock_acquire:
 
         core_info[core_idx].sample_dropped = 0;
         core_info[core_idx].sample_generated = 0;
-        core_info[core_idx].sample_idx = 0;
+        sample_ring_reset(&core_info[core_idx].sample_ring);
 
         PWORK_ITEM_CTXT context;
         context = WdfObjectGet_WORK_ITEM_CTXT(queueContext->WorkItem);
@@ -450,10 +513,12 @@ clean_lock_acquire:
         context->core_idx = core_idx;
         WdfWorkItemEnqueue(queueContext->WorkItem);
         WdfWorkItemFlush(queueContext->WorkItem);       // Wait for `WdfWorkItemEnqueue` to finish
+        core_info[core_idx].sample_active = FALSE;      // Overflow interrupts are disabled
 
         struct PMUSampleSummary* out = (struct PMUSampleSummary*)pOutBuffer;
         out->sample_generated = core_info[core_idx].sample_generated;
         out->sample_dropped = core_info[core_idx].sample_dropped;
+        out->timer_freq = (UINT64)_ReadStatusReg(CNTFRQ_EL0);
         *outputSize = sizeof(struct PMUSampleSummary);
 
         if (*outputSize > OutBufSize)
@@ -467,8 +532,6 @@ clean_lock_acquire:
     {
         struct PMUCtlGetSampleHdr* ctl_req = (struct PMUCtlGetSampleHdr*)pInBuffer;
         UINT32 core_idx = ctl_req->core_idx;
-        CoreInfo* core = core_info + core_idx;
-        KIRQL oldIrql;
 
         // Check if current file_object is the owner of the lock
         if (!IsLockOwner(IoCtlCode, file_object))
@@ -484,28 +547,99 @@ clean_lock_acquire:
             break;
         }
 
+        if (core_idx >= numCores)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %u for action %d\n", core_idx, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (core_info[core_idx].sample_ring_mdl)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: ring of core %u is mapped, read it from user space\n", core_idx));
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_GET\n"));
 
-        KeAcquireSpinLock(&core->SampleLock, &oldIrql);
+        struct PMUSamplePayload* out = (struct PMUSamplePayload*)pOutBuffer;
+        *outputSize = sizeof(struct PMUSamplePayload);
+        if (*outputSize > OutBufSize)
         {
-            struct PMUSamplePayload* out = (struct PMUSamplePayload*)pOutBuffer;
-            *outputSize = sizeof(struct PMUSamplePayload);
-            if (*outputSize > OutBufSize)
-            {
-                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
-                status = STATUS_BUFFER_TOO_SMALL;
-            }
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // No lock needed, this handler is the only consumer of the ring (sequential queue)
+        out->size = (UINT32)sample_ring_pop_bulk(&core_info[core_idx].sample_ring, out->payload, SAMPLE_CHAIN_BUFFER_SIZE);
+        *outputSize = FIELD_OFFSET(struct PMUSamplePayload, payload) + sizeof(FrameChain) * out->size;  // Return only valid frames
+        break;
+    }
+    case IOCTL_PMU_CTL_SAMPLE_MAP:
+    case IOCTL_PMU_CTL_SAMPLE_UNMAP:
+    {
+        struct PMUCtlGetSampleHdr* ctl_req = (struct PMUCtlGetSampleHdr*)pInBuffer;
 
-            RtlSecureZeroMemory(out, *outputSize);
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
 
-            if (core->sample_idx > 0)
-            {
-                RtlCopyMemory(out->payload, core->samples, sizeof(FrameChain) * core->sample_idx);
-                out->size = core->sample_idx;
-                core->sample_idx = 0;
-            }
+        // PMU_CTL_SAMPLE_MAP may carry ring capacity, `struct PMUCtlSampleMapHdr` starts with `core_idx` too
+        const BOOLEAN has_capacity = IoCtlCode == IOCTL_PMU_CTL_SAMPLE_MAP && InBufSize == sizeof(struct PMUCtlSampleMapHdr);
+
+        if (InBufSize != sizeof(struct PMUCtlGetSampleHdr) && !has_capacity)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for action %d\n", InBufSize, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
         }
-        KeReleaseSpinLock(&core->SampleLock, oldIrql);
+
+        UINT32 core_idx = ctl_req->core_idx;
+
+        if (core_idx >= numCores)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %u for action %d\n", core_idx, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        // Mapping is created in (and removed from) the current process address space
+        PIRP irp = WdfRequestWdmGetIrp(queueContext->CurrentRequest);
+        if (IoGetRequestorProcess(irp) != IoGetCurrentProcess())
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: action %d not called in requestor context\n", action));
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (IoCtlCode == IOCTL_PMU_CTL_SAMPLE_UNMAP)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_UNMAP\n"));
+
+            status = sample_ring_unmap(core_idx, file_object);
+            *outputSize = 0;
+            break;
+        }
+
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_MAP\n"));
+
+        *outputSize = sizeof(struct PMUSampleRingMap);
+        if (*outputSize > OutBufSize)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        UINT64 capacity = has_capacity ? ((struct PMUCtlSampleMapHdr*)pInBuffer)->capacity : 0;
+        status = sample_ring_map(core_idx, capacity, file_object, (struct PMUSampleRingMap*)pOutBuffer);
+        if (status != STATUS_SUCCESS)
+            *outputSize = 0;
         break;
     }
     case IOCTL_PMU_CTL_SAMPLE_SET_SRC:
@@ -519,9 +653,23 @@ clean_lock_acquire:
 
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_SET_SRC\n"));
 
+        if (InBufSize < sizeof(PMUSampleSetSrcHdr))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for action %d\n", InBufSize, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
         PMUSampleSetSrcHdr* sample_req = (PMUSampleSetSrcHdr*)pInBuffer;
         UINT32 core_idx = sample_req->core_idx;
 
+        if (core_idx >= numCores)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %u for action %d\n", core_idx, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
         int sample_src_num = (InBufSize - sizeof(PMUSampleSetSrcHdr)) / sizeof(SampleSrcDesc);
 
         // rough check
@@ -551,6 +699,7 @@ clean_lock_acquire:
         context->core_idx = core_idx;
         context->sample_req = sample_req;
         context->sample_src_num = sample_src_num;
+        core->sample_active = TRUE;                     // Overflow interrupts are enabled below
         WdfWorkItemEnqueue(queueContext->WorkItem);
         WdfWorkItemFlush(queueContext->WorkItem);       // Wait for `WdfWorkItemEnqueue` to finish
 
@@ -604,6 +753,25 @@ clean_lock_acquire:
             break;
         }
 
+        // Every core is queued once in the broadcast below
+        UINT64 cores_seen[MAX_PMU_CTL_CORES_COUNT / 64] = { 0 };
+        for (size_t k = 0; k < cores_count; k++)
+        {
+            UINT8 core_idx = ctl_req->cores_idx.cores_no[k];
+            UINT64 core_bit = 1ULL << (core_idx % 64);
+
+            if (core_idx >= numCores || (cores_seen[core_idx / 64] & core_bit))
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid or duplicate core_idx %d for action %d\n", core_idx, action));
+                status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+            cores_seen[core_idx / 64] |= core_bit;
+        }
+
+        if (status != STATUS_SUCCESS)
+            break;
+
         KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "IOCTL: action %d\n", action));
 
         VOID(*core_func)(VOID) = NULL;
@@ -624,19 +792,34 @@ clean_lock_acquire:
         if (ctl_flags & CTL_FLAG_DSU)
             dsu_func = dsu_ctl_funcs[funcsIdx];
 
-        PWORK_ITEM_CTXT context;
-        context = WdfObjectGet_WORK_ITEM_CTXT(queueContext->WorkItem);
-        context->action = PMU_CTL_START;
-        context->ctl_flags = ctl_flags;
-        context->ctl_req = ctl_req;
-        context->cores_count = cores_count;
-        context->do_func = core_func;
-        context->do_func2 = dsu_func;
+        // Execute action on all cores at once with per-core DPCs
+        struct broadcast_req req = { 0 };
+        req.core_func = core_func;
+        req.dsu_func = dsu_func;
 
-        KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d enqueuing for action %d\n", __FUNCTION__, __LINE__, context->action));
+        KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d broadcasting action %d\n", __FUNCTION__, __LINE__, action));
 
-        WdfWorkItemEnqueue(queueContext->WorkItem);
-        WdfWorkItemFlush(queueContext->WorkItem);       // Wait for `WdfWorkItemEnqueue` to finish
+        int last_cluster = -1;
+        KIRQL old_irql = broadcast_begin(&req, (LONG)cores_count);
+        for (auto k = 0; k < cores_count; k++)
+        {
+            int i = ctl_req->cores_idx.cores_no[k];
+            BOOLEAN dsu_head = FALSE;
+
+            // This works only if ctl_req->cores_idx.cores_no[] is sorted
+            // We will only configure one core in cluster
+            if ((ctl_flags & CTL_FLAG_DSU) && last_cluster != i / dsu_sizeCluster)
+            {
+                last_cluster = i / dsu_sizeCluster;
+                dsu_head = TRUE;
+            }
+
+            if (!broadcast_queue(&req, i, dsu_head) && dsu_head)
+                last_cluster = -1;  // Next core of this cluster executes DSU action instead
+        }
+
+        struct pmu_ctl_out ctl_out = { 0 };
+        broadcast_end(&req, old_irql, &ctl_out);
 
         if (ctl_flags & CTL_FLAG_DMC)
         {
@@ -662,6 +845,7 @@ clean_lock_acquire:
         if (action == PMU_CTL_START)
         {
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: action PMU_CTL_START cores_count %lld\n", cores_count));
+            LONG period_shortest = LONG_MAX;
             for (auto k = 0; k < cores_count; k++)
             {
                 int i = ctl_req->cores_idx.cores_no[k];
@@ -716,9 +900,33 @@ clean_lock_acquire:
                     && ctl_req->period <= PMU_CTL_START_PERIOD)
                     Period = ctl_req->period;
 
+                // Adaptive period: one rotation of all multiplexed events fits into `Period`
+                core->period_target = 0;
+                core->period_max = Period;
+                if (do_multiplex && (ctl_req->period_flags & CTL_PERIOD_ADAPTIVE))
+                {
+                    UINT32 rotation = 1;
+                    if (core->prof_core == PROF_MULTIPLEX)
+                        rotation = mpx_sched_rotation(&core->sched);
+                    if (core->prof_dsu == PROF_MULTIPLEX && mpx_sched_rotation(&core->dsu_sched) > rotation)
+                        rotation = mpx_sched_rotation(&core->dsu_sched);
+
+                    Period = mpx_period_target(rotation, PMU_CTL_START_PERIOD_MIN, Period);
+                    core->period_target = Period;
+                }
+
                 DueTime.QuadPart = do_multiplex ? (Period * ns100) : (2 * (LONGLONG)Period * ns100);
                 Period = do_multiplex ? Period : (2 * Period);
 
+                core->period = core->period_lo = core->period_hi = Period;
+                core->peak_rate = 0;
+                core->last_vct = 0;
+                core->dpc_ticks = 0;
+                core->dpc_max_ticks = 0;
+                core->dpc_count = 0;
+                if (Period < period_shortest)
+                    period_shortest = Period;
+
                 KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d ctl_req->period = %d\n", __FUNCTION__, __LINE__, ctl_req->period));
                 KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d count.period = %d\n", __FUNCTION__, __LINE__, Period));
                 KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d DueTime.QuadPart = %lld\n", __FUNCTION__, __LINE__, DueTime.QuadPart));
@@ -727,6 +935,9 @@ clean_lock_acquire:
                 KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: action PMU_CTL_START calling set timer multiplex %s for loop k  %d core idx %lld\n", do_multiplex? "TRUE":"FALSE", k, core->idx));
                 KeSetTimerEx(&core->timer, DueTime, Period, dpc);
             }
+
+            if (period_shortest != LONG_MAX)
+                timer_resolution_request(period_shortest);
         }
         else if (action == PMU_CTL_STOP)
         {
@@ -737,10 +948,34 @@ clean_lock_acquire:
                 CoreInfo* core = &core_info[i];
                 if (core->timer_running)
                 {
-                    KeCancelTimer(&core->timer);
                     core->timer_running = 0;
+                    KeCancelTimer(&core->timer);
                 }
             }
+
+            // Timer DPC running on other core may have re-armed adaptive timer before it saw `timer_running` cleared
+            KeFlushQueuedDpcs();
+
+            for (auto k = 0; k < cores_count; k++)
+            {
+                int i = ctl_req->cores_idx.cores_no[k];
+                CoreInfo* core = &core_info[i];
+                KeCancelTimer(&core->timer);
+
+                if (!core->dpc_count)
+                    continue;
+
+                ctl_out.dpc_ticks += core->dpc_ticks;
+                ctl_out.dpc_count += core->dpc_count;
+                if (core->dpc_max_ticks > ctl_out.dpc_max_ticks)
+                    ctl_out.dpc_max_ticks = core->dpc_max_ticks;
+                if (!ctl_out.period_min || (UINT32)core->period_lo < ctl_out.period_min)
+                    ctl_out.period_min = (UINT32)core->period_lo;
+                if ((UINT32)core->period_hi > ctl_out.period_max)
+                    ctl_out.period_max = (UINT32)core->period_hi;
+            }
+
+            timer_resolution_release();
         }
         else if (action == PMU_CTL_RESET)
         {
@@ -798,7 +1033,13 @@ clean_lock_acquire:
             }
         }
 
+        // Output is optional, older wperf sends no output buffer
         *outputSize = 0;
+        if (OutBufSize >= sizeof(struct pmu_ctl_out))
+        {
+            RtlCopyMemory(pOutBuffer, &ctl_out, sizeof(struct pmu_ctl_out));
+            *outputSize = sizeof(struct pmu_ctl_out);
+        }
         break;
     }
     case IOCTL_PMU_CTL_QUERY_HW_CFG:
@@ -1044,16 +1285,31 @@ clean_lock_acquire:
             enum evt_class evt_class = hdr->evt_class;
             UINT16 evt_num = hdr->num;
             UINT16* raw_evts = (UINT16*)(hdr + 1);
+            const struct evt_sched_attr* attrs = NULL;
+            ULONG evt_sz = sizeof(struct evt_hdr) + evt_num * sizeof(UINT16);
+
+            if (hdr->flags & EVT_HDR_FLAG_SCHED)
+            {
+                attrs = (const struct evt_sched_attr*)(payload_addr + consumed_sz + evt_sz);
+                evt_sz += evt_num * sizeof(struct evt_sched_attr);
+            }
+
+            if (evt_sz > avail_sz - consumed_sz)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: PMU_CTL_ASSIGN_EVENTS payload truncated\n"));
+                status = STATUS_INVALID_PARAMETER;
+                break;
+            }
 
             if (evt_class == EVT_CORE)
             {
-                status = evt_assign_core(queueContext, core_base, core_end, evt_num, raw_evts, filter_bits);
+                status = evt_assign_core(core_base, core_end, evt_num, raw_evts, attrs, filter_bits);
                 if (status != STATUS_SUCCESS)
                     break;
             }
             else if (evt_class == EVT_DSU)
             {
-                status = evt_assign_dsu(queueContext, core_base, core_end, evt_num, raw_evts);
+                status = evt_assign_dsu(core_base, core_end, evt_num, raw_evts, attrs);
                 if (status != STATUS_SUCCESS)
                     break;
             }
@@ -1111,7 +1367,7 @@ clean_lock_acquire:
                 }
             }
 
-            consumed_sz += sizeof(struct evt_hdr) + evt_num * sizeof(UINT16);
+            consumed_sz += evt_sz;
         }
 
         *outputSize = 0;
@@ -1192,6 +1448,8 @@ clean_lock_acquire:
                 out_event->filter_bits = event->filter_bits;
                 out_event->scheduled = event->scheduled;
                 out_event->value = event->value;
+                out_event->delta_min = event->delta_min;
+                out_event->delta_max = event->delta_max;
             }
 
             outputSizeReturned += sizeof(ReadOut);
@@ -1205,6 +1463,123 @@ clean_lock_acquire:
         }
         break;
     }
+    case IOCTL_PMU_CTL_READ_COUNTING_BATCH:
+    {
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        struct pmu_ctl_hdr* ctl_req = (struct pmu_ctl_hdr*)pInBuffer;
+
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_READ_COUNTING_BATCH\n"));
+
+        if (InBufSize != sizeof(struct pmu_ctl_hdr))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for PMU_CTL_READ_COUNTING_BATCH\n", InBufSize));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        const BOOLEAN live = ctl_req->flags == (CTL_FLAG_CORE | CTL_FLAG_LIVE);
+
+        if (ctl_req->flags != CTL_FLAG_CORE && ctl_req->flags != CTL_FLAG_DSU && !live)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid flags 0x%X for PMU_CTL_READ_COUNTING_BATCH\n", ctl_req->flags));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (!check_cores_in_pmu_ctl_hdr_p(ctl_req))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid cores_no for action %d\n", action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        struct counting_snapshot_hdr* snapshot = counting_snapshot_init(pOutBuffer, OutBufSize);
+        if (!snapshot)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: OutBufSize %ld too small for PMU_CTL_READ_COUNTING_BATCH\n", OutBufSize));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        const BOOLEAN dsu = ctl_req->flags == CTL_FLAG_DSU;
+        struct broadcast_req req = { 0 };
+
+        // One entry per requested core with only used events, see wperf-common/snapshot.h
+        for (size_t k = 0; k < ctl_req->cores_idx.cores_count; k++)
+        {
+            UINT8 core_idx = ctl_req->cores_idx.cores_no[k];
+
+            if (core_idx >= numCores)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %d for PMU_CTL_READ_COUNTING_BATCH\n", core_idx));
+                status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            // Every core is queued once in the broadcast below
+            BOOLEAN duplicate = FALSE;
+            for (size_t m = 0; live && m < k; m++)
+                duplicate |= ctl_req->cores_idx.cores_no[m] == core_idx;
+
+            if (duplicate)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: duplicate core_idx %d for PMU_CTL_READ_COUNTING_BATCH\n", core_idx));
+                status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            CoreInfo* core = &core_info[core_idx];
+            UINT32 events_num = dsu ? core->dsu_events_num : core->events_num;
+            struct pmu_event_pseudo* events = dsu ? core->dsu_events : core->events;
+
+            struct counting_snapshot_entry* entry = counting_snapshot_add(snapshot, OutBufSize, core_idx, events_num, core->timer_round);
+            if (!entry)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: OutBufSize %ld too small for PMU_CTL_READ_COUNTING_BATCH\n", OutBufSize));
+                status = STATUS_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            // Live entries are filled by their cores below, each core gets offset of its entry
+            if (live)
+            {
+                req.live_offset[core_idx] = (UINT32)((UINT8*)entry - (UINT8*)snapshot);
+                continue;
+            }
+
+            for (UINT32 j = 0; j < events_num; j++)
+            {
+                struct pmu_event_pseudo* event = events + j;
+                struct pmu_event_usr* out_event = &entry->evts[j];
+                out_event->event_idx = event->event_idx;
+                out_event->filter_bits = dsu ? 0 : event->filter_bits;
+                out_event->scheduled = event->scheduled;
+                out_event->value = event->value;
+                out_event->delta_min = event->delta_min;
+                out_event->delta_max = event->delta_max;
+            }
+        }
+
+        // Read all cores at once while they keep counting, so readings of all cores are from the same moment
+        if (live && NT_SUCCESS(status) && snapshot->entry_num)
+        {
+            req.live = snapshot;
+
+            KIRQL old_irql = broadcast_begin(&req, (LONG)ctl_req->cores_idx.cores_count);
+            for (size_t k = 0; k < ctl_req->cores_idx.cores_count; k++)
+                broadcast_queue(&req, ctl_req->cores_idx.cores_no[k], FALSE);
+            broadcast_end(&req, old_irql, NULL);
+        }
+
+        *outputSize = NT_SUCCESS(status) ? snapshot->size : 0;
+        break;
+    }
     case IOCTL_DSU_CTL_INIT:
     {
         // Check if current file_object is the owner of the lock
@@ -1328,6 +1703,8 @@ clean_lock_acquire:
                 out_event->event_idx = event->event_idx;
                 out_event->scheduled = event->scheduled;
                 out_event->value = event->value;
+                out_event->delta_min = event->delta_min;
+                out_event->delta_max = event->delta_max;
             }
 
             outputSizeReturned += sizeof(DSUReadOut);
@@ -39,6 +39,7 @@
 #include "core.h"
 #include "coreinfo.h"
 #include "sysregs.h"
+#include "wperf-common\snapshot.h"
 #if defined(ENABLE_ETW_TRACING)
 #include "wperf-driver-etw.h"
 #endif
@@ -59,7 +60,6 @@ extern UINT64 midr_value;
 extern HANDLE pmc_resource_handle;
 extern CoreInfo* core_info;
 KEVENT sync_reset_dpc;
-extern UINT64* last_fpc_read;
 extern UINT8 counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
 extern struct pmu_event_kernel default_events[AARCH64_MAX_HWC_SUPP + numFPC];
 extern running;
@@ -81,12 +81,12 @@ static UINT64 get_fixed_counter_value(UINT64 core_idx)
     UINT64 curr = _ReadStatusReg(PMCCNTR_EL0);
 
     // We no longer reset the fixed counter so we need to keep track of its last value
-    UINT64 delta = curr - last_fpc_read[core_idx];
+    UINT64 delta = curr - core_info[core_idx].last_fpc_read;
 
     // Just to avoid astronomical numbers when something weird happens
-    delta = curr < last_fpc_read[core_idx] ? 0 : delta;
+    delta = curr < core_info[core_idx].last_fpc_read ? 0 : delta;
 
-    last_fpc_read[core_idx] = curr;
+    core_info[core_idx].last_fpc_read = curr;
     return delta;
 }
 
@@ -122,9 +122,38 @@ static VOID update_core_counting(CoreInfo* core)
     CoreCounterStart();
 }
 
+// Account time spent in counting timer DPC and adjust adaptive timer period
+static VOID timer_dpc_end(CoreInfo* core, PRKDPC dpc, UINT64 dpc_start, UINT64 cycles)
+{
+    if (core->period_target && core->last_vct)
+    {
+        bool idle = core->prof_core == PROF_MULTIPLEX && mpx_period_idle(cycles, dpc_start - core->last_vct, &core->peak_rate);
+        LONG period = mpx_period_next(core->period, core->period_target, core->period_max, idle);
+
+        // PMU_CTL_STOP clears `timer_running` before it cancels the timer, do not re-arm it
+        if (period != core->period && core->timer_running)
+        {
+            LARGE_INTEGER DueTime;
+            DueTime.QuadPart = (LONGLONG)period * -10000;
+            core->period = period;
+            if (period < core->period_lo)
+                core->period_lo = period;
+            if (period > core->period_hi)
+                core->period_hi = period;
+            KeSetTimerEx(&core->timer, DueTime, period, dpc);
+        }
+    }
+    core->last_vct = dpc_start;
+
+    UINT64 ticks = (UINT64)_ReadStatusReg(CNTVCT_EL0) - dpc_start;
+    core->dpc_ticks += ticks;
+    if (ticks > core->dpc_max_ticks)
+        core->dpc_max_ticks = ticks;
+    core->dpc_count++;
+}
+
 VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
 {
-    UNREFERENCED_PARAMETER(dpc);
     UNREFERENCED_PARAMETER(sys_arg1);
     UNREFERENCED_PARAMETER(sys_arg2);
 
@@ -138,8 +167,9 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         return;
 
     CoreInfo* core = (CoreInfo*)ctx;
-    UINT64 round = core->timer_round;
-    UINT64 new_round = round + 1;
+    UINT64 new_round = core->timer_round + 1;
+    UINT64 dpc_start = (UINT64)_ReadStatusReg(CNTVCT_EL0);
+    UINT64 cycles = 0;
 
     if (core->prof_core == PROF_NORMAL)
     {
@@ -148,40 +178,42 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
     else if (core->prof_core == PROF_MULTIPLEX)
     {
         struct pmu_event_pseudo* events = core->events;
-        UINT32 events_num = core->events_num;
-
-        UINT32 event_start_idx1 = (numFreeGPC * round) % (events_num - numFPC);
-        UINT32 event_start_idx2 = (numFreeGPC * new_round) % (events_num - numFPC);
 
         CoreCounterStop();
 
         //Only one FPC, cycle counter
         //We will improve the logic handling FPC later
-        events[0].value += get_fixed_counter_value(core->idx); //_ReadStatusReg(PMCCNTR_EL0);
+        cycles = get_fixed_counter_value(core->idx);
+        events[0].value += cycles;
         events[0].scheduled += 1;
 
-        for (UINT32 i = 0; i < numFreeGPC; i++)
+        for (UINT32 i = 0; i < core->sched_slots_num; i++)
         {
-            UINT32 adjusted_idx = (event_start_idx1 + i) % (events_num - numFPC);
-            events[adjusted_idx + numFPC].value += core_read_counter_helper(i);
-            events[adjusted_idx + numFPC].scheduled += 1;
+            struct pmu_event_pseudo* event = &events[numFPC + core->sched_slots[i]];
+            mpx_sched_account(core_read_counter_helper(i), &event->value, &event->scheduled, &event->delta_min, &event->delta_max);
         }
 
         update_last_fixed_counter(core->idx);
         CoreCounterReset();
 
-        for (UINT32 i = 0; i < numFreeGPC; i++)
+        core->sched_slots_num = mpx_sched_next(&core->sched, core->sched_slots, numFreeGPC);
+
+        for (UINT32 i = 0; i < core->sched_slots_num; i++)
         {
-            UINT32 adjusted_idx = (event_start_idx2 + i) % (events_num - numFPC);
+            struct pmu_event_pseudo* next = &events[numFPC + core->sched_slots[i]];
 
             struct pmu_event_kernel event;
-            event.event_idx = events[adjusted_idx + numFPC].event_idx;
-            event.filter_bits = events[adjusted_idx + numFPC].filter_bits;
+            event.event_idx = next->event_idx;
+            event.filter_bits = next->filter_bits;
             event.counter_idx = i;
             event.enable_irq = 0;
             event_enable(&event);
         }
 
+        // Counters not used in this round (next unit did not fit)
+        for (UINT32 i = core->sched_slots_num; i < numFreeGPC; i++)
+            CoreCounterDisable(1U << counter_idx_map[i]);
+
         CoreCounterStart();
     }
 
@@ -192,10 +224,6 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
     else if (core->prof_dsu == PROF_MULTIPLEX)
     {
         struct pmu_event_pseudo* events = core->dsu_events;
-        UINT32 events_num = core->dsu_events_num;
-
-        UINT32 event_start_idx1 = (dsu_numGPC * round) % (events_num - dsu_numFPC);
-        UINT32 event_start_idx2 = (dsu_numGPC * new_round) % (events_num - dsu_numFPC);
 
         DSUCounterStop();
 
@@ -204,21 +232,20 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         events[0].value += DSUReadPMCCNTR();
         events[0].scheduled += 1;
 
-        for (UINT32 i = 0; i < dsu_numGPC; i++)
+        for (UINT32 i = 0; i < core->dsu_sched_slots_num; i++)
         {
-            UINT32 adjusted_idx = (event_start_idx1 + i) % (events_num - dsu_numFPC);
-            events[adjusted_idx + dsu_numFPC].value += DSUReadCounter(i);
-            events[adjusted_idx + dsu_numFPC].scheduled += 1;
+            struct pmu_event_pseudo* event = &events[dsu_numFPC + core->dsu_sched_slots[i]];
+            mpx_sched_account(DSUReadCounter(i), &event->value, &event->scheduled, &event->delta_min, &event->delta_max);
         }
 
         DSUCounterReset();
 
-        for (UINT32 i = 0; i < dsu_numGPC; i++)
-        {
-            UINT32 adjusted_idx = (event_start_idx2 + i) % (events_num - dsu_numFPC);
+        core->dsu_sched_slots_num = mpx_sched_next(&core->dsu_sched, core->dsu_sched_slots, dsu_numGPC);
 
+        for (UINT32 i = 0; i < core->dsu_sched_slots_num; i++)
+        {
             struct pmu_event_kernel event;
-            event.event_idx = events[adjusted_idx + dsu_numFPC].event_idx;
+            event.event_idx = events[dsu_numFPC + core->dsu_sched_slots[i]].event_idx;
             event.counter_idx = i;
             DSUEventEnable(&event);
         }
@@ -230,13 +257,13 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         UpdateDmcCounting(core->dmc_ch, &dmc_array);
 
     core->timer_round = new_round;
+    timer_dpc_end(core, dpc, dpc_start, cycles);
 }
 
 // When there is no event multiplexing, we still need to use multiplexing-like timer for
 // collecting counter value before overflow.
 VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
 {
-    UNREFERENCED_PARAMETER(dpc);
     UNREFERENCED_PARAMETER(sys_arg1);
     UNREFERENCED_PARAMETER(sys_arg2);
 
@@ -250,6 +277,8 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         return;
 
     CoreInfo* core = (CoreInfo*)ctx;
+    UINT64 dpc_start = (UINT64)_ReadStatusReg(CNTVCT_EL0);
+
     if (core->prof_core != PROF_DISABLED)
         update_core_counting(core);
 
@@ -260,6 +289,7 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         UpdateDmcCounting(core->dmc_ch, &dmc_array);
 
     core->timer_round++;
+    timer_dpc_end(core, dpc, dpc_start, 0);
 }
 
 VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
@@ -288,6 +318,167 @@ VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         KeSetEvent(&sync_reset_dpc, 0, FALSE);
 }
 
+/// <summary>
+/// Fill live snapshot entry of `core` without stopping its counters: values
+/// folded in by timer DPCs plus values counted since, see wperf-common/snapshot.h.
+/// Timer DPCs of the core run at the same IRQL on the same core, so they do
+/// not interleave with this read. Entry is at `offset` bytes in `snapshot`,
+/// precomputed when the snapshot was built so no core walks other entries.
+/// </summary>
+static VOID core_snapshot_live(CoreInfo* core, struct counting_snapshot_hdr* snapshot, UINT32 offset)
+{
+    if (offset < sizeof(struct counting_snapshot_hdr) || offset + FIELD_OFFSET(struct counting_snapshot_entry, evts) > snapshot->size)
+        return;
+
+    struct counting_snapshot_entry* entry = (struct counting_snapshot_entry*)((UINT8*)snapshot + offset);
+    if (entry->core_idx != core->idx)
+        return;
+
+    struct pmu_event_pseudo* events = core->events;
+    UINT32 events_num = entry->evt_num < core->events_num ? entry->evt_num : core->events_num;
+
+    entry->round = core->timer_round;
+    for (UINT32 j = 0; j < events_num; j++)
+    {
+        struct pmu_event_usr* out_event = &entry->evts[j];
+        out_event->event_idx = events[j].event_idx;
+        out_event->filter_bits = events[j].filter_bits;
+        out_event->scheduled = events[j].scheduled;
+        out_event->value = events[j].value;
+        out_event->delta_min = events[j].delta_min;
+        out_event->delta_max = events[j].delta_max;
+    }
+
+    if (!running || !core->timer_running || current_status.status == STS_IDLE)
+        return;
+
+    // Same as get_fixed_counter_value() but `last_fpc_read` is left for the next timer DPC
+    UINT64 curr = _ReadStatusReg(PMCCNTR_EL0);
+    UINT64 cycles = curr < core->last_fpc_read ? 0 : curr - core->last_fpc_read;
+
+    // Round in flight is accounted as the next timer DPC will do it: in `round` and in
+    // `scheduled` of every event counted in it, so values and scaling cover the same rounds
+    if (core->prof_core == PROF_NORMAL)
+    {
+        entry->round++;
+        for (UINT32 j = 0; j < events_num; j++)
+        {
+            entry->evts[j].value += events[j].event_idx == CYCLE_EVENT_IDX ? cycles : core_read_counter_helper(events[j].counter_idx);
+            entry->evts[j].scheduled++;
+        }
+    }
+    else if (core->prof_core == PROF_MULTIPLEX && events_num)
+    {
+        entry->round++;
+        entry->evts[0].value += cycles;
+        entry->evts[0].scheduled++;
+        for (UINT32 i = 0; i < core->sched_slots_num; i++)
+        {
+            UINT32 j = numFPC + core->sched_slots[i];
+            if (j < events_num)
+            {
+                entry->evts[j].value += core_read_counter_helper(i);
+                entry->evts[j].scheduled++;
+            }
+        }
+    }
+}
+
+VOID broadcast_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
+{
+    UNREFERENCED_PARAMETER(dpc);
+
+    CoreInfo* core = (CoreInfo*)ctx;
+    struct broadcast_req* req = (struct broadcast_req*)sys_arg1;
+    BOOLEAN dsu_head = (BOOLEAN)(ULONG_PTR)sys_arg2;
+
+    // Always complete, thread in `broadcast_end` waits for all queued cores
+    broadcast_barrier_wait(&req->barrier, BROADCAST_SPIN_LIMIT);
+    broadcast_barrier_record(&req->barrier, (LONG64)_ReadStatusReg(CNTVCT_EL0));
+
+    if (req->core_func)
+        req->core_func();
+    if (req->dsu_func && dsu_head)
+        req->dsu_func();
+
+    if (req->event_func && !req->dsu_events)
+    {
+        for (UINT32 j = 0; j < core->sched_slots_num; j++)
+            req->event_func((struct pmu_event_kernel*)&core->events[numFPC + core->sched_slots[j]]);
+    }
+    else if (req->event_func && dsu_head)
+    {
+        for (UINT32 j = 0; j < core->dsu_sched_slots_num; j++)
+            req->event_func((struct pmu_event_kernel*)&core->dsu_events[dsu_numFPC + core->dsu_sched_slots[j]]);
+    }
+
+    if (req->live)
+        core_snapshot_live(core, req->live, req->live_offset[core->idx]);
+
+    if (broadcast_barrier_complete(&req->barrier))
+        KeSetEvent(&req->done, 0, FALSE);
+}
+
+/// <summary>
+/// Start broadcasting `req` to `cores_count` cores. IRQL is raised so that DPC
+/// targeted to the current core does not run (and spin) before all DPCs are queued.
+/// </summary>
+KIRQL broadcast_begin(struct broadcast_req* req, LONG cores_count)
+{
+    KIRQL old_irql;
+
+    broadcast_barrier_init(&req->barrier, cores_count);
+    KeInitializeEvent(&req->done, NotificationEvent, FALSE);
+    KeRaiseIrql(DISPATCH_LEVEL, &old_irql);
+    return old_irql;
+}
+
+/// <summary>
+/// Queue broadcast DPC of `core_idx`. `dsu_head` selects core which executes `req->dsu_func`.
+/// </summary>
+/// <returns>FALSE if DPC was already queued, core is then removed from the barrier</returns>
+BOOLEAN broadcast_queue(struct broadcast_req* req, UINT32 core_idx, BOOLEAN dsu_head)
+{
+    if (KeInsertQueueDpc(&core_info[core_idx].dpc_broadcast, req, (PVOID)(ULONG_PTR)dsu_head))
+        return TRUE;
+
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "broadcast: DPC of core %u already queued\n", core_idx));
+    if (broadcast_barrier_leave(&req->barrier))
+        KeSetEvent(&req->done, 0, FALSE);
+    return FALSE;
+}
+
+/// <summary>
+/// Wait until all queued cores executed the action. Fill `out` (optional) with measured skew.
+/// </summary>
+VOID broadcast_end(struct broadcast_req* req, KIRQL old_irql, struct pmu_ctl_out* out)
+{
+    LARGE_INTEGER timeout;
+
+    KeLowerIrql(old_irql);
+
+    // DPCs give up spinning after `BROADCAST_SPIN_LIMIT`, completion should never take this long
+    timeout.QuadPart = -10000LL * BROADCAST_WAIT_TIMEOUT_MS;     // Relative, in 100 ns units
+    if (KeWaitForSingleObject(&req->done, Executive, KernelMode, FALSE, &timeout) == STATUS_TIMEOUT)
+    {
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "broadcast: timed out with %ld of %ld cores completed\n",
+            req->barrier.completed, req->barrier.count));
+        KeFlushQueuedDpcs();    // `req` lives on the caller's stack, queued DPCs must not outlive it
+    }
+
+    UINT64 skew = broadcast_barrier_skew(&req->barrier);
+    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "broadcast: %ld cores, skew %llu ticks, %ld timeouts\n",
+        req->barrier.count, skew, req->barrier.timeouts));
+
+    if (out)
+    {
+        out->skew = skew;
+        out->timer_freq = (UINT64)_ReadStatusReg(CNTFRQ_EL0);
+        out->cores_count = (UINT32)req->barrier.completed;
+        out->timeouts = (UINT32)req->barrier.timeouts;
+    }
+}
+
 VOID arm64pmc_enable_default(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
 {
     UNREFERENCED_PARAMETER(dpc);
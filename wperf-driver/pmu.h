@@ -46,6 +46,8 @@ struct pmu_event_pseudo
     UINT32 enable_irq;
     UINT64 value;
     UINT64 scheduled;
+    UINT64 delta_min;
+    UINT64 delta_max;
 };
 
 struct pmu_event_kernel
@@ -39,9 +39,6 @@
 #endif
 
 SpeInfo* spe_info = NULL;
-static __declspec(align(64)) unsigned char SpeMemoryBuffer[SPE_MEMORY_BUFFER_SIZE];
-static __declspec(align(64)) unsigned char* SpeMemoryBufferLimit = NULL;
-static unsigned char* lastCopiedPtr = NULL;
 
 size_t spe_bytesToCopy = 0;
 
@@ -60,6 +57,15 @@ static ULONG totalCores = 0;
 
 #define STOP_WORK_ON_CORE()  KeRevertToUserGroupAffinityThread(&old_affinity);
 
+// Point profiling buffer of current core at ACTIVE buffer of `dbuf` and enable it
+static void spe_buffer_enable(struct spe_dbuf* dbuf)
+{
+    _WriteStatusReg(PMBPTR_EL1, (UINT64)dbuf->base[dbuf->active]);
+    _WriteStatusReg(PMBSR_EL1, _ReadStatusReg(PMBSR_EL1) & (~PMBSR_EL1_S)); // Clear PMBSR_EL1.S
+    //PMBPTR_EL1[63:56] must equal PMBLIMITR_EL1.LIMIT[63:56]
+    _WriteStatusReg(PMBLIMITR_EL1, (spe_dbuf_limit(dbuf) & PMBLIMITR_EL1_LIMIT_MASK) | PMBLIMITR_EL1_E); // Enable PMBLIMITR_ELI1.E
+}
+
 VOID SPEWorkItemFunc(WDFWORKITEM WorkItem)
 {
 	PSPE_WORK_ITEM_CTXT context;
@@ -69,12 +75,10 @@ VOID SPEWorkItemFunc(WDFWORKITEM WorkItem)
     {
         case PMU_CTL_SPE_START:
         {
-            RtlSecureZeroMemory(SpeMemoryBuffer, sizeof(SpeMemoryBuffer));
+            SpeInfo* spu = &spe_info[context->core_idx];
 
             START_WORK_ON_CORE(context->core_idx);
-            
-            _WriteStatusReg(PMBPTR_EL1, (UINT64)SpeMemoryBuffer);
-           
+
             /*
             * Writing to PMSIRR_EL1 and PMSICR_EL1 seems to be innefective for some reason.
             * When PMSIRR_EL1 is written to its value just goes to 0 and PMSICR_EL1 seems to be unchanged.
@@ -145,15 +149,16 @@ VOID SPEWorkItemFunc(WDFWORKITEM WorkItem)
                 KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SPE: ts_enable=1 PMSICR_EL1=0x%llX\n", _ReadStatusReg(PMSCR_EL1) & 0b11111011));
             }
 
-            _WriteStatusReg(PMBSR_EL1, _ReadStatusReg(PMBSR_EL1) & (~PMBSR_EL1_S)); // Clear PMBSR_EL1.S
-            //PMBPTR_EL1[63:56] must equal PMBLIMITR_EL1.LIMIT[63:56]
-            _WriteStatusReg(PMBLIMITR_EL1, (UINT64)SpeMemoryBufferLimit | PMBLIMITR_EL1_E); // Enable PMBLIMITR_ELI1.E
+            KIRQL irql;
+            KeAcquireSpinLock(&spu->lock, &irql);
+            spe_buffer_enable(&spu->dbuf);
+            KeReleaseSpinLock(&spu->lock, irql);
             _WriteStatusReg(PMSCR_EL1, _ReadStatusReg(PMSCR_EL1) | PMSCR_EL1_E0SPE_E1SPE); // Enable PMSCR_EL1.{E0SPE,E1SPE}
 
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer 0x%llX\n", _ReadStatusReg(PMBPTR_EL1)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer limit address %llX\n", _ReadStatusReg(PMBLIMITR_EL1)));
-            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer real address %llX\n", (UINT64)SpeMemoryBuffer));
-            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer real limit address %llX\n", (UINT64)SpeMemoryBufferLimit));
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer real address %llX\n", (UINT64)spu->dbuf.base[spu->dbuf.active]));
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer real limit address %llX\n", spe_dbuf_limit(&spu->dbuf)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: sampling profile ID register %llX\n", _ReadStatusReg(PMSIDR_EL1)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: PMSFCR_EL1 0x%llX\n", _ReadStatusReg(PMSFCR_EL1)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: PMSEVFR_EL1 0x%llX\n", _ReadStatusReg(PMSEVFR_EL1)));
@@ -165,14 +170,19 @@ VOID SPEWorkItemFunc(WDFWORKITEM WorkItem)
         }
         case PMU_CTL_SPE_GET_SIZE:
         {
+            SpeInfo* spu = &spe_info[context->core_idx];
+
             START_WORK_ON_CORE(context->core_idx);
-            UINT64 currentBufferPtr = _ReadStatusReg(PMBPTR_EL1);
+
+            // Holding the lock on profiled core keeps SPE DPC from swapping buffers under PMBPTR_EL1 read
+            KIRQL irql;
+            KeAcquireSpinLock(&spu->lock, &irql);
+            spe_bytesToCopy = (size_t)spe_dbuf_pending(&spu->dbuf, _ReadStatusReg(PMBPTR_EL1));
+            KeReleaseSpinLock(&spu->lock, irql);
 
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: PMSICR_EL1 0x%llX\n", _ReadStatusReg(PMSICR_EL1)));
 
             STOP_WORK_ON_CORE();
-
-            spe_bytesToCopy += (currentBufferPtr - (UINT64)lastCopiedPtr);
             break;
         }
         case PMU_CTL_SPE_STOP:
@@ -189,13 +199,16 @@ VOID SPEWorkItemFunc(WDFWORKITEM WorkItem)
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer 0x%llX\n", _ReadStatusReg(PMBPTR_EL1)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: memory buffer limit address %llX\n", _ReadStatusReg(PMBLIMITR_EL1)));
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: profiling buffer status/syndrome %llX\n", _ReadStatusReg(PMBSR_EL1)));
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "Statistical Profiling Extension: buffer swaps %llu stalls %llu\n",
+                spe_info[context->core_idx].dbuf.swaps, spe_info[context->core_idx].dbuf.stalls));
 
             break;
         }
     }
 }
 
-// mitigating lack of interrupt handler for buffer full event.
+// mitigating lack of interrupt handler for buffer full event: runs periodically on profiled core,
+// swaps hardware to spare buffer when active one is (nearly) full and resumes stalled capture.
 static VOID dpc_spe_overflow(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
 {
     UNREFERENCED_PARAMETER(dpc);
@@ -208,16 +221,31 @@ static VOID dpc_spe_overflow(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SPE_DPC core_idx %u running at %u\n", spu->idx, KeGetCurrentProcessorNumberEx(NULL)));
     if(spu->profiling_running == TRUE)
     {
+        KeAcquireSpinLockAtDpcLevel(&spu->lock);
+
         UINT64 currentBufferPtr = _ReadStatusReg(PMBPTR_EL1);
-        if (currentBufferPtr - (UINT64)SpeMemoryBufferLimit <= SPE_BUFFER_THRESHOLD)
+        bool stopped = (_ReadStatusReg(PMBSR_EL1) & PMBSR_EL1_S) != 0;
+        UINT8* next = NULL;
+
+        if (spe_dbuf_should_swap(&spu->dbuf, currentBufferPtr, SPE_BUFFER_THRESHOLD, stopped))
         {
-            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SPE_DPC profiling buffer full\n"));
-            //Disable sampling
-            _WriteStatusReg(PMBLIMITR_EL1, 0); // Disable PMBLIMITR_ELI1.E
-            _WriteStatusReg(PMBSR_EL1, _ReadStatusReg(PMBSR_EL1) & (~PMBSR_EL1_S)); // Clear PMBSR_EL1.S
-            _WriteStatusReg(PMSCR_EL1, _ReadStatusReg(PMSCR_EL1) & (~PMSCR_EL1_E0SPE_E1SPE)); // Disable PMSCR_EL1.{E0SPE,E1SPE}
-            spu->profiling_running = FALSE;
+            _WriteStatusReg(PMBLIMITR_EL1, 0); // Disable PMBLIMITR_ELI1.E, no more writes to this buffer
+            next = spe_dbuf_swap(&spu->dbuf, _ReadStatusReg(PMBPTR_EL1));
+            if (next == NULL)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SPE_DPC profiling buffers full, capture stalled\n"));
+                _WriteStatusReg(PMBSR_EL1, _ReadStatusReg(PMBSR_EL1) & (~PMBSR_EL1_S)); // Clear PMBSR_EL1.S
+            }
+        }
+        else
+        {
+            next = spe_dbuf_resume(&spu->dbuf);
         }
+
+        if (next)
+            spe_buffer_enable(&spu->dbuf);
+
+        KeReleaseSpinLockFromDpcLevel(&spu->lock);
     }
 }
 
@@ -234,14 +262,14 @@ NTSTATUS spe_setup(ULONG numCores)
     
     totalCores = numCores;
 
-    SpeMemoryBufferLimit = (unsigned char*)(((UINT64)SpeMemoryBuffer + SPE_MEMORY_BUFFER_SIZE) & PMBLIMITR_EL1_LIMIT_MASK);
-
     for (ULONG i = 0; i < numCores; i++)
     {
         SpeInfo* spu = &spe_info[i];
         spu->profiling_running = FALSE;
         spu->timer_running = FALSE;
         spu->idx = i;
+        spu->dbuf.active = SPE_DBUF_NONE;
+        KeInitializeSpinLock(&spu->lock);
 
         PROCESSOR_NUMBER ProcNumber;
         NTSTATUS status = KeGetProcessorNumberFromIndex(i, &ProcNumber);
@@ -272,6 +300,10 @@ void spe_destroy()
             spu->timer_running = FALSE;
 
             KeRemoveQueueDpc(&spu->dpc_overflow);
+
+            for (ULONG b = 0; b < SPE_DBUF_COUNT; b++)
+                if (spu->buffers[b])
+                    ExFreePoolWithTag(spu->buffers[b], 'SPEB');
         }
         ExFreePoolWithTag(spe_info, 'SPE');
     }
@@ -301,10 +333,20 @@ void spe_get_buffer(WDFWORKITEM* workItem, UINT32 core_idx, PVOID target, UINT64
 {
 #ifdef ENABLE_SPE
     UNREFERENCED_PARAMETER(workItem);
-    UNREFERENCED_PARAMETER(core_idx);
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SPE_GET_BUFFER target %llX %llu\n", (UINT64)target, size));
-    RtlCopyMemory(target, lastCopiedPtr, sizeof(unsigned char)*size);
-    lastCopiedPtr += size;
+
+    if (core_idx >= totalCores)
+    {
+        spe_bytesToCopy = 0;
+        return;
+    }
+
+    // Copy at most what PMU_CTL_SPE_GET_SIZE reported, drained FULL buffers become spare buffers again
+    SpeInfo* spu = &spe_info[core_idx];
+    KIRQL irql;
+    KeAcquireSpinLock(&spu->lock, &irql);
+    spe_bytesToCopy = (size_t)spe_dbuf_copy_out(&spu->dbuf, (UINT8*)target, size < spe_bytesToCopy ? size : spe_bytesToCopy);
+    KeReleaseSpinLock(&spu->lock, irql);
 #else
     UNREFERENCED_PARAMETER(workItem);
     UNREFERENCED_PARAMETER(core_idx);
@@ -320,7 +362,6 @@ void spe_init(WDFWORKITEM* workItem)
 
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SPE_INIT\n"));
 
-    lastCopiedPtr = SpeMemoryBuffer;
     spe_bytesToCopy = 0;
 #else
     UNREFERENCED_PARAMETER(workItem);
@@ -334,8 +375,29 @@ void spe_start(WDFWORKITEM* workItem, struct spe_ctl_hdr *req)
 #ifdef ENABLE_SPE
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SPE_START core_idx %u\n", core_idx));
 
+    if (core_idx >= totalCores) return;
+
     if (spe_info[core_idx].timer_running == TRUE) KeCancelTimer(&spe_info[core_idx].timer);
 
+    // Per-core capture buffers are allocated once and reused by following sessions
+    SpeInfo* spu = &spe_info[core_idx];
+    for (ULONG b = 0; b < SPE_DBUF_COUNT; b++)
+    {
+        if (spu->buffers[b] == NULL)
+            spu->buffers[b] = (UINT8*)ExAllocatePool2(POOL_FLAG_NON_PAGED, SPE_MEMORY_BUFFER_SIZE, 'SPEB');
+        if (spu->buffers[b] == NULL)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "SPE: failed to allocate capture buffer for core %u\n", core_idx));
+            return;
+        }
+        RtlSecureZeroMemory(spu->buffers[b], SPE_MEMORY_BUFFER_SIZE);
+    }
+
+    KIRQL irql;
+    KeAcquireSpinLock(&spu->lock, &irql);
+    spe_dbuf_init(&spu->dbuf, spu->buffers, SPE_MEMORY_BUFFER_SIZE);
+    KeReleaseSpinLock(&spu->lock, irql);
+
     KeInitializeTimer(&spe_info[core_idx].timer);
     
     const LONGLONG ns100 = -10000; // negative, the expiration time is relative to the current system time
@@ -29,6 +29,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "wperf-common/iorequest.h"
+#include "wperf-common/spebuffer.h"
 
 //
 // Arm Statistical Profiling Extensions (SPE)
@@ -51,9 +52,10 @@
 #define PMSIRR_EL1_RND                      BIT(0)
 #define PMBLIMITR_EL1_LIMIT_MASK            (~((UINT64)0xFFF))  // PMBLIMITR.LIMIT, bits [63:12]
 
-#define SPE_MEMORY_BUFFER_SIZE              (PAGE_SIZE*128)     // PAGE_SIZE is defined in WDM.h
+#define SPE_MEMORY_BUFFER_SIZE              (PAGE_SIZE*128)     // Size of each of SPE_DBUF_COUNT per-core buffers, PAGE_SIZE is defined in WDM.h
 #define SPE_TIMER_PERIOD                    500
-#define SPE_BUFFER_THRESHOLD                256
+#define SPE_RECORD_MAX_SIZE                 2048                // Largest record size PMSIDR_EL1.MaxSize allows
+#define SPE_BUFFER_THRESHOLD                (SPE_RECORD_MAX_SIZE*4)     // Swap to spare buffer when less than a few records fit
 
 typedef struct spe_info_
 {
@@ -63,6 +65,10 @@ typedef struct spe_info_
 
     BOOLEAN     profiling_running;
     BOOLEAN     timer_running;
+
+    KSPIN_LOCK  lock;                           // Serializes `dbuf` between SPE DPC and IOCTL handlers
+    UINT8*      buffers[SPE_DBUF_COUNT];        // Allocated on first PMU_CTL_SPE_START on this core
+    struct spe_dbuf dbuf;
 } SpeInfo;
 
 #define SPE_IOCTL                                                                                                       \
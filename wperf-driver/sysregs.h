@@ -56,6 +56,8 @@
 #define ID_DFR0_EL1					ARM64_SYSREG(1, 0, 0,  5, 0)
 #define MIDR_EL1					ARM64_SYSREG(1, 0, 0,  0, 0)
 #define ID_AA64DFR0_EL1				ARM64_SYSREG(3, 0, 0,  5, 0)
+#define CNTFRQ_EL0					ARM64_SYSREG(1, 3, 14, 0, 0)
+#define CNTVCT_EL0					ARM64_SYSREG(1, 3, 14, 0, 2)
 
 #define PMEVTYPER0_EL0				ARM64_SYSREG(1, 3, 14, 12, 0)
 #define PMEVTYPER1_EL0				ARM64_SYSREG(1, 3, 14, 12, 1)
@@ -35,14 +35,15 @@
 #include "utilities.tmh"
 #endif
 #include "sysregs.h"
+#include "coreinfo.h"
 
-extern UINT64* last_fpc_read;
+extern CoreInfo* core_info;
 extern UINT8   counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
 
 // Just update last_fpc_read, this is the fixed counter equivalent to CoreCounterReset
 void update_last_fixed_counter(UINT64 core_idx)
 {
-    last_fpc_read[core_idx] = _ReadStatusReg(PMCCNTR_EL0);
+    core_info[core_idx].last_fpc_read = _ReadStatusReg(PMCCNTR_EL0);
 }
 extern LOCK_STATUS   current_status;
 
@@ -97,6 +98,9 @@ static PCHAR GetIoctlStr(ULONG ioctl)
     case IOCTL_PMU_CTL_SAMPLE_START:        return "IOCTL_PMU_CTL_SAMPLE_START";
     case IOCTL_PMU_CTL_SAMPLE_STOP:         return "IOCTL_PMU_CTL_SAMPLE_STOP";
     case IOCTL_PMU_CTL_SAMPLE_GET:          return "IOCTL_PMU_CTL_SAMPLE_GET";
+    case IOCTL_PMU_CTL_SAMPLE_MAP:          return "IOCTL_PMU_CTL_SAMPLE_MAP";
+    case IOCTL_PMU_CTL_SAMPLE_UNMAP:        return "IOCTL_PMU_CTL_SAMPLE_UNMAP";
+    case IOCTL_PMU_CTL_READ_COUNTING_BATCH: return "IOCTL_PMU_CTL_READ_COUNTING_BATCH";
     case IOCTL_PMU_CTL_LOCK_ACQUIRE:        return "IOCTL_PMU_CTL_LOCK_ACQUIRE";
     case IOCTL_PMU_CTL_LOCK_RELEASE:        return "IOCTL_PMU_CTL_LOCK_RELEASE";
     default:                                return "unknown IOCTL!";
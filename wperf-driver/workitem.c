@@ -116,89 +116,7 @@ VOID EvtWorkItemFunc(WDFWORKITEM WorkItem)
     
     KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%!FUNC! Entry for action %d\n", action));
 
-    if (action == PMU_CTL_ASSIGN_EVENTS)
-    {
-        VOID(*func)(struct pmu_event_kernel* event) = NULL;
-        if (context->isDSU)
-        {
-            func = DSUEventEnable;
-        }
-        else {
-            func = event_enable;
-        }
-
-        for (UINT32 i = context->core_base; i < context->core_end; i++)
-        {
-            GROUP_AFFINITY old_affinity, new_affinity;
-            PROCESSOR_NUMBER ProcNumber;
-
-            RtlSecureZeroMemory(&new_affinity, sizeof(GROUP_AFFINITY));
-            RtlSecureZeroMemory(&old_affinity, sizeof(GROUP_AFFINITY));
-            RtlSecureZeroMemory(&ProcNumber, sizeof(PROCESSOR_NUMBER));
-            KeGetProcessorNumberFromIndex(i, &ProcNumber);
-
-            new_affinity.Group = ProcNumber.Group;
-            new_affinity.Mask = 1ULL << (ProcNumber.Number);
-            KeSetSystemGroupAffinityThread(&new_affinity, &old_affinity);
-
-            CoreInfo* core = &core_info[i];
-            UINT32 init_num = context->event_num <= numFreeGPC ? context->event_num : numFreeGPC;
-            struct pmu_event_pseudo* events = &core->events[0];
-            for (UINT32 j = 0; j < init_num; j++)
-            {
-                struct pmu_event_kernel* event = (struct pmu_event_kernel*)&events[numFPC + j];
-                func(event);
-            }
-            KeRevertToUserGroupAffinityThread(&old_affinity);
-        }
-        KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%!FUNC! Exit\n"));
-        return;
-    }
-    else if (action == PMU_CTL_START || action == PMU_CTL_STOP || action == PMU_CTL_RESET)
-    {
-        int last_cluster = -1;
-        for (auto k = 0; k < context->cores_count; k++)
-        {
-            int i = context->ctl_req->cores_idx.cores_no[k];
-            VOID(*dsu_func2)(VOID) = context->do_func2;
-
-            if (context->ctl_flags & CTL_FLAG_DSU)
-            {
-                int cluster_no = i / dsu_sizeCluster;
-
-                // This works only if ctl_req->cores_idx.cores_no[] is sorted
-                // We will only cofigure one core in cluster with per_core_exec
-                if (last_cluster != cluster_no)
-                    last_cluster = cluster_no;
-                else
-                    dsu_func2 = NULL;
-            }
-
-            if (context->do_func || dsu_func2)
-            {
-                GROUP_AFFINITY old_affinity, new_affinity;
-                PROCESSOR_NUMBER ProcNumber;
-
-                RtlSecureZeroMemory(&new_affinity, sizeof(GROUP_AFFINITY));
-                RtlSecureZeroMemory(&old_affinity, sizeof(GROUP_AFFINITY));
-                RtlSecureZeroMemory(&ProcNumber, sizeof(PROCESSOR_NUMBER));
-                KeGetProcessorNumberFromIndex(i, &ProcNumber);
-
-                new_affinity.Group = ProcNumber.Group;
-                new_affinity.Mask = 1ULL << (ProcNumber.Number);
-                KeSetSystemGroupAffinityThread(&new_affinity, &old_affinity);
-
-                if (context->do_func)
-                    context->do_func();
-                if (context->do_func2)
-                    context->do_func2();
-
-                KeRevertToUserGroupAffinityThread(&old_affinity);
-            }
-        }
-        KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%!FUNC! Exit\n"));
-        return;
-    }
+    // PMU_CTL_ASSIGN_EVENTS and PMU_CTL_START/STOP/RESET are broadcast to all cores with `broadcast_dpc`
 
     GROUP_AFFINITY old_affinity, new_affinity;
     PROCESSOR_NUMBER ProcNumber;
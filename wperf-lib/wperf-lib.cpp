@@ -37,6 +37,8 @@
 #include "pe_file.h"
 #include "pmu_device.h"
 #include "process_api.h"
+#include "sample_aggregator.h"
+#include "symbol_resolver.h"
 #include "timeline.h"
 #include "wperf-common/gitver.h"
 #include "wperf-common/public.h"
@@ -493,11 +495,28 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
                 spawned_process = true;
             }
 
-            do
+            // Read counters while they keep counting instead of stopping and restarting them every interval
+            const bool live = enable_bits == CTL_FLAG_CORE && __pmu_device->core_events_live_probe();
+            const bool live_gap_free = stat_conf->timeline && counting_interval_iter == 0;
+            bool live_continued = false;
+
+            if (live)
             {
                 __pmu_device->reset(enable_bits);
-
                 __pmu_device->start(enable_bits);
+            }
+
+            do
+            {
+                if (!live)
+                {
+                    __pmu_device->reset(enable_bits);
+                    __pmu_device->start(enable_bits);
+                }
+                else if (!live_continued)
+                {
+                    __pmu_device->core_events_read_live();
+                }
 
                 int64_t t_count = counting_duration_iter;
 
@@ -512,11 +531,16 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
                             break;
                 }
 
-                __pmu_device->stop(enable_bits);
+                if (live)
+                    __pmu_device->core_events_read_live();
+                else
+                    __pmu_device->stop(enable_bits);
+                live_continued = live_gap_free;
 
                 if (enable_bits & CTL_FLAG_CORE)
                 {
-                    __pmu_device->core_events_read();
+                    if (!live)
+                        __pmu_device->core_events_read();
                     const ReadOut* core_outs = __pmu_device->get_core_outs();
 
                     std::vector<uint8_t> counting_cores = __pmu_device->get_cores_idx();
@@ -608,6 +632,9 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
 
             } while (stat_conf->timeline);
 
+            if (live)
+                __pmu_device->stop(enable_bits);
+
             if (do_count_process_spawn)
             {
                 TerminateProcess(pi.hProcess, 0);
@@ -747,6 +774,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
 
             if (sample_conf->export_perf_data)
             {
+                perfDataWriter.Open();
                 for (auto& events_sample : ioctl_events_sample)
                 {
                     perfDataWriter.RegisterSampleEvent(events_sample.index);
@@ -893,121 +921,45 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
             }
             CloseHandle(process_handle);
 
-            std::vector<SampleDesc> resolved_samples;
+            // Index image symbols and symbols of modules loaded with image (such as DLLs) once.
+            // Note: at this point:
+            //  `dll_metadata` contains names of all modules loaded with image (executable)
+            //  `modules_metadata` contains e.g. symbols of image modules loaded which had
+            //                     PDB files present and we were able to load them.
+            symbol_resolver resolver;
+            resolver.add_image(sym_info, sec_info, image_base + runtime_vaddr_delta);
+            for (const auto& [key, value] : dll_metadata)
+                if (modules_metadata.count(key))
+                    resolver.add_module(key, modules_metadata[key], value.sec_info);
+            resolver.build();
+
+            sample_aggregator aggregator;
+            SampleDesc unknown_sd;
+            unknown_sd.desc.name = L"unknown";
 
             for (const auto& a : raw_samples)
             {
-                bool found = false;
-                SampleDesc sd;
-                uint64_t sec_base = 0;
-
-                // Search in symbol table for image (executable)
-                for (const auto& b : sym_info)
-                {
-                    for (const auto& c : sec_info)
-                    {
-                        if (c.idx == (b.sec_idx - 1))
-                        {
-                            sec_base = image_base + c.offset + runtime_vaddr_delta;
-                            break;
-                        }
-                    }
-
-                    if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                    {
-                        sd.desc = b;
-                        sd.module = 0;
-                        found = true;
-                        break;
-                    }
-                }
+                const symbol_resolver::symbol* sym = resolver.resolve(a.pc);
+                const SampleDesc& sd = sym ? sym->proto : unknown_sd;
 
-                // Nothing was found in base images, let's search inside modules loaded with
-                // images (such as DLLs).
-                // Note: at this point:
-                //  `dll_metadata` contains names of all modules loaded with image (executable)
-                //  `modules_metadata` contains e.g. symbols of image modules loaded which had
-                //                     PDB files present and we were able to load them.
-                if (!found)
-                {
-                    sec_base = 0;
-
-                    for (const auto& [key, value] : dll_metadata)
-                    {
-                        if (modules_metadata.count(key))
-                        {
-                            ModuleMetaData& mmd = modules_metadata[key];
-
-                            for (auto& b : mmd.sym_info)
-                                for (const auto& c : value.sec_info)
-                                    if (c.idx == (b.sec_idx - 1))
-                                    {
-                                        sec_base = (UINT64)mmd.handle + c.offset;
-                                        break;
-                                    }
-
-                            for (const auto& b : mmd.sym_info)
-                                if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                                {
-                                    sd.desc = b;
-                                    sd.desc.name = b.name + L":" + key;
-                                    sd.desc.sname = b.name;
-                                    sd.module = &mmd;
-                                    found = true;
-                                    break;
-                                }
-                        }
-                    }
-                }
-
-                if (!found)
-                    sd.desc.name = L"unknown";
+                const uint32_t sym_id = aggregator.intern(sd);
 
                 for (auto const& [mapped_counter_idx, counter_idx] : __pmu_device->counter_idx_unmap)
                 {
                     if (!(a.ov_flags & (1i64 << (UINT64)mapped_counter_idx)))
                         continue;
 
-                    bool inserted = false;
                     uint32_t event_src;
                     if (counter_idx == 31)
                         event_src = CYCLE_EVT_IDX;
                     else
                         event_src = ioctl_events_sample[counter_idx].index;
-                    for (auto& c : resolved_samples)
-                    {
-                        if (c.desc.name == sd.desc.name && c.event_src == event_src)
-                        {
-                            c.freq++;
-                            bool pc_found = false;
-                            for (int i = 0; i < c.pc.size(); i++)
-                            {
-                                if (c.pc[i].first == a.pc)
-                                {
-                                    c.pc[i].second += 1;
-                                    pc_found = true;
-                                    break;
-                                }
-                            }
-
-                            if (!pc_found)
-                                c.pc.push_back(std::make_pair(a.pc, 1));
 
-                            inserted = true;
-                            break;
-                        }
-                    }
-
-                    if (!inserted)
-                    {
-                        sd.freq = 1;
-                        sd.event_src = event_src;
-                        sd.pc.push_back(std::make_pair(a.pc, 1));
-                        resolved_samples.push_back(sd);
-                    }
+                    aggregator.add(sym_id, event_src, a.pc, a.cpu);
                 }
             }
 
+            std::vector<SampleDesc> resolved_samples = aggregator.get_resolved_samples();
             std::sort(resolved_samples.begin(), resolved_samples.end(), sort_samples);
 
             uint32_t prev_evt_src = 0;
@@ -1109,7 +1061,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
             }
 
             if (sample_conf->export_perf_data)
-                perfDataWriter.Write();
+                perfDataWriter.Close();
         }
         else
         {
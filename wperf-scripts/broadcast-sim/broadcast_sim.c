@@ -0,0 +1,137 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//
+// Simulation of the driver broadcast barrier (`wperf-common/broadcast.h`)
+// with POSIX threads playing the role of cores executing `broadcast_dpc`.
+//
+// Every fourth round one extra core "fails to queue" and leaves the barrier
+// while the other cores are already waiting, like `broadcast_queue` does when
+// `KeInsertQueueDpc` fails.
+//
+// Build and run (Linux, macOS):
+//
+//     cc -std=c11 -O2 -pthread -o broadcast_sim broadcast_sim.c
+//     ./broadcast_sim [cores] [rounds]
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../../wperf-common/broadcast.h"
+
+struct sim_round
+{
+    struct broadcast_barrier barrier;
+    volatile LONG signalled;        //!< Number of cores (or queuing thread) which signalled completion
+    volatile LONG early;            //!< Cores released before all present cores arrived
+    LONG present;                   //!< Cores which really run
+};
+
+static LONG64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (LONG64)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void* sim_core(void* arg)
+{
+    struct sim_round* round = (struct sim_round*)arg;
+
+    if (broadcast_barrier_wait(&round->barrier, BROADCAST_SPIN_LIMIT)
+        && ReadAcquire(&round->barrier.arrived) < round->present)
+        InterlockedIncrement(&round->early);
+
+    broadcast_barrier_record(&round->barrier, now_ns());
+
+    if (broadcast_barrier_complete(&round->barrier))
+        InterlockedIncrement(&round->signalled);
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    LONG cores = argc > 1 ? atoi(argv[1]) : 8;
+    long rounds = argc > 2 ? atol(argv[2]) : 1000;
+    pthread_t* threads;
+    UINT64 skew_sum = 0, skew_max = 0;
+    long timeouts = 0, failures = 0;
+
+    if (cores < 1 || rounds < 1)
+    {
+        fprintf(stderr, "usage: %s [cores] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    threads = (pthread_t*)calloc((size_t)cores, sizeof(pthread_t));
+    if (!threads)
+        return 2;
+
+    for (long r = 0; r < rounds; r++)
+    {
+        struct sim_round round = { 0 };
+        LONG absent = (r % 4) == 0;
+
+        round.present = cores;
+        broadcast_barrier_init(&round.barrier, cores + absent);
+
+        for (LONG i = 0; i < cores; i++)
+            pthread_create(&threads[i], NULL, sim_core, &round);
+
+        if (absent && broadcast_barrier_leave(&round.barrier))
+            InterlockedIncrement(&round.signalled);
+
+        for (LONG i = 0; i < cores; i++)
+            pthread_join(threads[i], NULL);
+
+        if (round.early || round.signalled < 1 || round.barrier.completed != cores)
+        {
+            fprintf(stderr, "round %ld: early=%ld signalled=%ld completed=%ld\n",
+                r, (long)round.early, (long)round.signalled, (long)round.barrier.completed);
+            failures++;
+        }
+
+        UINT64 skew = broadcast_barrier_skew(&round.barrier);
+        skew_sum += skew;
+        if (skew > skew_max)
+            skew_max = skew;
+        timeouts += round.barrier.timeouts;
+    }
+
+    printf("cores %ld, rounds %ld: skew mean %llu ns, max %llu ns, %ld timeouts, %ld failed rounds\n",
+        (long)cores, rounds, (unsigned long long)(skew_sum / (UINT64)rounds), (unsigned long long)skew_max, timeouts, failures);
+
+    free(threads);
+    return failures ? 1 : 0;
+}
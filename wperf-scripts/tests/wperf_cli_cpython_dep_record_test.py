@@ -169,3 +169,37 @@ def test_cpython_bench_record_symbol(arg):
     
     assert b'x_mul' in stdout
     assert b'x_mul:python' in stdout
+
+@pytest.mark.parametrize("cores",
+[
+   ("1,2"),
+   ("0-3"),
+]
+)
+def test_cpython_bench_record_many_cores(cores):
+    """ Test sampling on more than one core, per-core sample counts are in `cpus` table. """
+    python_d_exe_path = os.path.join(CPYTHON_EXE_DIR, "python_d.exe")
+
+    if not check_if_file_exists(python_d_exe_path):
+        pytest.skip(f"Can't locate CPython native executable in {python_d_exe_path}")
+
+    cmd = f"wperf record -e ld_spec:100000 -c {cores} --timeout 3 --json -- {python_d_exe_path} -c 10**10**100"
+    stdout, _ = run_command(cmd)
+
+    assert is_json(stdout), f"in {cmd}"
+    json_output = json.loads(stdout)
+
+    if "-" in cores:
+        first, last = cores.split("-")
+        expected_cores = set(range(int(first), int(last) + 1))
+    else:
+        expected_cores = set(int(c) for c in cores.split(","))
+
+    for evt in json_output["sampling"]["events"]:
+        assert "cpus" in evt
+        samples_total = sum(s["count"] for s in evt["samples"])
+        cpus_total = 0
+        for cpu in evt["cpus"]:
+            assert cpu["cpu"] in expected_cores, f"in {cmd}"
+            cpus_total += cpu["count"]
+        assert cpus_total >= samples_total, f"in {cmd}"
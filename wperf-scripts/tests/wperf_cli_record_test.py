@@ -48,11 +48,11 @@ from common import run_command, wperf_test_get_key_val
 ]
 )
 def test_record_many_cores_selected(cores):
-    """ It is not allowed to specify more than one core for sampling. """
+    """ Software sampling allows more than one core. """
     _, stderr = run_command(f"wperf record -c {cores} -- TEST")
 
     assert b"unexpected arg" not in stderr
-    assert b"you can specify only one core for sampling" in stderr
+    assert b"you can specify only one core for sampling" not in stderr
 
 @pytest.mark.parametrize("cores",
 [
@@ -66,11 +66,11 @@ def test_record_many_cores_selected(cores):
 ]
 )
 def test_record_many_cores_selected_ext(cores):
-    """ It is not allowed to specify more than one core for sampling. """
-    _, stderr = run_command(f"wperf record -v -e ld_spec:100000 -c {cores} --timeout 30 -- python_d.exe -c 10**10**100")
+    """ Software sampling allows more than one core. """
+    _, stderr = run_command(f"wperf record -v -e ld_spec:100000 -c {cores} --timeout 3 -- python_d.exe -c 10**10**100")
 
     assert b"unexpected arg" not in stderr
-    assert b"you can specify only one core for sampling" in stderr
+    assert b"you can specify only one core for sampling" not in stderr
 
 def test_record_pe_file_not_specified():
     """ Test for error if we can't deduce PE file name or name missing.
@@ -114,6 +114,40 @@ def test_wperf_timeline_core_n_file_output(C, I, N, SLEEP):
         pattern = r'([0-9]+,){%s}\n' % (gpc_num + 1)
         assert len(re.findall(pattern, cvs, re.DOTALL)) == N
 
+@pytest.mark.parametrize("C,I,N,SLEEP",
+[
+    (1,0,3,1),
+]
+)
+def test_wperf_timeline_core_n_binary_file_output(C, I, N, SLEEP):
+    """ Test timeline (core X) binary file output and its conversion to CSV. """
+    cmd = f'wperf stat -m imix -c {C} -t -i {I} -n {N} -v --timeline-binary sleep {SLEEP}'
+    stdout, _ = run_command(cmd.split())
+
+    json_output = wperf_test_no_params()      # get output from `wperf test`
+    gpc_num = get_result_from_test_results(json_output, "PMU_CTL_QUERY_HW_CFG [gpc_num]")
+    gpc_num = int(gpc_num, 16)  # it's a hex string e,g,. 0x0005
+
+    wtl_files = re.findall(rb'wperf_core_%s_[0-9_]+\.core\.wtl' % (str.encode(str(C))), stdout)   # e.g. ['wperf_core_1_2023_06_29_09_09_05.core.wtl']
+    assert len(wtl_files) == 1
+
+    wtl_file = wtl_files[0].decode()
+    csv_file = wtl_file[:-len(".wtl")] + ".csv"
+    converter = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "timeline_convert.py")
+    run_command(["python", converter, wtl_file, "-o", csv_file])
+
+    with open(csv_file, 'r') as file:
+        cvs = file.read()
+
+        assert cvs.count("Multiplexing,FALSE") == 1
+        assert cvs.count("Kernel mode,FALSE") == 1
+        assert cvs.count(f"Count interval,{I}.00") == 1
+        assert cvs.count("Event class,core") == 1
+        assert cvs.count(f"core {C},") == gpc_num + 1  # +1 for cycle fixed counter
+
+        pattern = r'([0-9]+,){%s}\n' % (gpc_num + 1)
+        assert len(re.findall(pattern, cvs, re.DOTALL)) == N
+
 @pytest.mark.parametrize("C,I,N,SLEEP",
 [
     (0,0,3,1),
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""Convert binary (.wtl) timeline file produced by `wperf stat --timeline` \
+   with `--timeline-binary` to CSV or JSON """
+
+# BSD 3-Clause License
+#
+# Copyright (c) 2024, Arm Limited
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import sys
+import os
+import io
+import struct
+import argparse
+import json
+
+
+TIMELINE_BIN_MAGIC = b"WPTL"
+TIMELINE_BIN_VERSION = 1
+TIMELINE_BIN_FLAG_MULTIPLEXING = 0x0001
+TIMELINE_BIN_FLAG_KERNEL = 0x0002
+
+class TimelineReader:
+    """read binary timeline file, see wperf/timeline.h for format description"""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+        self.header = {}
+        self.cores = []
+        self.events = []
+        self.metrics = []
+        self.rows = []      # list of (event values, metric values) tuples
+        self.parse()
+
+    def read(self, size):
+        """read `size` raw bytes"""
+        if self.pos + size > len(self.data):
+            raise ValueError("unexpected end of timeline file at offset %d" % self.pos)
+        chunk = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return chunk
+
+    def read_varint(self):
+        """read LEB128 unsigned integer"""
+        value = 0
+        shift = 0
+        while True:
+            byte = self.read(1)[0]
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+
+    def read_zigzag(self):
+        """read zigzag encoded signed integer"""
+        value = self.read_varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def read_string(self):
+        """read varint length prefixed string"""
+        return self.read(self.read_varint()).decode("utf-8")
+
+    def read_names(self):
+        """read varint count prefixed list of strings"""
+        return [self.read_string() for _ in range(self.read_varint())]
+
+    def parse(self):
+        """parse file header and all interval records"""
+        if self.read(4) != TIMELINE_BIN_MAGIC:
+            raise ValueError("not a binary timeline file")
+        version, flags = struct.unpack("<HH", self.read(4))
+        if version != TIMELINE_BIN_VERSION:
+            raise ValueError("unsupported binary timeline version %d" % version)
+        (count_interval,) = struct.unpack("<d", self.read(8))
+
+        self.header = {
+            "Multiplexing": bool(flags & TIMELINE_BIN_FLAG_MULTIPLEXING),
+            "Kernel mode": bool(flags & TIMELINE_BIN_FLAG_KERNEL),
+            "Count interval": count_interval,
+            "Vendor": self.read_string(),
+            "Event class": self.read_string(),
+        }
+        self.cores = self.read_names()
+        self.events = self.read_names()
+        self.metrics = self.read_names()
+
+        prev = []
+        while self.pos < len(self.data):
+            event_num = self.read_varint()
+            metric_num = self.read_varint()
+            prev.extend([0] * (event_num - len(prev)))
+            events = []
+            for i in range(event_num):
+                prev[i] = (prev[i] + self.read_zigzag()) & 0xFFFFFFFFFFFFFFFF
+                events.append(prev[i])
+            metrics = list(struct.unpack("<%dd" % metric_num, self.read(8 * metric_num)))
+            self.rows.append((events, metrics))
+
+    def to_csv(self):
+        """return timeline in the same CSV format `wperf stat --timeline` outputs"""
+        def names(items, prefix=""):
+            return "".join(prefix + item + "," for item in items)
+
+        def boolean(value):
+            return "TRUE" if value else "FALSE"
+
+        out = io.StringIO()
+        out.write("Multiplexing,%s\n" % boolean(self.header["Multiplexing"]))
+        if self.header["Event class"] == "core":
+            out.write("Kernel mode,%s\n" % boolean(self.header["Kernel mode"]))
+        out.write("Count interval,%.2f\n" % self.header["Count interval"])
+        out.write("Vendor,%s\n" % self.header["Vendor"])
+        out.write("Event class,%s\n" % self.header["Event class"])
+        out.write("\n")
+        out.write(names(self.cores) + "\n")
+        out.write(names(self.events) + names(self.metrics, "M@") + "\n")
+        for events, metrics in self.rows:
+            out.write("".join("%d," % value for value in events))
+            out.write("".join("%.3f," % value for value in metrics))
+            out.write("\n")
+        out.write("\n")
+        return out.getvalue()
+
+    def to_json(self):
+        """return timeline as JSON object"""
+        return {
+            "header": self.header,
+            "cores": self.cores,
+            "events": self.events,
+            "metrics": self.metrics,
+            "timeline": [{"events": events, "metrics": metrics} for events, metrics in self.rows],
+        }
+
+def main(argv):
+    """command line entry point"""
+    parser = argparse.ArgumentParser(description="convert binary timeline file to CSV or JSON")
+    parser.add_argument("input", help="binary timeline file (.wtl)")
+    parser.add_argument("-o", "--output", help="output file, default is input file with .csv or .json extension")
+    parser.add_argument("--json", action="store_true", help="output JSON instead of CSV")
+    parser.add_argument("--stats", action="store_true", help="print size per interval compared with CSV")
+    args = parser.parse_args(argv)
+
+    with open(args.input, "rb") as fbin:
+        data = fbin.read()
+    reader = TimelineReader(data)
+
+    if args.json:
+        content = json.dumps(reader.to_json(), indent=4)
+    else:
+        content = reader.to_csv()
+
+    output = args.output
+    if output is None:
+        output = os.path.splitext(args.input)[0] + (".json" if args.json else ".csv")
+    with open(output, "w", encoding="utf-8") as fout:
+        fout.write(content)
+
+    if args.stats:
+        intervals = max(len(reader.rows), 1)
+        csv_size = len(reader.to_csv().encode("utf-8"))
+        print("intervals: %d" % len(reader.rows))
+        print("binary: %d bytes (%.1f bytes per interval)" % (len(data), len(data) / intervals))
+        print("csv:    %d bytes (%.1f bytes per interval)" % (csv_size, csv_size / intervals))
+        print("ratio:  %.2fx" % (csv_size / max(len(data), 1)))
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,122 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <string>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/a64_decoder.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_a64_decoder)
+	{
+	public:
+
+		// Expected text is `llvm-objdump` output with mnemonic padded as in `LLVMDisassembler::ParseOutput`
+		TEST_METHOD(test_a64_decode_known_encodings)
+		{
+			const struct { uint32_t insn; const wchar_t* text; } encodings[] = {
+				{ 0x91004020, L"add   x0, x1, #16" },
+				{ 0x910003FD, L"mov   x29, sp" },
+				{ 0x713FFC7F, L"cmp   w3, #4095" },
+				{ 0x92401C20, L"and   x0, x1, #0xff" },
+				{ 0x92800000, L"mov   x0, #-1" },
+				{ 0xF2A24680, L"movk  x0, #4660, lsl #16" },
+				{ 0xD37DF020, L"lsl   x0, x1, #3" },
+				{ 0x53082C20, L"ubfx  w0, w1, #8, #4" },
+				{ 0xF9400420, L"ldr   x0, [x1, #8]" },
+				{ 0xF8627820, L"ldr   x0, [x1, x2, lsl #3]" },
+				{ 0x38624820, L"ldrb  w0, [x1, w2, uxtw]" },
+				{ 0xB85FC3A0, L"ldur  w0, [x29, #-4]" },
+				{ 0xA9BF7BFD, L"stp   x29, x30, [sp, #-16]!" },
+				{ 0xA8C17BFD, L"ldp   x29, x30, [sp], #16" },
+				{ 0x885FFC20, L"ldaxr w0, [x1]" },
+				{ 0xB8E00041, L"ldaddal w0, w1, [x2]" },
+				{ 0x1A9F17E0, L"cset  w0, eq" },
+				{ 0x9B020C20, L"madd  x0, x1, x2, x3" },
+				{ 0x1AC20820, L"udiv  w0, w1, w2" },
+				{ 0xD65F03C0, L"ret" },
+				{ 0xD503233F, L"paciasp" },
+				{ 0xD503245F, L"bti   c" },
+				{ 0xD5033BBF, L"dmb   ish" },
+				{ 0xD53BD040, L"mrs   x0, TPIDR_EL0" },
+				{ 0xD4000001, L"svc   #0" },
+				{ 0x1E6E1000, L"fmov  d0, #1.00000000" },
+				{ 0x1E222820, L"fadd  s0, s1, s2" },
+				{ 0x1E602008, L"fcmp  d0, #0.0" },
+				{ 0x1E780020, L"fcvtzs w0, d1" },
+				{ 0x9E620020, L"scvtf d0, x1" },
+				{ 0x4EA28420, L"add   v0.4s, v1.4s, v2.4s" },
+				{ 0x4FC21820, L"fmla  v0.2d, v1.2d, v2.d[1]" },
+				{ 0x6F00E400, L"movi  v0.2d, #0000000000000000" },
+				{ 0x0E0C3C20, L"mov   w0, v1.s[1]" },
+				{ 0x4E040C20, L"dup   v0.4s, w1" },
+				{ 0x4CDFA000, L"ld1   { v0.16b, v1.16b }, [x0], #32" },
+				{ 0x4E032020, L"tbl   v0.16b, { v1.16b, v2.16b }, v3.16b" },
+				{ 0x4EB1B820, L"addv  s0, v1.4s" },
+				{ 0x2598E3E0, L"ptrue p0.s" },
+				{ 0x25A11C00, L"whilelo p0.s, x0, x1" },
+				{ 0xA5414000, L"ld1w  { z0.s }, p0/z, [x0, x1, lsl #2]" },
+				{ 0xE5E1E441, L"st1d  { z1.d }, p1, [x2, #1, mul vl]" },
+				{ 0x65A20020, L"fmla  z0.s, p0/m, z1.s, z2.s" },
+				{ 0x04A1E3E0, L"cntw  x0, all, mul #2" },
+				{ 0x05A03800, L"mov   z0.s, w0" },
+			};
+
+			for (const auto& e : encodings)
+				Assert::AreEqual(std::wstring(e.text), a64_decode(e.insn, 0x1000));
+		}
+
+		TEST_METHOD(test_a64_decode_pc_relative_targets)
+		{
+			Assert::AreEqual(std::wstring(L"b     0x1010"), a64_decode(0x14000004, 0x1000));
+			Assert::AreEqual(std::wstring(L"bl    0xff0"), a64_decode(0x97FFFFFC, 0x1000));
+			Assert::AreEqual(std::wstring(L"b.ne  0x1ffc"), a64_decode(0x54FFFFE1, 0x2000));
+			Assert::AreEqual(std::wstring(L"cbz   x1, 0x2008"), a64_decode(0xB4000041, 0x2000));
+			Assert::AreEqual(std::wstring(L"tbz   w0, #1, 0x2008"), a64_decode(0x36080040, 0x2000));
+			Assert::AreEqual(std::wstring(L"adrp  x0, 0x2000"), a64_decode(0xB0000000, 0x1234));
+			Assert::AreEqual(std::wstring(L"ldr   x0, 0x1240"), a64_decode(0x58000060, 0x1234));
+		}
+
+		TEST_METHOD(test_a64_decode_unallocated)
+		{
+			Assert::AreEqual(std::wstring(L".inst 0xff000000"), a64_decode(0xFF000000, 0));
+			// Logical immediate with all ones element is reserved
+			Assert::AreEqual(std::wstring(L".inst 0x9200fc00"), a64_decode(0x9200FC00, 0));
+			// LDR (literal) of 128-bit FP register pair size is reserved
+			Assert::AreEqual(std::wstring(L".inst 0xdc000000"), a64_decode(0xDC000000, 0));
+		}
+	};
+}
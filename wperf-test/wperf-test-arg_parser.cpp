@@ -480,5 +480,104 @@ namespace wperftest
             Assert::IsTrue(COMMAND_CLASS::RECORD == parser.m_command);
         }
 
+        TEST_METHOD(test_sample_copy)
+        {
+            const wchar_t* argv[] = { L"wperf", L"sample", L"-e", L"ld_spec:100000", L"--pe_file", L"python_d.exe", L"-c", L"1", L"--sample-copy" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.sample_copy_opt.is_set());
+            Assert::IsFalse(parser.config_arg.is_set());
+
+            Assert::IsTrue(COMMAND_CLASS::SAMPLE == parser.m_command);
+        }
+
+        TEST_METHOD(test_sample_ring_size)
+        {
+            const wchar_t* argv[] = { L"wperf", L"sample", L"-e", L"ld_spec:100000", L"--pe_file", L"python_d.exe", L"-c", L"1", L"--sample-ring-size", L"32768" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.sample_ring_size_arg.is_set());
+            Assert::IsTrue(check_value_in_vector(parser.sample_ring_size_arg.get_values(), L"32768"));
+            Assert::IsFalse(parser.sample_copy_opt.is_set());
+
+            Assert::IsTrue(COMMAND_CLASS::SAMPLE == parser.m_command);
+        }
+
+        TEST_METHOD(test_record_spe_memory)
+        {
+            const wchar_t* argv[] = { L"wperf", L"record", L"-e", L"arm_spe_0/ld=1,st=1/", L"-c", L"8", L"--spe-memory", L"--", L"python_d.exe", L"-c", L"10**10**100" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.spe_memory_opt.is_set());
+            Assert::IsFalse(parser.config_arg.is_set());
+            Assert::IsTrue(check_value_in_vector(parser.extra_args_arg.get_values(), L"python_d.exe"));
+
+            Assert::IsTrue(COMMAND_CLASS::RECORD == parser.m_command);
+        }
+
+        TEST_METHOD(test_record_disassemble_llvm)
+        {
+            const wchar_t* argv[] = { L"wperf", L"record", L"-e", L"ld_spec:100000", L"-c", L"1", L"--disassemble-llvm", L"--", L"python_d.exe" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.disassembly_llvm_opt.is_set());
+            Assert::IsFalse(parser.disassembly_opt.is_set());
+            Assert::IsFalse(parser.config_arg.is_set());
+
+            Assert::IsTrue(COMMAND_CLASS::RECORD == parser.m_command);
+        }
+
+        TEST_METHOD(test_stat_output_ndjson)
+        {
+            const wchar_t* argv[] = { L"wperf", L"stat", L"-e", L"inst_spec", L"-c", L"0", L"--output-ndjson", L"-", L"sleep", L"5" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.output_ndjson_filename_arg.is_set());
+            Assert::IsFalse(parser.output_filename_arg.is_set());
+            Assert::IsFalse(parser.output_csv_filename_arg.is_set());
+            Assert::IsTrue(check_value_in_vector(parser.output_ndjson_filename_arg.get_values(), L"-"));
+            Assert::IsTrue(check_value_in_vector(parser.timeout_arg.get_values(), L"5"));
+
+            Assert::IsTrue(COMMAND_CLASS::STAT == parser.m_command);
+        }
+
+        TEST_METHOD(test_stat_timeline_binary)
+        {
+            const wchar_t* argv[] = { L"wperf", L"stat", L"-e", L"l1d_cache_rd", L"-t", L"--timeline-binary", L"-n", L"3", L"-c", L"7" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.timeline_opt.is_set());
+            Assert::IsTrue(parser.timeline_binary_opt.is_set());
+            Assert::IsFalse(parser.config_arg.is_set());
+
+            Assert::IsTrue(COMMAND_CLASS::STAT == parser.m_command);
+        }
+
+        TEST_METHOD(test_stat_event_weight)
+        {
+            const wchar_t* argv[] = { L"wperf", L"stat", L"-e", L"inst_spec,vfp_spec", L"--event-weight", L"inst_spec:2", L"-c", L"0", L"sleep", L"5" };
+            const int argc = _countof(argv);
+            arg_parser parser;
+            parser.parse(argc, argv);
+
+            Assert::IsTrue(parser.event_weight_arg.is_set());
+            Assert::IsTrue(check_value_in_vector(parser.event_weight_arg.get_values(), L"inst_spec:2"));
+            Assert::IsTrue(check_value_in_vector(parser.events_arg.get_values(), L"inst_spec,vfp_spec"));
+
+            Assert::IsTrue(COMMAND_CLASS::STAT == parser.m_command);
+        }
+
     };
 }
@@ -0,0 +1,229 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <windows.h>
+#include "wperf-common\broadcast.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest_common
+{
+	TEST_CLASS(wperftest_common_broadcast)
+	{
+	public:
+
+		// Threads play the role of cores executing `broadcast_dpc`
+		static void simulate_broadcast(struct broadcast_barrier* barrier, LONG cores, std::vector<LONG>& seen_arrived, std::atomic<int>& last_count)
+		{
+			std::vector<std::thread> threads;
+
+			broadcast_barrier_init(barrier, cores);
+			for (LONG i = 0; i < cores; i++)
+			{
+				threads.emplace_back([barrier, i, &seen_arrived, &last_count]() {
+					// Stagger arrival, barrier must hold early cores back
+					std::this_thread::sleep_for(std::chrono::microseconds(100 * i));
+					bool released = broadcast_barrier_wait(barrier, ~0ULL);
+					seen_arrived[i] = released ? ReadAcquire(&barrier->arrived) : -1;
+
+					LONG64 ts = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+					broadcast_barrier_record(barrier, ts);
+
+					if (broadcast_barrier_complete(barrier))
+						last_count++;
+				});
+			}
+
+			for (auto& t : threads)
+				t.join();
+		}
+
+		TEST_METHOD(test_broadcast_barrier_no_timestamp)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 4);
+
+			Assert::AreEqual(LONG(4), barrier.count);
+			Assert::AreEqual(LONG(0), barrier.arrived);
+			Assert::AreEqual(UINT64(0), broadcast_barrier_skew(&barrier));
+		}
+
+		TEST_METHOD(test_broadcast_barrier_record_min_max)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 3);
+
+			broadcast_barrier_record(&barrier, 100);
+			Assert::AreEqual(UINT64(0), broadcast_barrier_skew(&barrier));
+
+			broadcast_barrier_record(&barrier, 50);
+			broadcast_barrier_record(&barrier, 300);
+			broadcast_barrier_record(&barrier, 200);
+			Assert::AreEqual(LONG64(50), barrier.first_ts);
+			Assert::AreEqual(LONG64(300), barrier.last_ts);
+			Assert::AreEqual(UINT64(250), broadcast_barrier_skew(&barrier));
+		}
+
+		TEST_METHOD(test_broadcast_barrier_wait_timeout)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 2);
+
+			// Second core never arrives
+			Assert::IsFalse(broadcast_barrier_wait(&barrier, 16));
+			Assert::AreEqual(LONG(1), barrier.timeouts);
+			Assert::IsFalse(broadcast_barrier_complete(&barrier));
+
+			// Late core is released at once
+			Assert::IsTrue(broadcast_barrier_wait(&barrier, 0));
+			Assert::IsTrue(broadcast_barrier_complete(&barrier));
+			Assert::AreEqual(LONG(1), barrier.timeouts);
+		}
+
+		TEST_METHOD(test_broadcast_barrier_single_core)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 1);
+
+			Assert::IsTrue(broadcast_barrier_wait(&barrier, 0));
+			broadcast_barrier_record(&barrier, 42);
+			Assert::IsTrue(broadcast_barrier_complete(&barrier));
+			Assert::AreEqual(UINT64(0), broadcast_barrier_skew(&barrier));
+		}
+
+		TEST_METHOD(test_broadcast_barrier_leave_before_arrival)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 2);
+
+			// DPC of second core could not be queued
+			Assert::IsFalse(broadcast_barrier_leave(&barrier));
+			Assert::AreEqual(LONG(1), barrier.count);
+
+			Assert::IsTrue(broadcast_barrier_wait(&barrier, 0));
+			Assert::IsTrue(broadcast_barrier_complete(&barrier));
+			Assert::AreEqual(LONG(0), barrier.timeouts);
+		}
+
+		TEST_METHOD(test_broadcast_barrier_leave_after_completion)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 2);
+
+			// First core gave up waiting for the second one and completed
+			Assert::IsFalse(broadcast_barrier_wait(&barrier, 16));
+			Assert::IsFalse(broadcast_barrier_complete(&barrier));
+
+			// Nobody is left to signal completion
+			Assert::IsTrue(broadcast_barrier_leave(&barrier));
+		}
+
+		TEST_METHOD(test_broadcast_barrier_leave_all)
+		{
+			struct broadcast_barrier barrier;
+			broadcast_barrier_init(&barrier, 1);
+
+			Assert::IsTrue(broadcast_barrier_leave(&barrier));
+			Assert::AreEqual(LONG(0), barrier.count);
+		}
+
+		TEST_METHOD(test_broadcast_barrier_threads_leave)
+		{
+			const LONG cores = 8;
+
+			for (int round = 0; round < 16; round++)
+			{
+				struct broadcast_barrier barrier;
+				std::vector<std::thread> threads;
+				std::vector<LONG> seen_arrived(cores, 0);
+				std::atomic<int> last_count(0);
+
+				// One extra core never arrives, it leaves while the others are already waiting
+				broadcast_barrier_init(&barrier, cores + 1);
+				for (LONG i = 0; i < cores; i++)
+				{
+					threads.emplace_back([&barrier, i, &seen_arrived, &last_count]() {
+						bool released = broadcast_barrier_wait(&barrier, ~0ULL);
+						seen_arrived[i] = released ? ReadAcquire(&barrier.arrived) : -1;
+						if (broadcast_barrier_complete(&barrier))
+							last_count++;
+					});
+				}
+
+				if (broadcast_barrier_leave(&barrier))
+					last_count++;
+
+				for (auto& t : threads)
+					t.join();
+
+				for (LONG i = 0; i < cores; i++)
+					Assert::AreEqual(cores, seen_arrived[i]);
+
+				// Completion is signalled at least once (signalling twice is harmless)
+				Assert::IsTrue(last_count.load() >= 1);
+				Assert::AreEqual(cores, barrier.count);
+				Assert::AreEqual(cores, barrier.completed);
+			}
+		}
+
+		TEST_METHOD(test_broadcast_barrier_threads)
+		{
+			const LONG cores = 8;
+			struct broadcast_barrier barrier;
+
+			for (int round = 0; round < 16; round++)
+			{
+				std::vector<LONG> seen_arrived(cores, 0);
+				std::atomic<int> last_count(0);
+
+				simulate_broadcast(&barrier, cores, seen_arrived, last_count);
+
+				// Nobody left the barrier before all cores arrived
+				for (LONG i = 0; i < cores; i++)
+					Assert::AreEqual(cores, seen_arrived[i]);
+
+				// Exactly one core signals completion
+				Assert::AreEqual(1, last_count.load());
+				Assert::AreEqual(cores, barrier.completed);
+				Assert::AreEqual(LONG(0), barrier.timeouts);
+				Assert::IsTrue(barrier.first_ts <= barrier.last_ts);
+				Assert::AreEqual(UINT64(barrier.last_ts - barrier.first_ts), broadcast_barrier_skew(&barrier));
+			}
+		}
+	};
+}
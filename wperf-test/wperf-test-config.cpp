@@ -55,6 +55,19 @@ namespace wperftest
 			Assert::IsTrue(value == PMU_CTL_START_PERIOD_MIN);
 		}
 
+		TEST_METHOD(test_config_period_adaptive)
+		{
+			LONG value;
+			drvconfig::init();
+
+			Assert::IsTrue(drvconfig::get(L"count.period_adaptive", value));
+			Assert::IsTrue(value == 0);
+
+			Assert::IsTrue(drvconfig::set(L"count.period_adaptive=1"));
+			Assert::IsTrue(drvconfig::get(L"count.period_adaptive", value));
+			Assert::IsTrue(value == 1);
+		}
+
 		TEST_METHOD(test_config_set_ro)
 		{
 			drvconfig::init();
@@ -0,0 +1,267 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/disassembly_cache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_disassembly_cache)
+	{
+	public:
+
+		// Fake disassembler: one instruction every 4 bytes, records requested ranges, fails while `fail` is set
+		struct fake_disassembler
+		{
+			std::vector<std::pair<uint64_t, uint64_t>> calls;
+			bool fail = false;
+
+			disassembly_cache::disassemble_fn fn()
+			{
+				return [this](const std::wstring&, uint64_t, uint64_t from, uint64_t to, std::vector<DisassembledInstruction>& out) {
+					calls.push_back(std::make_pair(from, to));
+					if (fail)
+						return false;
+					for (uint64_t addr = from; addr < to; addr += 4)
+						out.push_back(DisassembledInstruction{ addr & 0xFFFFFF, 0xD503201F, L"nop ; " + std::to_wstring(addr & 0xFFFFFF) });
+					return true;
+				};
+			}
+		};
+
+		static std::wstring temp_file_path()
+		{
+			wchar_t dir[MAX_PATH], path[MAX_PATH];
+			Assert::AreNotEqual(DWORD(0), GetTempPathW(MAX_PATH, dir));
+			Assert::AreNotEqual(UINT(0), GetTempFileNameW(dir, L"wdc", 0, path));
+			return path;
+		}
+
+		TEST_METHOD(test_disassembly_cache_lines_of_symbol_disassembled_once)
+		{
+			fake_disassembler dasm;
+			disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+			const uint64_t base = 0x140000000;
+
+			// Symbol 0x1000-0x1100, 64 lines of 4 bytes each
+			for (uint64_t line = 0x1000; line < 0x1100; line += 4)
+			{
+				auto insns = cache.get(L"app.exe", base, line, line + 4, 0x1000, 0x1100);
+				Assert::AreEqual(size_t(1), insns.size());
+				Assert::AreEqual(DWORD_PTR(line), insns[0].m_address);
+				Assert::AreEqual(L"nop ; " + std::to_wstring(line), insns[0].m_asm);
+			}
+
+			Assert::AreEqual(size_t(1), cache.disassembler_runs());
+			Assert::AreEqual(size_t(1), dasm.calls.size());
+			Assert::AreEqual(base + 0x1000, dasm.calls[0].first);
+			Assert::AreEqual(base + 0x1100, dasm.calls[0].second);
+		}
+
+		TEST_METHOD(test_disassembly_cache_images_and_ranges)
+		{
+			fake_disassembler dasm;
+			disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+
+			Assert::AreEqual(size_t(3), cache.get(L"app.exe", 0x140000000, 0x1000, 0x100C, 0x1000, 0x1100).size());
+			// Same addresses in other image are not shared
+			Assert::AreEqual(size_t(3), cache.get(L"lib.dll", 0x180000000, 0x1000, 0x100C, 0x1000, 0x1100).size());
+			Assert::AreEqual(size_t(2), cache.disassembler_runs());
+
+			// Line outside of its hint range, range is extended
+			auto insns = cache.get(L"app.exe", 0x140000000, 0x10F8, 0x1108, 0x1100, 0x1200);
+			Assert::AreEqual(size_t(4), insns.size());
+			Assert::AreEqual(size_t(3), cache.disassembler_runs());
+			Assert::AreEqual(UINT64(0x1400010F8), dasm.calls.back().first);
+
+			// Adjacent ranges were merged, lookup spanning both is a hit
+			Assert::AreEqual(size_t(0x200 / 4), cache.get(L"app.exe", 0x140000000, 0x1000, 0x1200, 0x1000, 0x1200).size());
+			Assert::AreEqual(size_t(3), cache.disassembler_runs());
+
+			// Gap between ranges is a miss
+			cache.get(L"app.exe", 0x140000000, 0x1300, 0x1304, 0x1300, 0x1310);
+			cache.get(L"app.exe", 0x140000000, 0x11FC, 0x1304, 0x11FC, 0x1304);
+			Assert::AreEqual(size_t(5), cache.disassembler_runs());
+		}
+
+		TEST_METHOD(test_disassembly_cache_persisted_per_timestamp)
+		{
+			const std::wstring cache_file = temp_file_path();
+
+			{
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0x5F000000));	// Empty temp file
+				cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100);
+				cache.get(L"app.exe", 0x140000000, 0x2000, 0x2010, 0x2000, 0x2040);
+				cache.save();
+			}
+
+			{
+				// Same image timestamp, served from cache file
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsTrue(cache.attach(L"app.exe", cache_file, 0x5F000000));
+				auto insns = cache.get(L"app.exe", 0x140000000, 0x1080, 0x1090, 0x1000, 0x1100);
+				Assert::AreEqual(size_t(4), insns.size());
+				Assert::AreEqual(L"nop ; " + std::to_wstring(0x1080), insns[0].m_asm);
+				Assert::AreEqual(DWORD_PTR(0xD503201F), insns[0].m_instruction);
+				Assert::AreEqual(size_t(16), cache.get(L"app.exe", 0x140000000, 0x2000, 0x2040, 0x2000, 0x2040).size());
+				Assert::AreEqual(size_t(0), cache.disassembler_runs());
+			}
+
+			{
+				// Image was rebuilt, cache file is stale
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0x5F000001));
+				cache.get(L"app.exe", 0x140000000, 0x1080, 0x1090, 0x1000, 0x1100);
+				Assert::AreEqual(size_t(1), cache.disassembler_runs());
+			}
+
+			DeleteFileW(cache_file.c_str());
+		}
+
+		TEST_METHOD(test_disassembly_cache_other_backend_not_reused)
+		{
+			const std::wstring cache_file = temp_file_path();
+
+			{
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::llvm_objdump, dasm.fn());
+				cache.attach(L"app.exe", cache_file, 0x5F000000);
+				cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100);
+				cache.save();
+			}
+
+			{
+				// Same image, cache file was written by llvm-objdump
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0x5F000000));
+				cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100);
+				Assert::AreEqual(size_t(1), cache.disassembler_runs());
+			}
+
+			DeleteFileW(cache_file.c_str());
+		}
+
+		TEST_METHOD(test_disassembly_cache_failed_range_not_cached)
+		{
+			const std::wstring cache_file = temp_file_path();
+
+			{
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				cache.attach(L"app.exe", cache_file, 0x5F000000);
+
+				dasm.fail = true;
+				Assert::AreEqual(size_t(0), cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100).size());
+				Assert::AreEqual(size_t(0), cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100).size());
+				Assert::AreEqual(size_t(2), cache.disassembler_runs());
+
+				// Nothing to persist
+				cache.save();
+				std::ifstream in(cache_file, std::ios::binary | std::ios::ate);
+				Assert::AreEqual(std::streamoff(0), std::streamoff(in.tellg()));
+			}
+
+			{
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0x5F000000));
+
+				// Retried once code can be read
+				Assert::AreEqual(size_t(4), cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100).size());
+				Assert::AreEqual(size_t(1), cache.disassembler_runs());
+			}
+
+			DeleteFileW(cache_file.c_str());
+		}
+
+		TEST_METHOD(test_disassembly_cache_damaged_counts_are_miss)
+		{
+			const std::wstring cache_file = temp_file_path();
+
+			// Offsets in cache file with one range: number of ranges, text size of first instruction
+			const std::streamoff ranges_num_offset = 16, text_size_offset = 56;
+
+			for (std::streamoff offset : { ranges_num_offset, text_size_offset })
+			{
+				{
+					fake_disassembler dasm;
+					disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+					cache.attach(L"app.exe", cache_file, 0x5F000000);
+					cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100);
+					cache.save();
+				}
+
+				{
+					const uint32_t huge = 0xFFFFFFF0;
+					std::fstream file(cache_file, std::ios::binary | std::ios::in | std::ios::out);
+					file.seekp(offset);
+					file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+				}
+
+				// Count larger than the file is not allocated, image is disassembled again
+				fake_disassembler dasm;
+				disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+				Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0x5F000000));
+				Assert::AreEqual(size_t(4), cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100).size());
+				Assert::AreEqual(size_t(1), cache.disassembler_runs());
+			}
+
+			DeleteFileW(cache_file.c_str());
+		}
+
+		TEST_METHOD(test_disassembly_cache_no_timestamp_not_persisted)
+		{
+			const std::wstring cache_file = temp_file_path();
+			DeleteFileW(cache_file.c_str());
+
+			fake_disassembler dasm;
+			disassembly_cache cache(disassembly_cache::backend::builtin, dasm.fn());
+			Assert::IsFalse(cache.attach(L"app.exe", cache_file, 0));
+			cache.get(L"app.exe", 0x140000000, 0x1000, 0x1010, 0x1000, 0x1100);
+			cache.save();
+
+			std::ifstream in(cache_file);
+			Assert::IsFalse(in.is_open());
+		}
+	};
+}
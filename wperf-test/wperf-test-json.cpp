@@ -190,5 +190,83 @@ namespace wperftest
 				Assert::AreEqual(std::string("{\"key1\":\"97\"}"), ss.str());
 			}
 		}
+
+		TEST_METHOD(test_json_escaped_value)
+		{
+			{
+				JSONObject<std::string, false, true, char> obj;
+				obj.m_map["pe file"] = "C:\\app\"1\".exe\n\t\x01";
+				std::stringstream ss;
+				ss << obj;
+				Assert::AreEqual(std::string("{\"pe_file\":\"C:\\\\app\\\"1\\\".exe\\n\\t\\u0001\"}"), ss.str());
+			}
+			{
+				JSONObject<std::wstring, false, true, wchar_t> obj;
+				obj.m_map[L"key1"] = L"\\\\?\\C:\\";
+				std::wstringstream ss;
+				ss << obj;
+				Assert::AreEqual(std::wstring(L"{\"key1\":\"\\\\\\\\?\\\\C:\\\\\"}"), ss.str());
+			}
+		}
+
+		TEST_METHOD(test_jsonwriter_char)
+		{
+			{
+				std::stringstream ss;
+				JSONWriter<char> writer(ss);
+				writer.BeginObject();
+				writer.EndObject();
+				Assert::AreEqual(std::string("{\n\n}"), ss.str());
+			}
+			{
+				TableJSON<UnitTestOutputTraits<char>, char> table;
+				std::vector<std::string> vals = { std::string("item1") };
+				table.SetKey("json_key");
+				table.AddColumn("column_header");
+				table.Insert(vals);
+
+				std::stringstream ss;
+				JSONWriter<char> writer(ss);
+				writer.BeginObject();
+				writer.Member("name", std::string("a\"b"));
+				writer.Member("verbose", true);
+				writer.Member("count", 3);
+				writer.Key("duration");
+				writer.Number(1.5, 2);
+				writer.Key("list");
+				writer.BeginArray();
+				writer.Number(1);
+				writer.String("x");
+				writer.EndArray();
+				writer.Key("table");
+				writer.Raw(table);
+				table.m_isEmbedded = true;
+				writer.Raw(table);
+				writer.EndObject();
+				Assert::AreEqual(std::string("{\n\"name\": \"a\\\"b\",\n\"verbose\": true,\n\"count\": 3,\n\"duration\": 1.50,\n"
+					"\"list\": [1,\n\"x\"],\n\"table\": {\"json_key\":[{\"column_header\":\"item1\"}]},\n"
+					"\"json_key\":[{\"column_header\":\"item1\"}]\n}"), ss.str());
+
+				// Fixed precision does not leak into following values
+				ss.str("");
+				writer.Number(1.125);
+				Assert::AreEqual(std::string("1.125"), ss.str());
+			}
+		}
+
+		TEST_METHOD(test_jsonwriter_wchar)
+		{
+			std::wstringstream ss;
+			JSONWriter<wchar_t> writer(ss);
+			writer.BeginArray();
+			writer.BeginObject();
+			writer.Member(L"pdb_file", std::wstring(L"C:\\a.pdb"));
+			writer.EndObject();
+			writer.BeginObject();
+			writer.Member(L"Kernel_mode", false);
+			writer.EndObject();
+			writer.EndArray();
+			Assert::AreEqual(std::wstring(L"[{\n\"pdb_file\": \"C:\\\\a.pdb\"\n},\n{\n\"Kernel_mode\": false\n}]"), ss.str());
+		}
 	};
 }
@@ -28,9 +28,13 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <random>
+#include <sstream>
+
 #include "pch.h"
 #include "CppUnitTest.h"
 
+#include "wperf/exception.h"
 #include "wperf/metric.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -222,4 +226,170 @@ namespace wperftest_metric
 		}
 
 	};
+
+	TEST_CLASS(wperftest_metric_compiled)
+	{
+	public:
+
+		struct ts_metric
+		{
+			std::wstring events_raw;
+			std::wstring formula_sy;
+		};
+
+		static std::vector<ts_metric> get_all_ts_metrics()
+		{
+			std::vector<ts_metric> result;
+#			define WPERF_TS_EVENTS(...)
+#			define WPERF_TS_METRICS(A,B,C,D,E,F,G,H) result.push_back({ std::wstring(L##C), std::wstring(L##E) });
+#			define WPERF_TS_PRODUCT_CONFIGURATION(...)
+#			define WPERF_TS_ALIAS(...)
+#			define WPERF_TS_GROUPS_METRICS(...)
+#include "wperf-common/neoverse-n1.def"
+#include "wperf-common/neoverse-n2-r0p0.def"
+#include "wperf-common/neoverse-n2-r0p1.def"
+#include "wperf-common/neoverse-n2-r0p3.def"
+#include "wperf-common/neoverse-n2.def"
+#include "wperf-common/neoverse-n3.def"
+#include "wperf-common/neoverse-v1.def"
+#include "wperf-common/neoverse-v2.def"
+#include "wperf-common/neoverse-v3.def"
+#			undef WPERF_TS_EVENTS
+#			undef WPERF_TS_METRICS
+#			undef WPERF_TS_PRODUCT_CONFIGURATION
+#			undef WPERF_TS_ALIAS
+#			undef WPERF_TS_GROUPS_METRICS
+			return result;
+		}
+
+		static std::vector<std::wstring> split_events(const std::wstring& events_raw)
+		{
+			std::vector<std::wstring> result;
+			std::wstring token;
+			std::wistringstream ss(events_raw);
+			while (std::getline(ss, token, L','))
+				result.push_back(token);
+			return result;
+		}
+
+		TEST_METHOD(test_metric_compile_slots)
+		{
+			metric_program program = metric_compile_shunting_yard_expression(L"100 op_retired op_spec / * 1 stall_slot cpu_cycles 8 * / - *");
+
+			Assert::AreEqual(size_t(4), program.vars.size());
+			Assert::AreEqual(0, program.get_slot(L"op_retired"));
+			Assert::AreEqual(1, program.get_slot(L"op_spec"));
+			Assert::AreEqual(2, program.get_slot(L"stall_slot"));
+			Assert::AreEqual(3, program.get_slot(L"cpu_cycles"));
+			Assert::AreEqual(-1, program.get_slot(L"inst_spec"));
+			Assert::AreEqual(size_t(13), program.code.size());
+		}
+
+		TEST_METHOD(test_metric_compile_repeated_variable)
+		{
+			metric_program program = metric_compile_shunting_yard_expression(L"cpu_cycles cpu_cycles +");
+
+			Assert::AreEqual(size_t(1), program.vars.size());
+
+			double slots[] = { 21 };
+			Assert::AreEqual(42.0, metric_evaluate(program, slots));
+		}
+
+		TEST_METHOD(test_metric_compile_bad_formula)
+		{
+			Assert::ExpectException<fatal_exception>([]() { metric_compile_shunting_yard_expression(L"cpu_cycles /"); });
+			Assert::ExpectException<fatal_exception>([]() { metric_compile_shunting_yard_expression(L"cpu_cycles inst_spec"); });
+			Assert::ExpectException<fatal_exception>([]() { metric_compile_shunting_yard_expression(L""); });
+		}
+
+		TEST_METHOD(test_metric_evaluate_div_zero)
+		{
+			metric_program program = metric_compile_shunting_yard_expression(L"ld_spec inst_spec / 100 *");
+
+			double slots[] = { 123456, 0 };		// We force "divide by zero"
+			Assert::IsTrue(metric_evaluate(program, slots) == 0);
+		}
+
+		// Compare compiled formulas with metric_calculate_shunting_yard_expression() for all Neoverse metrics
+		TEST_METHOD(test_metric_evaluate_all_ts_metrics)
+		{
+			std::mt19937_64 rng(2024);
+			std::uniform_int_distribution<uint64_t> dist(0, 1000000);
+
+			auto metrics = get_all_ts_metrics();
+			Assert::IsTrue(metrics.size() > 0);
+
+			std::vector<metric_program> programs;
+			std::vector<std::map<std::wstring, double>> vars(metrics.size());
+			std::vector<std::vector<double>> slots(metrics.size());
+
+			for (size_t m = 0; m < metrics.size(); m++)
+			{
+				programs.push_back(metric_compile_shunting_yard_expression(metrics[m].formula_sy));
+				slots[m].assign(programs[m].vars.size(), 0.0);
+
+				for (const auto& event : split_events(metrics[m].events_raw))
+				{
+					double value = static_cast<double>(dist(rng));
+					vars[m][event] = value;
+					int slot = programs[m].get_slot(event);
+					if (slot >= 0)
+						slots[m][slot] = value;
+				}
+			}
+
+			for (size_t m = 0; m < metrics.size(); m++)
+				Assert::AreEqual(metric_calculate_shunting_yard_expression(vars[m], metrics[m].formula_sy),
+					metric_evaluate(programs[m], slots[m].data()), metrics[m].formula_sy.c_str());
+		}
+
+		TEST_METHOD(test_metric_evaluate_batch_div_zero)
+		{
+			metric_program program = metric_compile_shunting_yard_expression(L"ld_spec inst_spec / 100 * 1 +");
+
+			// [slot][core] matrix: ld_spec row followed by inst_spec row, 0/0 and x/0 for cores 1 and 3
+			double slots[] = { 7, 0, 10, 5,
+			                   2, 0, 4, 0 };
+			double out[4];
+			std::vector<double> scratch;
+			metric_evaluate_batch(program, slots, 4, out, scratch);
+
+			Assert::AreEqual(351.0, out[0]);
+			Assert::IsTrue(out[1] == 0);
+			Assert::AreEqual(251.0, out[2]);
+			Assert::IsTrue(out[3] == 0);
+		}
+
+		// Compare batch evaluation on 128 cores with per core evaluation for all Neoverse metrics
+		TEST_METHOD(test_metric_evaluate_batch_all_ts_metrics)
+		{
+			const size_t cores = 128;
+			std::mt19937_64 rng(128);
+			std::uniform_int_distribution<uint64_t> dist(0, 1000000);
+
+			auto metrics = get_all_ts_metrics();
+			std::vector<double> slots, row(cores), out(cores), expected(cores), scratch;
+
+			for (const auto& metric : metrics)
+			{
+				metric_program program = metric_compile_shunting_yard_expression(metric.formula_sy);
+				const size_t slots_num = program.vars.size();
+
+				slots.resize(slots_num * cores);
+				for (size_t i = 0; i < slots.size(); i++)
+					slots[i] = (i % 17 == 0) ? 0.0 : static_cast<double>(dist(rng));	// Some cores will divide by zero
+
+				for (size_t c = 0; c < cores; c++)
+				{
+					for (size_t s = 0; s < slots_num; s++)
+						row[s] = slots[s * cores + c];
+					expected[c] = metric_evaluate(program, row.data());
+				}
+				metric_evaluate_batch(program, slots.data(), cores, out.data(), scratch);
+
+				for (size_t c = 0; c < cores; c++)
+					Assert::AreEqual(expected[c], out[c], metric.formula_sy.c_str());
+			}
+		}
+	};
 }
@@ -0,0 +1,297 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <windows.h>
+#include "wperf-common\mpxsched.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest_common
+{
+	TEST_CLASS(wperftest_common_mpxsched)
+	{
+	public:
+
+		// Legacy `multiplex_dpc` rotation: window of `counters` consecutive events
+		static std::vector<UINT16> legacy_next(UINT32 counters, UINT32 events_num, UINT64 round)
+		{
+			std::vector<UINT16> slots;
+			UINT32 start = (UINT32)((counters * round) % events_num);
+
+			for (UINT32 i = 0; i < counters && i < events_num; i++)
+				slots.push_back((UINT16)((start + i) % events_num));
+			return slots;
+		}
+
+		static std::vector<UINT16> sched_next(struct mpx_sched* sched)
+		{
+			UINT16 slots[MAX_MANAGED_CORE_EVENTS];
+			UINT32 used = mpx_sched_next(sched, slots, MAX_MANAGED_CORE_EVENTS);
+			return std::vector<UINT16>(slots, slots + used);
+		}
+
+		TEST_METHOD(test_mpx_sched_init_units)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[8];
+			//                                 {g1, g1, g1}   single  {g2, g2}   single
+			struct evt_sched_attr attrs[] = { {1, 1}, {1, 3}, {1, 1}, {0, 1}, {2, 1}, {2, 1}, {0, 200} };
+
+			Assert::IsTrue(mpx_sched_init(&sched, units, 8, 4, attrs, _countof(attrs)));
+			Assert::AreEqual(4u, sched.units_num);
+			Assert::AreEqual((UINT16)3, units[0].size);
+			Assert::AreEqual((UINT16)3, units[0].weight);       // Heaviest member
+			Assert::AreEqual((UINT16)3, units[1].first);
+			Assert::AreEqual((UINT16)2, units[2].size);
+			Assert::AreEqual((UINT16)MPX_SCHED_MAX_WEIGHT, units[3].weight);
+
+			// Group larger than number of counters can't be scheduled
+			Assert::IsFalse(mpx_sched_init(&sched, units, 8, 2, attrs, _countof(attrs)));
+			// Not enough unit storage
+			Assert::IsFalse(mpx_sched_init(&sched, units, 4, 4, attrs, _countof(attrs)));
+		}
+
+		TEST_METHOD(test_mpx_sched_equal_weights_match_legacy_rotation)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[MAX_MANAGED_CORE_EVENTS];
+
+			for (UINT32 events_num : { 6u, 7u, 11u, 13u })
+			{
+				Assert::IsTrue(mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, 5, NULL, events_num));
+				for (UINT64 round = 0; round < 100; round++)
+				{
+					std::vector<UINT16> slots = sched_next(&sched);
+					Assert::IsTrue(legacy_next(5, events_num, round) == slots);
+				}
+			}
+		}
+
+		TEST_METHOD(test_mpx_sched_padding_never_scheduled)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[8];
+			struct evt_sched_attr attrs[] = { {0, 1}, {0, 0}, {0, 1}, {0, 0}, {0, 1}, {0, 0} };
+
+			Assert::IsTrue(mpx_sched_init(&sched, units, 8, 2, attrs, _countof(attrs)));
+			for (int round = 0; round < 50; round++)
+			{
+				std::vector<UINT16> slots = sched_next(&sched);
+				Assert::AreEqual((size_t)2, slots.size());      // No counter is wasted on padding
+				for (UINT16 s : slots)
+					Assert::AreEqual((UINT16)1, attrs[s].weight);
+			}
+		}
+
+		TEST_METHOD(test_mpx_sched_weight_share)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[8];
+			struct evt_sched_attr attrs[] = { {0, 4}, {0, 2}, {0, 1}, {0, 1}, {0, 1}, {0, 1} };
+			UINT64 scheduled[_countof(attrs)] = {};
+			const int rounds = 900;
+
+			Assert::IsTrue(mpx_sched_init(&sched, units, 8, 2, attrs, _countof(attrs)));
+			for (int round = 0; round < rounds; round++)
+				for (UINT16 s : sched_next(&sched))
+					scheduled[s]++;
+
+			// Counter time is shared in proportion to weight: 4 + 2 + 1 * 4 = 10 shares of 2 counters
+			for (size_t i = 0; i < _countof(attrs); i++)
+			{
+				double expected = 2.0 * rounds * attrs[i].weight / 10;
+				Assert::IsTrue(std::fabs(scheduled[i] - expected) <= 2.0);
+			}
+		}
+
+		TEST_METHOD(test_mpx_sched_groups_scheduled_together)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[16];
+			// 5 counters: groups of 3 and 2 events can't share a round with the other 3-event group
+			struct evt_sched_attr attrs[] = { {1, 1}, {1, 1}, {1, 1}, {0, 1}, {2, 2}, {2, 2}, {3, 1}, {3, 1}, {3, 1}, {0, 1} };
+			UINT64 scheduled[_countof(attrs)] = {};
+			const int rounds = 200;
+
+			Assert::IsTrue(mpx_sched_init(&sched, units, 16, 5, attrs, _countof(attrs)));
+			for (int round = 0; round < rounds; round++)
+			{
+				std::vector<UINT16> slots = sched_next(&sched);
+				Assert::IsTrue(slots.size() <= 5);
+
+				for (UINT16 s : slots)
+				{
+					// All members of the group are in this round
+					for (size_t i = 0; i < _countof(attrs); i++)
+						if (attrs[s].group && attrs[i].group == attrs[s].group)
+							Assert::IsTrue(std::find(slots.begin(), slots.end(), (UINT16)i) != slots.end());
+					scheduled[s]++;
+				}
+			}
+
+			// No unit starves
+			for (size_t i = 0; i < _countof(attrs); i++)
+				Assert::IsTrue(scheduled[i] >= rounds / 5);
+		}
+
+		TEST_METHOD(test_mpx_sched_no_starvation)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[8];
+			struct evt_sched_attr attrs[] = { {0, MPX_SCHED_MAX_WEIGHT}, {0, MPX_SCHED_MAX_WEIGHT}, {0, 1}, {1, 1}, {1, 1} };
+			int last[_countof(attrs)] = {};
+
+			Assert::IsTrue(mpx_sched_init(&sched, units, 8, 2, attrs, _countof(attrs)));
+			for (int round = 1; round <= 1000; round++)
+			{
+				for (UINT16 s : sched_next(&sched))
+					last[s] = round;
+
+				// Heavy events can't keep light event or group off counters for long
+				for (size_t i = 0; i < _countof(attrs); i++)
+					Assert::IsTrue(round - last[i] <= 2 * MPX_SCHED_MAX_WEIGHT + 2);
+			}
+		}
+
+		TEST_METHOD(test_mpx_scale)
+		{
+			UINT64 lo, hi;
+
+			Assert::AreEqual(0ull, mpx_scale(100, 0, 10));
+			Assert::AreEqual(100ull, mpx_scale(100, 10, 10));
+			Assert::AreEqual(250ull, mpx_scale(100, 4, 10));
+
+			mpx_scale_range(100, 4, 10, 20, 30, &lo, &hi);
+			Assert::AreEqual(220ull, lo);
+			Assert::AreEqual(280ull, hi);
+
+			UINT64 value = 0, scheduled = 0, dmin = 0, dmax = 0;
+			for (UINT64 delta : { 30ull, 10ull, 20ull })
+				mpx_sched_account(delta, &value, &scheduled, &dmin, &dmax);
+			Assert::AreEqual(60ull, value);
+			Assert::AreEqual(3ull, scheduled);
+			Assert::AreEqual(10ull, dmin);
+			Assert::AreEqual(30ull, dmax);
+		}
+
+		TEST_METHOD(test_mpx_sched_padding_list_share)
+		{
+			// Event list as `set_event_padding()` builds it for 5 counters:
+			//   {g0, g0, g0}, e, e, {g1, g1, g1}, e, e, e, e, pad, pad, pad
+			struct evt_sched_attr attrs[] = {
+				{1, 1}, {1, 1}, {1, 1}, {0, 1}, {0, 1},
+				{2, 1}, {2, 1}, {2, 1}, {0, 1}, {0, 1},
+				{0, 1}, {0, 1}, {0, 0}, {0, 0}, {0, 0},
+			};
+			const size_t events_num = _countof(attrs);
+			const UINT32 counters = 5;
+			UINT64 scheduled[events_num] = {};
+
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[MAX_MANAGED_CORE_EVENTS];
+			Assert::IsTrue(mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, counters, attrs, events_num));
+
+			for (int round = 1; round <= 1000; round++)
+			{
+				// Counters are never wasted on padding
+				std::vector<UINT16> slots = sched_next(&sched);
+				Assert::AreEqual(size_t(counters), slots.size());
+				for (UINT16 s : slots)
+					scheduled[s]++;
+
+				// After any number of rounds units with equal weight are at most one round apart
+				UINT64 lo = ~0ULL, hi = 0;
+				for (size_t i = 0; i < events_num; i++)
+				{
+					if (!attrs[i].weight)
+					{
+						Assert::AreEqual(0ull, scheduled[i]);
+						continue;
+					}
+					lo = (std::min)(lo, scheduled[i]);
+					hi = (std::max)(hi, scheduled[i]);
+				}
+				Assert::IsTrue(hi - lo <= 1);
+			}
+		}
+
+		TEST_METHOD(test_mpx_period_target)
+		{
+			struct mpx_sched sched;
+			struct mpx_sched_unit units[MAX_MANAGED_CORE_EVENTS];
+
+			// 30 events on 6 counters: 5 rounds per rotation, 20 ms each
+			Assert::IsTrue(mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, 6, NULL, 30));
+			Assert::AreEqual(5u, mpx_sched_rotation(&sched));
+			Assert::AreEqual(20L, (long)mpx_period_target(mpx_sched_rotation(&sched), PMU_CTL_START_PERIOD_MIN, PMU_CTL_START_PERIOD));
+
+			// Padding does not make rotation longer
+			struct evt_sched_attr attrs[] = { {0, 1}, {0, 1}, {0, 1}, {0, 0}, {0, 0}, {0, 0}, {0, 0} };
+			Assert::IsTrue(mpx_sched_init(&sched, units, MAX_MANAGED_CORE_EVENTS, 2, attrs, _countof(attrs)));
+			Assert::AreEqual(2u, mpx_sched_rotation(&sched));
+
+			Assert::AreEqual(100L, (long)mpx_period_target(1, PMU_CTL_START_PERIOD_MIN, PMU_CTL_START_PERIOD));
+			Assert::AreEqual((long)PMU_CTL_START_PERIOD_MIN, (long)mpx_period_target(MAX_MANAGED_CORE_EVENTS, PMU_CTL_START_PERIOD_MIN, PMU_CTL_START_PERIOD));
+		}
+
+		TEST_METHOD(test_mpx_period_adapts_to_idle_core)
+		{
+			UINT64 peak_rate = 0;
+			LONG period = 10;
+
+			// Busy core: period stays at target
+			Assert::IsFalse(mpx_period_idle(3000000, 1000, &peak_rate));
+			Assert::IsFalse(mpx_period_idle(2500000, 1000, &peak_rate));
+			period = mpx_period_next(period, 10, 100, false);
+			Assert::AreEqual(10L, (long)period);
+
+			// Idle core: period backs off up to the longest period
+			Assert::IsTrue(mpx_period_idle(1000, 1000, &peak_rate));
+			for (LONG expected : { 20L, 40L, 80L, 100L, 100L })
+			{
+				period = mpx_period_next(period, 10, 100, true);
+				Assert::AreEqual((long)expected, (long)period);
+			}
+
+			// Busy again: back to target at once
+			Assert::IsFalse(mpx_period_idle(3000000, 1000, &peak_rate));
+			Assert::AreEqual(10L, (long)mpx_period_next(period, 10, 100, false));
+			Assert::IsFalse(mpx_period_idle(1000, 0, &peak_rate));
+		}
+	};
+}
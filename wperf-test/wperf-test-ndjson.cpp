@@ -0,0 +1,79 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <string>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/ndjson.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_ndjson)
+	{
+	public:
+
+		TEST_METHOD(test_ndjson_format_empty_record)
+		{
+			ndjson_core_record record;
+			record.interval = 1;
+			record.duration = 0.5;
+			record.core = 3;
+
+			Assert::AreEqual(std::wstring(L"{\"interval\":1,\"duration\":0.5,\"core\":3,\"multiplexing\":false,\"kernel_mode\":false,"
+				L"\"round\":0,\"events\":[],\"metrics\":[]}"), ndjson_format(record));
+		}
+
+		TEST_METHOD(test_ndjson_format_one_line)
+		{
+			ndjson_core_record record;
+			record.interval = 7;
+			record.duration = 1;
+			record.core = 0;
+			record.multiplexing = true;
+			record.kernel_mode = true;
+			record.round = 10;
+			record.events.push_back({ L"cpu_cycles", L"fixed", L"e", 1000, 10, 1000, 1000, 1000 });
+			record.events.push_back({ L"inst_spec", L"0x1b", L"g0,ipc", 400, 5, 800, 650, 900 });
+			record.metrics.push_back({ L"ipc", 0.8, L"per cycle" });
+
+			const std::wstring line = ndjson_format(record);
+			Assert::AreEqual(std::wstring::npos, line.find(L'\n'));
+			Assert::AreEqual(std::wstring(L"{\"interval\":7,\"duration\":1,\"core\":0,\"multiplexing\":true,\"kernel_mode\":true,\"round\":10,"
+				L"\"events\":[{\"event_name\":\"cpu_cycles\",\"event_idx\":\"fixed\",\"event_note\":\"e\",\"counter_value\":1000,\"scheduled\":10,\"scaled_value\":1000,\"scaled_min\":1000,\"scaled_max\":1000},"
+				L"{\"event_name\":\"inst_spec\",\"event_idx\":\"0x1b\",\"event_note\":\"g0,ipc\",\"counter_value\":400,\"scheduled\":5,\"scaled_value\":800,\"scaled_min\":650,\"scaled_max\":900}],"
+				L"\"metrics\":[{\"metric_name\":\"ipc\",\"value\":0.8,\"unit\":\"per cycle\"}]}"), line);
+		}
+	};
+}
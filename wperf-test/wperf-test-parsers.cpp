@@ -1085,4 +1085,35 @@ namespace wperftest
 			}
 		}
 	};
+
+	/****************************************************************************/
+
+	TEST_CLASS(wperftest_parsers_events_weight)
+	{
+	public:
+		TEST_METHOD(test_parse_events_weight)
+		{
+			std::map<enum evt_class, std::map<uint16_t, uint16_t>> weights;	// [event_idx] => weight
+
+			parse_events_weight(L"vfp_spec:2,r1b:4,/dsu/l3d_cache:3", weights);
+
+			Assert::IsTrue(weights[EVT_CORE].size() == 2);
+			Assert::IsTrue(weights[EVT_CORE][0x0075] == 2);	// vfp_spec
+			Assert::IsTrue(weights[EVT_CORE][0x001b] == 4);	// inst_spec
+			Assert::IsTrue(weights[EVT_DSU].size() == 1);
+			Assert::IsTrue(weights[EVT_DSU][0x002b] == 3);	// l3d_cache
+		}
+
+		TEST_METHOD(test_parse_events_weight_invalid)
+		{
+			for (const wchar_t* str : { L"vfp_spec", L"vfp_spec:0", L"vfp_spec:65", L"vfp_spec:x", L"no_such_event:2" })
+			{
+				auto wrapper = [=]() {
+					std::map<enum evt_class, std::map<uint16_t, uint16_t>> weights;
+					parse_events_weight(str, weights);
+				};
+				Assert::ExpectException<fatal_exception>(wrapper);
+			}
+		}
+	};
 }
@@ -0,0 +1,454 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/exception.h"
+#include "wperf/perfdata.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	// Minimal perf.data reader, decodes what Linux perf tools read from files written by PerfDataWriter
+	struct perf_data_reader
+	{
+		struct sample
+		{
+			UINT64 ip = 0, time = 0, id = 0, period = 0;
+			UINT32 pid = 0, tid = 0, cpu = 0;
+			std::vector<UINT64> callchain;
+		};
+
+		struct event_desc
+		{
+			perfdata::perf_event_attr attr;
+			std::string name;
+			std::vector<UINT64> ids;
+		};
+
+		std::string content;
+		perfdata::perf_file_header header;
+		std::vector<perfdata::perf_file_attr> attrs;
+		std::map<UINT64, perfdata::perf_event_attr> attr_by_id;
+		std::vector<UINT32> record_types;
+		std::vector<sample> samples;
+		std::vector<std::string> mmap_filenames;
+		std::map<UINT64, perfdata::perf_file_section> features;	// [HEADER_*] -> section
+
+		template <typename T>
+		T get(UINT64& pos) const
+		{
+			T value;
+			Assert::IsTrue(pos + sizeof(T) <= content.size());
+			memcpy(&value, content.data() + pos, sizeof(T));
+			pos += sizeof(T);
+			return value;
+		}
+
+		std::string get_string(UINT64& pos) const
+		{
+			UINT32 len = get<UINT32>(pos);
+			Assert::IsTrue(pos + len <= content.size());
+			std::string str(content.data() + pos, strnlen(content.data() + pos, len));
+			pos += len;
+			return str;
+		}
+
+		perf_data_reader(const std::string& file) : content(file)
+		{
+			UINT64 pos = 0;
+			header = get<perfdata::perf_file_header>(pos);
+			Assert::AreEqual(perfdata::PERF_FILE_MAGIC, header.magic);
+			Assert::AreEqual(UINT64(sizeof(perfdata::perf_file_header)), header.size);
+			Assert::AreEqual(UINT64(sizeof(perfdata::perf_file_attr)), header.attr_size);
+
+			pos = header.attrs.offset;
+			for (UINT64 i = 0; i < header.attrs.size / header.attr_size; i++)
+			{
+				attrs.push_back(get<perfdata::perf_file_attr>(pos));
+				UINT64 ids = attrs.back().ids.offset;
+				for (UINT64 j = 0; j < attrs.back().ids.size / sizeof(UINT64); j++)
+					attr_by_id[get<UINT64>(ids)] = attrs.back().attr;
+			}
+
+			pos = header.data.offset;
+			while (pos < header.data.offset + header.data.size)
+			{
+				const UINT64 start = pos;
+				auto rec = get<perfdata::perf_event_header>(pos);
+				Assert::IsTrue(rec.size >= sizeof(rec));
+				record_types.push_back(rec.type);
+				if (rec.type == perfdata::PERF_RECORD_SAMPLE)
+					samples.push_back(parse_sample(pos));
+				else if (rec.type == perfdata::PERF_RECORD_MMAP)
+				{
+					pos += 2 * sizeof(UINT32) + 3 * sizeof(UINT64);
+					mmap_filenames.push_back(std::string(content.data() + pos, strnlen(content.data() + pos, start + rec.size - pos)));
+				}
+				pos = start + rec.size;
+			}
+			Assert::AreEqual(header.data.offset + header.data.size, pos);
+
+			// Feature sections are stored in feature bit order right after data section
+			pos = header.data.offset + header.data.size;
+			for (UINT64 bit = perfdata::HEADER_FIRST_FEATURE; bit < perfdata::HEADER_LAST_FEATURE; bit++)
+				if (header.features[bit / 64] & (1ULL << (bit % 64)))
+					features[bit] = get<perfdata::perf_file_section>(pos);
+		}
+
+		// Field order defined by PERF_RECORD_SAMPLE, `sample_type` of all attributes is the same
+		sample parse_sample(UINT64& pos) const
+		{
+			const UINT64 sample_type = attrs.at(0).attr.sample_type;
+			sample s;
+			if (sample_type & perfdata::PERF_SAMPLE_IP) s.ip = get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_TID) { s.pid = get<UINT32>(pos); s.tid = get<UINT32>(pos); }
+			if (sample_type & perfdata::PERF_SAMPLE_TIME) s.time = get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_ADDR) get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_ID) s.id = get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_STREAM_ID) get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_CPU) { s.cpu = get<UINT32>(pos); get<UINT32>(pos); }
+			if (sample_type & perfdata::PERF_SAMPLE_PERIOD) s.period = get<UINT64>(pos);
+			if (sample_type & perfdata::PERF_SAMPLE_CALLCHAIN)
+			{
+				UINT64 nr = get<UINT64>(pos);
+				for (UINT64 i = 0; i < nr; i++)
+					s.callchain.push_back(get<UINT64>(pos));
+			}
+			return s;
+		}
+
+		std::vector<std::string> cmdline() const
+		{
+			UINT64 pos = features.at(perfdata::HEADER_CMDLINE).offset;
+			std::vector<std::string> args(get<UINT32>(pos));
+			for (auto& arg : args)
+				arg = get_string(pos);
+			return args;
+		}
+
+		std::pair<UINT32, UINT32> nrcpus() const
+		{
+			UINT64 pos = features.at(perfdata::HEADER_NRCPUS).offset;
+			UINT32 available = get<UINT32>(pos);
+			return std::make_pair(available, get<UINT32>(pos));
+		}
+
+		std::string cpudesc() const
+		{
+			UINT64 pos = features.at(perfdata::HEADER_CPUDESC).offset;
+			return get_string(pos);
+		}
+
+		std::vector<event_desc> event_descs() const
+		{
+			UINT64 pos = features.at(perfdata::HEADER_EVENT_DESC).offset;
+			std::vector<event_desc> descs(get<UINT32>(pos));
+			UINT32 attr_size = get<UINT32>(pos);
+			Assert::AreEqual(UINT32(sizeof(perfdata::perf_event_attr)), attr_size);
+			for (auto& desc : descs)
+			{
+				desc.attr = get<perfdata::perf_event_attr>(pos);
+				UINT32 nr_ids = get<UINT32>(pos);
+				desc.name = get_string(pos);
+				for (UINT32 i = 0; i < nr_ids; i++)
+					desc.ids.push_back(get<UINT64>(pos));
+			}
+			return descs;
+		}
+	};
+
+	TEST_CLASS(wperftest_perfdata)
+	{
+	public:
+
+		static std::string temp_file_path()
+		{
+			char dir[MAX_PATH], path[MAX_PATH];
+			Assert::AreNotEqual(DWORD(0), GetTempPathA(MAX_PATH, dir));
+			Assert::AreNotEqual(UINT(0), GetTempFileNameA(dir, "wpd", 0, path));
+			return path;
+		}
+
+		static std::string read_and_delete(const std::string& path)
+		{
+			std::ifstream in(path, std::ios::binary);
+			std::stringstream content;
+			content << in.rdbuf();
+			in.close();
+			DeleteFileA(path.c_str());
+			return content.str();
+		}
+
+		// Size of sample record with `nr` callchain entries
+		static UINT64 sample_size(UINT64 nr)
+		{
+			return sizeof(perfdata::perf_data_sample_event) - sizeof(perfdata::perf_data_sample_event::ips) + nr * sizeof(UINT64);
+		}
+
+		template <typename T>
+		static T read_at(const std::string& content, UINT64 offset)
+		{
+			T value;
+			Assert::IsTrue(offset + sizeof(T) <= content.size());
+			memcpy(&value, content.data() + offset, sizeof(T));
+			return value;
+		}
+
+		TEST_METHOD(test_perfdata_register_event_before_open)
+		{
+			PerfDataWriter writer;
+			Assert::ExpectException<fatal_exception>([&writer]() {
+				writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(1), UINT64(0x1000), UINT32(0), UINT64(0x11));
+			});
+		}
+
+		TEST_METHOD(test_perfdata_ticks_to_timestamp)
+		{
+			Assert::AreEqual(UINT64(0), PerfDataWriter::TicksToTimestamp(0, 25000000));
+			Assert::AreEqual(UINT64(40), PerfDataWriter::TicksToTimestamp(1, 25000000));
+			Assert::AreEqual(UINT64(1000000040), PerfDataWriter::TicksToTimestamp(25000001, 25000000));
+
+			// One year of 1 GHz generic timer, `ticks * 1000000000` would overflow
+			const UINT64 year = 365ULL * 24 * 3600 * 1000000000ULL;
+			Assert::AreEqual(year, PerfDataWriter::TicksToTimestamp(year, 1000000000));
+		}
+
+		TEST_METHOD(test_perfdata_records_are_compact)
+		{
+			std::string path = temp_file_path();
+			std::wstring comm = L"app.exe";
+			std::wstring module = L"C:\\app\\app.exe";		// 14 characters + '\0' padded to 16 bytes
+
+			PerfDataWriter writer;
+			writer.Open(path);
+			writer.RegisterSampleEvent(0x11);
+			writer.RegisterEvent(PerfDataWriter::COMM, DWORD(42), comm);
+			writer.RegisterEvent(PerfDataWriter::MMAP, DWORD(42), UINT64(0x140000000), UINT64(0x2000), module, UINT64(0));
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001000), UINT32(3), UINT64(0x11));
+
+			const UINT64 mmap_size = sizeof(perfdata::perf_data_mmap_event) - PATH_MAX + 16;
+			const UINT64 data_size = sizeof(perfdata::perf_data_comm_event) + mmap_size + sample_size(1);
+			Assert::AreEqual(data_size, writer.GetDataSize());
+			writer.Close();
+
+			std::string content = read_and_delete(path);
+			auto header = read_at<perfdata::perf_file_header>(content, 0);
+			Assert::AreEqual(perfdata::PERF_FILE_MAGIC, header.magic);
+			Assert::AreEqual(UINT64(sizeof(perfdata::perf_file_header)), header.data.offset);
+			Assert::AreEqual(data_size, header.data.size);
+
+			// Walk records by `header.size`
+			UINT64 offset = header.data.offset;
+			std::vector<UINT32> types;
+			while (offset < header.data.offset + header.data.size)
+			{
+				auto rec = read_at<perfdata::perf_event_header>(content, offset);
+				types.push_back(rec.type);
+				if (rec.type == perfdata::PERF_RECORD_MMAP)
+				{
+					Assert::AreEqual(UINT16(mmap_size), rec.size);
+					perfdata::perf_data_mmap_event mmap{ 0 };
+					memcpy(&mmap, content.data() + offset, rec.size);
+					Assert::AreEqual(std::string("C:\\app\\app.exe"), std::string(mmap.filename));
+					Assert::AreEqual(UINT64(0x140000000), mmap.start);
+				}
+				offset += rec.size;
+			}
+			Assert::AreEqual(header.data.offset + header.data.size, offset);
+			Assert::IsTrue(std::vector<UINT32>{ perfdata::PERF_RECORD_COMM, perfdata::PERF_RECORD_MMAP, perfdata::PERF_RECORD_SAMPLE } == types);
+
+			// Sample event IDs and attributes follow data section
+			Assert::AreEqual(UINT64(1) * sizeof(perfdata::perf_file_attr), header.attrs.size);
+			auto attr = read_at<perfdata::perf_file_attr>(content, header.attrs.offset);
+			Assert::AreEqual(UINT64(0x11), attr.attr.config);
+			Assert::IsTrue(attr.ids.offset >= header.data.offset + header.data.size);
+			Assert::AreEqual(UINT64(0x11), read_at<UINT64>(content, attr.ids.offset));
+		}
+
+		TEST_METHOD(test_perfdata_streaming_buffer_is_bounded)
+		{
+			std::string path = temp_file_path();
+			const UINT64 samples = 100000;
+
+			PerfDataWriter writer;
+			writer.Open(path);
+			writer.RegisterSampleEvent(0x11);
+			for (UINT64 i = 0; i < samples; i++)
+			{
+				writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001000 + i * 4), UINT32(i % 8), UINT64(0x11));
+				Assert::IsTrue(writer.GetBufferedSize() <= PERF_DATA_BUFFER_SIZE);
+			}
+			Assert::AreEqual(samples * sample_size(1), writer.GetDataSize());
+			writer.Close();
+
+			std::string content = read_and_delete(path);
+			auto header = read_at<perfdata::perf_file_header>(content, 0);
+			Assert::AreEqual(samples * sample_size(1), header.data.size);
+
+			auto last = read_at<perfdata::perf_data_sample_event>(content, header.data.offset + header.data.size - sample_size(1));
+			Assert::AreEqual(UINT64(0x140001000 + (samples - 1) * 4), last.ip);
+			Assert::AreEqual(UINT32((samples - 1) % 8), last.cpu);
+		}
+
+		TEST_METHOD(test_perfdata_features_after_data)
+		{
+			std::string path = temp_file_path();
+			const wchar_t* argv[] = { L"wperf", L"record" };
+
+			PerfDataWriter writer;
+			writer.Open(path);
+			writer.WriteCommandLine(2, argv);
+			writer.RegisterSampleEvent(0x11);
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001000), UINT32(0), UINT64(0x11));
+			writer.Close();
+
+			std::string content = read_and_delete(path);
+			auto header = read_at<perfdata::perf_file_header>(content, 0);
+			const UINT64 features = (1ULL << perfdata::HEADER_CMDLINE) | (1ULL << perfdata::HEADER_EVENT_DESC);
+			Assert::AreEqual(features, header.features[0]);
+
+			// perf reads feature sections table at the end of data section, HEADER_CMDLINE is the lowest bit set
+			auto section = read_at<perfdata::perf_file_section>(content, header.data.offset + header.data.size);
+			Assert::AreEqual(header.data.offset + header.data.size + 2 * sizeof(perfdata::perf_file_section), section.offset);
+
+			UINT64 offset = section.offset;
+			Assert::AreEqual(UINT32(2), read_at<UINT32>(content, offset));
+			offset += sizeof(UINT32);
+
+			std::vector<std::string> args;
+			for (int i = 0; i < 2; i++)
+			{
+				UINT32 len = read_at<UINT32>(content, offset);
+				offset += sizeof(UINT32);
+				Assert::IsTrue(offset + len <= content.size());
+				args.push_back(std::string(content.data() + offset));
+				offset += len;
+			}
+			Assert::AreEqual(section.offset + section.size, offset);
+			Assert::IsTrue(std::vector<std::string>{ "wperf", "record" } == args);
+
+			// IDs and attributes follow feature sections
+			Assert::IsTrue(header.attrs.offset >= section.offset + section.size);
+			auto attr = read_at<perfdata::perf_file_attr>(content, header.attrs.offset);
+			Assert::AreEqual(UINT64(0x11), attr.attr.config);
+		}
+
+		TEST_METHOD(test_perfdata_round_trip)
+		{
+			std::string path = temp_file_path();
+			std::wstring comm = L"app.exe";
+			std::wstring module = L"C:\\app\\app.exe";
+			const wchar_t* argv[] = { L"wperf", L"record", L"-e", L"cpu_cycles:10000,inst_retired:50000", L"--export-perf-data" };
+
+			PerfDataWriter writer;
+			writer.WriteCommandLine(5, argv);
+			writer.WriteCpuInfo(8, 6, L"neoverse-n1");
+			writer.Open(path);
+			writer.RegisterSampleEvent(0x11, 10000, L"cpu_cycles");
+			writer.RegisterSampleEvent(0x08, 50000, L"inst_retired");
+			writer.RegisterSampleEvent(0x11, 20000, L"ignored");		// Already registered
+			writer.RegisterEvent(PerfDataWriter::COMM, DWORD(42), comm);
+			writer.RegisterEvent(PerfDataWriter::MMAP, DWORD(42), UINT64(0x140000000), UINT64(0x2000), module, UINT64(0));
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001000), UINT64(0x140001800), UINT32(3), UINT64(0x11), UINT64(1000), UINT64(10000));
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001004), UINT64(0), UINT32(5), UINT64(0x08), UINT64(2000), UINT64(50000));
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x140001008), UINT32(7), UINT64(0x08));
+			// Not registered (e.g. SPE event known after decoding), gets its own attribute
+			writer.RegisterEvent(PerfDataWriter::SAMPLE, DWORD(42), UINT64(0x14000100C), UINT64(0x140002000), UINT32(1), UINT64(0x03), UINT64(3000), UINT64(1));
+			writer.Close();
+
+			perf_data_reader reader(read_and_delete(path));
+
+			Assert::IsTrue(std::vector<UINT32>{ perfdata::PERF_RECORD_COMM, perfdata::PERF_RECORD_MMAP,
+				perfdata::PERF_RECORD_SAMPLE, perfdata::PERF_RECORD_SAMPLE, perfdata::PERF_RECORD_SAMPLE, perfdata::PERF_RECORD_SAMPLE } == reader.record_types);
+			Assert::AreEqual(size_t(1), reader.mmap_filenames.size());
+			Assert::AreEqual(std::string("C:\\app\\app.exe"), reader.mmap_filenames[0]);
+
+			// Attributes
+			Assert::AreEqual(size_t(3), reader.attrs.size());
+			for (const auto& fattr : reader.attrs)
+				Assert::AreEqual(perfdata::PERF_DATA_SAMPLE_TYPE, fattr.attr.sample_type);
+			Assert::AreEqual(UINT64(10000), reader.attr_by_id.at(0x11).sample_period);
+			Assert::AreEqual(UINT64(50000), reader.attr_by_id.at(0x08).sample_period);
+			Assert::AreEqual(UINT64(1), reader.attr_by_id.at(0x03).sample_period);
+
+			// Samples
+			Assert::AreEqual(size_t(4), reader.samples.size());
+			const auto& s0 = reader.samples[0];
+			Assert::AreEqual(UINT64(0x140001000), s0.ip);
+			Assert::AreEqual(UINT32(42), s0.pid);
+			Assert::AreEqual(UINT32(42), s0.tid);
+			Assert::AreEqual(UINT64(1000), s0.time);
+			Assert::AreEqual(UINT64(0x11), s0.id);
+			Assert::AreEqual(UINT32(3), s0.cpu);
+			Assert::AreEqual(UINT64(10000), s0.period);
+			Assert::IsTrue(std::vector<UINT64>{ 0x140001000, 0x140001800 } == s0.callchain);
+
+			const auto& s1 = reader.samples[1];
+			Assert::AreEqual(UINT32(5), s1.cpu);
+			Assert::AreEqual(UINT64(2000), s1.time);
+			Assert::IsTrue(std::vector<UINT64>{ 0x140001004 } == s1.callchain);	// No link register
+
+			const auto& s2 = reader.samples[2];
+			Assert::AreEqual(UINT32(7), s2.cpu);
+			Assert::AreEqual(UINT64(0), s2.time);
+			Assert::AreEqual(UINT64(50000), s2.period);		// Period of registered event
+
+			const auto& s3 = reader.samples[3];
+			Assert::AreEqual(UINT64(0x03), s3.id);
+			Assert::AreEqual(UINT32(1), s3.cpu);
+			Assert::IsTrue(std::vector<UINT64>{ 0x14000100C, 0x140002000 } == s3.callchain);
+
+			// Features
+			Assert::AreEqual(size_t(4), reader.features.size());
+			Assert::IsTrue(std::vector<std::string>{ "wperf", "record", "-e", "cpu_cycles:10000,inst_retired:50000", "--export-perf-data" } == reader.cmdline());
+			Assert::AreEqual(UINT32(8), reader.nrcpus().first);
+			Assert::AreEqual(UINT32(6), reader.nrcpus().second);
+			Assert::AreEqual(std::string("neoverse-n1"), reader.cpudesc());
+
+			auto descs = reader.event_descs();
+			Assert::AreEqual(size_t(3), descs.size());
+			Assert::AreEqual(std::string("cpu_cycles"), descs[0].name);
+			Assert::AreEqual(std::string("inst_retired"), descs[1].name);
+			Assert::AreEqual(std::string("raw 0x0003"), descs[2].name);
+			Assert::IsTrue(std::vector<UINT64>{ 0x08 } == descs[1].ids);
+			Assert::AreEqual(UINT64(0x08), descs[1].attr.config);
+		}
+	};
+}
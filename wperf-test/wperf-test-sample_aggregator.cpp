@@ -0,0 +1,181 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/sample_aggregator.h"
+#include "wperf-common/iorequest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_sample_aggregator)
+	{
+	public:
+
+		static SampleDesc make_symbol(const std::wstring& name)
+		{
+			SampleDesc sd;
+			sd.desc.name = name;
+			sd.desc.sname = name;
+			return sd;
+		}
+
+		TEST_METHOD(test_intern_same_name)
+		{
+			sample_aggregator aggregator;
+
+			uint32_t a = aggregator.intern(make_symbol(L"x_mul:python312_d.dll"));
+			uint32_t b = aggregator.intern(make_symbol(L"v_iadd:python312_d.dll"));
+			uint32_t c = aggregator.intern(make_symbol(L"x_mul:python312_d.dll"));
+
+			Assert::AreNotEqual(a, b);
+			Assert::AreEqual(a, c);
+			Assert::AreEqual(size_t(2), aggregator.symbol_count());
+			Assert::AreEqual(size_t(0), aggregator.entry_count());
+		}
+
+		TEST_METHOD(test_add_pc_histogram)
+		{
+			sample_aggregator aggregator;
+			uint32_t sym = aggregator.intern(make_symbol(L"x_mul"));
+
+			aggregator.add(sym, 0x11, 0x1008, 0);
+			aggregator.add(sym, 0x11, 0x1000, 0);
+			aggregator.add(sym, 0x11, 0x1008, 1);
+			aggregator.add(sym, 0x11, 0x1008, 0);
+
+			std::vector<SampleDesc> resolved = aggregator.get_resolved_samples();
+			Assert::AreEqual(size_t(1), resolved.size());
+
+			const SampleDesc& sd = resolved[0];
+			Assert::AreEqual(std::wstring(L"x_mul"), sd.desc.name);
+			Assert::AreEqual(uint32_t(0x11), sd.event_src);
+			Assert::AreEqual(uint32_t(4), sd.freq);
+
+			Assert::AreEqual(size_t(2), sd.pc.size());
+			Assert::AreEqual(uint64_t(0x1000), sd.pc[0].first);
+			Assert::AreEqual(uint64_t(1), sd.pc[0].second);
+			Assert::AreEqual(uint64_t(0x1008), sd.pc[1].first);
+			Assert::AreEqual(uint64_t(3), sd.pc[1].second);
+
+			Assert::AreEqual(size_t(3), sd.pc_cpu.size());
+			Assert::AreEqual(uint64_t(2), sd.pc_cpu.at(std::make_pair(uint64_t(0x1008), uint32_t(0))));
+			Assert::AreEqual(uint64_t(1), sd.pc_cpu.at(std::make_pair(uint64_t(0x1008), uint32_t(1))));
+			Assert::AreEqual(uint64_t(1), sd.pc_cpu.at(std::make_pair(uint64_t(0x1000), uint32_t(0))));
+		}
+
+		TEST_METHOD(test_entries_per_event_src)
+		{
+			sample_aggregator aggregator;
+			uint32_t x_mul = aggregator.intern(make_symbol(L"x_mul"));
+			uint32_t v_iadd = aggregator.intern(make_symbol(L"v_iadd"));
+
+			aggregator.add(v_iadd, 0x11, 0x2000, 0);
+			aggregator.add(x_mul, 0x11, 0x1000, 0);
+			aggregator.add(x_mul, 0x06, 0x1000, 0);
+			aggregator.add(v_iadd, 0x11, 0x2004, 0);
+
+			std::vector<SampleDesc> resolved = aggregator.get_resolved_samples();
+			Assert::AreEqual(size_t(3), resolved.size());
+
+			// Entries are returned in order of first occurrence
+			Assert::AreEqual(std::wstring(L"v_iadd"), resolved[0].desc.name);
+			Assert::AreEqual(uint32_t(0x11), resolved[0].event_src);
+			Assert::AreEqual(uint32_t(2), resolved[0].freq);
+			Assert::AreEqual(std::wstring(L"x_mul"), resolved[1].desc.name);
+			Assert::AreEqual(uint32_t(0x11), resolved[1].event_src);
+			Assert::AreEqual(uint32_t(1), resolved[1].freq);
+			Assert::AreEqual(std::wstring(L"x_mul"), resolved[2].desc.name);
+			Assert::AreEqual(uint32_t(0x06), resolved[2].event_src);
+			Assert::AreEqual(uint32_t(1), resolved[2].freq);
+		}
+
+		TEST_METHOD(test_replay_synthetic_frames)
+		{
+			// Replay synthetic sample stream: 256 symbols, 16 PCs each, 4 cores and 2 events
+			const size_t frames_num = 1000000;
+			const uint32_t symbols_num = 256, pcs_per_symbol = 16;
+			const uint32_t events[] = { CYCLE_EVT_IDX, 0x11 };
+
+			std::vector<FrameChain> raw_samples(frames_num);
+			uint64_t seed = 0x2545F4914F6CDD1DULL;
+			for (auto& frame : raw_samples)
+			{
+				seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+				uint32_t r = static_cast<uint32_t>(seed >> 32);
+				frame.pc = 0x140001000ULL + (r % (symbols_num * pcs_per_symbol)) * 4;
+				frame.cpu = (r >> 16) % 4;
+				frame.ov_flags = ((r >> 24) & 1) + 1;
+			}
+
+			sample_aggregator aggregator;
+			std::map<std::pair<uint32_t, uint32_t>, uint64_t> expected;   // [symbol, event_src] -> freq
+
+			for (const auto& frame : raw_samples)
+			{
+				uint32_t symbol = static_cast<uint32_t>(((frame.pc - 0x140001000ULL) / 4) / pcs_per_symbol);
+				uint32_t sym_id = aggregator.intern(make_symbol(L"sym_" + std::to_wstring(symbol)));
+				uint32_t event_src = events[frame.ov_flags - 1];
+				aggregator.add(sym_id, event_src, frame.pc, frame.cpu);
+				expected[std::make_pair(symbol, event_src)]++;
+			}
+
+			Assert::AreEqual(size_t(symbols_num), aggregator.symbol_count());
+
+			std::vector<SampleDesc> resolved = aggregator.get_resolved_samples();
+			Assert::AreEqual(expected.size(), resolved.size());
+
+			uint64_t total = 0;
+			for (const auto& sd : resolved)
+			{
+				uint32_t symbol = std::stoul(sd.desc.name.substr(4));
+				Assert::AreEqual(expected[std::make_pair(symbol, sd.event_src)], uint64_t(sd.freq));
+
+				uint64_t pc_total = 0;
+				for (const auto& [pc, count] : sd.pc)
+					pc_total += count;
+				Assert::AreEqual(uint64_t(sd.freq), pc_total);
+				Assert::IsTrue(sd.pc.size() <= pcs_per_symbol);
+
+				total += sd.freq;
+			}
+			Assert::AreEqual(uint64_t(frames_num), total);
+		}
+	};
+}
@@ -0,0 +1,397 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <thread>
+#include <vector>
+#include <windows.h>
+#include "wperf-common\samplering.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest_common
+{
+	// Heap storage for `struct sample_ring_shared` with `capacity` frames, cache line aligned like driver rings
+	struct sample_ring_storage
+	{
+		std::vector<UINT8> mem;
+		sample_ring_storage(UINT64 capacity) : mem(SAMPLE_RING_SHARED_SIZE(capacity) + SYSTEM_CACHE_ALIGNMENT_SIZE) {}
+		struct sample_ring_shared* get()
+		{
+			UINT_PTR addr = (reinterpret_cast<UINT_PTR>(mem.data()) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) & ~UINT_PTR(SYSTEM_CACHE_ALIGNMENT_SIZE - 1);
+			return reinterpret_cast<struct sample_ring_shared*>(addr);
+		}
+	};
+
+	TEST_CLASS(wperftest_common_samplering)
+	{
+	public:
+
+		TEST_METHOD(test_sample_ring_capacity_valid)
+		{
+			Assert::IsFalse(sample_ring_capacity_valid(0));
+			Assert::IsFalse(sample_ring_capacity_valid(3));
+			Assert::IsFalse(sample_ring_capacity_valid(100));
+
+			Assert::IsTrue(sample_ring_capacity_valid(1));
+			Assert::IsTrue(sample_ring_capacity_valid(128));
+			Assert::IsTrue(sample_ring_capacity_valid(SAMPLE_RING_BUFFER_SIZE));
+		}
+
+		TEST_METHOD(test_sample_ring_capacity_clamp)
+		{
+			Assert::AreEqual(UINT64(SAMPLE_RING_BUFFER_SIZE), sample_ring_capacity_clamp(0));
+			Assert::AreEqual(UINT64(SAMPLE_RING_MIN_SIZE), sample_ring_capacity_clamp(1));
+			Assert::AreEqual(UINT64(SAMPLE_RING_MIN_SIZE), sample_ring_capacity_clamp(SAMPLE_RING_MIN_SIZE));
+			Assert::AreEqual(UINT64(SAMPLE_RING_MIN_SIZE * 2), sample_ring_capacity_clamp(SAMPLE_RING_MIN_SIZE + 1));
+			Assert::AreEqual(UINT64(32768), sample_ring_capacity_clamp(20000));
+			Assert::AreEqual(UINT64(SAMPLE_RING_MAX_SIZE), sample_ring_capacity_clamp(SAMPLE_RING_MAX_SIZE));
+			Assert::AreEqual(UINT64(SAMPLE_RING_MAX_SIZE), sample_ring_capacity_clamp(UINT64_MAX));
+
+			Assert::IsTrue(sample_ring_capacity_valid(sample_ring_capacity_clamp(12345)));
+		}
+
+		TEST_METHOD(test_sample_ring_init_nok)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(16);
+
+			Assert::IsFalse(sample_ring_init(nullptr, storage.get(), 16));
+			Assert::IsFalse(sample_ring_init(&ring, nullptr, 16));
+			Assert::IsFalse(sample_ring_init(&ring, storage.get(), 15));
+		}
+
+		TEST_METHOD(test_sample_ring_push_until_full)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(8);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 8));
+
+			FrameChain fc = { 0 };
+			for (UINT64 i = 0; i < 8; i++)
+			{
+				fc.pc = i;
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+			}
+
+			Assert::AreEqual(UINT64(8), sample_ring_count(&ring));
+			Assert::IsFalse(sample_ring_push(&ring, &fc));	// Full
+			Assert::AreEqual(UINT64(8), sample_ring_count(&ring));
+		}
+
+		TEST_METHOD(test_sample_ring_pop_bulk_wrap)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(8);
+			std::vector<FrameChain> out(8);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 8));
+
+			FrameChain fc = { 0 };
+			UINT64 next_pc = 0, expected_pc = 0;
+
+			// Move indices around the ring several times with odd sized batches
+			for (int round = 0; round < 10; round++)
+			{
+				for (int i = 0; i < 5; i++)
+				{
+					fc.pc = next_pc++;
+					Assert::IsTrue(sample_ring_push(&ring, &fc));
+				}
+
+				UINT64 n = sample_ring_pop_bulk(&ring, out.data(), 3);
+				Assert::AreEqual(UINT64(3), n);
+				n += sample_ring_pop_bulk(&ring, out.data() + 3, 8);
+				Assert::AreEqual(UINT64(5), n);
+
+				for (UINT64 i = 0; i < n; i++)
+					Assert::AreEqual(expected_pc++, out[i].pc);
+			}
+
+			Assert::AreEqual(UINT64(0), sample_ring_count(&ring));
+			Assert::AreEqual(UINT64(0), sample_ring_pop_bulk(&ring, out.data(), 8));
+		}
+
+		TEST_METHOD(test_sample_ring_reset)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(4);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 4));
+
+			FrameChain fc = { 0 };
+			Assert::IsTrue(sample_ring_push(&ring, &fc));
+			Assert::IsTrue(sample_ring_push(&ring, &fc));
+			sample_ring_reset(&ring);
+
+			Assert::AreEqual(UINT64(0), sample_ring_count(&ring));
+		}
+
+		TEST_METHOD(test_sample_ring_simulated_isr_drop_rate)
+		{
+			// Simulated ISR: 1000 samples per 100 ms poll, user space drains in bulk
+			// on each poll. Ring is big enough so nothing should be dropped.
+			struct sample_ring ring;
+			sample_ring_storage storage(SAMPLE_RING_BUFFER_SIZE);
+			std::vector<FrameChain> out(SAMPLE_CHAIN_BUFFER_SIZE);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), SAMPLE_RING_BUFFER_SIZE));
+
+			UINT64 generated = 0, dropped = 0, consumed = 0;
+			FrameChain fc = { 0 };
+
+			for (int poll = 0; poll < 100; poll++)
+			{
+				for (int i = 0; i < 1000; i++)
+				{
+					fc.pc = generated++;
+					if (!sample_ring_push(&ring, &fc))
+						dropped++;
+				}
+
+				UINT64 n;
+				do
+				{
+					n = sample_ring_pop_bulk(&ring, out.data(), out.size());
+					consumed += n;
+				} while (n == out.size());
+			}
+
+			Assert::AreEqual(UINT64(0), dropped);
+			Assert::AreEqual(generated, consumed);
+		}
+
+		TEST_METHOD(test_sample_ring_concurrent_producer)
+		{
+			// Producer and consumer running on different threads, every
+			// generated frame must be either consumed (in order) or dropped.
+			struct sample_ring ring;
+			sample_ring_storage storage(1024);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 1024));
+
+			const UINT64 total = 1000000;
+			volatile LONG done = 0;
+			UINT64 dropped = 0;
+
+			std::thread producer([&]() {
+				FrameChain fc = { 0 };
+				for (UINT64 i = 0; i < total; i++)
+				{
+					fc.pc = i;
+					fc.lr = ~i;
+					if (!sample_ring_push(&ring, &fc))
+						dropped++;
+				}
+				InterlockedExchange(&done, 1);
+			});
+
+			std::vector<FrameChain> out(SAMPLE_CHAIN_BUFFER_SIZE);
+			UINT64 consumed = 0;
+			UINT64 last_pc = 0;
+			bool ordered = true, intact = true;
+
+			for (;;)
+			{
+				bool finished = InterlockedCompareExchange(&done, 0, 0) != 0;
+				UINT64 n = sample_ring_pop_bulk(&ring, out.data(), out.size());
+				for (UINT64 i = 0; i < n; i++)
+				{
+					if (consumed && out[i].pc <= last_pc)
+						ordered = false;
+					if (out[i].lr != ~out[i].pc)
+						intact = false;
+					last_pc = out[i].pc;
+					consumed++;
+				}
+				if (finished && n == 0)
+					break;
+			}
+
+			producer.join();
+
+			Assert::IsTrue(ordered);
+			Assert::IsTrue(intact);
+			Assert::AreEqual(total, consumed + dropped);
+		}
+
+		TEST_METHOD(test_sample_ring_shared_peek_consume)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(8);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 8));
+			Assert::IsTrue(sample_ring_shared_valid(storage.get()));
+
+			const FrameChain* frames = nullptr;
+			Assert::AreEqual(UINT64(0), sample_ring_shared_peek(storage.get(), &frames));
+
+			FrameChain fc = { 0 };
+			for (UINT64 i = 0; i < 6; i++)
+			{
+				fc.pc = i;
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+			}
+			sample_ring_shared_consume(storage.get(), 6);
+
+			// Head is now at slot 6, next 4 frames wrap around the end of the ring
+			for (UINT64 i = 6; i < 10; i++)
+			{
+				fc.pc = i;
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+			}
+
+			Assert::AreEqual(UINT64(2), sample_ring_shared_peek(storage.get(), &frames));
+			Assert::AreEqual(UINT64(6), frames[0].pc);
+			Assert::AreEqual(UINT64(7), frames[1].pc);
+			sample_ring_shared_consume(storage.get(), 2);
+
+			Assert::AreEqual(UINT64(2), sample_ring_shared_peek(storage.get(), &frames));
+			Assert::AreEqual(UINT64(8), frames[0].pc);
+			Assert::AreEqual(UINT64(9), frames[1].pc);
+			sample_ring_shared_consume(storage.get(), 2);
+
+			Assert::AreEqual(UINT64(0), sample_ring_count(&ring));
+		}
+
+		TEST_METHOD(test_sample_ring_tail_cached)
+		{
+			struct sample_ring ring;
+			sample_ring_storage storage(8);
+			std::vector<FrameChain> out(8);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 8));
+
+			FrameChain fc = { 0 };
+			for (UINT64 i = 0; i < 8; i++)
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+			Assert::AreEqual(LONG64(0), ring.tail);
+
+			// Released slots are seen on first push which finds ring full
+			Assert::AreEqual(UINT64(4), sample_ring_pop_bulk(&ring, out.data(), 4));
+			Assert::AreEqual(LONG64(0), ring.tail);
+			Assert::IsTrue(sample_ring_push(&ring, &fc));
+			Assert::AreEqual(LONG64(4), ring.tail);
+
+			for (UINT64 i = 0; i < 3; i++)
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+			Assert::IsFalse(sample_ring_push(&ring, &fc));
+			Assert::AreEqual(UINT64(8), sample_ring_count(&ring));
+		}
+
+		TEST_METHOD(test_sample_ring_layout)
+		{
+			Assert::AreEqual(size_t(0), FIELD_OFFSET(struct sample_ring_shared, head) % SYSTEM_CACHE_ALIGNMENT_SIZE);
+			Assert::AreEqual(size_t(0), FIELD_OFFSET(struct sample_ring_shared, tail) % SYSTEM_CACHE_ALIGNMENT_SIZE);
+			Assert::AreEqual(size_t(0), FIELD_OFFSET(struct sample_ring_shared, frames) % SYSTEM_CACHE_ALIGNMENT_SIZE);
+			Assert::IsTrue(FIELD_OFFSET(struct sample_ring_shared, tail) - FIELD_OFFSET(struct sample_ring_shared, head) >= SYSTEM_CACHE_ALIGNMENT_SIZE);
+		}
+
+		TEST_METHOD(test_sample_ring_bogus_tail)
+		{
+			// Consumer can write anything to mapped `tail`, producer must not
+			// write outside of the ring and count must stay in range.
+			struct sample_ring ring;
+			sample_ring_storage storage(8);
+			Assert::IsTrue(sample_ring_init(&ring, storage.get(), 8));
+
+			FrameChain fc = { 0 };
+			for (UINT64 i = 0; i < 8; i++)
+				Assert::IsTrue(sample_ring_push(&ring, &fc));
+
+			// Producer reads shared `tail` only when ring looks full
+			storage.get()->tail = 1000;
+			Assert::IsFalse(sample_ring_push(&ring, &fc));
+			Assert::IsTrue(sample_ring_count(&ring) <= 8);
+
+			storage.get()->tail = -1000;
+			Assert::IsFalse(sample_ring_push(&ring, &fc));
+			Assert::IsTrue(sample_ring_count(&ring) <= 8);
+
+			std::vector<FrameChain> out(16);
+			Assert::IsTrue(sample_ring_pop_bulk(&ring, out.data(), out.size()) <= 8);
+		}
+
+		TEST_METHOD(test_sample_ring_shared_mapping)
+		{
+			// Stand-in for the driver mapping: same section mapped twice, producer
+			// writes through one view and consumer reads in place through the other.
+			const UINT64 capacity = 1024;
+			const DWORD size = (DWORD)SAMPLE_RING_SHARED_SIZE(capacity);
+
+			HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, NULL);
+			Assert::IsNotNull(section);
+
+			auto producer_view = (struct sample_ring_shared*)MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+			auto consumer_view = (struct sample_ring_shared*)MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+			Assert::IsNotNull(producer_view);
+			Assert::IsNotNull(consumer_view);
+			Assert::IsTrue(producer_view != consumer_view);
+
+			struct sample_ring ring;
+			Assert::IsTrue(sample_ring_init(&ring, producer_view, capacity));
+			Assert::IsTrue(sample_ring_shared_valid(consumer_view));
+
+			const UINT64 total = 200000;
+			volatile LONG done = 0;
+			UINT64 dropped = 0;
+
+			std::thread producer([&]() {
+				FrameChain fc = { 0 };
+				for (UINT64 i = 0; i < total; i++)
+				{
+					fc.pc = i;
+					if (!sample_ring_push(&ring, &fc))
+						dropped++;
+				}
+				InterlockedExchange(&done, 1);
+			});
+
+			std::vector<FrameChain> samples;
+			for (;;)
+			{
+				bool finished = InterlockedCompareExchange(&done, 0, 0) != 0;
+				const FrameChain* frames = nullptr;
+				UINT64 n = sample_ring_shared_peek(consumer_view, &frames);
+				samples.insert(samples.end(), frames, frames + n);
+				sample_ring_shared_consume(consumer_view, n);
+				if (finished && n == 0)
+					break;
+			}
+
+			producer.join();
+
+			Assert::AreEqual(total, (UINT64)samples.size() + dropped);
+			for (size_t i = 1; i < samples.size(); i++)
+				Assert::IsTrue(samples[i - 1].pc < samples[i].pc);
+
+			UnmapViewOfFile(consumer_view);
+			UnmapViewOfFile(producer_view);
+			CloseHandle(section);
+		}
+	};
+}
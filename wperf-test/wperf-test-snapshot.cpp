@@ -0,0 +1,359 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <windows.h>
+#include "wperf-common\snapshot.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest_common
+{
+	static ReadOut make_read_out(UINT32 core, UINT32 evt_num)
+	{
+		ReadOut out = { 0 };
+		out.evt_num = evt_num;
+		out.round = core;
+		for (UINT32 j = 0; j < evt_num; j++)
+			out.evts[j] = { j, 0, core * 1000ull + j, 10ull + j };
+		return out;
+	}
+
+	// Writer side of PMU_CTL_READ_COUNTING_BATCH, one entry for each of `cores_no`
+	static UINT32 write_snapshot(const std::vector<ReadOut>& cores, const std::vector<UINT8>& cores_no, void* buf, UINT32 buf_size)
+	{
+		struct counting_snapshot_hdr* snapshot = counting_snapshot_init(buf, buf_size);
+		if (!snapshot)
+			return 0;
+
+		for (UINT8 core : cores_no)
+		{
+			const ReadOut& in = cores[core];
+			struct counting_snapshot_entry* entry = counting_snapshot_add(snapshot, buf_size, core, in.evt_num, in.round);
+			if (!entry)
+				return 0;
+			for (UINT32 j = 0; j < in.evt_num; j++)
+				entry->evts[j] = in.evts[j];
+		}
+		return snapshot->size;
+	}
+
+	static void assert_read_out_equal(const ReadOut& expected, const ReadOut& actual)
+	{
+		Assert::AreEqual(expected.evt_num, actual.evt_num);
+		Assert::AreEqual(expected.round, actual.round);
+		for (UINT32 j = 0; j < expected.evt_num; j++)
+		{
+			Assert::AreEqual(expected.evts[j].event_idx, actual.evts[j].event_idx);
+			Assert::AreEqual(expected.evts[j].value, actual.evts[j].value);
+			Assert::AreEqual(expected.evts[j].scheduled, actual.evts[j].scheduled);
+		}
+	}
+
+	// Simulates one core counting with timer DPCs: every `period` ticks values counted by hardware
+	// counters are folded into `evts` and counters restart, see update_core_counting() and multiplex_dpc().
+	// Events above `counters` are multiplexed round robin. `read_live()` is the driver side of CTL_FLAG_LIVE.
+	struct mock_live_core
+	{
+		UINT32 counters;
+		UINT64 period, tick = 0;
+		UINT32 first = 0;					// First event counted in current round
+		ReadOut out = { 0 };				// Values folded in by timer DPCs
+		std::vector<UINT64> hw;				// Hardware counters, not folded in yet
+		std::vector<UINT64> counted;		// Everything hardware counted since reset
+
+		mock_live_core(UINT32 evt_num, UINT32 counters_num, UINT64 period_ticks) : counters(counters_num), period(period_ticks),
+			hw(evt_num), counted(evt_num)
+		{
+			out.evt_num = evt_num;
+			for (UINT32 j = 0; j < evt_num; j++)
+				out.evts[j].event_idx = 0x10 + j;
+		}
+
+		bool counting(UINT32 j) const
+		{
+			return out.evt_num <= counters || (j + out.evt_num - first) % out.evt_num < counters;
+		}
+
+		void run(UINT64 ticks)
+		{
+			for (UINT64 t = 0; t < ticks; t++, tick++)
+			{
+				for (UINT32 j = 0; j < out.evt_num; j++)
+				{
+					if (!counting(j))
+						continue;
+					UINT64 inc = (j + 1) * (1 + (tick + j) % 3);
+					hw[j] += inc;
+					counted[j] += inc;
+				}
+
+				if ((tick + 1) % period == 0)
+					timer();
+			}
+		}
+
+		void timer()
+		{
+			for (UINT32 j = 0; j < out.evt_num; j++)
+			{
+				if (counting(j))
+				{
+					out.evts[j].value += hw[j];
+					out.evts[j].scheduled++;
+				}
+				hw[j] = 0;
+			}
+			out.round++;
+			if (out.evt_num > counters)
+				first = (first + counters) % out.evt_num;
+		}
+
+		void reset()
+		{
+			for (UINT32 j = 0; j < out.evt_num; j++)
+			{
+				out.evts[j].value = out.evts[j].scheduled = 0;
+				hw[j] = counted[j] = 0;
+			}
+			out.round = 0;
+		}
+
+		void read_live(ReadOut& reading) const
+		{
+			reading = out;
+			for (UINT32 j = 0; j < out.evt_num; j++)
+				reading.evts[j].value += hw[j];
+		}
+	};
+
+	// Same as pmu_device::core_events_read_live(), `base` is previous live read
+	static void read_live_interval(const mock_live_core& core, ReadOut& base, ReadOut& interval)
+	{
+		ReadOut reading;
+		core.read_live(reading);
+		interval = reading;
+		counting_snapshot_diff(interval.evts, interval.evt_num, &interval.round, base.evts, base.evt_num, base.round);
+		base = reading;
+	}
+
+	TEST_CLASS(wperftest_common_snapshot)
+	{
+	public:
+
+		TEST_METHOD(test_snapshot_entry_size)
+		{
+			Assert::AreEqual(size_t(8), sizeof(struct counting_snapshot_hdr));
+			Assert::AreEqual(size_t(16), COUNTING_SNAPSHOT_ENTRY_SIZE(0));
+			Assert::AreEqual(size_t(16 + 7 * sizeof(struct pmu_event_usr)), COUNTING_SNAPSHOT_ENTRY_SIZE(7));
+		}
+
+		TEST_METHOD(test_snapshot_init_too_small)
+		{
+			UINT64 buf[1];
+			Assert::IsNull(counting_snapshot_init(nullptr, sizeof(buf)));
+			Assert::IsNull(counting_snapshot_init(buf, sizeof(struct counting_snapshot_hdr) - 1));
+			Assert::IsNotNull(counting_snapshot_init(buf, sizeof(buf)));
+		}
+
+		TEST_METHOD(test_snapshot_round_trip)
+		{
+			const std::vector<UINT8> cores_no = { 3, 0, 7 };
+			std::vector<ReadOut> cores;
+			for (UINT32 c = 0; c < 8; c++)
+				cores.push_back(make_read_out(c, 5));
+			std::vector<UINT64> buf(COUNTING_SNAPSHOT_MAX_SIZE(cores_no.size(), MAX_MANAGED_CORE_EVENTS) / sizeof(UINT64));
+
+			UINT32 size = write_snapshot(cores, cores_no, buf.data(), (UINT32)(buf.size() * sizeof(UINT64)));
+			Assert::AreEqual(UINT32(sizeof(struct counting_snapshot_hdr) + 3 * COUNTING_SNAPSHOT_ENTRY_SIZE(5)), size);
+
+			auto snapshot = reinterpret_cast<const struct counting_snapshot_hdr*>(buf.data());
+			Assert::IsTrue(counting_snapshot_check(snapshot, size, 8, MAX_MANAGED_CORE_EVENTS));
+
+			std::vector<ReadOut> outs(8);
+			for (auto entry = counting_snapshot_next(snapshot, nullptr); entry; entry = counting_snapshot_next(snapshot, entry))
+				counting_snapshot_copy(entry, &outs[entry->core_idx].evt_num, &outs[entry->core_idx].round, outs[entry->core_idx].evts);
+			for (UINT8 core : cores_no)
+				assert_read_out_equal(cores[core], outs[core]);
+		}
+
+		TEST_METHOD(test_snapshot_add_out_of_space)
+		{
+			std::vector<UINT64> buf((sizeof(struct counting_snapshot_hdr) + COUNTING_SNAPSHOT_ENTRY_SIZE(4)) / sizeof(UINT64));
+			const UINT32 buf_size = (UINT32)(buf.size() * sizeof(UINT64));
+
+			struct counting_snapshot_hdr* snapshot = counting_snapshot_init(buf.data(), buf_size);
+			Assert::IsNull(counting_snapshot_add(snapshot, buf_size, 0, 5, 0));
+			Assert::IsNotNull(counting_snapshot_add(snapshot, buf_size, 0, 4, 0));
+			Assert::IsNull(counting_snapshot_add(snapshot, buf_size, 1, 0, 0));
+			Assert::AreEqual(UINT32(1), snapshot->entry_num);
+			Assert::AreEqual(buf_size, snapshot->size);
+		}
+
+		TEST_METHOD(test_snapshot_reader_rejects_malformed)
+		{
+			const std::vector<UINT8> cores_no = { 0, 1 };
+			const std::vector<ReadOut> cores = { make_read_out(0, 3), make_read_out(1, 3) };
+			std::vector<UINT64> buf(COUNTING_SNAPSHOT_MAX_SIZE(cores_no.size(), MAX_MANAGED_CORE_EVENTS) / sizeof(UINT64));
+			UINT32 size = write_snapshot(cores, cores_no, buf.data(), (UINT32)(buf.size() * sizeof(UINT64)));
+			auto snapshot = reinterpret_cast<struct counting_snapshot_hdr*>(buf.data());
+
+			// Truncated transfer
+			Assert::IsFalse(counting_snapshot_check(snapshot, size - 1, 2, MAX_MANAGED_CORE_EVENTS));
+			Assert::IsFalse(counting_snapshot_check(snapshot, sizeof(struct counting_snapshot_hdr) - 1, 2, MAX_MANAGED_CORE_EVENTS));
+
+			// Entry claims more events than snapshot holds
+			auto second = const_cast<struct counting_snapshot_entry*>(counting_snapshot_next(snapshot, counting_snapshot_next(snapshot, nullptr)));
+			second->evt_num = 4;
+			Assert::IsFalse(counting_snapshot_check(snapshot, size, 2, MAX_MANAGED_CORE_EVENTS));
+			second->evt_num = 0xFFFFFFFF;
+			Assert::IsFalse(counting_snapshot_check(snapshot, size, 2, MAX_MANAGED_CORE_EVENTS));
+			second->evt_num = 3;
+
+			// More events than reader can hold
+			Assert::IsFalse(counting_snapshot_check(snapshot, size, 2, 2));
+
+			// Core out of range
+			second->core_idx = 2;
+			Assert::IsFalse(counting_snapshot_check(snapshot, size, 2, MAX_MANAGED_CORE_EVENTS));
+			second->core_idx = 1;
+
+			// Header claims more entries than snapshot holds
+			snapshot->entry_num = 3;
+			Assert::IsFalse(counting_snapshot_check(snapshot, size, 2, MAX_MANAGED_CORE_EVENTS));
+			snapshot->entry_num = 2;
+
+			Assert::IsTrue(counting_snapshot_check(snapshot, size, 2, MAX_MANAGED_CORE_EVENTS));
+		}
+
+		TEST_METHOD(test_snapshot_delta)
+		{
+			Assert::AreEqual(UINT64(6), counting_snapshot_delta(10, 4));
+			Assert::AreEqual(UINT64(0), counting_snapshot_delta(5, 5));
+			Assert::AreEqual(UINT64(3), counting_snapshot_delta(3, 10));	// Reset in between
+		}
+
+		// Intervals of live reads add up to everything counted, in-flight counts included
+		TEST_METHOD(test_snapshot_live_gap_free)
+		{
+			const UINT64 interval_ticks = 50;
+			const size_t intervals = 20;
+			mock_live_core core(4, 6, 7);
+			ReadOut base, interval;
+			std::vector<UINT64> total(4);
+			UINT64 rounds = 0;
+
+			core.read_live(base);
+			for (size_t i = 0; i < intervals; i++)
+			{
+				core.run(interval_ticks);
+				read_live_interval(core, base, interval);
+				for (UINT32 j = 0; j < interval.evt_num; j++)
+				{
+					total[j] += interval.evts[j].value;
+					Assert::AreEqual(interval.round, interval.evts[j].scheduled);
+				}
+				rounds += interval.round;
+			}
+
+			for (UINT32 j = 0; j < 4; j++)
+				Assert::AreEqual(core.counted[j], total[j]);
+			Assert::AreEqual(core.out.round, rounds);
+			Assert::AreEqual(UINT64(interval_ticks * intervals / 7), rounds);
+		}
+
+		TEST_METHOD(test_snapshot_live_multiplexed)
+		{
+			const UINT32 evt_num = 8;
+			mock_live_core core(evt_num, 3, 5);
+			ReadOut base, interval;
+			std::vector<UINT64> total(evt_num), scheduled(evt_num);
+
+			core.read_live(base);
+			for (size_t i = 0; i < 30; i++)
+			{
+				core.run(23);
+				read_live_interval(core, base, interval);
+				for (UINT32 j = 0; j < evt_num; j++)
+				{
+					total[j] += interval.evts[j].value;
+					scheduled[j] += interval.evts[j].scheduled;
+					Assert::IsTrue(interval.evts[j].scheduled <= interval.round);
+				}
+			}
+
+			for (UINT32 j = 0; j < evt_num; j++)
+			{
+				Assert::AreEqual(core.counted[j], total[j]);
+				Assert::AreEqual(core.out.evts[j].scheduled, scheduled[j]);
+			}
+		}
+
+		// Counting reset between live reads, interval is everything counted since reset
+		TEST_METHOD(test_snapshot_live_reset)
+		{
+			mock_live_core core(4, 6, 7);
+			ReadOut base, interval;
+
+			core.run(100);
+			core.read_live(base);
+			core.run(30);
+			core.reset();
+			core.run(20);
+			read_live_interval(core, base, interval);
+
+			Assert::AreEqual(core.out.round, interval.round);
+			for (UINT32 j = 0; j < 4; j++)
+				Assert::AreEqual(core.counted[j], interval.evts[j].value);
+		}
+
+		// Events were reassigned between live reads, values are not subtracted
+		TEST_METHOD(test_snapshot_live_reassigned)
+		{
+			mock_live_core core(4, 6, 7);
+			ReadOut base, interval;
+
+			core.run(100);
+			core.read_live(base);
+			base.evts[2].event_idx = 0x99;
+			core.run(30);
+			read_live_interval(core, base, interval);
+
+			Assert::AreEqual(core.out.round, interval.round);
+			for (UINT32 j = 0; j < 4; j++)
+				Assert::AreEqual(core.counted[j], interval.evts[j].value);
+		}
+	};
+}
@@ -31,6 +31,7 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 
+#include <cstring>
 #include "wperf\spe_device.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -125,4 +126,232 @@ namespace wperftest
 			Assert::AreEqual(spe_device::max_filter_val(L"min_latency"), (uint64_t)SPE_CTL_FLAG_VAL_MASK);
 		}
 	};
+
+	// Builds synthetic SPE records
+	struct spe_stream_builder
+	{
+		std::vector<UINT8> buf;
+
+		spe_stream_builder& bytes(std::initializer_list<UINT8> b) { buf.insert(buf.end(), b); return *this; }
+		spe_stream_builder& payload(UINT64 value, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+				buf.push_back(static_cast<UINT8>(value >> (i * 8)));
+			return *this;
+		}
+		spe_stream_builder& address(UINT8 index, UINT64 addr) { return bytes({ static_cast<UINT8>(0xB0 | index) }).payload(addr, 8); }
+		spe_stream_builder& counter(UINT8 index, UINT16 value) { return bytes({ static_cast<UINT8>(0x98 | index) }).payload(value, 2); }
+		spe_stream_builder& events(UINT16 value) { return bytes({ 0x52 }).payload(value, 2); }
+		spe_stream_builder& data_source(UINT16 value) { return bytes({ 0x53 }).payload(value, 2); }
+		spe_stream_builder& optype(UINT8 cls, UINT8 value) { return bytes({ static_cast<UINT8>(0x48 | cls), value }); }
+		spe_stream_builder& timestamp(UINT64 ts) { return bytes({ 0x71 }).payload(ts, 8); }
+		spe_stream_builder& end() { return bytes({ 0x01 }); }
+
+		// Typical load record: PC, latencies, events, operation type, data address and timestamp
+		spe_stream_builder& load(UINT64 pc, UINT64 va, UINT16 lat, UINT64 ts)
+		{
+			return address(0, pc).events(0x0006).optype(1, 0x00).counter(0, lat).counter(1, lat / 2)
+				.address(2, va).counter(2, 3).address(3, va & 0xFFFFFFF).timestamp(ts);
+		}
+	};
+
+	TEST_CLASS(wperftest_spe_decoder)
+	{
+	public:
+
+		TEST_METHOD(test_spe_decode_load_record)
+		{
+			spe_stream_builder sb;
+			sb.load(0xFFFF800012345678, 0x7FF612340000, 40, 123456789);
+
+			std::vector<struct spe_record> records;
+			Assert::AreEqual(sb.buf.size(), spe_device::decode_records(sb.buf.data(), sb.buf.size(), records));
+			Assert::AreEqual(size_t(1), records.size());
+
+			const auto& rec = records[0];
+			Assert::AreEqual(UINT64(0x00FF800012345678), rec.pc);
+			Assert::AreEqual(UINT64(0x7FF612340000), rec.data_va);
+			Assert::AreEqual(UINT64(0x2340000), rec.data_pa);
+			Assert::AreEqual(UINT64(123456789), rec.timestamp);
+			Assert::AreEqual(UINT16(40), rec.total_latency);
+			Assert::AreEqual(UINT16(20), rec.issue_latency);
+			Assert::AreEqual(UINT16(3), rec.translation_latency);
+			Assert::AreEqual(UINT16(0x1FF), rec.flags);
+			Assert::AreEqual(std::wstring(L"LOAD_STORE_ATOMIC-LOAD-GP/retired+level1-data-cache-access"), spe_device::get_record_desc(rec));
+		}
+
+		TEST_METHOD(test_spe_decode_long_header_and_padding)
+		{
+			spe_stream_builder sb;
+			sb.bytes({ 0x00, 0x00 }).bytes({ 0x20, 0xB0 }).payload(0x1000, 8)		// PC with long header
+				.bytes({ 0x20, 0x9A }).payload(77, 2)								// Translation latency with long header
+				.optype(2, 0x03).end()
+				.bytes({ 0x00, 0x00, 0x00, 0x00 });
+
+			std::vector<struct spe_record> records;
+			Assert::AreEqual(sb.buf.size() - 4, spe_device::decode_records(sb.buf.data(), sb.buf.size(), records));
+			Assert::AreEqual(size_t(1), records.size());
+			Assert::AreEqual(UINT64(0x1000), records[0].pc);
+			Assert::AreEqual(UINT16(77), records[0].translation_latency);
+			Assert::AreEqual(std::wstring(L"BRANCH_OR_EXCEPTION-CONDITIONAL-INDIRECT/"), spe_device::get_record_desc(records[0]));
+		}
+
+		TEST_METHOD(test_spe_decode_wide_events_packet)
+		{
+			// 4 byte Events packet with SVE predicate bits must not desynchronize the stream
+			spe_stream_builder sb;
+			sb.address(0, 0x2000).bytes({ 0x62 }).payload(0x60002, 4).optype(0, 0x00).end();
+
+			std::vector<struct spe_record> records;
+			spe_device::decode_records(sb.buf.data(), sb.buf.size(), records);
+			Assert::AreEqual(size_t(1), records.size());
+			Assert::AreEqual(UINT64(0x2000), records[0].pc);
+			Assert::AreEqual(std::wstring(L"OTHER/retired+sve-empty-predicate+sve-partial-predicate"), spe_device::get_record_desc(records[0]));
+		}
+
+		TEST_METHOD(test_spe_decode_data_source_packet)
+		{
+			spe_stream_builder sb;
+			sb.address(0, 0x2000).events(0x0206).data_source(0x000E).optype(1, 0x00).counter(0, 250).address(2, 0x9000).end();
+
+			std::vector<struct spe_record> records;
+			Assert::AreEqual(sb.buf.size(), spe_device::decode_records(sb.buf.data(), sb.buf.size(), records));
+			Assert::AreEqual(size_t(1), records.size());
+			Assert::AreEqual(UINT16(0x000E), records[0].data_source);
+			Assert::IsTrue(records[0].flags & SPE_RECORD_HAS_DATA_SOURCE);
+			Assert::AreEqual(UINT16(250), records[0].total_latency);
+			Assert::AreEqual(UINT64(0x9000), records[0].data_va);
+		}
+
+		TEST_METHOD(test_spe_decode_truncated_record)
+		{
+			spe_stream_builder sb;
+			sb.load(0x1000, 0x2000, 10, 1);
+			const size_t complete = sb.buf.size();
+			sb.address(0, 0x3000).events(0x0002);
+			sb.buf.pop_back();		// Truncate events packet payload
+
+			std::vector<struct spe_record> records;
+			Assert::AreEqual(complete, spe_device::decode_records(sb.buf.data(), sb.buf.size(), records));
+			Assert::AreEqual(size_t(1), records.size());
+		}
+
+		TEST_METHOD(test_spe_get_samples)
+		{
+			spe_stream_builder sb;
+			sb.load(0x1000, 0x8000, 10, 1).load(0x1004, 0x8008, 12, 2)
+				.address(0, 0x1008).events(0x0002).optype(2, 0x00).end()
+				.load(0x100C, 0x8010, 14, 3);
+
+			std::vector<FrameChain> raw_samples;
+			std::map<UINT64, std::wstring> spe_events;
+			spe_device::get_samples(sb.buf, raw_samples, spe_events);
+
+			Assert::AreEqual(size_t(4), raw_samples.size());
+			Assert::AreEqual(size_t(2), spe_events.size());
+			Assert::AreEqual(std::wstring(L"LOAD_STORE_ATOMIC-LOAD-GP/retired+level1-data-cache-access"), spe_events[0]);
+			Assert::AreEqual(std::wstring(L"BRANCH_OR_EXCEPTION-UNCONDITIONAL-DIRECT/retired"), spe_events[1]);
+
+			Assert::AreEqual(UINT64(0x1008), raw_samples[2].pc);
+			Assert::AreEqual(UINT32(0), raw_samples[0].spe_event_idx);
+			Assert::AreEqual(UINT32(0), raw_samples[1].spe_event_idx);
+			Assert::AreEqual(UINT32(1), raw_samples[2].spe_event_idx);
+			Assert::AreEqual(UINT32(0), raw_samples[3].spe_event_idx);
+		}
+
+		TEST_METHOD(test_spe_decode_synthetic_stream)
+		{
+			const size_t records_num = 1000000;
+
+			spe_stream_builder sb;
+			sb.buf.reserve(records_num * 64);
+			for (size_t i = 0; i < records_num; i++)
+				sb.load(0x140001000 + (i % 4096) * 4, 0x7FF600000000 + i * 64, static_cast<UINT16>(i % 500), i);
+
+			std::vector<struct spe_record> records;
+			records.reserve(records_num);
+
+			size_t consumed = spe_device::decode_records(sb.buf.data(), sb.buf.size(), records);
+
+			Assert::AreEqual(sb.buf.size(), consumed);
+			Assert::AreEqual(records_num, records.size());
+			Assert::AreEqual(UINT64(records_num - 1), records.back().timestamp);
+		}
+
+		// Mix of records whose payloads contain End (0x01) and Timestamp (0x71) bytes, padding and long headers
+		static spe_stream_builder make_adversarial_stream(size_t records_num)
+		{
+			spe_stream_builder sb;
+			for (size_t i = 0; i < records_num; i++)
+			{
+				switch (i % 4)
+				{
+				case 0: sb.load(0x7101710171010000 + i, 0x0171017101710171, 0x0171, 0x0101710171017101 + i); break;
+				case 1: sb.address(0, 0x1000 + i).events(0x0171).optype(2, 0x01).end(); break;
+				case 2: sb.bytes({ 0x00, 0x00, 0x00 }).bytes({ 0x20, 0xB0 }).payload(0x7101 + i, 8).counter(0, 0x0101).end(); break;
+				case 3: sb.bytes({ 0x71 }).payload(0x0171017101710171, 8).address(0, 0x0101 + i).timestamp(i); break;	// Leading timestamp forms its own record
+				}
+			}
+			return sb;
+		}
+
+		static void assert_parallel_equals_serial(const std::vector<UINT8>& buf)
+		{
+			std::vector<struct spe_record> serial;
+			const size_t serial_consumed = spe_device::decode_records(buf.data(), buf.size(), serial);
+
+			for (unsigned threads : { 2, 3, 8 })
+			{
+				for (size_t chunk_size : { 7, 97, 1000, 4096 })
+				{
+					std::vector<struct spe_record> parallel;
+					const size_t parallel_consumed = spe_device::decode_records_parallel(buf.data(), buf.size(), parallel, threads, chunk_size);
+
+					Assert::AreEqual(serial_consumed, parallel_consumed);
+					Assert::AreEqual(serial.size(), parallel.size());
+					Assert::AreEqual(0, std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(struct spe_record)));
+				}
+			}
+		}
+
+		TEST_METHOD(test_spe_decode_parallel_matches_serial)
+		{
+			spe_stream_builder sb = make_adversarial_stream(5000);
+			assert_parallel_equals_serial(sb.buf);
+		}
+
+		TEST_METHOD(test_spe_decode_parallel_truncated_tail)
+		{
+			spe_stream_builder sb = make_adversarial_stream(2000);
+			const size_t complete = sb.buf.size();
+			sb.address(0, 0x3000).events(0x0171);
+			sb.buf.pop_back();		// Truncate events packet payload
+			sb.bytes({ 0x00, 0x00 });
+
+			std::vector<struct spe_record> records;
+			Assert::AreEqual(complete, spe_device::decode_records_parallel(sb.buf.data(), sb.buf.size(), records, 4, 512));
+			assert_parallel_equals_serial(sb.buf);
+		}
+
+		TEST_METHOD(test_spe_decode_parallel_synthetic_stream)
+		{
+			const size_t records_num = 1000000;
+
+			spe_stream_builder sb;
+			sb.buf.reserve(records_num * 64);
+			for (size_t i = 0; i < records_num; i++)
+				sb.load(0x140001000 + (i % 4096) * 4, 0x7FF600000000 + i * 64, static_cast<UINT16>(i % 500), i);
+
+			std::vector<struct spe_record> serial, parallel;
+			serial.reserve(records_num);
+			parallel.reserve(records_num);
+
+			spe_device::decode_records(sb.buf.data(), sb.buf.size(), serial);
+			size_t consumed = spe_device::decode_records_parallel(sb.buf.data(), sb.buf.size(), parallel, 0, 1024 * 1024);
+
+			Assert::AreEqual(sb.buf.size(), consumed);
+			Assert::AreEqual(records_num, parallel.size());
+			Assert::AreEqual(0, std::memcmp(serial.data(), parallel.data(), records_num * sizeof(struct spe_record)));
+		}
+	};
 }
@@ -0,0 +1,189 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/spe_memory_profile.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_spe_memory_profile)
+	{
+	public:
+
+		static struct spe_record make_load(UINT64 pc, UINT64 va, UINT16 latency, UINT64 events, UINT16 data_source)
+		{
+			struct spe_record rec = { 0 };
+			rec.pc = pc;
+			rec.data_va = va;
+			rec.total_latency = latency;
+			rec.events = events;
+			rec.data_source = data_source;
+			rec.optype_class = 1;
+			rec.flags = SPE_RECORD_HAS_PC | SPE_RECORD_HAS_DATA_VA | SPE_RECORD_HAS_TOTAL_LATENCY
+				| SPE_RECORD_HAS_EVENTS | SPE_RECORD_HAS_DATA_SOURCE | SPE_RECORD_HAS_OPTYPE;
+			return rec;
+		}
+
+		TEST_METHOD(test_latency_buckets_cover_all_latencies)
+		{
+			typedef spe_memory_profile::latency_stats stats;
+
+			for (uint32_t latency = 0; latency <= 0xFFFF; latency++)
+			{
+				const uint32_t idx = stats::bucket(latency);
+				Assert::IsTrue(idx < SPE_LATENCY_BUCKETS);
+				Assert::IsTrue(stats::bucket_min(idx) <= latency && latency <= stats::bucket_max(idx));
+			}
+
+			Assert::AreEqual(uint32_t(7), stats::bucket(7));
+			Assert::AreEqual(uint32_t(8), stats::bucket(8));
+			Assert::AreEqual(stats::bucket(64), stats::bucket(79));
+			Assert::AreNotEqual(stats::bucket(79), stats::bucket(80));
+		}
+
+		TEST_METHOD(test_latency_percentiles)
+		{
+			spe_memory_profile::latency_stats s;
+			for (UINT16 latency = 1; latency <= 100; latency++)
+				s.add(make_load(0x1000, 0x8000, latency, 0, SPE_DATA_SOURCE_L1D));
+
+			Assert::AreEqual(uint64_t(100), s.samples);
+			Assert::AreEqual(50.5, s.latency_avg());
+			Assert::AreEqual(uint32_t(100), s.latency_max);
+			Assert::AreEqual(uint32_t(1), s.latency_percentile(0.0));
+			Assert::AreEqual(uint32_t(55), s.latency_percentile(0.50));		// 50 falls into 48-55 bucket
+			Assert::AreEqual(uint32_t(95), s.latency_percentile(0.90));		// 90 falls into 80-95 bucket
+			Assert::AreEqual(uint32_t(100), s.latency_percentile(1.0));		// Clamped to maximum
+		}
+
+		TEST_METHOD(test_accesses_without_latency_skip_latency_stats)
+		{
+			spe_memory_profile::latency_stats s;
+			s.add(make_load(0x1000, 0x8000, 10, SPE_EVENT_L1D_ACCESS, SPE_DATA_SOURCE_L1D));
+			s.add(make_load(0x1000, 0x8000, 30, SPE_EVENT_L1D_ACCESS, SPE_DATA_SOURCE_L1D));
+
+			struct spe_record rec = make_load(0x1000, 0x8000, 0, SPE_EVENT_L1D_ACCESS | SPE_EVENT_L1D_REFILL, SPE_DATA_SOURCE_L2);
+			rec.flags &= static_cast<UINT16>(~SPE_RECORD_HAS_TOTAL_LATENCY);
+			s.add(rec);
+
+			Assert::AreEqual(uint64_t(3), s.samples);
+			Assert::AreEqual(uint64_t(2), s.latency_samples);
+			Assert::AreEqual(20.0, s.latency_avg());
+			Assert::AreEqual(uint32_t(30), s.latency_max);
+			Assert::AreEqual(uint64_t(0), s.histogram[0]);
+			Assert::AreEqual(uint64_t(3), s.l1d_access);
+			Assert::AreEqual(uint64_t(1), s.l1d_miss);
+		}
+
+		TEST_METHOD(test_only_memory_accesses_are_profiled)
+		{
+			spe_memory_profile profile;
+
+			struct spe_record branch = { 0 };
+			branch.pc = 0x1000;
+			branch.optype_class = 2;
+			branch.flags = SPE_RECORD_HAS_PC | SPE_RECORD_HAS_OPTYPE;
+			profile.add(branch, L"f", L"f.c:1");
+
+			struct spe_record store = { 0 };
+			store.pc = 0x1004;
+			store.optype_class = 1;
+			store.optype = 1;
+			store.flags = SPE_RECORD_HAS_PC | SPE_RECORD_HAS_OPTYPE;
+			profile.add(store, L"f", L"f.c:2");
+
+			Assert::AreEqual(uint64_t(1), profile.total().samples);
+			Assert::AreEqual(size_t(1), profile.by_source_line().size());
+			Assert::AreEqual(size_t(0), profile.by_page().size());			// No data address
+			Assert::AreEqual(std::wstring(L"unknown"), profile.by_data_source()[0].first);
+		}
+
+		TEST_METHOD(test_profile_groups_and_order)
+		{
+			spe_memory_profile profile;
+
+			// `hot` misses L1D and LLC and waits for DRAM, `cold` always hits L1D
+			for (int i = 0; i < 10; i++)
+				profile.add(make_load(0x2000, 0x10000 + i * 4, 300, SPE_EVENT_L1D_ACCESS | SPE_EVENT_L1D_REFILL | SPE_EVENT_LLC_ACCESS | SPE_EVENT_LLC_MISS, SPE_DATA_SOURCE_DRAM), L"hot", L"a.c:10");
+			for (int i = 0; i < 50; i++)
+				profile.add(make_load(0x3000, 0x20000 + i * 64, 4, SPE_EVENT_L1D_ACCESS, SPE_DATA_SOURCE_L1D), L"cold", L"a.c:20");
+
+			auto symbols = profile.by_symbol();
+			Assert::AreEqual(size_t(2), symbols.size());
+			Assert::AreEqual(std::wstring(L"hot"), symbols[0].first);		// 3000 cycles before 200
+			Assert::AreEqual(uint64_t(10), symbols[0].second.l1d_miss);
+			Assert::AreEqual(uint64_t(10), symbols[0].second.llc_miss);
+			Assert::AreEqual(uint64_t(0), symbols[1].second.l1d_miss);
+
+			auto sources = profile.by_data_source();
+			Assert::AreEqual(std::wstring(L"DRAM"), sources[0].first);
+			Assert::AreEqual(std::wstring(L"L1D"), sources[1].first);
+			Assert::AreEqual(uint64_t(50), sources[1].second.samples);
+
+			auto pages = profile.by_page();
+			Assert::AreEqual(size_t(2), pages.size());
+			Assert::AreEqual(uint64_t(0x10), pages[0].first);
+
+			auto lines = profile.by_cache_line();
+			Assert::AreEqual(size_t(1 + 50), lines.size());
+			Assert::AreEqual(uint64_t(0x10000 >> SPE_CACHE_LINE_SHIFT), lines[0].first);
+			Assert::AreEqual(uint64_t(10), lines[0].second.samples);
+			Assert::AreEqual(uint64_t(3000), lines[0].second.latency_sum);
+		}
+
+		TEST_METHOD(test_contended_cache_line)
+		{
+			spe_memory_profile profile;
+
+			// Two PCs share one cache line which is often served from peer core cache
+			for (int i = 0; i < 8; i++)
+			{
+				profile.add(make_load(0x4000, 0x30008, 120, SPE_EVENT_L1D_REFILL, SPE_DATA_SOURCE_PEER_CORE), L"producer", L"q.c:5");
+				profile.add(make_load(0x5000, 0x30030, 20, SPE_EVENT_L1D_ACCESS, SPE_DATA_SOURCE_L2), L"consumer", L"q.c:9");
+			}
+
+			auto lines = profile.by_cache_line();
+			Assert::AreEqual(size_t(1), lines.size());
+			Assert::AreEqual(uint64_t(16), lines[0].second.samples);
+			Assert::AreEqual(uint64_t(8), lines[0].second.peer_hits);
+			Assert::AreEqual(size_t(2), lines[0].second.pcs.size());
+			Assert::AreEqual(uint32_t(120), lines[0].second.latency_max);
+		}
+	};
+}
@@ -0,0 +1,287 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <windows.h>
+#include "wperf-common\spebuffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest_common
+{
+	// Simulated profiling buffer unit: writes a running byte pattern at PMBPTR_EL1
+	// and stops (PMBSR_EL1.S) when it reaches PMBLIMITR_EL1.LIMIT.
+	struct spe_dbuf_sim
+	{
+		static const UINT64 size = 64;
+
+		std::vector<UINT8> storage[SPE_DBUF_COUNT];
+		UINT8* buffers[SPE_DBUF_COUNT];
+		struct spe_dbuf db;
+
+		UINT64 ptr = 0;				// PMBPTR_EL1
+		UINT64 limit = 0;			// PMBLIMITR_EL1, 0 when disabled
+		bool stopped = false;		// PMBSR_EL1.S
+		UINT8 next_byte = 0;		// Pattern advances for dropped bytes as well
+		UINT64 written = 0;			// Bytes written by "hardware"
+		UINT64 dropped = 0;			// Bytes not written, buffer stopped or disabled
+
+		spe_dbuf_sim()
+		{
+			for (UINT32 i = 0; i < SPE_DBUF_COUNT; i++)
+			{
+				storage[i].resize(size);
+				buffers[i] = storage[i].data();
+			}
+			UINT8* first = spe_dbuf_init(&db, buffers, size);
+			Assert::IsNotNull(first);
+			program(first);
+		}
+
+		void program(UINT8* base)
+		{
+			ptr = (UINT64)base;
+			limit = spe_dbuf_limit(&db);
+			stopped = false;
+		}
+
+		void write(UINT64 n)
+		{
+			for (UINT64 i = 0; i < n; i++)
+			{
+				if (!limit || stopped || ptr >= limit)
+				{
+					stopped = limit != 0;
+					next_byte++;
+					dropped++;
+					continue;
+				}
+				*(UINT8*)ptr++ = next_byte++;
+				written++;
+			}
+		}
+
+		// Mirrors dpc_spe_overflow()
+		void tick(UINT64 threshold)
+		{
+			UINT8* next = NULL;
+			if (spe_dbuf_should_swap(&db, ptr, threshold, stopped))
+			{
+				limit = 0;
+				next = spe_dbuf_swap(&db, ptr);
+				stopped = false;
+			}
+			else
+			{
+				next = spe_dbuf_resume(&db);
+			}
+
+			if (next)
+				program(next);
+		}
+
+		// Mirrors PMU_CTL_SPE_GET_SIZE followed by PMU_CTL_SPE_GET_BUFFER
+		UINT64 drain(std::vector<UINT8>& out, UINT64 max_bytes = UINT64(-1))
+		{
+			UINT64 pending = spe_dbuf_pending(&db, ptr);
+			if (pending > max_bytes)
+				pending = max_bytes;
+			std::vector<UINT8> chunk(pending);
+			UINT64 copied = spe_dbuf_copy_out(&db, chunk.data(), pending);
+			Assert::AreEqual(pending, copied);
+			out.insert(out.end(), chunk.begin(), chunk.end());
+			return copied;
+		}
+	};
+
+	// Drained stream must be the running byte pattern written by the simulator
+	static void assert_stream_in_order(const std::vector<UINT8>& out)
+	{
+		for (size_t i = 0; i < out.size(); i++)
+			Assert::AreEqual(UINT8(i), out[i]);
+	}
+
+	TEST_CLASS(wperftest_common_spebuffer)
+	{
+	public:
+
+		TEST_METHOD(test_spe_dbuf_init_nok)
+		{
+			struct spe_dbuf db;
+			UINT8 a[16], b[16];
+			UINT8* buffers[SPE_DBUF_COUNT] = { a, b };
+			UINT8* missing[SPE_DBUF_COUNT] = { a, nullptr };
+
+			Assert::IsNull(spe_dbuf_init(nullptr, buffers, 16));
+			Assert::IsNull(spe_dbuf_init(&db, nullptr, 16));
+			Assert::IsNull(spe_dbuf_init(&db, buffers, 0));
+			Assert::IsNull(spe_dbuf_init(&db, missing, 16));
+		}
+
+		TEST_METHOD(test_spe_dbuf_init_ok)
+		{
+			struct spe_dbuf db;
+			UINT8 a[16], b[16];
+			UINT8* buffers[SPE_DBUF_COUNT] = { a, b };
+
+			Assert::IsTrue(spe_dbuf_init(&db, buffers, 16) == a);
+			Assert::AreEqual(UINT32(0), db.active);
+			Assert::AreEqual(UINT64((UINT64)a + 16), spe_dbuf_limit(&db));
+			Assert::AreEqual(UINT64(0), spe_dbuf_pending(&db, (UINT64)a));
+			Assert::AreEqual(UINT64(0), db.swaps);
+			Assert::AreEqual(UINT64(0), db.stalls);
+		}
+
+		TEST_METHOD(test_spe_dbuf_partial_drain_of_active)
+		{
+			spe_dbuf_sim sim;
+			std::vector<UINT8> out;
+
+			sim.write(10);
+			Assert::AreEqual(UINT64(4), sim.drain(out, 4));
+			Assert::AreEqual(UINT64(6), sim.drain(out));
+			sim.write(5);
+			Assert::AreEqual(UINT64(5), sim.drain(out));
+
+			// Nothing new, nothing to copy
+			Assert::AreEqual(UINT64(0), sim.drain(out));
+
+			Assert::AreEqual(size_t(15), out.size());
+			assert_stream_in_order(out);
+			Assert::AreEqual(UINT64(0), sim.db.swaps);
+		}
+
+		TEST_METHOD(test_spe_dbuf_swap_on_threshold)
+		{
+			spe_dbuf_sim sim;
+			std::vector<UINT8> out;
+
+			sim.write(40);
+			sim.tick(16);		// 24 bytes left, more than threshold
+			Assert::AreEqual(UINT64(0), sim.db.swaps);
+
+			sim.write(10);
+			sim.tick(16);		// 14 bytes left
+			Assert::AreEqual(UINT64(1), sim.db.swaps);
+			Assert::AreEqual(UINT32(1), sim.db.active);
+			Assert::AreEqual(int(SPE_DBUF_FULL), int(sim.db.state[0]));
+
+			sim.write(20);
+			Assert::AreEqual(UINT64(70), sim.drain(out));
+			Assert::AreEqual(int(SPE_DBUF_FREE), int(sim.db.state[0]));
+
+			Assert::AreEqual(UINT64(0), sim.dropped);
+			assert_stream_in_order(out);
+		}
+
+		TEST_METHOD(test_spe_dbuf_no_loss_when_consumer_keeps_pace)
+		{
+			spe_dbuf_sim sim;
+			std::vector<UINT8> out;
+
+			// Producer writes less than half a buffer per tick, consumer drains
+			// everything every other tick and a small chunk in between
+			for (int t = 0; t < 1000; t++)
+			{
+				sim.write(7 + t % 13);
+				sim.tick(spe_dbuf_sim::size / 2);
+				if (t % 2 == 0)
+					sim.drain(out);
+				else
+					sim.drain(out, 1 + t % 11);
+			}
+			sim.drain(out);
+
+			Assert::AreEqual(UINT64(0), sim.dropped);
+			Assert::AreEqual(UINT64(0), sim.db.stalls);
+			Assert::IsTrue(sim.db.swaps > 0);
+			Assert::AreEqual(size_t(sim.written), out.size());
+			assert_stream_in_order(out);
+		}
+
+		TEST_METHOD(test_spe_dbuf_stall_and_resume)
+		{
+			spe_dbuf_sim sim;
+			std::vector<UINT8> out;
+
+			// Fill both buffers, nobody drains
+			sim.write(spe_dbuf_sim::size + 5);
+			Assert::IsTrue(sim.stopped);
+			sim.tick(8);
+			Assert::AreEqual(UINT64(1), sim.db.swaps);
+
+			sim.write(spe_dbuf_sim::size + 5);
+			sim.tick(8);
+			Assert::AreEqual(UINT64(1), sim.db.stalls);
+			Assert::AreEqual(SPE_DBUF_NONE, sim.db.active);
+			Assert::AreEqual(UINT64(0), spe_dbuf_limit(&sim.db));
+
+			// Still stalled, writes are lost
+			sim.write(10);
+			sim.tick(8);
+			Assert::AreEqual(UINT64(20), sim.dropped);
+			Assert::AreEqual(SPE_DBUF_NONE, sim.db.active);
+
+			// Drain oldest buffer only, next tick resumes capture in it
+			Assert::AreEqual(UINT64(spe_dbuf_sim::size), sim.drain(out, spe_dbuf_sim::size));
+			sim.tick(8);
+			Assert::AreEqual(UINT32(0), sim.db.active);
+
+			sim.write(10);
+			sim.drain(out);
+			Assert::AreEqual(size_t(sim.written), out.size());
+			Assert::AreEqual(UINT64(2 * spe_dbuf_sim::size + 10), sim.written);
+
+			// Gaps in drained stream are exactly the dropped bytes
+			for (size_t i = 0; i < out.size(); i++)
+			{
+				size_t skipped = i < spe_dbuf_sim::size ? 0 : i < 2 * spe_dbuf_sim::size ? 5 : 20;
+				Assert::AreEqual(UINT8(i + skipped), out[i]);
+			}
+		}
+
+		TEST_METHOD(test_spe_dbuf_swap_empty_buffer)
+		{
+			spe_dbuf_sim sim;
+			std::vector<UINT8> out;
+
+			// Hardware stopped without writing anything, empty FULL buffer is released on drain
+			sim.stopped = true;
+			sim.tick(8);
+			Assert::AreEqual(UINT64(1), sim.db.swaps);
+			Assert::AreEqual(UINT64(0), sim.drain(out));
+			Assert::AreEqual(int(SPE_DBUF_FREE), int(sim.db.state[0]));
+		}
+	};
+}
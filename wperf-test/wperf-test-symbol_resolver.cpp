@@ -0,0 +1,202 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/symbol_resolver.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_symbol_resolver)
+	{
+	public:
+
+		static FuncSymDesc make_sym(const std::wstring& name, uint32_t sec_idx, uint64_t offset, uint32_t size)
+		{
+			FuncSymDesc sym;
+			sym.name = name;
+			sym.sname = name;
+			sym.sec_idx = sec_idx;
+			sym.offset = offset;
+			sym.size = size;
+			return sym;
+		}
+
+		static std::vector<SectionDesc> make_sections()
+		{
+			std::vector<SectionDesc> sec_info(2);
+			sec_info[0].idx = 0;
+			sec_info[0].name = L".text";
+			sec_info[0].offset = 0x1000;
+			sec_info[1].idx = 1;
+			sec_info[1].name = L".text2";
+			sec_info[1].offset = 0x8000;
+			return sec_info;
+		}
+
+		TEST_METHOD(test_resolve_empty)
+		{
+			symbol_resolver resolver;
+			resolver.build();
+
+			Assert::IsNull(resolver.resolve(0));
+			Assert::IsNull(resolver.resolve(0x140001000));
+		}
+
+		TEST_METHOD(test_resolve_image)
+		{
+			std::vector<FuncSymDesc> sym_info = {
+				make_sym(L"main", 1, 0x100, 0x40),
+				make_sym(L"foo", 1, 0x200, 0x10),
+				make_sym(L"bar", 2, 0x0, 0x20),     // Second section
+				make_sym(L"nosec", 0, 0x0, 0x20),   // Not decoded, skipped
+				make_sym(L"empty", 1, 0x300, 0),    // No size, can't be hit
+			};
+
+			symbol_resolver resolver;
+			resolver.add_image(sym_info, make_sections(), 0x140000000);
+			resolver.build();
+
+			Assert::AreEqual(size_t(4), resolver.symbol_count());
+
+			Assert::IsNull(resolver.resolve(0x1400010FF));
+			Assert::AreEqual(std::wstring(L"main"), resolver.resolve(0x140001100)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"main"), resolver.resolve(0x14000113F)->proto.desc.name);
+			Assert::IsNull(resolver.resolve(0x140001140));
+			Assert::AreEqual(std::wstring(L"foo"), resolver.resolve(0x140001208)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"bar"), resolver.resolve(0x140008000)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"bar"), resolver.resolve(0x14000801F)->proto.desc.name);
+			Assert::IsNull(resolver.resolve(0x140008020));
+			Assert::IsNull(resolver.resolve(0x140001300));
+
+			const symbol_resolver::symbol* sym = resolver.resolve(0x140001120);
+			Assert::AreEqual(uint64_t(0x140001100), sym->start);
+			Assert::IsNull(sym->proto.module);
+		}
+
+		TEST_METHOD(test_resolve_module)
+		{
+			ModuleMetaData mmd;
+			mmd.mod_name = L"python312_d.dll";
+			mmd.handle = reinterpret_cast<HMODULE>(0x7FF800000000);
+			mmd.sym_info = {
+				make_sym(L"x_mul", 1, 0x10, 0x100),
+				make_sym(L"v_iadd", 2, 0x10, 0x20),
+			};
+
+			symbol_resolver resolver;
+			resolver.add_module(L"python312_d.dll", mmd, make_sections());
+			resolver.build();
+
+			// Each symbol uses base of its own section
+			const symbol_resolver::symbol* sym = resolver.resolve(0x7FF800001050);
+			Assert::IsNotNull(sym);
+			Assert::AreEqual(std::wstring(L"x_mul:python312_d.dll"), sym->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"x_mul"), sym->proto.desc.sname);
+			Assert::IsTrue(sym->proto.module == &mmd);
+
+			sym = resolver.resolve(0x7FF800008010);
+			Assert::IsNotNull(sym);
+			Assert::AreEqual(std::wstring(L"v_iadd:python312_d.dll"), sym->proto.desc.name);
+
+			Assert::IsNull(resolver.resolve(0x7FF800008030));
+		}
+
+		TEST_METHOD(test_resolve_overlap_first_added_wins)
+		{
+			std::vector<FuncSymDesc> image = {
+				make_sym(L"outer", 1, 0x100, 0x100),
+				make_sym(L"inner", 1, 0x140, 0x10),     // Fully inside `outer`, added later
+				make_sym(L"tail", 1, 0x1F0, 0x20),      // Overlaps end of `outer`
+			};
+			ModuleMetaData mmd;
+			mmd.handle = reinterpret_cast<HMODULE>(0x140000000);
+			mmd.sym_info = { make_sym(L"dll_sym", 1, 0x80, 0x100) };  // Overlaps `outer` start
+
+			symbol_resolver resolver;
+			resolver.add_image(image, make_sections(), 0x140000000);
+			resolver.add_module(L"mod.dll", mmd, make_sections());
+			resolver.build();
+
+			Assert::AreEqual(std::wstring(L"dll_sym:mod.dll"), resolver.resolve(0x1400010FF)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"outer"), resolver.resolve(0x140001100)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"outer"), resolver.resolve(0x140001148)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"outer"), resolver.resolve(0x1400011FF)->proto.desc.name);
+			Assert::AreEqual(std::wstring(L"tail"), resolver.resolve(0x140001200)->proto.desc.name);
+			Assert::IsNull(resolver.resolve(0x140001210));
+		}
+
+		TEST_METHOD(test_resolve_matches_linear_scan)
+		{
+			// Synthetic symbol table with gaps, compare against naive linear lookup
+			std::vector<FuncSymDesc> sym_info;
+			for (uint32_t i = 0; i < 2000; i++)
+				sym_info.push_back(make_sym(L"f" + std::to_wstring(i), 1 + (i % 2), (i / 2) * 0x40, 0x20 + (i % 3) * 0x8));
+
+			auto sec_info = make_sections();
+			const uint64_t base = 0x140000000;
+
+			symbol_resolver resolver;
+			resolver.add_image(sym_info, sec_info, base);
+			resolver.build();
+
+			for (uint64_t pc = base; pc < base + 0x8000 + 1000 * 0x40; pc += 0xC)
+			{
+				const FuncSymDesc* expected = nullptr;
+				for (const auto& b : sym_info)
+				{
+					uint64_t start = base + sec_info[b.sec_idx - 1].offset + b.offset;
+					if (pc >= start && pc < start + b.size)
+					{
+						expected = &b;
+						break;
+					}
+				}
+
+				const symbol_resolver::symbol* sym = resolver.resolve(pc);
+				if (!expected)
+					Assert::IsNull(sym);
+				else
+				{
+					Assert::IsNotNull(sym);
+					Assert::AreEqual(expected->name, sym->proto.desc.name);
+				}
+			}
+		}
+	};
+}
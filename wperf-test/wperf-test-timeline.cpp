@@ -0,0 +1,226 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/timeline.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_timeline)
+	{
+	public:
+
+		TEST_METHOD(test_append_value_uint64)
+		{
+			std::string out;
+			timeline::append_value(out, uint64_t(0));
+			out += ',';
+			timeline::append_value(out, uint64_t(1234567890123));
+			out += ',';
+			timeline::append_value(out, UINT64_MAX);
+			Assert::AreEqual(std::string("0,1234567890123,18446744073709551615"), out);
+		}
+
+		TEST_METHOD(test_append_value_double)
+		{
+			std::string out;
+			timeline::append_value(out, 0.0);
+			out += ',';
+			timeline::append_value(out, 1.0 / 3.0);
+			out += ',';
+			timeline::append_value(out, 2.0005);
+			out += ',';
+			timeline::append_value(out, 12345.5);
+			Assert::AreEqual(std::string("0.000,0.333,2.000,12345.500"), out);
+		}
+
+		TEST_METHOD(test_stream_rows_to_file)
+		{
+			char path[MAX_PATH], dir[MAX_PATH];
+			Assert::AreNotEqual(DWORD(0), GetTempPathA(MAX_PATH, dir));
+			Assert::AreNotEqual(UINT(0), GetTempFileNameA(dir, "wpt", 0, path));
+
+			timeline::init();
+			auto& header = timeline::timeline_headers[EVT_CORE];
+			header.filename = path;
+			header.count_interval = 0.5;
+			header.vendor_name = L"Arm Limited";
+			header.event_class = L"core";
+			timeline::timeline_header_cores[EVT_CORE] = { L"core 0", L"core 0" };
+			timeline::timeline_header_event_names[EVT_CORE] = { L"cycle", L"inst_spec" };
+
+			timeline::push_event_values(EVT_CORE, { 100, 20 });
+			timeline::push_metric_values(EVT_CORE, { 0.2 });
+			timeline::timeline_header_cores[EVT_CORE].push_back(L"core 0");
+			timeline::timeline_header_metric_names[EVT_CORE] = { L"ipc" };
+			timeline::push_event_values(EVT_CORE, { 200, 50 });
+			timeline::push_metric_values(EVT_CORE, { 0.25 });
+			timeline::print();
+
+			std::ifstream in(path);
+			std::stringstream content;
+			content << in.rdbuf();
+			in.close();
+			DeleteFileA(path);
+
+			Assert::AreEqual(std::string(
+				"Multiplexing,FALSE\n"
+				"Kernel mode,FALSE\n"
+				"Count interval,0.50\n"
+				"Vendor,Arm Limited\n"
+				"Event class,core\n"
+				"\n"
+				"core 0,core 0,core 0,\n"
+				"cycle,inst_spec,M@ipc,\n"
+				"100,20,0.200,\n"
+				"200,50,0.250,\n"
+				"\n"), content.str());
+		}
+
+		static uint64_t read_varint(const std::string& in, size_t& pos)
+		{
+			uint64_t value = 0;
+			for (int shift = 0; ; shift += 7)
+			{
+				uint8_t b = static_cast<uint8_t>(in[pos++]);
+				value |= static_cast<uint64_t>(b & 0x7F) << shift;
+				if (!(b & 0x80))
+					return value;
+			}
+		}
+
+		static int64_t read_zigzag(const std::string& in, size_t& pos)
+		{
+			uint64_t v = read_varint(in, pos);
+			return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+		}
+
+		TEST_METHOD(test_varint_encoding)
+		{
+			std::string out;
+			timeline::append_varint(out, 0);
+			timeline::append_varint(out, 127);
+			timeline::append_varint(out, 128);
+			timeline::append_varint(out, UINT64_MAX);
+			Assert::AreEqual(size_t(1 + 1 + 2 + 10), out.size());
+			Assert::AreEqual(std::string("\x00\x7f\x80\x01", 4), out.substr(0, 4));
+
+			size_t pos = 0;
+			Assert::AreEqual(uint64_t(0), read_varint(out, pos));
+			Assert::AreEqual(uint64_t(127), read_varint(out, pos));
+			Assert::AreEqual(uint64_t(128), read_varint(out, pos));
+			Assert::AreEqual(UINT64_MAX, read_varint(out, pos));
+			Assert::AreEqual(out.size(), pos);
+
+			out.clear();
+			timeline::append_zigzag(out, 0);
+			timeline::append_zigzag(out, -1);
+			timeline::append_zigzag(out, 1);
+			timeline::append_zigzag(out, INT64_MIN);
+			Assert::AreEqual(std::string("\x00\x01\x02", 3), out.substr(0, 3));
+
+			pos = 0;
+			Assert::AreEqual(int64_t(0), read_zigzag(out, pos));
+			Assert::AreEqual(int64_t(-1), read_zigzag(out, pos));
+			Assert::AreEqual(int64_t(1), read_zigzag(out, pos));
+			Assert::AreEqual(INT64_MIN, read_zigzag(out, pos));
+		}
+
+		TEST_METHOD(test_binary_row_round_trip)
+		{
+			std::vector<std::vector<uint64_t>> rows = {
+				{ 1000000, 20, 0 },
+				{ 1000100, 10, 0 },
+				{ 999000, 10, UINT64_MAX },
+			};
+			std::vector<double> metrics = { 0.5, 1.25 };
+
+			std::string out;
+			std::vector<uint64_t> prev;
+			for (const auto& row : rows)
+				timeline::format_binary_row(out, row, metrics, prev);
+
+			size_t pos = 0;
+			std::vector<uint64_t> values(3, 0);
+			for (const auto& row : rows)
+			{
+				Assert::AreEqual(uint64_t(row.size()), read_varint(out, pos));
+				Assert::AreEqual(uint64_t(metrics.size()), read_varint(out, pos));
+				for (size_t i = 0; i < row.size(); i++)
+				{
+					values[i] += static_cast<uint64_t>(read_zigzag(out, pos));
+					Assert::AreEqual(row[i], values[i]);
+				}
+				for (const auto m : metrics)
+				{
+					double d;
+					memcpy(&d, out.data() + pos, sizeof(d));
+					pos += sizeof(d);
+					Assert::AreEqual(m, d);
+				}
+			}
+			Assert::AreEqual(out.size(), pos);
+		}
+
+		TEST_METHOD(test_binary_smaller_than_csv)
+		{
+			// 128 cores x (cycle + 6 events), 1 metric per core, counters change a little between intervals
+			const size_t intervals = 100, columns = 128 * 7, metric_columns = 128;
+
+			std::vector<uint64_t> row(columns);
+			std::vector<double> metrics(metric_columns, 1.234);
+			for (size_t i = 0; i < columns; i++)
+				row[i] = 1000000000ULL + i * 7919;
+
+			std::string csv, bin;
+			std::vector<uint64_t> prev;
+			for (size_t n = 0; n < intervals; n++)
+			{
+				row[n % columns] += n;
+				timeline::format_csv_row(csv, row, metrics);
+				timeline::format_binary_row(bin, row, metrics, prev);
+			}
+
+			Assert::IsTrue(bin.size() * 2 < csv.size());
+		}
+	};
+}
@@ -0,0 +1,2034 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <cstdio>
+
+#include "a64_decoder.h"
+
+namespace
+{
+    typedef bool (*a64_format_fn)(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out);
+
+    struct a64_encoding
+    {
+        uint32_t mask;
+        uint32_t value;
+        const wchar_t* mnemonic;
+        a64_format_fn format;
+    };
+
+    const wchar_t* const a64_conditions[16] = {
+        L"eq", L"ne", L"hs", L"lo", L"mi", L"pl", L"vs", L"vc", L"hi", L"ls", L"ge", L"lt", L"gt", L"le", L"al", L"nv" };
+    const wchar_t* const a64_shifts[4] = { L"lsl", L"lsr", L"asr", L"ror" };
+    const wchar_t* const a64_extends[8] = { L"uxtb", L"uxth", L"uxtw", L"uxtx", L"sxtb", L"sxth", L"sxtw", L"sxtx" };
+    const wchar_t* const a64_arrangements[8] = { L"8b", L"16b", L"4h", L"8h", L"2s", L"4s", L"1d", L"2d" };
+    const wchar_t a64_fp_sizes[6] = L"bhsdq";
+
+    inline uint32_t bits(uint32_t insn, int hi, int lo) { return (insn >> lo) & ((1u << (hi - lo + 1)) - 1); }
+    inline uint32_t bit(uint32_t insn, int b) { return (insn >> b) & 1; }
+    inline int64_t sext(uint64_t value, int width) { return static_cast<int64_t>(value << (64 - width)) >> (64 - width); }
+
+    std::wstring dec(int64_t value) { return std::to_wstring(value); }
+
+    std::wstring hex(uint64_t value)
+    {
+        wchar_t buf[24];
+        swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"0x%llx", static_cast<unsigned long long>(value));
+        return buf;
+    }
+
+    std::wstring imm(int64_t value) { return L"#" + dec(value); }
+    std::wstring himm(uint64_t value) { return L"#" + hex(value); }
+
+    // Mnemonic padded the same way `LLVMDisassembler::ParseOutput` does it
+    std::wstring text(const std::wstring& mnemonic, const std::wstring& operands = L"")
+    {
+        std::wstring out = mnemonic;
+        if (operands.empty())
+            return out;
+        if (out.size() < 5)
+            out.append(5 - out.size(), L' ');
+        out += L' ';
+        out += operands;
+        return out;
+    }
+
+    // General purpose register, register 31 is either SP or ZR
+    std::wstring gpr(bool sf, uint32_t n, bool sp = false)
+    {
+        if (n == 31)
+            return sp ? (sf ? L"sp" : L"wsp") : (sf ? L"xzr" : L"wzr");
+        return (sf ? L"x" : L"w") + std::to_wstring(n);
+    }
+
+    std::wstring xsp(uint32_t n) { return gpr(true, n, true); }
+
+    // Scalar FP/SIMD register, `size` indexes "bhsdq"
+    std::wstring fpr(uint32_t size, uint32_t n) { return a64_fp_sizes[size] + std::to_wstring(n); }
+
+    // FP register of `ftype` field (00 single, 01 double, 11 half), empty if reserved
+    std::wstring ftype_reg(uint32_t ftype, uint32_t n)
+    {
+        static const uint32_t sizes[4] = { 2, 3, 0, 1 };
+        return ftype == 2 ? L"" : fpr(sizes[ftype], n);
+    }
+
+    std::wstring vreg(uint32_t n, const wchar_t* arrangement) { return L"v" + std::to_wstring(n) + L"." + arrangement; }
+    std::wstring vreg(uint32_t n, uint32_t size, uint32_t q) { return vreg(n, a64_arrangements[size * 2 + q]); }
+    std::wstring velem(uint32_t n, uint32_t size, uint32_t index) { return L"v" + std::to_wstring(n) + L"." + a64_fp_sizes[size] + L"[" + std::to_wstring(index) + L"]"; }
+
+    std::wstring vlist(uint32_t first, uint32_t count, const std::wstring& suffix)
+    {
+        std::wstring out = L"{ ";
+        for (uint32_t i = 0; i < count; i++)
+            out += (i ? L", v" : L"v") + std::to_wstring((first + i) % 32) + suffix;
+        return out + L" }";
+    }
+
+    std::wstring zreg(uint32_t n, uint32_t size) { return L"z" + std::to_wstring(n) + L"." + a64_fp_sizes[size]; }
+    std::wstring preg(uint32_t n, uint32_t size) { return L"p" + std::to_wstring(n) + L"." + a64_fp_sizes[size]; }
+    std::wstring pg(uint32_t n, const wchar_t* qualifier) { return L"p" + std::to_wstring(n) + qualifier; }
+
+    std::wstring shift_text(uint32_t shift, uint32_t amount)
+    {
+        if (shift == 0 && amount == 0)
+            return L"";
+        return std::wstring(L", ") + a64_shifts[shift] + L" #" + std::to_wstring(amount);
+    }
+
+    std::wstring fp_imm(uint32_t imm8)
+    {
+        // VFPExpandImm(): sign, 3-bit exponent and 4-bit fraction
+        double value = (1.0 + (imm8 & 0xF) / 16.0) * std::ldexp(1.0, static_cast<int>(((imm8 >> 4) + 4) & 7) - 3);
+        wchar_t buf[32];
+        swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"#%.8f", (imm8 & 0x80) ? -value : value);
+        return buf;
+    }
+
+    bool decode_bit_masks(bool sf, uint32_t n, uint32_t immr, uint32_t imms, uint64_t& value)
+    {
+        uint32_t combined = (n << 6) | (~imms & 0x3F);
+        int len = -1;
+        for (int i = 6; i >= 0; i--)
+            if (combined & (1u << i)) { len = i; break; }
+        if (len < 1 || (!sf && n))
+            return false;
+
+        uint32_t esize = 1u << len, levels = esize - 1;
+        uint32_t s = imms & levels, r = immr & levels;
+        if (s == levels)
+            return false;
+
+        uint64_t emask = esize == 64 ? ~0ull : (1ull << esize) - 1;
+        uint64_t element = s + 1 == 64 ? ~0ull : (1ull << (s + 1)) - 1;
+        if (r)
+            element = ((element >> r) | (element << (esize - r))) & emask;
+
+        value = 0;
+        for (uint32_t i = 0; i < (sf ? 64u : 32u); i += esize)
+            value |= element << i;
+        return true;
+    }
+
+    // Can MOVZ (or MOVN with `~value`) load `value` into register of `width` bits
+    bool is_movz_imm(uint64_t value, int width)
+    {
+        for (int shift = 0; shift <= width - 16; shift += 16)
+            if ((value & ~(0xFFFFull << shift)) == 0)
+                return true;
+        return false;
+    }
+
+    std::wstring sve_pattern(uint32_t pattern)
+    {
+        static const wchar_t* const names[14] = {
+            L"pow2", L"vl1", L"vl2", L"vl3", L"vl4", L"vl5", L"vl6", L"vl7", L"vl8", L"vl16", L"vl32", L"vl64", L"vl128", L"vl256" };
+        if (pattern < 14)
+            return names[pattern];
+        if (pattern == 29) return L"mul4";
+        if (pattern == 30) return L"mul3";
+        if (pattern == 31) return L"all";
+        return imm(pattern);
+    }
+
+    std::wstring prefetch_op(uint32_t rt)
+    {
+        static const wchar_t* const types[3] = { L"pld", L"pli", L"pst" };
+        uint32_t type = rt >> 3, target = (rt >> 1) & 3;
+        if (type == 3 || target == 3)
+            return imm(rt);
+        return std::wstring(types[type]) + L"l" + std::to_wstring(target + 1) + ((rt & 1) ? L"strm" : L"keep");
+    }
+
+    std::wstring sysreg(uint32_t insn)
+    {
+        struct named_sysreg { uint32_t op0, op1, crn, crm, op2; const wchar_t* name; };
+        static const named_sysreg names[] = {
+            { 3, 0, 0, 0, 0, L"MIDR_EL1" }, { 3, 0, 0, 0, 5, L"MPIDR_EL1" }, { 3, 0, 0, 0, 6, L"REVIDR_EL1" },
+            { 3, 0, 0, 4, 0, L"ID_AA64PFR0_EL1" }, { 3, 0, 0, 6, 0, L"ID_AA64ISAR0_EL1" }, { 3, 0, 4, 2, 2, L"CurrentEL" },
+            { 3, 0, 13, 0, 4, L"TPIDR_EL1" }, { 3, 3, 0, 0, 1, L"CTR_EL0" }, { 3, 3, 0, 0, 7, L"DCZID_EL0" },
+            { 3, 3, 4, 2, 0, L"NZCV" }, { 3, 3, 4, 2, 1, L"DAIF" }, { 3, 3, 4, 4, 0, L"FPCR" }, { 3, 3, 4, 4, 1, L"FPSR" },
+            { 3, 3, 9, 12, 0, L"PMCR_EL0" }, { 3, 3, 9, 12, 1, L"PMCNTENSET_EL0" }, { 3, 3, 9, 12, 5, L"PMSELR_EL0" },
+            { 3, 3, 9, 13, 0, L"PMCCNTR_EL0" }, { 3, 3, 9, 13, 1, L"PMXEVTYPER_EL0" }, { 3, 3, 9, 13, 2, L"PMXEVCNTR_EL0" },
+            { 3, 3, 13, 0, 2, L"TPIDR_EL0" }, { 3, 3, 13, 0, 3, L"TPIDRRO_EL0" },
+            { 3, 3, 14, 0, 0, L"CNTFRQ_EL0" }, { 3, 3, 14, 0, 1, L"CNTPCT_EL0" }, { 3, 3, 14, 0, 2, L"CNTVCT_EL0" },
+        };
+
+        uint32_t op0 = 2 + bit(insn, 19), op1 = bits(insn, 18, 16), crn = bits(insn, 15, 12), crm = bits(insn, 11, 8), op2 = bits(insn, 7, 5);
+        for (const auto& reg : names)
+            if (reg.op0 == op0 && reg.op1 == op1 && reg.crn == crn && reg.crm == crm && reg.op2 == op2)
+                return reg.name;
+        return L"S" + std::to_wstring(op0) + L"_" + std::to_wstring(op1) + L"_C" + std::to_wstring(crn) +
+            L"_C" + std::to_wstring(crm) + L"_" + std::to_wstring(op2);
+    }
+
+    //
+    // Data processing (immediate)
+    //
+
+    bool fmt_addsub_imm(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), op = bit(insn, 30), s = bit(insn, 29);
+        uint32_t sh = bit(insn, 22), imm12 = bits(insn, 21, 10), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        std::wstring value = imm(imm12) + (sh ? L", lsl #12" : L"");
+
+        if (!op && !s && !sh && !imm12 && (rd == 31 || rn == 31))
+            out = text(L"mov", gpr(sf, rd, true) + L", " + gpr(sf, rn, true));
+        else if (s && rd == 31)
+            out = text(op ? L"cmp" : L"cmn", gpr(sf, rn, true) + L", " + value);
+        else
+            out = text(mnemonic, gpr(sf, rd, !s) + L", " + gpr(sf, rn, true) + L", " + value);
+        return true;
+    }
+
+    bool fmt_logical_imm(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t opc = bits(insn, 30, 29), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        uint64_t value;
+        if (!decode_bit_masks(sf, bit(insn, 22), bits(insn, 21, 16), bits(insn, 15, 10), value))
+            return false;
+
+        if (opc == 3 && rd == 31)
+            out = text(L"tst", gpr(sf, rn) + L", " + himm(value));
+        else if (opc == 1 && rn == 31 && !is_movz_imm(value, sf ? 64 : 32) && !is_movz_imm(sf ? ~value : ~value & 0xFFFFFFFF, sf ? 64 : 32))
+            out = text(L"mov", gpr(sf, rd, true) + L", " + imm(sf ? static_cast<int64_t>(value) : static_cast<int32_t>(value)));
+        else
+            out = text(mnemonic, gpr(sf, rd, opc != 3) + L", " + gpr(sf, rn) + L", " + himm(value));
+        return true;
+    }
+
+    bool fmt_move_wide(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t opc = bits(insn, 30, 29), hw = bits(insn, 22, 21), imm16 = bits(insn, 20, 5), rd = bits(insn, 4, 0);
+        if (!sf && hw >= 2)
+            return false;
+
+        uint32_t shift = hw * 16;
+        uint64_t value = static_cast<uint64_t>(imm16) << shift;
+        int width = sf ? 64 : 32;
+        uint64_t inverted = sf ? ~value : ~value & 0xFFFFFFFF;
+
+        if (opc == 2 && !(imm16 == 0 && shift != 0))
+            out = text(L"mov", gpr(sf, rd) + L", " + imm(sf ? static_cast<int64_t>(value) : static_cast<int32_t>(value)));
+        else if (opc == 0 && !(imm16 == 0 && shift != 0) && !is_movz_imm(inverted, width))
+            out = text(L"mov", gpr(sf, rd) + L", " + imm(sf ? static_cast<int64_t>(~value) : static_cast<int32_t>(~value)));
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + imm(imm16) + (shift ? L", lsl #" + std::to_wstring(shift) : L""));
+        return true;
+    }
+
+    bool fmt_adr(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        int64_t offset = sext((bits(insn, 23, 5) << 2) | bits(insn, 30, 29), 21);
+        uint64_t target = bit(insn, 31) ? (address & ~0xFFFull) + (offset << 12) : address + offset;
+        out = text(mnemonic, gpr(true, bits(insn, 4, 0)) + L", " + hex(target));
+        return true;
+    }
+
+    bool fmt_bitfield(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t opc = bits(insn, 30, 29), immr = bits(insn, 21, 16), imms = bits(insn, 15, 10);
+        uint32_t rn = bits(insn, 9, 5), rd = bits(insn, 4, 0), size = sf ? 64 : 32;
+        if (bit(insn, 22) != static_cast<uint32_t>(sf) || (!sf && (immr >= 32 || imms >= 32)))
+            return false;
+
+        std::wstring regs = gpr(sf, rd) + L", " + gpr(sf, rn);
+        auto field = [&](const wchar_t* name, uint32_t lsb, uint32_t width) {
+            out = text(name, regs + L", " + imm(lsb) + L", " + imm(width));
+        };
+
+        if (opc == 0)
+        {
+            if (imms == size - 1)
+                out = text(L"asr", regs + L", " + imm(immr));
+            else if (immr == 0 && (imms == 7 || imms == 15 || (sf && imms == 31)))
+                out = text(imms == 7 ? L"sxtb" : imms == 15 ? L"sxth" : L"sxtw", gpr(sf, rd) + L", " + gpr(false, rn));
+            else if (imms < immr)
+                field(L"sbfiz", size - immr, imms + 1);
+            else
+                field(L"sbfx", immr, imms - immr + 1);
+        }
+        else if (opc == 1)
+        {
+            if (rn == 31 && (immr == 0 || imms < immr))
+                out = text(L"bfc", gpr(sf, rd) + L", " + imm((size - immr) & (size - 1)) + L", " + imm(imms + 1));
+            else if (imms < immr)
+                field(L"bfi", size - immr, imms + 1);
+            else
+                field(L"bfxil", immr, imms - immr + 1);
+        }
+        else if (opc == 2)
+        {
+            if (imms == size - 1)
+                out = text(L"lsr", regs + L", " + imm(immr));
+            else if (imms + 1 == immr)
+                out = text(L"lsl", regs + L", " + imm(size - 1 - imms));
+            else if (!sf && immr == 0 && (imms == 7 || imms == 15))
+                out = text(imms == 7 ? L"uxtb" : L"uxth", regs);
+            else if (imms < immr)
+                field(L"ubfiz", size - immr, imms + 1);
+            else
+                field(L"ubfx", immr, imms - immr + 1);
+        }
+        else
+            return false;
+        return true;
+    }
+
+    bool fmt_extr(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t rm = bits(insn, 20, 16), imms = bits(insn, 15, 10), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (bit(insn, 22) != static_cast<uint32_t>(sf) || (!sf && imms >= 32))
+            return false;
+
+        if (rn == rm)
+            out = text(L"ror", gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + imm(imms));
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + gpr(sf, rm) + L", " + imm(imms));
+        return true;
+    }
+
+    //
+    // Branches, exception generation and system instructions
+    //
+
+    bool fmt_branch(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, hex(address + sext(bits(insn, 25, 0), 26) * 4));
+        return true;
+    }
+
+    bool fmt_branch_cond(uint32_t insn, uint64_t address, const wchar_t*, std::wstring& out)
+    {
+        out = text(std::wstring(L"b.") + a64_conditions[bits(insn, 3, 0)], hex(address + sext(bits(insn, 23, 5), 19) * 4));
+        return true;
+    }
+
+    bool fmt_compare_branch(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, gpr(bit(insn, 31), bits(insn, 4, 0)) + L", " + hex(address + sext(bits(insn, 23, 5), 19) * 4));
+        return true;
+    }
+
+    bool fmt_test_branch(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t b5 = bit(insn, 31), number = (b5 << 5) | bits(insn, 23, 19);
+        out = text(mnemonic, gpr(b5, bits(insn, 4, 0)) + L", " + imm(number) + L", " + hex(address + sext(bits(insn, 18, 5), 14) * 4));
+        return true;
+    }
+
+    bool fmt_branch_reg(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t rn = bits(insn, 9, 5);
+        if (bits(insn, 22, 21) == 2 && rn == 30)
+            out = text(mnemonic);
+        else
+            out = text(mnemonic, gpr(true, rn));
+        return true;
+    }
+
+    bool fmt_none(uint32_t, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic);
+        return true;
+    }
+
+    bool fmt_exception(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t imm16 = bits(insn, 20, 5);
+        out = text(mnemonic, imm16 ? himm(imm16) : imm(0));
+        return true;
+    }
+
+    bool fmt_udf(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, imm(bits(insn, 15, 0)));
+        return true;
+    }
+
+    bool fmt_hint(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        static const wchar_t* const names[40] = {
+            L"nop", L"yield", L"wfe", L"wfi", L"sev", L"sevl", L"dgh", L"xpaclri",
+            L"pacia1716", nullptr, L"pacib1716", nullptr, L"autia1716", nullptr, L"autib1716", nullptr,
+            L"esb", L"psb csync", L"tsb csync", nullptr, L"csdb", nullptr, nullptr, nullptr,
+            L"paciaz", L"paciasp", L"pacibz", L"pacibsp", L"autiaz", L"autiasp", L"autibz", L"autibsp",
+            L"bti", nullptr, L"bti c", nullptr, L"bti j", nullptr, L"bti jc", nullptr };
+        uint32_t op = bits(insn, 11, 5);
+        if (op < 40 && names[op])
+        {
+            std::wstring name = names[op];
+            size_t space = name.find(L' ');
+            out = space == std::wstring::npos ? text(name) : text(name.substr(0, space), name.substr(space + 1));
+        }
+        else
+            out = text(L"hint", imm(op));
+        return true;
+    }
+
+    bool fmt_barrier(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        static const wchar_t* const options[16] = {
+            nullptr, L"oshld", L"oshst", L"osh", nullptr, L"nshld", L"nshst", L"nsh",
+            nullptr, L"ishld", L"ishst", L"ish", nullptr, L"ld", L"st", L"sy" };
+        uint32_t crm = bits(insn, 11, 8), op2 = bits(insn, 7, 5);
+
+        if (op2 == 4 && (crm == 0 || crm == 4))
+            out = text(crm ? L"pssbb" : L"ssbb");
+        else if ((op2 == 2 || op2 == 6) && crm == 15)
+            out = text(mnemonic);
+        else if (op2 == 2 || op2 == 6 || !options[crm])
+            out = text(mnemonic, imm(crm));
+        else
+            out = text(mnemonic, options[crm]);
+        return true;
+    }
+
+    bool fmt_mrs(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, gpr(true, bits(insn, 4, 0)) + L", " + sysreg(insn));
+        return true;
+    }
+
+    bool fmt_msr(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, sysreg(insn) + L", " + gpr(true, bits(insn, 4, 0)));
+        return true;
+    }
+
+    //
+    // Loads and stores
+    //
+
+    enum a64_ldst_reg { LDST_W, LDST_X, LDST_FP, LDST_PRFM };
+
+    struct a64_ldst
+    {
+        const wchar_t* name;
+        a64_ldst_reg reg;
+        uint32_t scale;
+    };
+
+    // Indexed by size:V:opc of load/store register encodings
+    const a64_ldst a64_ldst_regs[32] = {
+        { L"strb", LDST_W, 0 }, { L"ldrb", LDST_W, 0 }, { L"ldrsb", LDST_X, 0 }, { L"ldrsb", LDST_W, 0 },
+        { L"str", LDST_FP, 0 }, { L"ldr", LDST_FP, 0 }, { L"str", LDST_FP, 4 }, { L"ldr", LDST_FP, 4 },
+        { L"strh", LDST_W, 1 }, { L"ldrh", LDST_W, 1 }, { L"ldrsh", LDST_X, 1 }, { L"ldrsh", LDST_W, 1 },
+        { L"str", LDST_FP, 1 }, { L"ldr", LDST_FP, 1 }, { nullptr, LDST_W, 0 }, { nullptr, LDST_W, 0 },
+        { L"str", LDST_W, 2 }, { L"ldr", LDST_W, 2 }, { L"ldrsw", LDST_X, 2 }, { nullptr, LDST_W, 0 },
+        { L"str", LDST_FP, 2 }, { L"ldr", LDST_FP, 2 }, { nullptr, LDST_W, 0 }, { nullptr, LDST_W, 0 },
+        { L"str", LDST_X, 3 }, { L"ldr", LDST_X, 3 }, { L"prfm", LDST_PRFM, 3 }, { nullptr, LDST_W, 0 },
+        { L"str", LDST_FP, 3 }, { L"ldr", LDST_FP, 3 }, { nullptr, LDST_W, 0 }, { nullptr, LDST_W, 0 },
+    };
+
+    const a64_ldst* ldst_desc(uint32_t insn)
+    {
+        const a64_ldst* desc = &a64_ldst_regs[(bits(insn, 31, 30) << 3) | (bit(insn, 26) << 2) | bits(insn, 23, 22)];
+        return desc->name ? desc : nullptr;
+    }
+
+    std::wstring ldst_rt(const a64_ldst* desc, uint32_t rt)
+    {
+        switch (desc->reg)
+        {
+        case LDST_W: return gpr(false, rt);
+        case LDST_X: return gpr(true, rt);
+        case LDST_FP: return fpr(desc->scale, rt);
+        default: return prefetch_op(rt);
+        }
+    }
+
+    std::wstring mem_offset(uint32_t rn, int64_t offset)
+    {
+        return L"[" + xsp(rn) + (offset ? L", " + imm(offset) : L"") + L"]";
+    }
+
+    bool fmt_ldst_uimm(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        const a64_ldst* desc = ldst_desc(insn);
+        if (!desc)
+            return false;
+        out = text(desc->name, ldst_rt(desc, bits(insn, 4, 0)) + L", " + mem_offset(bits(insn, 9, 5), bits(insn, 21, 10) << desc->scale));
+        return true;
+    }
+
+    bool fmt_ldst_imm9(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        const a64_ldst* desc = ldst_desc(insn);
+        uint32_t mode = bits(insn, 11, 10), rn = bits(insn, 9, 5);
+        int64_t offset = sext(bits(insn, 20, 12), 9);
+        if (!desc || (desc->reg == LDST_PRFM && mode != 0) || (mode == 2 && desc->reg == LDST_FP))
+            return false;
+
+        std::wstring name = desc->name;
+        std::wstring operands = ldst_rt(desc, bits(insn, 4, 0)) + L", ";
+        switch (mode)
+        {
+        case 0: name.insert(desc->reg == LDST_PRFM ? 3 : 2, L"u"); operands += mem_offset(rn, offset); break;
+        case 1: operands += L"[" + xsp(rn) + L"], " + imm(offset); break;
+        case 2: name.insert(2, L"t"); operands += mem_offset(rn, offset); break;
+        case 3: operands += L"[" + xsp(rn) + L", " + imm(offset) + L"]!"; break;
+        }
+        out = text(name, operands);
+        return true;
+    }
+
+    bool fmt_ldst_reg(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        const a64_ldst* desc = ldst_desc(insn);
+        uint32_t option = bits(insn, 15, 13), s = bit(insn, 12);
+        if (!desc || !(option & 2))
+            return false;
+
+        std::wstring extend;
+        if (option == 3)
+            extend = s ? L", lsl #" + std::to_wstring(desc->scale) : L"";
+        else
+            extend = std::wstring(L", ") + a64_extends[option] + (s ? L" #" + std::to_wstring(desc->scale) : L"");
+
+        out = text(desc->name, ldst_rt(desc, bits(insn, 4, 0)) + L", [" + xsp(bits(insn, 9, 5)) + L", " +
+            gpr(option & 1, bits(insn, 20, 16)) + extend + L"]");
+        return true;
+    }
+
+    bool fmt_ldst_literal(uint32_t insn, uint64_t address, const wchar_t*, std::wstring& out)
+    {
+        uint32_t opc = bits(insn, 31, 30), rt = bits(insn, 4, 0);
+        std::wstring target = hex(address + sext(bits(insn, 23, 5), 19) * 4);
+
+        if (bit(insn, 26))
+        {
+            if (opc == 3)
+                return false;
+            out = text(L"ldr", fpr(opc + 2, rt) + L", " + target);
+        }
+        else if (opc == 3)
+            out = text(L"prfm", prefetch_op(rt) + L", " + target);
+        else
+            out = text(opc == 2 ? L"ldrsw" : L"ldr", gpr(opc != 0, rt) + L", " + target);
+        return true;
+    }
+
+    bool fmt_ldst_pair(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t opc = bits(insn, 31, 30), mode = bits(insn, 24, 23), l = bit(insn, 22);
+        uint32_t rt2 = bits(insn, 14, 10), rn = bits(insn, 9, 5), rt = bits(insn, 4, 0);
+        bool simd = bit(insn, 26);
+        if (opc == 3 || (!simd && opc == 1 && (!l || mode == 0)))
+            return false;
+
+        uint32_t scale = simd ? opc + 2 : (opc == 2 ? 3 : 2);
+        int64_t offset = sext(bits(insn, 21, 15), 7) * (1ll << scale);
+        auto reg = [&](uint32_t n) { return simd ? fpr(scale, n) : gpr(opc != 0, n); };
+
+        std::wstring name = mode == 0 ? (l ? L"ldnp" : L"stnp") : (!simd && opc == 1) ? L"ldpsw" : (l ? L"ldp" : L"stp");
+        std::wstring operands = reg(rt) + L", " + reg(rt2) + L", ";
+        if (mode == 1)
+            operands += L"[" + xsp(rn) + L"], " + imm(offset);
+        else if (mode == 3)
+            operands += L"[" + xsp(rn) + L", " + imm(offset) + L"]!";
+        else
+            operands += mem_offset(rn, offset);
+        out = text(name, operands);
+        return true;
+    }
+
+    bool fmt_ldst_exclusive(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 31, 30), o2 = bit(insn, 23), l = bit(insn, 22), o1 = bit(insn, 21), o0 = bit(insn, 15);
+        uint32_t rs = bits(insn, 20, 16), rt2 = bits(insn, 14, 10), rn = bits(insn, 9, 5), rt = bits(insn, 4, 0);
+        const wchar_t* suffix = size == 0 ? L"b" : size == 1 ? L"h" : L"";
+        bool sf = size == 3;
+        std::wstring mem = L"[" + xsp(rn) + L"]";
+
+        if (!o2 && !o1)
+        {
+            if (l)
+                out = text(std::wstring(o0 ? L"ldaxr" : L"ldxr") + suffix, gpr(sf, rt) + L", " + mem);
+            else
+                out = text(std::wstring(o0 ? L"stlxr" : L"stxr") + suffix, gpr(false, rs) + L", " + gpr(sf, rt) + L", " + mem);
+        }
+        else if (!o2 && size < 2)
+        {
+            // CASP, register pairs starting at even register
+            bool sf64 = size == 1;
+            if (rt2 != 31 || (rs & 1) || (rt & 1))
+                return false;
+            out = text(std::wstring(L"casp") + (l ? L"a" : L"") + (o0 ? L"l" : L""), gpr(sf64, rs) + L", " + gpr(sf64, rs + 1) + L", " +
+                gpr(sf64, rt) + L", " + gpr(sf64, rt + 1) + L", " + mem);
+        }
+        else if (!o2)
+        {
+            if (l)
+                out = text(o0 ? L"ldaxp" : L"ldxp", gpr(sf, rt) + L", " + gpr(sf, rt2) + L", " + mem);
+            else
+                out = text(o0 ? L"stlxp" : L"stxp", gpr(false, rs) + L", " + gpr(sf, rt) + L", " + gpr(sf, rt2) + L", " + mem);
+        }
+        else if (!o1)
+        {
+            if (l)
+                out = text(std::wstring(o0 ? L"ldar" : L"ldlar") + suffix, gpr(sf, rt) + L", " + mem);
+            else
+                out = text(std::wstring(o0 ? L"stlr" : L"stllr") + suffix, gpr(sf, rt) + L", " + mem);
+        }
+        else
+        {
+            if (rt2 != 31)
+                return false;
+            std::wstring name = std::wstring(L"cas") + (l ? L"a" : L"") + (o0 ? L"l" : L"") + suffix;
+            out = text(name, gpr(sf, rs) + L", " + gpr(sf, rt) + L", " + mem);
+        }
+        return true;
+    }
+
+    bool fmt_atomic(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        static const wchar_t* const ops[8] = { L"add", L"clr", L"eor", L"set", L"smax", L"smin", L"umax", L"umin" };
+        uint32_t size = bits(insn, 31, 30), a = bit(insn, 23), r = bit(insn, 22), o3 = bit(insn, 15), opc = bits(insn, 14, 12);
+        uint32_t rs = bits(insn, 20, 16), rn = bits(insn, 9, 5), rt = bits(insn, 4, 0);
+        if (o3 && opc)
+            return false;
+
+        bool sf = size == 3;
+        std::wstring suffix = std::wstring(a ? L"a" : L"") + (r ? L"l" : L"") + (size == 0 ? L"b" : size == 1 ? L"h" : L"");
+        std::wstring mem = L"[" + xsp(rn) + L"]";
+
+        if (o3)
+            out = text(L"swp" + suffix, gpr(sf, rs) + L", " + gpr(sf, rt) + L", " + mem);
+        else if (rt == 31 && !a)
+            out = text(L"st" + std::wstring(ops[opc]) + suffix, gpr(sf, rs) + L", " + mem);
+        else
+            out = text(L"ld" + std::wstring(ops[opc]) + suffix, gpr(sf, rs) + L", " + gpr(sf, rt) + L", " + mem);
+        return true;
+    }
+
+    //
+    // Data processing (register)
+    //
+
+    bool fmt_logical_shifted(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t opc = bits(insn, 30, 29), shift = bits(insn, 23, 22), n = bit(insn, 21), imm6 = bits(insn, 15, 10);
+        uint32_t rm = bits(insn, 20, 16), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (!sf && imm6 >= 32)
+            return false;
+
+        std::wstring shifted = gpr(sf, rm) + shift_text(shift, imm6);
+        if (opc == 1 && !n && rn == 31 && shift == 0 && imm6 == 0)
+            out = text(L"mov", gpr(sf, rd) + L", " + gpr(sf, rm));
+        else if (opc == 1 && n && rn == 31)
+            out = text(L"mvn", gpr(sf, rd) + L", " + shifted);
+        else if (opc == 3 && !n && rd == 31)
+            out = text(L"tst", gpr(sf, rn) + L", " + shifted);
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + shifted);
+        return true;
+    }
+
+    bool fmt_addsub_shifted(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), op = bit(insn, 30), s = bit(insn, 29);
+        uint32_t shift = bits(insn, 23, 22), imm6 = bits(insn, 15, 10);
+        uint32_t rm = bits(insn, 20, 16), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (shift == 3 || (!sf && imm6 >= 32))
+            return false;
+
+        std::wstring shifted = gpr(sf, rm) + shift_text(shift, imm6);
+        if (s && rd == 31)
+            out = text(op ? L"cmp" : L"cmn", gpr(sf, rn) + L", " + shifted);
+        else if (op && rn == 31)
+            out = text(s ? L"negs" : L"neg", gpr(sf, rd) + L", " + shifted);
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + shifted);
+        return true;
+    }
+
+    bool fmt_addsub_extended(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), op = bit(insn, 30), s = bit(insn, 29);
+        uint32_t option = bits(insn, 15, 13), imm3 = bits(insn, 12, 10);
+        uint32_t rm = bits(insn, 20, 16), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (imm3 > 4)
+            return false;
+
+        std::wstring extended = gpr(sf && (option & 3) == 3, rm);
+        if (((rd == 31 && !s) || rn == 31) && option == (sf ? 3u : 2u))
+            extended += imm3 ? L", lsl #" + std::to_wstring(imm3) : L"";
+        else
+            extended += std::wstring(L", ") + a64_extends[option] + (imm3 ? L" #" + std::to_wstring(imm3) : L"");
+
+        if (s && rd == 31)
+            out = text(op ? L"cmp" : L"cmn", gpr(sf, rn, true) + L", " + extended);
+        else
+            out = text(mnemonic, gpr(sf, rd, !s) + L", " + gpr(sf, rn, true) + L", " + extended);
+        return true;
+    }
+
+    bool fmt_addsub_carry(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), op = bit(insn, 30), s = bit(insn, 29);
+        uint32_t rm = bits(insn, 20, 16), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (op && rn == 31)
+            out = text(s ? L"ngcs" : L"ngc", gpr(sf, rd) + L", " + gpr(sf, rm));
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + gpr(sf, rm));
+        return true;
+    }
+
+    bool fmt_cond_compare(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        uint32_t rm = bits(insn, 20, 16), cond = bits(insn, 15, 12), rn = bits(insn, 9, 5), nzcv = bits(insn, 3, 0);
+        std::wstring second = bit(insn, 11) ? imm(rm) : gpr(sf, rm);
+        out = text(mnemonic, gpr(sf, rn) + L", " + second + L", " + imm(nzcv) + L", " + a64_conditions[cond]);
+        return true;
+    }
+
+    bool fmt_cond_select(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), op = bit(insn, 30), o2 = bit(insn, 10);
+        uint32_t rm = bits(insn, 20, 16), cond = bits(insn, 15, 12), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+
+        if ((op || o2) && rn == rm && (cond >> 1) != 7)
+        {
+            const wchar_t* inverted = a64_conditions[cond ^ 1];
+            if (rn == 31 && !(op && o2))
+                out = text(op ? L"csetm" : L"cset", gpr(sf, rd) + L", " + inverted);
+            else
+                out = text(op ? (o2 ? L"cneg" : L"cinv") : L"cinc", gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + inverted);
+        }
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + gpr(sf, rm) + L", " + a64_conditions[cond]);
+        return true;
+    }
+
+    bool fmt_dp3(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31), o0 = bit(insn, 15);
+        uint32_t rm = bits(insn, 20, 16), ra = bits(insn, 14, 10), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (ra == 31)
+            out = text(o0 ? L"mneg" : L"mul", gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + gpr(sf, rm));
+        else
+            out = text(mnemonic, gpr(sf, rd) + L", " + gpr(sf, rn) + L", " + gpr(sf, rm) + L", " + gpr(sf, ra));
+        return true;
+    }
+
+    // SMADDL/UMADDL/SMSUBL/UMSUBL, 64-bit accumulator with 32-bit sources
+    bool fmt_dp3_long(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool o0 = bit(insn, 15), u = bit(insn, 23);
+        uint32_t rm = bits(insn, 20, 16), ra = bits(insn, 14, 10), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        std::wstring sources = gpr(true, rd) + L", " + gpr(false, rn) + L", " + gpr(false, rm);
+        if (ra == 31)
+            out = text(std::wstring(u ? L"u" : L"s") + (o0 ? L"mnegl" : L"mull"), sources);
+        else
+            out = text(mnemonic, sources + L", " + gpr(true, ra));
+        return true;
+    }
+
+    bool fmt_dp2(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        out = text(mnemonic, gpr(sf, bits(insn, 4, 0)) + L", " + gpr(sf, bits(insn, 9, 5)) + L", " + gpr(sf, bits(insn, 20, 16)));
+        return true;
+    }
+
+    bool fmt_dp1(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 31);
+        out = text(mnemonic, gpr(sf, bits(insn, 4, 0)) + L", " + gpr(sf, bits(insn, 9, 5)));
+        return true;
+    }
+
+    //
+    // Scalar floating point
+    //
+
+    bool fmt_fp_dp1(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        std::wstring rd = ftype_reg(bits(insn, 23, 22), bits(insn, 4, 0)), rn = ftype_reg(bits(insn, 23, 22), bits(insn, 9, 5));
+        if (rd.empty())
+            return false;
+        out = text(mnemonic, rd + L", " + rn);
+        return true;
+    }
+
+    bool fmt_fp_fcvt(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22), opc = bits(insn, 16, 15);
+        if (ftype == opc || ftype == 2 || opc == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(opc, bits(insn, 4, 0)) + L", " + ftype_reg(ftype, bits(insn, 9, 5)));
+        return true;
+    }
+
+    bool fmt_fp_dp2(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 4, 0)) + L", " + ftype_reg(ftype, bits(insn, 9, 5)) + L", " + ftype_reg(ftype, bits(insn, 20, 16)));
+        return true;
+    }
+
+    bool fmt_fp_dp3(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 4, 0)) + L", " + ftype_reg(ftype, bits(insn, 9, 5)) + L", " +
+            ftype_reg(ftype, bits(insn, 20, 16)) + L", " + ftype_reg(ftype, bits(insn, 14, 10)));
+        return true;
+    }
+
+    bool fmt_fp_compare(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        std::wstring second = bit(insn, 3) ? L"#0.0" : ftype_reg(ftype, bits(insn, 20, 16));
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 9, 5)) + L", " + second);
+        return true;
+    }
+
+    bool fmt_fp_cond_compare(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 9, 5)) + L", " + ftype_reg(ftype, bits(insn, 20, 16)) + L", " +
+            imm(bits(insn, 3, 0)) + L", " + a64_conditions[bits(insn, 15, 12)]);
+        return true;
+    }
+
+    bool fmt_fp_cond_select(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 4, 0)) + L", " + ftype_reg(ftype, bits(insn, 9, 5)) + L", " +
+            ftype_reg(ftype, bits(insn, 20, 16)) + L", " + a64_conditions[bits(insn, 15, 12)]);
+        return true;
+    }
+
+    bool fmt_fp_imm(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        if (ftype == 2)
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 4, 0)) + L", " + fp_imm(bits(insn, 20, 13)));
+        return true;
+    }
+
+    // FP to integer conversions (FCVT*, FMOV to general register)
+    bool fmt_fp_to_int(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        bool sf = bit(insn, 31);
+        if (ftype == 2 || (bits(insn, 18, 16) == 6 && ftype != 3 && ftype != static_cast<uint32_t>(sf)))
+            return false;
+        out = text(mnemonic, gpr(sf, bits(insn, 4, 0)) + L", " + ftype_reg(ftype, bits(insn, 9, 5)));
+        return true;
+    }
+
+    // Integer to FP conversions (SCVTF/UCVTF, FMOV from general register)
+    bool fmt_int_to_fp(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t ftype = bits(insn, 23, 22);
+        bool sf = bit(insn, 31);
+        if (ftype == 2 || (bits(insn, 18, 16) == 7 && ftype != 3 && ftype != static_cast<uint32_t>(sf)))
+            return false;
+        out = text(mnemonic, ftype_reg(ftype, bits(insn, 4, 0)) + L", " + gpr(sf, bits(insn, 9, 5)));
+        return true;
+    }
+
+    // FMOV to or from the upper half of a 128-bit register
+    bool fmt_fmov_upper(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        std::wstring upper = velem(bit(insn, 16) ? bits(insn, 4, 0) : bits(insn, 9, 5), 3, 1);
+        if (bit(insn, 16))
+            out = text(mnemonic, upper + L", " + gpr(true, bits(insn, 9, 5)));
+        else
+            out = text(mnemonic, gpr(true, bits(insn, 4, 0)) + L", " + upper);
+        return true;
+    }
+
+    //
+    // Advanced SIMD
+    //
+
+    bool vector_size_valid(uint32_t size, uint32_t q) { return size != 3 || q; }
+
+    // Vector operation on three registers of the same arrangement
+    bool fmt_simd_same(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (!vector_size_valid(size, q))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + vreg(bits(insn, 20, 16), size, q));
+        return true;
+    }
+
+    bool fmt_simd_same_bhs(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) != 3 && fmt_simd_same(insn, address, mnemonic, out);
+    }
+
+    bool fmt_simd_same_hs(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22);
+        return (size == 1 || size == 2) && fmt_simd_same(insn, address, mnemonic, out);
+    }
+
+    // Bitwise operations, size field is part of the opcode
+    bool fmt_simd_same_b(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), rm = bits(insn, 20, 16), rn = bits(insn, 9, 5), rd = bits(insn, 4, 0);
+        if (bits(insn, 23, 21) == 5 && !bit(insn, 29) && rn == rm)
+            out = text(L"mov", vreg(rd, 0, q) + L", " + vreg(rn, 0, q));
+        else
+            out = text(mnemonic, vreg(rd, 0, q) + L", " + vreg(rn, 0, q) + L", " + vreg(rm, 0, q));
+        return true;
+    }
+
+    bool fmt_simd_same_fp(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = 2 + bit(insn, 22);
+        if (!vector_size_valid(size, q))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + vreg(bits(insn, 20, 16), size, q));
+        return true;
+    }
+
+    // Vector operation on two registers of the same arrangement
+    bool fmt_simd_misc(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (!vector_size_valid(size, q))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q));
+        return true;
+    }
+
+    bool fmt_simd_misc_bhs(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) != 3 && fmt_simd_misc(insn, address, mnemonic, out);
+    }
+
+    bool fmt_simd_misc_bh(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) < 2 && fmt_simd_misc(insn, address, mnemonic, out);
+    }
+
+    bool fmt_simd_misc_b(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) == 0 && fmt_simd_misc(insn, address, mnemonic, out);
+    }
+
+    // MVN and RBIT, size field is part of the opcode
+    bool fmt_simd_misc_not(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30);
+        out = text(mnemonic, vreg(bits(insn, 4, 0), 0, q) + L", " + vreg(bits(insn, 9, 5), 0, q));
+        return true;
+    }
+
+    // Compare against zero
+    bool fmt_simd_misc_zero(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        if (!fmt_simd_misc(insn, address, mnemonic, out))
+            return false;
+        out += L", #0";
+        return true;
+    }
+
+    bool fmt_simd_misc_fp(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = 2 + bit(insn, 22);
+        if (!vector_size_valid(size, q))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q));
+        return true;
+    }
+
+    // XTN/XTN2, destination elements are half the source size
+    bool fmt_simd_misc_narrow(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3)
+            return false;
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size + 1, 1));
+        return true;
+    }
+
+    // Reductions across lanes into scalar register
+    bool fmt_simd_across(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3 || (size == 2 && !q))
+            return false;
+        out = text(mnemonic, fpr(size, bits(insn, 4, 0)) + L", " + vreg(bits(insn, 9, 5), size, q));
+        return true;
+    }
+
+    bool fmt_simd_across_long(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3 || (size == 2 && !q))
+            return false;
+        out = text(mnemonic, fpr(size + 1, bits(insn, 4, 0)) + L", " + vreg(bits(insn, 9, 5), size, q));
+        return true;
+    }
+
+    bool fmt_simd_across_fp(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        if (!bit(insn, 30) || bit(insn, 22))
+            return false;
+        out = text(mnemonic, fpr(2, bits(insn, 4, 0)) + L", " + vreg(bits(insn, 9, 5), 2, 1));
+        return true;
+    }
+
+    // DUP, INS, SMOV and UMOV
+    bool fmt_simd_copy(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), op = bit(insn, 29), imm5 = bits(insn, 20, 16), imm4 = bits(insn, 14, 11);
+        uint32_t rn = bits(insn, 9, 5), rd = bits(insn, 4, 0), size = 0;
+        while (size < 4 && !(imm5 & (1u << size)))
+            size++;
+        if (size == 4)
+            return false;
+        uint32_t index = imm5 >> (size + 1);
+
+        if (op)
+        {
+            if (!q)
+                return false;
+            out = text(L"mov", velem(rd, size, index) + L", " + velem(rn, size, imm4 >> size));
+            return true;
+        }
+
+        switch (imm4)
+        {
+        case 0:
+            if (!vector_size_valid(size, q))
+                return false;
+            out = text(L"dup", vreg(rd, size, q) + L", " + velem(rn, size, index));
+            return true;
+        case 1:
+            if (!vector_size_valid(size, q))
+                return false;
+            out = text(L"dup", vreg(rd, size, q) + L", " + gpr(size == 3, rn));
+            return true;
+        case 3:
+            if (!q)
+                return false;
+            out = text(L"mov", velem(rd, size, index) + L", " + gpr(size == 3, rn));
+            return true;
+        case 5:
+            if (size == 3 || (size == 2 && !q))
+                return false;
+            out = text(L"smov", gpr(q, rd) + L", " + velem(rn, size, index));
+            return true;
+        case 7:
+            if ((q && size != 3) || (!q && size == 3))
+                return false;
+            out = text(size >= 2 ? L"mov" : L"umov", gpr(q, rd) + L", " + velem(rn, size, index));
+            return true;
+        }
+        return false;
+    }
+
+    // MOVI, MVNI, ORR, BIC and FMOV (vector, immediate)
+    bool fmt_simd_modified_imm(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), op = bit(insn, 29), cmode = bits(insn, 15, 12), rd = bits(insn, 4, 0);
+        uint32_t imm8 = (bits(insn, 18, 16) << 5) | bits(insn, 9, 5);
+
+        if (bit(insn, 11))
+        {
+            if (cmode != 15 || op)
+                return false;
+            out = text(L"fmov", vreg(rd, 1, q) + L", " + fp_imm(imm8));
+        }
+        else if (cmode < 12)
+        {
+            bool halfword = cmode >= 8;
+            uint32_t shift = 8 * ((cmode >> 1) & (halfword ? 1 : 3));
+            const wchar_t* name = (cmode & 1) ? (op ? L"bic" : L"orr") : (op ? L"mvni" : L"movi");
+            out = text(name, vreg(rd, halfword ? 1 : 2, q) + L", " + imm(imm8) + (shift ? L", lsl #" + std::to_wstring(shift) : L""));
+        }
+        else if (cmode < 14)
+            out = text(op ? L"mvni" : L"movi", vreg(rd, 2, q) + L", " + imm(imm8) + L", msl #" + ((cmode & 1) ? L"16" : L"8"));
+        else if (cmode == 14 && !op)
+            out = text(L"movi", vreg(rd, 0, q) + L", " + imm(imm8));
+        else if (cmode == 14)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < 8; i++)
+                if (imm8 & (1u << i))
+                    value |= 0xFFull << (8 * i);
+            wchar_t buf[24];
+            swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"#%#016llx", static_cast<unsigned long long>(value));
+            out = text(L"movi", (q ? vreg(rd, 3, 1) : fpr(3, rd)) + L", " + buf);
+        }
+        else if (!op || q)
+            out = text(L"fmov", vreg(rd, op ? 3 : 2, q) + L", " + fp_imm(imm8));
+        else
+            return false;
+        return true;
+    }
+
+    // Element size of shift by immediate encodings, highest set bit of immh
+    bool shift_size(uint32_t insn, uint32_t& size)
+    {
+        uint32_t immh = bits(insn, 22, 19);
+        for (size = 3; size < 4 && !(immh & (8u >> (3 - size))); size--)
+            ;
+        return size < 4;
+    }
+
+    bool fmt_simd_shift_right(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size;
+        if (!shift_size(insn, size) || !vector_size_valid(size, q))
+            return false;
+        uint32_t shift = (16u << size) - bits(insn, 22, 16);
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + imm(shift));
+        return true;
+    }
+
+    bool fmt_simd_shift_left(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size;
+        if (!shift_size(insn, size) || !vector_size_valid(size, q))
+            return false;
+        uint32_t shift = bits(insn, 22, 16) - (8u << size);
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + imm(shift));
+        return true;
+    }
+
+    bool fmt_simd_shift_narrow(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size;
+        if (!shift_size(insn, size) || size == 3)
+            return false;
+        uint32_t shift = (16u << size) - bits(insn, 22, 16);
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size + 1, 1) + L", " + imm(shift));
+        return true;
+    }
+
+    bool fmt_simd_shift_long(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size;
+        if (!shift_size(insn, size) || size == 3)
+            return false;
+        uint32_t shift = bits(insn, 22, 16) - (8u << size);
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size + 1, 1) + L", " +
+            vreg(bits(insn, 9, 5), size, q) + L", " + imm(shift));
+        return true;
+    }
+
+    // Fixed point conversions, shift is number of fraction bits
+    bool fmt_simd_shift_fixed(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size;
+        return shift_size(insn, size) && size >= 1 && fmt_simd_shift_right(insn, address, mnemonic, out);
+    }
+
+    bool fmt_simd_long(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3)
+            return false;
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size + 1, 1) + L", " +
+            vreg(bits(insn, 9, 5), size, q) + L", " + vreg(bits(insn, 20, 16), size, q));
+        return true;
+    }
+
+    bool fmt_simd_long_hs(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22);
+        return (size == 1 || size == 2) && fmt_simd_long(insn, address, mnemonic, out);
+    }
+
+    bool fmt_simd_wide(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3)
+            return false;
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size + 1, 1) + L", " +
+            vreg(bits(insn, 9, 5), size + 1, 1) + L", " + vreg(bits(insn, 20, 16), size, q));
+        return true;
+    }
+
+    bool fmt_simd_narrow(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22);
+        if (size == 3)
+            return false;
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size, q) + L", " +
+            vreg(bits(insn, 9, 5), size + 1, 1) + L", " + vreg(bits(insn, 20, 16), size + 1, 1));
+        return true;
+    }
+
+    // Register and lane index of by element encodings, `size` is element size
+    bool element_index(uint32_t insn, uint32_t size, uint32_t& rm, uint32_t& index)
+    {
+        uint32_t h = bit(insn, 11), l = bit(insn, 21), m = bit(insn, 20);
+        switch (size)
+        {
+        case 1: rm = bits(insn, 19, 16); index = (h << 2) | (l << 1) | m; return true;
+        case 2: rm = bits(insn, 20, 16); index = (h << 1) | l; return true;
+        case 3: rm = bits(insn, 20, 16); index = h; return !l;
+        }
+        return false;
+    }
+
+    bool fmt_simd_element(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22), rm, index;
+        if (size == 3 || !element_index(insn, size, rm, index))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + velem(rm, size, index));
+        return true;
+    }
+
+    bool fmt_simd_element_long(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22), rm, index;
+        if (size == 3 || !element_index(insn, size, rm, index))
+            return false;
+        out = text(std::wstring(mnemonic) + (q ? L"2" : L""), vreg(bits(insn, 4, 0), size + 1, 1) + L", " +
+            vreg(bits(insn, 9, 5), size, q) + L", " + velem(rm, size, index));
+        return true;
+    }
+
+    bool fmt_simd_element_fp(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 23, 22), rm, index;
+        if (size == 1)
+            return false;
+        size = size ? size : 1;
+        if (!vector_size_valid(size, q) || !element_index(insn, size, rm, index))
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), size, q) + L", " + vreg(bits(insn, 9, 5), size, q) + L", " + velem(rm, size, index));
+        return true;
+    }
+
+    bool fmt_simd_ext(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), index = bits(insn, 14, 11);
+        if (!q && index >= 8)
+            return false;
+        out = text(mnemonic, vreg(bits(insn, 4, 0), 0, q) + L", " + vreg(bits(insn, 9, 5), 0, q) + L", " + vreg(bits(insn, 20, 16), 0, q) + L", " + imm(index));
+        return true;
+    }
+
+    bool fmt_simd_table(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30);
+        out = text(mnemonic, vreg(bits(insn, 4, 0), 0, q) + L", " + vlist(bits(insn, 9, 5), bits(insn, 14, 13) + 1, L".16b") + L", " + vreg(bits(insn, 20, 16), 0, q));
+        return true;
+    }
+
+    std::wstring post_index(uint32_t insn, uint32_t bytes)
+    {
+        uint32_t rm = bits(insn, 20, 16);
+        return L"[" + xsp(bits(insn, 9, 5)) + L"], " + (rm == 31 ? imm(bytes) : gpr(true, rm));
+    }
+
+    // LD1-LD4/ST1-ST4 (multiple structures)
+    bool fmt_simd_ldst_multiple(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), l = bit(insn, 22), opcode = bits(insn, 15, 12), size = bits(insn, 11, 10);
+        uint32_t regs, structures;
+        switch (opcode)
+        {
+        case 0: regs = 4; structures = 4; break;
+        case 2: regs = 4; structures = 1; break;
+        case 4: regs = 3; structures = 3; break;
+        case 6: regs = 3; structures = 1; break;
+        case 7: regs = 1; structures = 1; break;
+        case 8: regs = 2; structures = 2; break;
+        case 10: regs = 2; structures = 1; break;
+        default: return false;
+        }
+        if (size == 3 && !q && structures != 1)
+            return false;
+
+        std::wstring name = std::wstring(l ? L"ld" : L"st") + std::to_wstring(structures);
+        std::wstring list = vlist(bits(insn, 4, 0), regs, std::wstring(L".") + a64_arrangements[size * 2 + q]);
+        if (bit(insn, 23))
+            out = text(name, list + L", " + post_index(insn, regs * (q ? 16 : 8)));
+        else
+            out = text(name, list + L", [" + xsp(bits(insn, 9, 5)) + L"]");
+        return true;
+    }
+
+    // LD1/ST1 (single structure) of one lane
+    bool fmt_simd_ldst_lane(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), opcode = bits(insn, 15, 13), s = bit(insn, 12), size = bits(insn, 11, 10);
+        uint32_t esize, index;
+        if (opcode == 0)
+            esize = 0, index = (q << 3) | (s << 2) | size;
+        else if (opcode == 2 && !(size & 1))
+            esize = 1, index = (q << 2) | (s << 1) | (size >> 1);
+        else if (opcode == 4 && size == 0)
+            esize = 2, index = (q << 1) | s;
+        else if (opcode == 4 && size == 1 && !s)
+            esize = 3, index = q;
+        else
+            return false;
+
+        std::wstring lane = L"{ v" + std::to_wstring(bits(insn, 4, 0)) + L"." + a64_fp_sizes[esize] + L" }[" + std::to_wstring(index) + L"]";
+        if (bit(insn, 23))
+            out = text(mnemonic, lane + L", " + post_index(insn, 1u << esize));
+        else
+            out = text(mnemonic, lane + L", [" + xsp(bits(insn, 9, 5)) + L"]");
+        return true;
+    }
+
+    bool fmt_simd_ld1r(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t q = bit(insn, 30), size = bits(insn, 11, 10);
+        std::wstring list = vlist(bits(insn, 4, 0), 1, std::wstring(L".") + a64_arrangements[size * 2 + q]);
+        if (bit(insn, 23))
+            out = text(mnemonic, list + L", " + post_index(insn, 1u << size));
+        else
+            out = text(mnemonic, list + L", [" + xsp(bits(insn, 9, 5)) + L"]");
+        return true;
+    }
+
+    // Scalar DUP (element), shown as MOV
+    bool fmt_scalar_dup(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        uint32_t imm5 = bits(insn, 20, 16), size = 0;
+        while (size < 4 && !(imm5 & (1u << size)))
+            size++;
+        if (size == 4)
+            return false;
+        out = text(L"mov", fpr(size, bits(insn, 4, 0)) + L", " + velem(bits(insn, 9, 5), size, imm5 >> (size + 1)));
+        return true;
+    }
+
+    // Scalar pairwise reduction of two lanes
+    bool fmt_scalar_pair(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bit(insn, 29) ? 2 + bit(insn, 22) : 3;
+        out = text(mnemonic, fpr(size, bits(insn, 4, 0)) + L", " + vreg(bits(insn, 9, 5), size, size == 3));
+        return true;
+    }
+
+    bool fmt_scalar_same_d(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, fpr(3, bits(insn, 4, 0)) + L", " + fpr(3, bits(insn, 9, 5)) + L", " + fpr(3, bits(insn, 20, 16)));
+        return true;
+    }
+
+    bool fmt_scalar_shift_d(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t immhb = bits(insn, 22, 16);
+        uint32_t shift = bits(insn, 15, 11) == 0x0A ? immhb - 64 : 128 - immhb;
+        out = text(mnemonic, fpr(3, bits(insn, 4, 0)) + L", " + fpr(3, bits(insn, 9, 5)) + L", " + imm(shift));
+        return true;
+    }
+
+    //
+    // SVE
+    //
+
+    std::wstring sve_count(uint32_t insn)
+    {
+        uint32_t pattern = bits(insn, 9, 5), mul = bits(insn, 19, 16) + 1;
+        if (mul > 1)
+            return L", " + sve_pattern(pattern) + L", mul " + imm(mul);
+        return pattern == 31 ? L"" : L", " + sve_pattern(pattern);
+    }
+
+    std::wstring sve_mul_vl(uint32_t rn, int64_t offset)
+    {
+        return L"[" + xsp(rn) + (offset ? L", " + imm(offset) + L", mul vl" : L"") + L"]";
+    }
+
+    bool fmt_sve_ptrue(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t pattern = bits(insn, 9, 5);
+        out = text(mnemonic, preg(bits(insn, 3, 0), bits(insn, 23, 22)) + (pattern == 31 ? L"" : L", " + sve_pattern(pattern)));
+        return true;
+    }
+
+    bool fmt_sve_pfalse(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, preg(bits(insn, 3, 0), 0));
+        return true;
+    }
+
+    bool fmt_sve_while(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        bool sf = bit(insn, 12);
+        out = text(mnemonic, preg(bits(insn, 3, 0), bits(insn, 23, 22)) + L", " + gpr(sf, bits(insn, 9, 5)) + L", " + gpr(sf, bits(insn, 20, 16)));
+        return true;
+    }
+
+    struct a64_sve_load
+    {
+        const wchar_t* name;
+        uint32_t esize;
+        uint32_t msize;
+    };
+
+    // Indexed by dtype of contiguous loads
+    const a64_sve_load a64_sve_loads[16] = {
+        { L"ld1b", 0, 0 }, { L"ld1b", 1, 0 }, { L"ld1b", 2, 0 }, { L"ld1b", 3, 0 },
+        { L"ld1sw", 3, 2 }, { L"ld1h", 1, 1 }, { L"ld1h", 2, 1 }, { L"ld1h", 3, 1 },
+        { L"ld1sh", 3, 1 }, { L"ld1sh", 2, 1 }, { L"ld1w", 2, 2 }, { L"ld1w", 3, 2 },
+        { L"ld1sb", 3, 0 }, { L"ld1sb", 2, 0 }, { L"ld1sb", 1, 0 }, { L"ld1d", 3, 3 },
+    };
+
+    std::wstring sve_scalar_offset(uint32_t insn, uint32_t msize)
+    {
+        return L"[" + xsp(bits(insn, 9, 5)) + L", " + gpr(true, bits(insn, 20, 16)) + (msize ? L", lsl #" + std::to_wstring(msize) : L"") + L"]";
+    }
+
+    bool fmt_sve_ld1(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        const a64_sve_load& load = a64_sve_loads[bits(insn, 24, 21)];
+        std::wstring operands = L"{ " + zreg(bits(insn, 4, 0), load.esize) + L" }, " + pg(bits(insn, 12, 10), L"/z") + L", ";
+        if (bit(insn, 13))
+            operands += sve_mul_vl(bits(insn, 9, 5), sext(bits(insn, 19, 16), 4));
+        else if (bits(insn, 20, 16) == 31)
+            return false;
+        else
+            operands += sve_scalar_offset(insn, load.msize);
+        out = text(load.name, operands);
+        return true;
+    }
+
+    bool fmt_sve_st1(uint32_t insn, uint64_t, const wchar_t*, std::wstring& out)
+    {
+        static const wchar_t* const names[4] = { L"st1b", L"st1h", L"st1w", L"st1d" };
+        uint32_t msize = bits(insn, 24, 23), esize = bits(insn, 22, 21);
+        if (esize < msize)
+            return false;
+
+        std::wstring operands = L"{ " + zreg(bits(insn, 4, 0), esize) + L" }, " + pg(bits(insn, 12, 10), L"") + L", ";
+        if (bit(insn, 13))
+            operands += sve_mul_vl(bits(insn, 9, 5), sext(bits(insn, 19, 16), 4));
+        else if (bits(insn, 20, 16) == 31)
+            return false;
+        else
+            operands += sve_scalar_offset(insn, msize);
+        out = text(names[msize], operands);
+        return true;
+    }
+
+    // LDR/STR of whole vector or predicate register
+    bool fmt_sve_ldr_str(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        int64_t offset = sext((bits(insn, 21, 16) << 3) | bits(insn, 12, 10), 9);
+        std::wstring reg = (bit(insn, 14) ? L"z" : L"p") + std::to_wstring(bits(insn, 4, 0));
+        out = text(mnemonic, reg + L", " + sve_mul_vl(bits(insn, 9, 5), offset));
+        return true;
+    }
+
+    bool fmt_sve_zzz(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22);
+        out = text(mnemonic, zreg(bits(insn, 4, 0), size) + L", " + zreg(bits(insn, 9, 5), size) + L", " + zreg(bits(insn, 20, 16), size));
+        return true;
+    }
+
+    bool fmt_sve_zzz_fp(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) != 0 && fmt_sve_zzz(insn, address, mnemonic, out);
+    }
+
+    // Unpredicated bitwise operations, ORR of the same register is MOV
+    bool fmt_sve_zzz_d(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t zm = bits(insn, 20, 16), zn = bits(insn, 9, 5), zd = bits(insn, 4, 0);
+        if (bits(insn, 23, 22) == 1 && zn == zm)
+            out = text(L"mov", zreg(zd, 3) + L", " + zreg(zn, 3));
+        else
+            out = text(mnemonic, zreg(zd, 3) + L", " + zreg(zn, 3) + L", " + zreg(zm, 3));
+        return true;
+    }
+
+    // Predicated destructive operation, Zdn = Zdn <op> Zm
+    bool fmt_sve_zpzz(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22), zdn = bits(insn, 4, 0);
+        out = text(mnemonic, zreg(zdn, size) + L", " + pg(bits(insn, 12, 10), L"/m") + L", " + zreg(zdn, size) + L", " + zreg(bits(insn, 9, 5), size));
+        return true;
+    }
+
+    bool fmt_sve_zpzz_fp(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) != 0 && fmt_sve_zpzz(insn, address, mnemonic, out);
+    }
+
+    bool fmt_sve_zpzz_sd(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) >= 2 && fmt_sve_zpzz(insn, address, mnemonic, out);
+    }
+
+    // Predicated multiply-add, Zda = Zda +/- Zn * Zm
+    bool fmt_sve_mla(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22);
+        out = text(mnemonic, zreg(bits(insn, 4, 0), size) + L", " + pg(bits(insn, 12, 10), L"/m") + L", " + zreg(bits(insn, 9, 5), size) + L", " + zreg(bits(insn, 20, 16), size));
+        return true;
+    }
+
+    bool fmt_sve_mla_fp(uint32_t insn, uint64_t address, const wchar_t* mnemonic, std::wstring& out)
+    {
+        return bits(insn, 23, 22) != 0 && fmt_sve_mla(insn, address, mnemonic, out);
+    }
+
+    // CNT<T> and INC<T>/DEC<T> (scalar)
+    bool fmt_sve_count(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, gpr(true, bits(insn, 4, 0)) + sve_count(insn));
+        return true;
+    }
+
+    bool fmt_sve_dup_reg(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22);
+        out = text(mnemonic, zreg(bits(insn, 4, 0), size) + L", " + gpr(size == 3, bits(insn, 9, 5), true));
+        return true;
+    }
+
+    bool fmt_sve_dup_imm(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        uint32_t size = bits(insn, 23, 22), sh = bit(insn, 13);
+        if (sh && size == 0)
+            return false;
+        int64_t value = sext(bits(insn, 12, 5), 8);
+        if (sh && value == 0)
+            out = text(mnemonic, zreg(bits(insn, 4, 0), size) + L", #0, lsl #8");
+        else
+            out = text(mnemonic, zreg(bits(insn, 4, 0), size) + L", " + imm(sh ? value * 256 : value));
+        return true;
+    }
+
+    bool fmt_sve_addvl(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, xsp(bits(insn, 4, 0)) + L", " + xsp(bits(insn, 20, 16)) + L", " + imm(sext(bits(insn, 10, 5), 6)));
+        return true;
+    }
+
+    bool fmt_sve_rdvl(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, gpr(true, bits(insn, 4, 0)) + L", " + imm(sext(bits(insn, 10, 5), 6)));
+        return true;
+    }
+
+    bool fmt_sve_movprfx(uint32_t insn, uint64_t, const wchar_t* mnemonic, std::wstring& out)
+    {
+        out = text(mnemonic, L"z" + std::to_wstring(bits(insn, 4, 0)) + L", z" + std::to_wstring(bits(insn, 9, 5)));
+        return true;
+    }
+
+    // First matching entry with format accepting the instruction wins, keep specific encodings before generic ones
+    const a64_encoding a64_encodings[] = {
+        // Data processing (immediate)
+        { 0x7F800000, 0x11000000, L"add", fmt_addsub_imm },
+        { 0x7F800000, 0x31000000, L"adds", fmt_addsub_imm },
+        { 0x7F800000, 0x51000000, L"sub", fmt_addsub_imm },
+        { 0x7F800000, 0x71000000, L"subs", fmt_addsub_imm },
+        { 0x7F800000, 0x12000000, L"and", fmt_logical_imm },
+        { 0x7F800000, 0x32000000, L"orr", fmt_logical_imm },
+        { 0x7F800000, 0x52000000, L"eor", fmt_logical_imm },
+        { 0x7F800000, 0x72000000, L"ands", fmt_logical_imm },
+        { 0x7F800000, 0x12800000, L"movn", fmt_move_wide },
+        { 0x7F800000, 0x52800000, L"movz", fmt_move_wide },
+        { 0x7F800000, 0x72800000, L"movk", fmt_move_wide },
+        { 0x9F000000, 0x10000000, L"adr", fmt_adr },
+        { 0x9F000000, 0x90000000, L"adrp", fmt_adr },
+        { 0x7F800000, 0x13000000, L"sbfm", fmt_bitfield },
+        { 0x7F800000, 0x33000000, L"bfm", fmt_bitfield },
+        { 0x7F800000, 0x53000000, L"ubfm", fmt_bitfield },
+        { 0x7FA00000, 0x13800000, L"extr", fmt_extr },
+
+        // Branches, exception generation and system
+        { 0xFC000000, 0x14000000, L"b", fmt_branch },
+        { 0xFC000000, 0x94000000, L"bl", fmt_branch },
+        { 0xFF000010, 0x54000000, L"b.", fmt_branch_cond },
+        { 0x7F000000, 0x34000000, L"cbz", fmt_compare_branch },
+        { 0x7F000000, 0x35000000, L"cbnz", fmt_compare_branch },
+        { 0x7F000000, 0x36000000, L"tbz", fmt_test_branch },
+        { 0x7F000000, 0x37000000, L"tbnz", fmt_test_branch },
+        { 0xFFFFFC1F, 0xD61F0000, L"br", fmt_branch_reg },
+        { 0xFFFFFC1F, 0xD63F0000, L"blr", fmt_branch_reg },
+        { 0xFFFFFC1F, 0xD65F0000, L"ret", fmt_branch_reg },
+        { 0xFFFFFFFF, 0xD65F0BFF, L"retaa", fmt_none },
+        { 0xFFFFFFFF, 0xD65F0FFF, L"retab", fmt_none },
+        { 0xFFE0001F, 0xD4000001, L"svc", fmt_exception },
+        { 0xFFE0001F, 0xD4000002, L"hvc", fmt_exception },
+        { 0xFFE0001F, 0xD4000003, L"smc", fmt_exception },
+        { 0xFFE0001F, 0xD4200000, L"brk", fmt_exception },
+        { 0xFFE0001F, 0xD4400000, L"hlt", fmt_exception },
+        { 0xFFFF0000, 0x00000000, L"udf", fmt_udf },
+        { 0xFFFFF01F, 0xD503201F, L"hint", fmt_hint },
+        { 0xFFFFF0FF, 0xD503305F, L"clrex", fmt_barrier },
+        { 0xFFFFF0FF, 0xD503309F, L"dsb", fmt_barrier },
+        { 0xFFFFF0FF, 0xD50330BF, L"dmb", fmt_barrier },
+        { 0xFFFFF0FF, 0xD50330DF, L"isb", fmt_barrier },
+        { 0xFFF00000, 0xD5300000, L"mrs", fmt_mrs },
+        { 0xFFF00000, 0xD5100000, L"msr", fmt_msr },
+
+        // Loads and stores
+        { 0x3F000000, 0x08000000, nullptr, fmt_ldst_exclusive },
+        { 0x3F200C00, 0x38200000, nullptr, fmt_atomic },
+        { 0x3B000000, 0x18000000, nullptr, fmt_ldst_literal },
+        { 0x3A000000, 0x28000000, nullptr, fmt_ldst_pair },
+        { 0x3B000000, 0x39000000, nullptr, fmt_ldst_uimm },
+        { 0x3B200000, 0x38000000, nullptr, fmt_ldst_imm9 },
+        { 0x3B200C00, 0x38200800, nullptr, fmt_ldst_reg },
+
+        // Data processing (register)
+        { 0x7F200000, 0x0A000000, L"and", fmt_logical_shifted },
+        { 0x7F200000, 0x0A200000, L"bic", fmt_logical_shifted },
+        { 0x7F200000, 0x2A000000, L"orr", fmt_logical_shifted },
+        { 0x7F200000, 0x2A200000, L"orn", fmt_logical_shifted },
+        { 0x7F200000, 0x4A000000, L"eor", fmt_logical_shifted },
+        { 0x7F200000, 0x4A200000, L"eon", fmt_logical_shifted },
+        { 0x7F200000, 0x6A000000, L"ands", fmt_logical_shifted },
+        { 0x7F200000, 0x6A200000, L"bics", fmt_logical_shifted },
+        { 0x7F200000, 0x0B000000, L"add", fmt_addsub_shifted },
+        { 0x7F200000, 0x2B000000, L"adds", fmt_addsub_shifted },
+        { 0x7F200000, 0x4B000000, L"sub", fmt_addsub_shifted },
+        { 0x7F200000, 0x6B000000, L"subs", fmt_addsub_shifted },
+        { 0x7FE00000, 0x0B200000, L"add", fmt_addsub_extended },
+        { 0x7FE00000, 0x2B200000, L"adds", fmt_addsub_extended },
+        { 0x7FE00000, 0x4B200000, L"sub", fmt_addsub_extended },
+        { 0x7FE00000, 0x6B200000, L"subs", fmt_addsub_extended },
+        { 0x7FE0FC00, 0x1A000000, L"adc", fmt_addsub_carry },
+        { 0x7FE0FC00, 0x3A000000, L"adcs", fmt_addsub_carry },
+        { 0x7FE0FC00, 0x5A000000, L"sbc", fmt_addsub_carry },
+        { 0x7FE0FC00, 0x7A000000, L"sbcs", fmt_addsub_carry },
+        { 0x7FE00410, 0x3A400000, L"ccmn", fmt_cond_compare },
+        { 0x7FE00410, 0x7A400000, L"ccmp", fmt_cond_compare },
+        { 0x7FE00C00, 0x1A800000, L"csel", fmt_cond_select },
+        { 0x7FE00C00, 0x1A800400, L"csinc", fmt_cond_select },
+        { 0x7FE00C00, 0x5A800000, L"csinv", fmt_cond_select },
+        { 0x7FE00C00, 0x5A800400, L"csneg", fmt_cond_select },
+        { 0x7FE08000, 0x1B000000, L"madd", fmt_dp3 },
+        { 0x7FE08000, 0x1B008000, L"msub", fmt_dp3 },
+        { 0xFFE08000, 0x9B200000, L"smaddl", fmt_dp3_long },
+        { 0xFFE08000, 0x9B208000, L"smsubl", fmt_dp3_long },
+        { 0xFFE08000, 0x9BA00000, L"umaddl", fmt_dp3_long },
+        { 0xFFE08000, 0x9BA08000, L"umsubl", fmt_dp3_long },
+        { 0xFFE0FC00, 0x9B407C00, L"smulh", fmt_dp2 },
+        { 0xFFE0FC00, 0x9BC07C00, L"umulh", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC00800, L"udiv", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC00C00, L"sdiv", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC02000, L"lsl", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC02400, L"lsr", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC02800, L"asr", fmt_dp2 },
+        { 0x7FE0FC00, 0x1AC02C00, L"ror", fmt_dp2 },
+        { 0x7FFFFC00, 0x5AC00000, L"rbit", fmt_dp1 },
+        { 0x7FFFFC00, 0x5AC00400, L"rev16", fmt_dp1 },
+        { 0xFFFFFC00, 0x5AC00800, L"rev", fmt_dp1 },
+        { 0xFFFFFC00, 0xDAC00800, L"rev32", fmt_dp1 },
+        { 0xFFFFFC00, 0xDAC00C00, L"rev", fmt_dp1 },
+        { 0x7FFFFC00, 0x5AC01000, L"clz", fmt_dp1 },
+        { 0x7FFFFC00, 0x5AC01400, L"cls", fmt_dp1 },
+
+        // Scalar floating point
+        { 0xFF3FFC00, 0x1E204000, L"fmov", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E20C000, L"fabs", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E214000, L"fneg", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E21C000, L"fsqrt", fmt_fp_dp1 },
+        { 0xFF3E7C00, 0x1E224000, L"fcvt", fmt_fp_fcvt },
+        { 0xFF3FFC00, 0x1E244000, L"frintn", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E24C000, L"frintp", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E254000, L"frintm", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E25C000, L"frintz", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E264000, L"frinta", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E274000, L"frintx", fmt_fp_dp1 },
+        { 0xFF3FFC00, 0x1E27C000, L"frinti", fmt_fp_dp1 },
+        { 0xFF20FC00, 0x1E200800, L"fmul", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E201800, L"fdiv", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E202800, L"fadd", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E203800, L"fsub", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E204800, L"fmax", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E205800, L"fmin", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E206800, L"fmaxnm", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E207800, L"fminnm", fmt_fp_dp2 },
+        { 0xFF20FC00, 0x1E208800, L"fnmul", fmt_fp_dp2 },
+        { 0xFF20FC17, 0x1E202000, L"fcmp", fmt_fp_compare },
+        { 0xFF20FC17, 0x1E202010, L"fcmpe", fmt_fp_compare },
+        { 0xFF200C10, 0x1E200400, L"fccmp", fmt_fp_cond_compare },
+        { 0xFF200C10, 0x1E200410, L"fccmpe", fmt_fp_cond_compare },
+        { 0xFF200C00, 0x1E200C00, L"fcsel", fmt_fp_cond_select },
+        { 0xFF201FE0, 0x1E201000, L"fmov", fmt_fp_imm },
+        { 0xFF208000, 0x1F000000, L"fmadd", fmt_fp_dp3 },
+        { 0xFF208000, 0x1F008000, L"fmsub", fmt_fp_dp3 },
+        { 0xFF208000, 0x1F200000, L"fnmadd", fmt_fp_dp3 },
+        { 0xFF208000, 0x1F208000, L"fnmsub", fmt_fp_dp3 },
+        { 0xFFFFFC00, 0x9EAE0000, L"fmov", fmt_fmov_upper },
+        { 0xFFFFFC00, 0x9EAF0000, L"fmov", fmt_fmov_upper },
+        { 0x7F3FFC00, 0x1E200000, L"fcvtns", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E210000, L"fcvtnu", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E220000, L"scvtf", fmt_int_to_fp },
+        { 0x7F3FFC00, 0x1E230000, L"ucvtf", fmt_int_to_fp },
+        { 0x7F3FFC00, 0x1E240000, L"fcvtas", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E250000, L"fcvtau", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E260000, L"fmov", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E270000, L"fmov", fmt_int_to_fp },
+        { 0x7F3FFC00, 0x1E280000, L"fcvtps", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E290000, L"fcvtpu", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E300000, L"fcvtms", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E310000, L"fcvtmu", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E380000, L"fcvtzs", fmt_fp_to_int },
+        { 0x7F3FFC00, 0x1E390000, L"fcvtzu", fmt_fp_to_int },
+
+        // Advanced SIMD three same
+        { 0xBF20FC00, 0x0E200400, L"shadd", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E200400, L"uhadd", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E200C00, L"sqadd", fmt_simd_same },
+        { 0xBF20FC00, 0x2E200C00, L"uqadd", fmt_simd_same },
+        { 0xBF20FC00, 0x0E201400, L"srhadd", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E201400, L"urhadd", fmt_simd_same_bhs },
+        { 0xBFE0FC00, 0x0E201C00, L"and", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x0E601C00, L"bic", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x0EA01C00, L"orr", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x0EE01C00, L"orn", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x2E201C00, L"eor", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x2E601C00, L"bsl", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x2EA01C00, L"bit", fmt_simd_same_b },
+        { 0xBFE0FC00, 0x2EE01C00, L"bif", fmt_simd_same_b },
+        { 0xBF20FC00, 0x0E202C00, L"sqsub", fmt_simd_same },
+        { 0xBF20FC00, 0x2E202C00, L"uqsub", fmt_simd_same },
+        { 0xBF20FC00, 0x0E203400, L"cmgt", fmt_simd_same },
+        { 0xBF20FC00, 0x2E203400, L"cmhi", fmt_simd_same },
+        { 0xBF20FC00, 0x0E203C00, L"cmge", fmt_simd_same },
+        { 0xBF20FC00, 0x2E203C00, L"cmhs", fmt_simd_same },
+        { 0xBF20FC00, 0x0E204400, L"sshl", fmt_simd_same },
+        { 0xBF20FC00, 0x2E204400, L"ushl", fmt_simd_same },
+        { 0xBF20FC00, 0x0E206400, L"smax", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E206400, L"umax", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E206C00, L"smin", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E206C00, L"umin", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E207400, L"sabd", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E207400, L"uabd", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E207C00, L"saba", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E207C00, L"uaba", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E208400, L"add", fmt_simd_same },
+        { 0xBF20FC00, 0x2E208400, L"sub", fmt_simd_same },
+        { 0xBF20FC00, 0x0E208C00, L"cmtst", fmt_simd_same },
+        { 0xBF20FC00, 0x2E208C00, L"cmeq", fmt_simd_same },
+        { 0xBF20FC00, 0x0E209400, L"mla", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E209400, L"mls", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E209C00, L"mul", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E20A400, L"smaxp", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E20A400, L"umaxp", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E20AC00, L"sminp", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x2E20AC00, L"uminp", fmt_simd_same_bhs },
+        { 0xBF20FC00, 0x0E20B400, L"sqdmulh", fmt_simd_same_hs },
+        { 0xBF20FC00, 0x2E20B400, L"sqrdmulh", fmt_simd_same_hs },
+        { 0xBF20FC00, 0x0E20BC00, L"addp", fmt_simd_same },
+        { 0xBFA0FC00, 0x0E20C400, L"fmaxnm", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0EA0C400, L"fminnm", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0E20CC00, L"fmla", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0EA0CC00, L"fmls", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0E20D400, L"fadd", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0EA0D400, L"fsub", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2E20D400, L"faddp", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2EA0D400, L"fabd", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2E20DC00, L"fmul", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0E20E400, L"fcmeq", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2E20E400, L"fcmge", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2EA0E400, L"fcmgt", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0E20F400, L"fmax", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x0EA0F400, L"fmin", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2E20F400, L"fmaxp", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2EA0F400, L"fminp", fmt_simd_same_fp },
+        { 0xBFA0FC00, 0x2E20FC00, L"fdiv", fmt_simd_same_fp },
+
+        // Advanced SIMD two-register miscellaneous and across lanes
+        { 0xBF3FFC00, 0x0E200800, L"rev64", fmt_simd_misc_bhs },
+        { 0xBF3FFC00, 0x2E200800, L"rev32", fmt_simd_misc_bh },
+        { 0xBF3FFC00, 0x0E201800, L"rev16", fmt_simd_misc_b },
+        { 0xBF3FFC00, 0x0E204800, L"cls", fmt_simd_misc_bhs },
+        { 0xBF3FFC00, 0x2E204800, L"clz", fmt_simd_misc_bhs },
+        { 0xBF3FFC00, 0x0E205800, L"cnt", fmt_simd_misc_b },
+        { 0xBFFFFC00, 0x2E205800, L"mvn", fmt_simd_misc_not },
+        { 0xBFFFFC00, 0x2E605800, L"rbit", fmt_simd_misc_not },
+        { 0xBF3FFC00, 0x0E208800, L"cmgt", fmt_simd_misc_zero },
+        { 0xBF3FFC00, 0x2E208800, L"cmge", fmt_simd_misc_zero },
+        { 0xBF3FFC00, 0x0E209800, L"cmeq", fmt_simd_misc_zero },
+        { 0xBF3FFC00, 0x2E209800, L"cmle", fmt_simd_misc_zero },
+        { 0xBF3FFC00, 0x0E20A800, L"cmlt", fmt_simd_misc_zero },
+        { 0xBF3FFC00, 0x0E20B800, L"abs", fmt_simd_misc },
+        { 0xBF3FFC00, 0x2E20B800, L"neg", fmt_simd_misc },
+        { 0xBF3FFC00, 0x0E212800, L"xtn", fmt_simd_misc_narrow },
+        { 0xBFBFFC00, 0x0E218800, L"frintn", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0E219800, L"frintm", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0E21D800, L"scvtf", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0EA0F800, L"fabs", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0EA18800, L"frintp", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0EA19800, L"frintz", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x0EA1B800, L"fcvtzs", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2E218800, L"frinta", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2E219800, L"frintx", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2E21D800, L"ucvtf", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2EA0F800, L"fneg", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2EA19800, L"frinti", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2EA1B800, L"fcvtzu", fmt_simd_misc_fp },
+        { 0xBFBFFC00, 0x2EA1F800, L"fsqrt", fmt_simd_misc_fp },
+        { 0xBF3FFC00, 0x0E303800, L"saddlv", fmt_simd_across_long },
+        { 0xBF3FFC00, 0x2E303800, L"uaddlv", fmt_simd_across_long },
+        { 0xBF3FFC00, 0x0E30A800, L"smaxv", fmt_simd_across },
+        { 0xBF3FFC00, 0x2E30A800, L"umaxv", fmt_simd_across },
+        { 0xBF3FFC00, 0x0E31A800, L"sminv", fmt_simd_across },
+        { 0xBF3FFC00, 0x2E31A800, L"uminv", fmt_simd_across },
+        { 0xBF3FFC00, 0x0E31B800, L"addv", fmt_simd_across },
+        { 0xBFBFFC00, 0x2E30C800, L"fmaxnmv", fmt_simd_across_fp },
+        { 0xBFBFFC00, 0x2EB0C800, L"fminnmv", fmt_simd_across_fp },
+        { 0xBFBFFC00, 0x2E30F800, L"fmaxv", fmt_simd_across_fp },
+        { 0xBFBFFC00, 0x2EB0F800, L"fminv", fmt_simd_across_fp },
+
+        // Advanced SIMD three different
+        { 0xBF20FC00, 0x0E200000, L"saddl", fmt_simd_long },
+        { 0xBF20FC00, 0x2E200000, L"uaddl", fmt_simd_long },
+        { 0xBF20FC00, 0x0E201000, L"saddw", fmt_simd_wide },
+        { 0xBF20FC00, 0x2E201000, L"uaddw", fmt_simd_wide },
+        { 0xBF20FC00, 0x0E202000, L"ssubl", fmt_simd_long },
+        { 0xBF20FC00, 0x2E202000, L"usubl", fmt_simd_long },
+        { 0xBF20FC00, 0x0E203000, L"ssubw", fmt_simd_wide },
+        { 0xBF20FC00, 0x2E203000, L"usubw", fmt_simd_wide },
+        { 0xBF20FC00, 0x0E204000, L"addhn", fmt_simd_narrow },
+        { 0xBF20FC00, 0x0E206000, L"subhn", fmt_simd_narrow },
+        { 0xBF20FC00, 0x0E205000, L"sabal", fmt_simd_long },
+        { 0xBF20FC00, 0x2E205000, L"uabal", fmt_simd_long },
+        { 0xBF20FC00, 0x0E207000, L"sabdl", fmt_simd_long },
+        { 0xBF20FC00, 0x2E207000, L"uabdl", fmt_simd_long },
+        { 0xBF20FC00, 0x0E208000, L"smlal", fmt_simd_long },
+        { 0xBF20FC00, 0x2E208000, L"umlal", fmt_simd_long },
+        { 0xBF20FC00, 0x0E20A000, L"smlsl", fmt_simd_long },
+        { 0xBF20FC00, 0x2E20A000, L"umlsl", fmt_simd_long },
+        { 0xBF20FC00, 0x0E20C000, L"smull", fmt_simd_long },
+        { 0xBF20FC00, 0x2E20C000, L"umull", fmt_simd_long },
+        { 0xBF20FC00, 0x0E20D000, L"sqdmull", fmt_simd_long_hs },
+
+        // Advanced SIMD copy, permute, extract and table lookup
+        { 0x9FE08400, 0x0E000400, nullptr, fmt_simd_copy },
+        { 0xBF20FC00, 0x0E001800, L"uzp1", fmt_simd_same },
+        { 0xBF20FC00, 0x0E002800, L"trn1", fmt_simd_same },
+        { 0xBF20FC00, 0x0E003800, L"zip1", fmt_simd_same },
+        { 0xBF20FC00, 0x0E005800, L"uzp2", fmt_simd_same },
+        { 0xBF20FC00, 0x0E006800, L"trn2", fmt_simd_same },
+        { 0xBF20FC00, 0x0E007800, L"zip2", fmt_simd_same },
+        { 0xBFE08400, 0x2E000000, L"ext", fmt_simd_ext },
+        { 0xBFE09C00, 0x0E000000, L"tbl", fmt_simd_table },
+        { 0xBFE09C00, 0x0E001000, L"tbx", fmt_simd_table },
+
+        // Advanced SIMD modified immediate, shift by immediate and vector by element
+        { 0x9FF80400, 0x0F000400, nullptr, fmt_simd_modified_imm },
+        { 0xBF80FC00, 0x0F000400, L"sshr", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x2F000400, L"ushr", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x0F001400, L"ssra", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x2F001400, L"usra", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x0F002400, L"srshr", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x2F002400, L"urshr", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x2F004400, L"sri", fmt_simd_shift_right },
+        { 0xBF80FC00, 0x0F005400, L"shl", fmt_simd_shift_left },
+        { 0xBF80FC00, 0x2F005400, L"sli", fmt_simd_shift_left },
+        { 0xBF80FC00, 0x0F008400, L"shrn", fmt_simd_shift_narrow },
+        { 0xBF80FC00, 0x0F008C00, L"rshrn", fmt_simd_shift_narrow },
+        { 0xBF80FC00, 0x0F00A400, L"sshll", fmt_simd_shift_long },
+        { 0xBF80FC00, 0x2F00A400, L"ushll", fmt_simd_shift_long },
+        { 0xBF80FC00, 0x0F00E400, L"scvtf", fmt_simd_shift_fixed },
+        { 0xBF80FC00, 0x2F00E400, L"ucvtf", fmt_simd_shift_fixed },
+        { 0xBF80FC00, 0x0F00FC00, L"fcvtzs", fmt_simd_shift_fixed },
+        { 0xBF80FC00, 0x2F00FC00, L"fcvtzu", fmt_simd_shift_fixed },
+        { 0xBF00F400, 0x2F000000, L"mla", fmt_simd_element },
+        { 0xBF00F400, 0x2F004000, L"mls", fmt_simd_element },
+        { 0xBF00F400, 0x0F008000, L"mul", fmt_simd_element },
+        { 0xBF00F400, 0x0F00C000, L"sqdmulh", fmt_simd_element },
+        { 0xBF00F400, 0x0F00D000, L"sqrdmulh", fmt_simd_element },
+        { 0xBF00F400, 0x0F002000, L"smlal", fmt_simd_element_long },
+        { 0xBF00F400, 0x2F002000, L"umlal", fmt_simd_element_long },
+        { 0xBF00F400, 0x0F00A000, L"smull", fmt_simd_element_long },
+        { 0xBF00F400, 0x2F00A000, L"umull", fmt_simd_element_long },
+        { 0xBF00F400, 0x0F001000, L"fmla", fmt_simd_element_fp },
+        { 0xBF00F400, 0x0F005000, L"fmls", fmt_simd_element_fp },
+        { 0xBF00F400, 0x0F009000, L"fmul", fmt_simd_element_fp },
+
+        // Advanced SIMD loads and stores
+        { 0xBFFF0000, 0x0C000000, nullptr, fmt_simd_ldst_multiple },
+        { 0xBFFF0000, 0x0C400000, nullptr, fmt_simd_ldst_multiple },
+        { 0xBFE00000, 0x0C800000, nullptr, fmt_simd_ldst_multiple },
+        { 0xBFE00000, 0x0CC00000, nullptr, fmt_simd_ldst_multiple },
+        { 0xBFFFF000, 0x0D40C000, L"ld1r", fmt_simd_ld1r },
+        { 0xBFE0F000, 0x0DC0C000, L"ld1r", fmt_simd_ld1r },
+        { 0xBFFF2000, 0x0D000000, L"st1", fmt_simd_ldst_lane },
+        { 0xBFFF2000, 0x0D400000, L"ld1", fmt_simd_ldst_lane },
+        { 0xBFE02000, 0x0D800000, L"st1", fmt_simd_ldst_lane },
+        { 0xBFE02000, 0x0DC00000, L"ld1", fmt_simd_ldst_lane },
+
+        // Advanced SIMD scalar
+        { 0xFFE0FC00, 0x5E000400, L"mov", fmt_scalar_dup },
+        { 0xFFFFFC00, 0x5EF1B800, L"addp", fmt_scalar_pair },
+        { 0xFFBFFC00, 0x7E30D800, L"faddp", fmt_scalar_pair },
+        { 0xFFE0FC00, 0x5EE08400, L"add", fmt_scalar_same_d },
+        { 0xFFE0FC00, 0x7EE08400, L"sub", fmt_scalar_same_d },
+        { 0xFFC0FC00, 0x5F400400, L"sshr", fmt_scalar_shift_d },
+        { 0xFFC0FC00, 0x7F400400, L"ushr", fmt_scalar_shift_d },
+        { 0xFFC0FC00, 0x5F405400, L"shl", fmt_scalar_shift_d },
+
+        // SVE
+        { 0xFF3FFC10, 0x2518E000, L"ptrue", fmt_sve_ptrue },
+        { 0xFF3FFC10, 0x2519E000, L"ptrues", fmt_sve_ptrue },
+        { 0xFFFFFFF0, 0x2518E400, L"pfalse", fmt_sve_pfalse },
+        { 0xFF20FC10, 0x25200400, L"whilelt", fmt_sve_while },
+        { 0xFF20EC10, 0x25200410, L"whilele", fmt_sve_while },
+        { 0xFF20EC10, 0x25200C00, L"whilelo", fmt_sve_while },
+        { 0xFF20EC10, 0x25200C10, L"whilels", fmt_sve_while },
+        { 0xFFC0E000, 0x85804000, L"ldr", fmt_sve_ldr_str },
+        { 0xFFC0E010, 0x85800000, L"ldr", fmt_sve_ldr_str },
+        { 0xFFC0E000, 0xE5804000, L"str", fmt_sve_ldr_str },
+        { 0xFFC0E010, 0xE5800000, L"str", fmt_sve_ldr_str },
+        { 0xFE00E000, 0xA4004000, nullptr, fmt_sve_ld1 },
+        { 0xFE10E000, 0xA400A000, nullptr, fmt_sve_ld1 },
+        { 0xFE00E000, 0xE4004000, nullptr, fmt_sve_st1 },
+        { 0xFE10E000, 0xE400E000, nullptr, fmt_sve_st1 },
+        { 0xFF20FC00, 0x04200000, L"add", fmt_sve_zzz },
+        { 0xFF20FC00, 0x04200400, L"sub", fmt_sve_zzz },
+        { 0xFF20FC00, 0x04201000, L"sqadd", fmt_sve_zzz },
+        { 0xFF20FC00, 0x04201400, L"uqadd", fmt_sve_zzz },
+        { 0xFF20FC00, 0x04201800, L"sqsub", fmt_sve_zzz },
+        { 0xFF20FC00, 0x04201C00, L"uqsub", fmt_sve_zzz },
+        { 0xFFE0FC00, 0x04203000, L"and", fmt_sve_zzz_d },
+        { 0xFFE0FC00, 0x04603000, L"orr", fmt_sve_zzz_d },
+        { 0xFFE0FC00, 0x04A03000, L"eor", fmt_sve_zzz_d },
+        { 0xFFE0FC00, 0x04E03000, L"bic", fmt_sve_zzz_d },
+        { 0xFF3FE000, 0x04000000, L"add", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04010000, L"sub", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04030000, L"subr", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04080000, L"smax", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04090000, L"umax", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x040A0000, L"smin", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x040B0000, L"umin", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x040C0000, L"sabd", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x040D0000, L"uabd", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04100000, L"mul", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04120000, L"smulh", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04130000, L"umulh", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04140000, L"sdiv", fmt_sve_zpzz_sd },
+        { 0xFF3FE000, 0x04150000, L"udiv", fmt_sve_zpzz_sd },
+        { 0xFF3FE000, 0x04160000, L"sdivr", fmt_sve_zpzz_sd },
+        { 0xFF3FE000, 0x04170000, L"udivr", fmt_sve_zpzz_sd },
+        { 0xFF3FE000, 0x04180000, L"orr", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x04190000, L"eor", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x041A0000, L"and", fmt_sve_zpzz },
+        { 0xFF3FE000, 0x041B0000, L"bic", fmt_sve_zpzz },
+        { 0xFF20E000, 0x04004000, L"mla", fmt_sve_mla },
+        { 0xFF20E000, 0x04006000, L"mls", fmt_sve_mla },
+        { 0xFFF0FC00, 0x0420E000, L"cntb", fmt_sve_count },
+        { 0xFFF0FC00, 0x0460E000, L"cnth", fmt_sve_count },
+        { 0xFFF0FC00, 0x04A0E000, L"cntw", fmt_sve_count },
+        { 0xFFF0FC00, 0x04E0E000, L"cntd", fmt_sve_count },
+        { 0xFFF0FC00, 0x0430E000, L"incb", fmt_sve_count },
+        { 0xFFF0FC00, 0x0430E400, L"decb", fmt_sve_count },
+        { 0xFFF0FC00, 0x0470E000, L"inch", fmt_sve_count },
+        { 0xFFF0FC00, 0x0470E400, L"dech", fmt_sve_count },
+        { 0xFFF0FC00, 0x04B0E000, L"incw", fmt_sve_count },
+        { 0xFFF0FC00, 0x04B0E400, L"decw", fmt_sve_count },
+        { 0xFFF0FC00, 0x04F0E000, L"incd", fmt_sve_count },
+        { 0xFFF0FC00, 0x04F0E400, L"decd", fmt_sve_count },
+        { 0xFFE0F800, 0x04205000, L"addvl", fmt_sve_addvl },
+        { 0xFFE0F800, 0x04605000, L"addpl", fmt_sve_addvl },
+        { 0xFFFFF800, 0x04BF5000, L"rdvl", fmt_sve_rdvl },
+        { 0xFFFFFC00, 0x0420BC00, L"movprfx", fmt_sve_movprfx },
+        { 0xFF3FFC00, 0x05203800, L"mov", fmt_sve_dup_reg },
+        { 0xFF3FC000, 0x2538C000, L"mov", fmt_sve_dup_imm },
+        { 0xFF20FC00, 0x65000000, L"fadd", fmt_sve_zzz_fp },
+        { 0xFF20FC00, 0x65000400, L"fsub", fmt_sve_zzz_fp },
+        { 0xFF20FC00, 0x65000800, L"fmul", fmt_sve_zzz_fp },
+        { 0xFF3FE000, 0x65008000, L"fadd", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65018000, L"fsub", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65028000, L"fmul", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65038000, L"fsubr", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65048000, L"fmaxnm", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65058000, L"fminnm", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65068000, L"fmax", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65078000, L"fmin", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x65088000, L"fabd", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x650C8000, L"fdivr", fmt_sve_zpzz_fp },
+        { 0xFF3FE000, 0x650D8000, L"fdiv", fmt_sve_zpzz_fp },
+        { 0xFF20E000, 0x65200000, L"fmla", fmt_sve_mla_fp },
+        { 0xFF20E000, 0x65202000, L"fmls", fmt_sve_mla_fp },
+        { 0xFF20E000, 0x65204000, L"fnmla", fmt_sve_mla_fp },
+        { 0xFF20E000, 0x65206000, L"fnmls", fmt_sve_mla_fp },
+    };
+}
+
+std::wstring a64_decode(uint32_t insn, uint64_t address)
+{
+    std::wstring out;
+    for (const auto& encoding : a64_encodings)
+        if ((insn & encoding.mask) == encoding.value && encoding.format(insn, address, encoding.mnemonic, out))
+            return out;
+
+    wchar_t buf[24];
+    swprintf(buf, sizeof(buf) / sizeof(buf[0]), L"0x%08x", insn);
+    return text(L".inst", buf);
+}
@@ -142,7 +142,7 @@ namespace ArgParser {
             L"sample",
             { L"" },
             L"Sampling mode, for determining the frequencies of event occurrences produced by program locations at the function, basic block, and /or instruction levels.",
-            L"wperf sample [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config] [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock] [--sample-display-row] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble]",
+            L"wperf sample [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config] [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock] [--sample-display-row] [--sample-copy] [--sample-ring-size] [--spe-memory] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble] [--disassemble-llvm]",
             COMMAND_CLASS::SAMPLE,
             {
                 L"> wperf sample -e ld_spec:100000 --pe_file python_d.exe -c 1 Sample event `ld_spec` with frequency `100000` already running process `python_d.exe` on core #1. Press Ctrl + C to stop sampling and see the results.",
@@ -152,7 +152,7 @@ namespace ArgParser {
             L"record",
             { L"" },
             L"Same as sample but also automatically spawns the process and pins it to the core specified by `-c`. Process name is defined by COMMAND.User can pass verbatim arguments to the process with[ARGS].",
-            L"wperf record [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config] [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock] [--sample-display-row] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble] --COMMAND[ARGS]",
+            L"wperf record [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config] [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock] [--sample-display-row] [--sample-copy] [--sample-ring-size] [--spe-memory] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble] [--disassemble-llvm] --COMMAND[ARGS]",
             COMMAND_CLASS::RECORD,
             {
                 L"> wperf record -e ld_spec:100000 -c 1 --timeout 30 -- python_d.exe -c 10**10**100 Launch `python_d.exe - c 10 * *10 * *100` process and start sampling event `ld_spec` with frequency `100000` on core #1 for 30 seconds. Hint: add `--annotate` or `--disassemble` to `wperf record` command line parameters to increase sampling \"resolution\"."
@@ -165,7 +165,7 @@ namespace ArgParser {
             L"stat",
             { L"" },
             L"Counting mode, for obtaining aggregate counts of occurrences of special events.",
-            L"wperf stat [-e] [-m] [-t] [-i] [-n] [-c] [-C] [-E] [-k] [--dmc] [-q] [--json] [--output][--config] [--force-lock] --COMMAND[ARGS]",
+            L"wperf stat [-e] [-m] [-t] [--timeline-binary] [-i] [-n] [-c] [-C] [-E] [-k] [--dmc] [-q] [--json] [--output][--config] [--force-lock] --COMMAND[ARGS]",
             COMMAND_CLASS::STAT,
             {
                 L"> wperf stat -e inst_spec,vfp_spec,ase_spec,ld_spec -c 0 --timeout 3 Count events `inst_spec`, `vfp_spec`, `ase_spec` and `ld_spec` on core #0 for 3 seconds.",
@@ -223,6 +223,18 @@ namespace ArgParser {
             L"Quiet mode, no output is produced.",
             {}
         );
+        arg_parser_arg_opt sample_copy_opt = arg_parser_arg_opt::arg_parser_arg_opt(
+            L"--sample-copy",
+            {},
+            L"Read samples with `PMU_CTL_SAMPLE_GET` copies instead of mapping driver sample ring into `wperf`.",
+            {}
+        );
+        arg_parser_arg_opt spe_memory_opt = arg_parser_arg_opt::arg_parser_arg_opt(
+            L"--spe-memory",
+            {},
+            L"Print SPE memory access latency profile of sampled loads and stores after sampling report.",
+            {}
+        );
         arg_parser_arg_opt annotate_opt = arg_parser_arg_opt::arg_parser_arg_opt(
             L"--annotate",
             {},
@@ -235,12 +247,24 @@ namespace ArgParser {
             L"Enable disassemble output on sampling mode. Implies 'annotate'.",
             {}
         );
+        arg_parser_arg_opt disassembly_llvm_opt = arg_parser_arg_opt::arg_parser_arg_opt(
+            L"--disassemble-llvm",
+            {},
+            L"Same as 'disassemble' but disassemble with LLVM's `llvm-objdump` (must be on PATH) instead of built-in decoder.",
+            {}
+        );
         arg_parser_arg_opt timeline_opt = arg_parser_arg_opt::arg_parser_arg_opt(
             L"-t",
             {},
             L"Enable timeline mode (count multiple times with specified interval). Use `-i` to specify timeline interval, and `-n` to specify number of counts.",
             {}
         );
+        arg_parser_arg_opt timeline_binary_opt = arg_parser_arg_opt::arg_parser_arg_opt(
+            L"--timeline-binary",
+            {},
+            L"Write timeline in compact binary format (.wtl) instead of CSV. Only with timeline `-t`.",
+            {}
+        );
 
 
 #pragma endregion
@@ -257,7 +281,7 @@ namespace ArgParser {
         arg_parser_arg_pos cores_arg = arg_parser_arg_pos::arg_parser_arg_pos(
             L"-c",
             { L"--cores" },
-            L"Specify comma separated list of CPU cores, and or ranges of CPU cores, to count on, or one CPU to sample on.",
+            L"Specify comma separated list of CPU cores, and or ranges of CPU cores, to count or sample on. SPE sampling supports only one CPU.",
             {}
         );
 
@@ -285,6 +309,12 @@ namespace ArgParser {
             L"Set how many samples you want to see in the summary (50 by default).",
             { L"50" }
         );
+        arg_parser_arg_pos sample_ring_size_arg = arg_parser_arg_pos::arg_parser_arg_pos(
+            L"--sample-ring-size",
+            {},
+            L"Set capacity, in samples, of each driver sample ring mapped into `wperf` (rounded up to a power of two, 1024 to 65536).",
+            {}
+        );
         arg_parser_arg_pos pe_file_arg = arg_parser_arg_pos::arg_parser_arg_pos(
             L"--pe_file",
             {},
@@ -315,6 +345,12 @@ namespace ArgParser {
             L"Provide customized config file which describes custom events or provide custom events from the command line.",
             {}
         );
+        arg_parser_arg_pos event_weight_arg = arg_parser_arg_pos::arg_parser_arg_pos(
+            L"--event-weight",
+            {},
+            L"Specify comma separated list of <event>:<weight> pairs. When events are multiplexed an event with weight 2 is counted twice as often as an event with default weight 1. Weight range is 1-64.",
+            {}
+        );
         arg_parser_arg_pos output_filename_arg = arg_parser_arg_pos::arg_parser_arg_pos(
             L"--output",
             { L"-o" },
@@ -327,6 +363,12 @@ namespace ArgParser {
             L"Specify CSV output filename. Only with timeline `-t`.",
             {}
         );
+        arg_parser_arg_pos output_ndjson_filename_arg = arg_parser_arg_pos::arg_parser_arg_pos(
+            L"--output-ndjson",
+            {},
+            L"Stream counting results of each interval to NDJSON file, one JSON object per core and interval. Use `-` for standard output. Enables timeline mode.",
+            {}
+        );
         arg_parser_arg_pos output_prefix_arg = arg_parser_arg_pos::arg_parser_arg_pos(
             L"--output-prefix",
             { L"--cwd" },
@@ -395,21 +437,28 @@ namespace ArgParser {
            &sample_display_long_opt,
            &verbose_opt,
            &quite_opt,
+           &sample_copy_opt,
+           &spe_memory_opt,
            &annotate_opt,
            &disassembly_opt,
+           &disassembly_llvm_opt,
            &timeline_opt,
+           &timeline_binary_opt,
            &cores_arg,
            &timeout_arg,
            &symbol_arg,
            &record_spawn_delay_arg,
            &sample_display_row_arg,
+           &sample_ring_size_arg,
            &pe_file_arg,
            &image_name_arg,
            &pdb_file_arg,
            &metric_config_arg,
            &event_config_arg,
+           &event_weight_arg,
            &output_filename_arg,
            &output_csv_filename_arg,
+           &output_ndjson_filename_arg,
            &output_prefix_arg,
            &config_arg,
            &interval_arg,
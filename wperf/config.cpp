@@ -42,6 +42,7 @@ namespace drvconfig {
 
         // Read-write configuration values
         data[std::wstring(L"count.period")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RW, std::wstring(L"ms") };
+        data[std::wstring(L"count.period_adaptive")] = { 0, DRVCONFIG_RW, std::wstring(L"") };  // Driver shortens `count.period` for large multiplexed event sets
 
         // Read-only configuration values
         data[std::wstring(L"count.period_max")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RO, std::wstring(L"ms") };
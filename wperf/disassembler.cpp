@@ -29,6 +29,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "disassembler.h"
+#include "a64_decoder.h"
+#include "pe_file.h"
 
 DWORD WINAPI ReadStdOut(LPVOID lpParam)
 {
@@ -111,14 +113,11 @@ VOID Disassembler::Spawn(const std::wstring& command)
     }
 }
 
-VOID Disassembler::Disassemble(const std::wstring& target)
+VOID Disassembler::Run(const std::wstring& commandline)
 {
     DWORD threadId;
-    std::wstringstream commandline;
-
-    commandline << m_command << TEXT(" ") << m_commandLine << TEXT(" ") << target;
 
-    Spawn(commandline.str());
+    Spawn(commandline);
 
     m_processOutput.clear();
     m_thread = CreateThread(NULL, 0, ReadStdOut, (LPVOID)this, 0, &threadId);
@@ -128,26 +127,49 @@ VOID Disassembler::Disassemble(const std::wstring& target)
     }
 
     WaitForSingleObject(m_piProcInfo.hProcess, INFINITE);
+
+    // Child is gone, close our copy of its stdout so reader thread drains the pipe and sees ERROR_BROKEN_PIPE
+    CloseHandle(m_hChildStd_OUT_Wr);
+    m_hChildStd_OUT_Wr = NULL;
+    WaitForSingleObject(m_thread, INFINITE);
+
+    Close();
+}
+
+VOID Disassembler::Disassemble(const std::wstring& target)
+{
+    std::wstringstream commandline;
+
+    commandline << m_command << TEXT(" ") << m_commandLine << TEXT(" ") << target;
+
+    Run(commandline.str());
 }
 
 VOID Disassembler::Disassemble(uint64_t from, uint64_t to, const std::wstring& target)
 {
-    DWORD threadId;
     std::wstringstream commandline;
 
     commandline << m_command << L" " << m_commandLine << L" " <<
         m_commandLineFrom << L"0x" << std::hex << from << L" " << m_commandLineTo << L"0x" << to << L" " << target;
 
-    //std::wcout << commandline.str() << std::endl;
+    Run(commandline.str());
+}
 
-    Spawn(commandline.str());
+BOOL A64Disassembler::Disassemble(const std::wstring& target, uint64_t from, uint64_t to, std::vector<DisassembledInstruction>& source)
+{
+    // A64 instructions are 4 bytes long and aligned
+    from &= ~3ull;
+    to = (to + 3) & ~3ull;
 
-    m_processOutput.clear();
-    m_thread = CreateThread(NULL, 0, ReadStdOut, (LPVOID)this, 0, &threadId);
-    if (m_thread == NULL)
+    std::vector<uint8_t> code;
+    if (!read_pe_section_data(target, from, to, code))
+        return false;
+
+    for (size_t i = 0; i + 4 <= code.size(); i += 4)
     {
-        throw std::exception("Error creating thread");
+        uint32_t insn = code[i] | (code[i + 1] << 8) | (code[i + 2] << 16) | (static_cast<uint32_t>(code[i + 3]) << 24);
+        source.push_back(DisassembledInstruction{ from + i, insn, a64_decode(insn, from + i) });
     }
 
-    WaitForSingleObject(m_piProcInfo.hProcess, INFINITE);
+    return true;
 }
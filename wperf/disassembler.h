@@ -103,6 +103,7 @@ class Disassembler
     }
 
     VOID Spawn(const std::wstring& command);
+    VOID Run(const std::wstring& commandline);     // Spawn `commandline`, wait for it and collect all its output
 public:
     Disassembler(const std::wstring& cmd,
         const std::wstring& cmdline,
@@ -111,15 +112,12 @@ public:
 
     VOID Close()
     {
-        CloseHandle(m_piProcInfo.hProcess);
-        CloseHandle(m_piProcInfo.hThread);
-
-        CloseHandle(m_hChildStd_OUT_Wr);
-        CloseHandle(m_hChildStd_OUT_Rd);
-        CloseHandle(m_hChildStd_IN_Wr);
-        CloseHandle(m_hChildStd_IN_Rd);
-
-        if (m_thread) CloseHandle(m_thread);
+        for (HANDLE* handle : { &m_piProcInfo.hProcess, &m_piProcInfo.hThread,
+            &m_hChildStd_OUT_Wr, &m_hChildStd_OUT_Rd, &m_hChildStd_IN_Wr, &m_hChildStd_IN_Rd, &m_thread })
+        {
+            if (*handle) CloseHandle(*handle);
+            *handle = NULL;
+        }
     }
 
     VOID Disassemble(const std::wstring& target);
@@ -135,8 +133,7 @@ public:
             return false;
         }
 
-        CloseHandle(m_piProcInfo.hProcess);
-        CloseHandle(m_piProcInfo.hThread);
+        Close();
 
         return true;
     }
@@ -205,3 +202,11 @@ public:
         }
     }
 };
+
+// Built-in disassembler, decodes A64 instructions straight from image section bytes without spawning `llvm-objdump`
+class A64Disassembler
+{
+public:
+    // Disassemble image relative range [from, to) of `target`, instruction addresses are image relative
+    static BOOL Disassemble(const std::wstring& target, uint64_t from, uint64_t to, std::vector<DisassembledInstruction>& source);
+};
@@ -0,0 +1,240 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "disassembly_cache.h"
+
+#define DISASSEMBLY_CACHE_MAGIC     "WPDASM02"
+
+bool disassembly_cache::covered(const image& img, uint64_t from, uint64_t to)
+{
+    auto it = img.ranges.upper_bound(from);
+    if (it == img.ranges.begin())
+        return false;
+    --it;
+    return it->second >= to;
+}
+
+void disassembly_cache::add_range(image& img, uint64_t from, uint64_t to)
+{
+    // Merge with overlapping and adjacent ranges
+    auto it = img.ranges.upper_bound(from);
+    if (it != img.ranges.begin() && std::prev(it)->second >= from)
+        --it;
+
+    while (it != img.ranges.end() && it->first <= to)
+    {
+        from = (std::min)(from, it->first);
+        to = (std::max)(to, it->second);
+        it = img.ranges.erase(it);
+    }
+    img.ranges[from] = to;
+}
+
+bool disassembly_cache::attach(const std::wstring& target, const std::wstring& cache_file, uint32_t timestamp)
+{
+    image& img = m_images[target];
+    if (!img.cache_file.empty())
+        return true;
+
+    img.cache_file = cache_file;
+    img.timestamp = timestamp;
+
+    // Image without timestamp can't be told apart from its rebuilt version
+    if (!timestamp)
+        return false;
+
+    return read_file(img, cache_file, timestamp);
+}
+
+std::vector<DisassembledInstruction> disassembly_cache::get(const std::wstring& target, uint64_t base, uint64_t from, uint64_t to,
+    uint64_t hint_from, uint64_t hint_to)
+{
+    image& img = m_images[target];
+
+    if (!covered(img, from, to))
+    {
+        hint_from = (std::min)(hint_from, from);
+        hint_to = (std::max)(hint_to, to);
+
+        std::vector<DisassembledInstruction> out;
+        bool ok = m_disassemble(target, base, hint_from + base, hint_to + base, out);
+        m_disassembler_runs++;
+
+        // Range which failed is not cached, next lookup retries it
+        if (!ok)
+        {
+            std::vector<DisassembledInstruction> result;
+            for (auto& insn : out)
+                if (insn.m_address >= from && insn.m_address < to)
+                    result.push_back(insn);
+            return result;
+        }
+
+        for (auto& insn : out)
+            img.insns[insn.m_address] = insn;
+        add_range(img, hint_from, hint_to);
+        img.dirty = true;
+    }
+
+    std::vector<DisassembledInstruction> result;
+    for (auto it = img.insns.lower_bound(from); it != img.insns.end() && it->first < to; ++it)
+        result.push_back(it->second);
+    return result;
+}
+
+void disassembly_cache::save()
+{
+    for (auto& [target, img] : m_images)
+        if (img.dirty && img.timestamp && !img.cache_file.empty() && write_file(img))
+            img.dirty = false;
+}
+
+/* Cache file layout, all integers little endian:
+
+    char[8]     DISASSEMBLY_CACHE_MAGIC
+    uint32_t    image timestamp
+    uint32_t    disassembler backend, `disassembly_cache::backend`
+    uint32_t    number of ranges, followed by { uint64_t from, to } for each range
+    uint32_t    number of instructions, followed for each instruction by
+                { uint64_t address, instruction; uint32_t size; char text[size] (UTF-8) }
+*/
+bool disassembly_cache::read_file(image& img, const std::wstring& cache_file, uint32_t timestamp) const
+{
+    std::ifstream in(cache_file, std::ios::binary | std::ios::ate);
+    if (!in.is_open())
+        return false;
+
+    // Counts and sizes are checked against bytes left in the file before anything is allocated
+    const std::streamoff file_size = in.tellg();
+    in.seekg(0);
+    auto remaining = [&]() -> uint64_t {
+        const std::streamoff pos = in.tellg();
+        return pos >= 0 && pos <= file_size ? static_cast<uint64_t>(file_size - pos) : 0;
+    };
+
+    char magic[8] = { 0 };
+    uint32_t file_timestamp = 0, file_backend = 0, count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&file_timestamp), sizeof(file_timestamp));
+    in.read(reinterpret_cast<char*>(&file_backend), sizeof(file_backend));
+    if (!in || memcmp(magic, DISASSEMBLY_CACHE_MAGIC, sizeof(magic)) || file_timestamp != timestamp
+        || file_backend != static_cast<uint32_t>(m_backend))
+        return false;
+
+    // Any failure is a cache miss, image is disassembled again
+    try
+    {
+        image loaded;
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in || uint64_t(count) * 2 * sizeof(uint64_t) > remaining())
+            return false;
+
+        for (uint32_t i = 0; i < count && in; i++)
+        {
+            uint64_t range[2] = { 0 };
+            in.read(reinterpret_cast<char*>(range), sizeof(range));
+            add_range(loaded, range[0], range[1]);
+        }
+
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in || uint64_t(count) * (2 * sizeof(uint64_t) + sizeof(uint32_t)) > remaining())
+            return false;
+
+        for (uint32_t i = 0; i < count && in; i++)
+        {
+            uint64_t fields[2] = { 0 };
+            uint32_t size = 0;
+            in.read(reinterpret_cast<char*>(fields), sizeof(fields));
+            in.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (!in || size > remaining())
+                return false;
+
+            std::string text(size, '\0');
+            in.read(text.data(), size);
+
+            DisassembledInstruction insn;
+            insn.m_address = static_cast<DWORD_PTR>(fields[0]);
+            insn.m_instruction = static_cast<DWORD_PTR>(fields[1]);
+            insn.m_asm = WideStringFromMultiByte(text.c_str());
+            loaded.insns[insn.m_address] = insn;
+        }
+
+        // Truncated or damaged file, disassemble again
+        if (!in)
+            return false;
+
+        img.insns.swap(loaded.insns);
+        img.ranges.swap(loaded.ranges);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+
+    img.dirty = false;
+    return true;
+}
+
+bool disassembly_cache::write_file(const image& img) const
+{
+    std::ofstream out(img.cache_file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    uint32_t count = static_cast<uint32_t>(img.ranges.size());
+    uint32_t file_backend = static_cast<uint32_t>(m_backend);
+    out.write(DISASSEMBLY_CACHE_MAGIC, 8);
+    out.write(reinterpret_cast<const char*>(&img.timestamp), sizeof(img.timestamp));
+    out.write(reinterpret_cast<const char*>(&file_backend), sizeof(file_backend));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& [from, to] : img.ranges)
+    {
+        uint64_t range[2] = { from, to };
+        out.write(reinterpret_cast<const char*>(range), sizeof(range));
+    }
+
+    count = static_cast<uint32_t>(img.insns.size());
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& [address, insn] : img.insns)
+    {
+        uint64_t fields[2] = { insn.m_address, insn.m_instruction };
+        std::string text = MultiByteFromWideString(insn.m_asm.c_str());
+        uint32_t size = static_cast<uint32_t>(text.size());
+        out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(text.data(), size);
+    }
+
+    return static_cast<bool>(out);
+}
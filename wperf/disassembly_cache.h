@@ -0,0 +1,96 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <windows.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "disassembler.h"
+
+/* Address indexed cache of disassembled instructions, one per image.
+
+   Annotation asks for instructions of every sampled source line. Instead of
+   running the disassembler for each line, a miss disassembles the whole
+   hint range (e.g. all lines of the hot symbol) once and following lookups
+   are served from the cache. Images can be attached to a cache file which is
+   reused by the next run while image timestamp and disassembler backend do
+   not change. Addresses are image relative, the same as
+   `LineNumberDesc::virtualAddress`.
+*/
+class disassembly_cache
+{
+public:
+    // Disassembler producing cached instructions, cache files of other backend are not reused
+    enum class backend : uint32_t
+    {
+        builtin = 1,        // `A64Disassembler`, image relative addresses
+        llvm_objdump = 2,   // `llvm-objdump`, addresses masked with 0xFFFFFF
+    };
+
+    // Disassemble absolute range [from, to) of `target` loaded at `base` into `out`, returns false if code can't be read
+    typedef std::function<bool(const std::wstring& target, uint64_t base, uint64_t from, uint64_t to, std::vector<DisassembledInstruction>& out)> disassemble_fn;
+
+    disassembly_cache(backend kind, disassemble_fn disassemble) : m_backend(kind), m_disassemble(disassemble) {}
+
+    // Load cache file of `target` if it was created for image with `timestamp` by the same backend, cache is saved to it by `save()`
+    bool attach(const std::wstring& target, const std::wstring& cache_file, uint32_t timestamp);
+
+    // Instructions of image relative range [from, to) of `target` loaded at `base`, on miss [hint_from, hint_to) is disassembled as well
+    std::vector<DisassembledInstruction> get(const std::wstring& target, uint64_t base, uint64_t from, uint64_t to,
+        uint64_t hint_from, uint64_t hint_to);
+
+    // Write attached images with new instructions to their cache files
+    void save();
+
+    size_t disassembler_runs() const { return m_disassembler_runs; }
+
+private:
+    struct image
+    {
+        std::map<uint64_t, DisassembledInstruction> insns;  // [address] -> instruction
+        std::map<uint64_t, uint64_t> ranges;                // [from] -> to, disjoint disassembled ranges
+        std::wstring cache_file;
+        uint32_t timestamp = 0;
+        bool dirty = false;
+    };
+
+    static bool covered(const image& img, uint64_t from, uint64_t to);
+    static void add_range(image& img, uint64_t from, uint64_t to);
+    bool read_file(image& img, const std::wstring& cache_file, uint32_t timestamp) const;
+    bool write_file(const image& img) const;
+
+    backend m_backend;
+    disassemble_fn m_disassemble;
+    std::map<std::wstring, image> m_images;     // [target] -> image
+    size_t m_disassembler_runs = 0;
+};
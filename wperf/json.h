@@ -29,6 +29,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <map>
@@ -38,6 +39,34 @@
 #include "outpututil.h"
 #include "utils.h"
 
+// Write `str` as contents of JSON string: quotes, backslashes and control characters are escaped
+template <typename CharType>
+void WriteJSONEscaped(std::basic_ostream<CharType>& os, const std::basic_string<CharType>& str)
+{
+    size_t last = 0;
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        const CharType c = str[i];
+        if (c != '"' && c != '\\' && static_cast<std::make_unsigned_t<CharType>>(c) >= 0x20)
+            continue;
+
+        os.write(str.data() + last, i - last);
+        last = i + 1;
+        switch (c)
+        {
+        case '"': os << LITERALCONSTANTS_GET("\\\""); break;
+        case '\\': os << LITERALCONSTANTS_GET("\\\\"); break;
+        case '\n': os << LiteralConstants<CharType>::m_newline_escaped; break;
+        case '\t': os << LiteralConstants<CharType>::m_tab_escaped; break;
+        case '\r': os << LITERALCONSTANTS_GET("\\r"); break;
+        default:
+            os << LITERALCONSTANTS_GET("\\u00") << LITERALCONSTANTS_GET("0123456789abcdef")[(c >> 4) & 0xF]
+                << LITERALCONSTANTS_GET("0123456789abcdef")[c & 0xF];
+        }
+    }
+    os.write(str.data() + last, str.size() - last);
+}
+
 /* 
 The JSON implementation bases itself on the JSON definition from JavaScript where it is defined as a dictionary with keys and values.
 The values themselves can be either arrays, raw values or recursively contain JSON Objects. Each key/value pair is defined as a 
@@ -86,7 +115,9 @@ public:
             }
             StringType newKey(key);
             std::replace(newKey.begin(), newKey.end(), ' ', '_');
-            os << LiteralConstants<CharType>::m_quotes << newKey << LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon;
+            os << LiteralConstants<CharType>::m_quotes;
+            WriteJSONEscaped(os, newKey);
+            os << LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon;
             if constexpr(isContainer)
             {
                 os << LiteralConstants<CharType>::m_bracket_open;
@@ -105,7 +136,10 @@ public:
                         os << LiteralConstants<CharType>::m_quotes;
                     }
 
-                    os << cv;
+                    if constexpr (std::is_same_v<std::decay_t<decltype(cv)>, StringType>)
+                        WriteJSONEscaped(os, cv);
+                    else
+                        os << cv;
 
                     if constexpr(std::is_same_v<ValueType, StringType> || std::is_same_v<ValueType, char> || std::is_same_v<ValueType, wchar_t>)
                     {
@@ -120,19 +154,7 @@ public:
                     }
 
                     if constexpr (std::is_same_v<ValueType, StringType>)
-                    {
-                        // Escape new lines '\n' with '\\n'
-                        StringType val_no_n = ReplaceAllTokensInString(val,
-                            StringType(LiteralConstants<CharType>::m_newline),
-                            StringType(LiteralConstants<CharType>::m_newline_escaped));
-
-                        // Escape tabs '\t' with '\\t'
-                        StringType val_no_nt = ReplaceAllTokensInString(val_no_n,
-                            StringType(LiteralConstants<CharType>::m_tab),
-                            StringType(LiteralConstants<CharType>::m_tab_escaped));
-
-                        os << val_no_nt;    // No tabs and newlines in JSON string
-                    }
+                        WriteJSONEscaped(os, val);
                     else
                         os << val;
 
@@ -364,3 +386,146 @@ public:
         return os;
     }
 };
+
+/*
+JSONWriter is a streaming (SAX style) JSON writer. Tokens are written to the output stream as soon as they are produced
+and strings are escaped one value at a time, so a document is never built in memory before it is written. Commas between
+object members and array elements are inserted by the writer. Tables are written with `Raw()`, as a value or, when
+embedded (`TableJSON::m_isEmbedded`), as members of the current object. Compact writer puts the whole document on one line.
+*/
+template <typename CharType>
+class JSONWriter
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+
+    OutputStream& m_os;
+    std::vector<bool> m_isFirst;    // One entry for each open object and array
+    bool m_hasKey = false;          // Key was written, its value follows
+    bool m_compact = false;         // No new lines and spaces between tokens
+
+    void Separator()
+    {
+        if (m_hasKey)
+        {
+            m_hasKey = false;
+            return;
+        }
+
+        if (!m_isFirst.empty())
+        {
+            if (!m_isFirst.back())
+            {
+                m_os << LiteralConstants<CharType>::m_comma;
+                if (!m_compact)
+                    m_os << LiteralConstants<CharType>::m_newline;
+            }
+            m_isFirst.back() = false;
+        }
+    }
+
+    void Quoted(const StringType& str)
+    {
+        m_os << LiteralConstants<CharType>::m_quotes;
+        WriteJSONEscaped(m_os, str);
+        m_os << LiteralConstants<CharType>::m_quotes;
+    }
+
+public:
+    explicit JSONWriter(OutputStream& os, bool compact = false) : m_os(os), m_compact(compact) {}
+
+    void BeginObject()
+    {
+        Separator();
+        m_os << LiteralConstants<CharType>::m_cbracket_open;
+        if (!m_compact)
+            m_os << LiteralConstants<CharType>::m_newline;
+        m_isFirst.push_back(true);
+    }
+
+    void EndObject()
+    {
+        m_isFirst.pop_back();
+        if (!m_compact)
+            m_os << LiteralConstants<CharType>::m_newline;
+        m_os << LiteralConstants<CharType>::m_cbracket_close;
+    }
+
+    void BeginArray()
+    {
+        Separator();
+        m_os << LiteralConstants<CharType>::m_bracket_open;
+        m_isFirst.push_back(true);
+    }
+
+    void EndArray()
+    {
+        m_isFirst.pop_back();
+        m_os << LiteralConstants<CharType>::m_bracket_close;
+    }
+
+    void Key(const StringType& key)
+    {
+        Separator();
+        Quoted(key);
+        m_os << LiteralConstants<CharType>::m_colon;
+        if (!m_compact)
+            m_os << LiteralConstants<CharType>::m_space;
+        m_hasKey = true;
+    }
+
+    void String(const StringType& value)
+    {
+        Separator();
+        Quoted(value);
+    }
+
+    void Bool(bool value)
+    {
+        Separator();
+        m_os << (value ? LITERALCONSTANTS_GET("true") : LITERALCONSTANTS_GET("false"));
+    }
+
+    template <typename T>
+    void Number(T value)
+    {
+        Separator();
+        m_os << value;
+    }
+
+    // Number with fixed `precision` digits after the decimal point, stream formatting is left unchanged
+    void Number(double value, int precision)
+    {
+        Separator();
+        const auto flags = m_os.flags();
+        const auto old_precision = m_os.precision();
+        m_os << std::fixed << std::setprecision(precision) << value;
+        m_os.flags(flags);
+        m_os.precision(old_precision);
+    }
+
+    // Already serialized JSON, e.g. `TableJSON`
+    template <typename T>
+    void Raw(const T& json)
+    {
+        Separator();
+        m_os << json;
+    }
+
+    template <typename T>
+    void Member(const StringType& key, const T& value)
+    {
+        Key(key);
+        if constexpr (std::is_same_v<T, bool>)
+            Bool(value);
+        else if constexpr (std::is_convertible_v<T, StringType>)
+            String(value);
+        else
+            Number(value);
+    }
+
+    void Flush()
+    {
+        m_os.flush();
+    }
+};
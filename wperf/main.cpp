@@ -42,6 +42,9 @@
 #include "output.h"
 #include "exception.h"
 #include "pe_file.h"
+#include "sample_aggregator.h"
+#include "spe_memory_profile.h"
+#include "symbol_resolver.h"
 #include "process_api.h"
 #include "events.h"
 #include "pmu_device.h"
@@ -50,6 +53,7 @@
 #include "config.h"
 #include "perfdata.h"
 #include "disassembler.h"
+#include "disassembly_cache.h"
 
 static bool no_ctrl_c = true;
 
@@ -74,6 +78,130 @@ static BOOL WINAPI ctrl_handler(DWORD dwCtrlType)
     }
 }
 
+// Per-CPU sample counts of one sampled event, `event_cpus` maps CPU to its sample count
+static TableOutput<SamplingCPUOutputTraits<GlobalCharType>, GlobalCharType> build_cpus_table(const std::map<uint32_t, uint64_t>& event_cpus)
+{
+    TableOutput<SamplingCPUOutputTraits<GlobalCharType>, GlobalCharType> cpus_table(m_outputType);
+    cpus_table.PresetHeaders();
+
+    std::vector<uint32_t> col_cpu;
+    std::vector<uint64_t> col_cpu_count;
+    for (const auto& [cpu, count] : event_cpus)
+    {
+        col_cpu.push_back(cpu);
+        col_cpu_count.push_back(count);
+    }
+    cpus_table.Insert(col_cpu, col_cpu_count);
+    return cpus_table;
+}
+
+// Fill SPE memory profile tables of sampling JSON, at most `rows` rows per table
+static void build_spe_memory_tables(const spe_memory_profile& profile, uint32_t rows)
+{
+    auto& json = m_globalSamplingJSON;
+    json.m_has_spe_memory = true;
+
+    {
+        const auto& total = profile.total();
+        std::vector<std::wstring> col_latency;
+        std::vector<uint64_t> col_samples;
+        std::vector<double> col_percent;
+        for (uint32_t i = 0; i < SPE_LATENCY_BUCKETS; i++)
+        {
+            if (total.histogram[i] == 0)
+                continue;
+            const uint32_t lo = spe_memory_profile::latency_stats::bucket_min(i);
+            const uint32_t hi = spe_memory_profile::latency_stats::bucket_max(i);
+            col_latency.push_back(lo == hi ? std::to_wstring(lo) : std::to_wstring(lo) + L"-" + std::to_wstring(hi));
+            col_samples.push_back(total.histogram[i]);
+            col_percent.push_back((double)total.histogram[i] * 100 / (double)total.latency_samples);
+        }
+        json.m_spe_memory_histogram = TableOutput<SpeMemoryHistogramOutputTraits<GlobalCharType>, GlobalCharType>(m_outputType);
+        json.m_spe_memory_histogram.PresetHeaders();
+        json.m_spe_memory_histogram.SetAlignment(1, ColumnAlignL::RIGHT);
+        json.m_spe_memory_histogram.SetAlignment(2, ColumnAlignL::RIGHT);
+        json.m_spe_memory_histogram.Insert(col_latency, col_samples, col_percent);
+    }
+
+    auto latency_table = [rows](auto& table, const auto& stats, auto name) {
+        std::vector<std::wstring> col_name;
+        std::vector<uint64_t> col_samples;
+        std::vector<double> col_avg, col_l1d_miss, col_llc_miss;
+        std::vector<uint32_t> col_p50, col_p90, col_p99, col_max;
+        for (const auto& [key, s] : stats)
+        {
+            if (col_name.size() == rows)
+                break;
+            col_name.push_back(name(key));
+            col_samples.push_back(s.samples);
+            col_avg.push_back(s.latency_avg());
+            col_p50.push_back(s.latency_percentile(0.50));
+            col_p90.push_back(s.latency_percentile(0.90));
+            col_p99.push_back(s.latency_percentile(0.99));
+            col_max.push_back(s.latency_max);
+            col_l1d_miss.push_back((double)s.l1d_miss * 100 / (double)s.samples);
+            col_llc_miss.push_back((double)s.llc_miss * 100 / (double)s.samples);
+        }
+        table = std::remove_reference_t<decltype(table)>(m_outputType);
+        table.PresetHeaders();
+        for (int i = 1; i < 9; i++)
+            table.SetAlignment(i, ColumnAlignL::RIGHT);
+        table.Insert(col_name, col_samples, col_avg, col_p50, col_p90, col_p99, col_max, col_l1d_miss, col_llc_miss);
+    };
+
+    auto as_is = [](const std::wstring& key) { return key; };
+    auto page_addr = [](uint64_t page) { return IntToHexWideString(page << SPE_PAGE_SHIFT, 16); };
+    latency_table(json.m_spe_memory_symbols, profile.by_symbol(), as_is);
+    latency_table(json.m_spe_memory_lines, profile.by_source_line(), as_is);
+    latency_table(json.m_spe_memory_pages, profile.by_page(), page_addr);
+    latency_table(json.m_spe_memory_sources, profile.by_data_source(), as_is);
+
+    {
+        std::vector<std::wstring> col_line;
+        std::vector<uint64_t> col_samples, col_total, col_peer;
+        std::vector<double> col_avg;
+        std::vector<uint32_t> col_max, col_pcs;
+        for (const auto& [line, s] : profile.by_cache_line())
+        {
+            if (col_line.size() == rows)
+                break;
+            col_line.push_back(IntToHexWideString(line << SPE_CACHE_LINE_SHIFT, 16));
+            col_samples.push_back(s.samples);
+            col_total.push_back(s.latency_sum);
+            col_avg.push_back(s.latency_avg());
+            col_max.push_back(s.latency_max);
+            col_peer.push_back(s.peer_hits);
+            col_pcs.push_back(static_cast<uint32_t>(s.pcs.size()));
+        }
+        json.m_spe_memory_cache_lines = TableOutput<SpeMemoryCacheLineOutputTraits<GlobalCharType>, GlobalCharType>(m_outputType);
+        json.m_spe_memory_cache_lines.PresetHeaders();
+        for (int i = 1; i < 7; i++)
+            json.m_spe_memory_cache_lines.SetAlignment(i, ColumnAlignL::RIGHT);
+        json.m_spe_memory_cache_lines.Insert(col_line, col_samples, col_total, col_avg, col_max, col_peer, col_pcs);
+    }
+}
+
+static void print_spe_memory_tables(const spe_memory_profile& profile)
+{
+    auto& json = m_globalSamplingJSON;
+    const auto& total = profile.total();
+
+    m_out.GetOutputStream() << std::endl << L"======================== SPE memory access latency: "
+        << std::dec << total.samples << L" accesses, avg " << DoubleToWideString(total.latency_avg())
+        << L" cycles ========================" << std::endl;
+    m_out.Print(json.m_spe_memory_histogram);
+    m_out.GetOutputStream() << std::endl << L"by symbol:" << std::endl;
+    m_out.Print(json.m_spe_memory_symbols);
+    m_out.GetOutputStream() << std::endl << L"by source line:" << std::endl;
+    m_out.Print(json.m_spe_memory_lines);
+    m_out.GetOutputStream() << std::endl << L"by data page:" << std::endl;
+    m_out.Print(json.m_spe_memory_pages);
+    m_out.GetOutputStream() << std::endl << L"by data source:" << std::endl;
+    m_out.Print(json.m_spe_memory_sources);
+    m_out.GetOutputStream() << std::endl << L"top contended cache lines:" << std::endl;
+    m_out.Print(json.m_spe_memory_cache_lines);
+}
+
 int __cdecl
 wmain(
     _In_ const int argc,
@@ -167,7 +295,10 @@ wmain(
             pmu_device.get_product_groups_metrics_names(),
             pmu_events::extra_events);
         pmu_device.do_verbose = request.do_verbose;
+        pmu_device.sample_mapped = !request.do_sample_copy;
+        pmu_device.sample_ring_size = request.sample_ring_size;
         pmu_device.timeline_output_file = request.timeline_output_file;
+        pmu_device.timeline_binary = request.do_timeline_binary;
         pmu_device.m_sampling_with_spe = request.m_sampling_with_spe;
         pmu_device.m_sampling_flags = request.m_sampling_flags;
     }
@@ -301,6 +432,11 @@ wmain(
 
             pmu_device.timeline_header(request.ioctl_events);
 
+            ndjson_stream ndjson;
+            uint64_t ndjson_interval = 0;
+            if (request.ndjson_output_file.size() && !ndjson.open(request.ndjson_output_file))
+                throw fatal_exception("Unable to open NDJSON output file");
+
             int64_t counting_duration_iter = request.count_duration > 0 ?
                 static_cast<int64_t>(request.count_duration * 10) : _I64_MAX;
 
@@ -337,14 +473,47 @@ wmain(
                 spawned_process = true;
             }
 
-            do
+            if (request.do_timeline)
+            {
+                m_globalTimelineJSON.m_count_duration = request.count_duration;
+                m_globalTimelineJSON.m_count_interval = request.count_interval;
+                m_globalTimelineJSON.m_count_timeline = request.count_timeline;
+                m_out.BeginTimeline(m_globalTimelineJSON);
+            }
+
+            // Core events only: read counters while they keep counting instead of stopping and restarting
+            // them every interval. With no sleep between timeline intervals next interval starts where
+            // previous one ended, so nothing is lost in between.
+            const bool live = enable_bits == CTL_FLAG_CORE && pmu_device.core_events_live_probe();
+            const bool live_gap_free = request.do_timeline && counting_interval_iter == 0;
+            SYSTEMTIME live_timestamp = { 0 };
+            bool live_continued = false;
+
+            if (live)
             {
                 pmu_device.reset(enable_bits);
+                pmu_device.start(enable_bits);
+            }
 
+            do
+            {
                 SYSTEMTIME timestamp_a;
-                GetSystemTime(&timestamp_a);
 
-                pmu_device.start(enable_bits);
+                if (!live)
+                {
+                    pmu_device.reset(enable_bits);
+                    GetSystemTime(&timestamp_a);
+                    pmu_device.start(enable_bits);
+                }
+                else if (live_continued)
+                {
+                    timestamp_a = live_timestamp;
+                }
+                else
+                {
+                    pmu_device.core_events_read_live();
+                    GetSystemTime(&timestamp_a);
+                }
 
                 m_out.GetOutputStream() << L"counting ... -";
 
@@ -366,16 +535,32 @@ wmain(
                 }
                 m_out.GetOutputStream() << L'\b' << "done\n";
 
-                pmu_device.stop(enable_bits);
+                if (live)
+                    pmu_device.core_events_read_live();
+                else
+                    pmu_device.stop(enable_bits);
 
                 SYSTEMTIME timestamp_b;
                 GetSystemTime(&timestamp_b);
 
+                live_timestamp = timestamp_b;
+                live_continued = live_gap_free;
+
                 if (enable_bits & CTL_FLAG_CORE)
                 {
-                    pmu_device.core_events_read();
+                    if (!live)
+                        pmu_device.core_events_read();
+
+                    // Metrics are evaluated once per interval, for NDJSON and the metrics table
+                    std::vector<const struct product_metric*> metrics;
+                    std::vector<double> metric_values;
+                    pmu_device.core_metrics_evaluate(request.ioctl_events[EVT_CORE], metrics, metric_values);
+
+                    if (ndjson.is_open())
+                        pmu_device.print_core_ndjson(request.ioctl_events[EVT_CORE], metrics, metric_values, ndjson, ++ndjson_interval,
+                            timestamps_to_duration(timestamp_a, timestamp_b));
                     pmu_device.print_core_stat(request.ioctl_events[EVT_CORE]);
-                    pmu_device.print_core_metrics(request.ioctl_events[EVT_CORE]);
+                    pmu_device.print_core_metrics(metrics, metric_values);
                 }
 
                 if (enable_bits & CTL_FLAG_DSU)
@@ -416,13 +601,11 @@ wmain(
                     if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
                         m_out.Print(m_globalJSON);
 
-                m_globalTimelineJSON.m_timelineWperfStat.push_back(m_globalJSON);
-                m_globalTimelineJSON.m_count_duration = request.count_duration;
-                m_globalTimelineJSON.m_count_interval = request.count_interval;
-                m_globalTimelineJSON.m_count_timeline = request.count_timeline;
-
                 if (request.do_timeline)
+                {
+                    m_out.PrintTimelineInterval(m_globalTimelineJSON, m_globalJSON);
                     m_globalJSON = WPerfStatJSON<GlobalCharType>();
+                }
 
                 if (counting_timeline_times > 0)
                 {
@@ -436,6 +619,9 @@ wmain(
 
             } while (request.do_timeline && no_ctrl_c);
 
+            if (live)
+                pmu_device.stop(enable_bits);
+
             if (do_count_process_spawn)
             {
                 TerminateProcess(pi.hProcess, 0);
@@ -445,7 +631,7 @@ wmain(
             }
 
             if (request.do_timeline)
-                m_out.Print(m_globalTimelineJSON);
+                m_out.EndTimeline(m_globalTimelineJSON);
         }
         else if (request.do_sample || request.do_record)
         {
@@ -487,7 +673,8 @@ wmain(
                 m_out.GetOutputStream() << std::endl << std::endl;
             }
 
-            if (request.do_disassembly)
+            const bool disasm_llvm = request.do_disassembly_llvm;
+            if (disasm_llvm)
             {
                 if (!disassembler.CheckCommand())
                 {
@@ -499,10 +686,6 @@ wmain(
             HardwareInformation hardwareInformation{ 0 };
             GetHardwareInfo(hardwareInformation);
             
-            PerfDataWriter perfDataWriter;
-            if (request.do_export_perf_data)
-                perfDataWriter.WriteCommandLine(argc, argv);
-
             if (SetConsoleCtrlHandler(&ctrl_handler, TRUE) == FALSE)
                 throw fatal_exception("SetConsoleCtrlHandler failed for sampling");
 
@@ -512,8 +695,9 @@ wmain(
             if (request.sample_pdb_file == L"")
                 throw fatal_exception("PDB file not specified");
 
-            if (request.cores_idx.size() > 1)
-                throw fatal_exception("you can specify only one core for sampling");
+            // Software sampling drains each core's sample ring separately, SPE uses one core's buffer
+            if (request.m_sampling_with_spe && request.cores_idx.size() > 1)
+                throw fatal_exception("you can specify only one core for sampling with SPE");
 
             m_globalSamplingJSON.m_pe_file = request.sample_pe_file;
             m_globalSamplingJSON.m_pdb_file = request.sample_pdb_file;
@@ -534,11 +718,18 @@ wmain(
                 pmu_device.set_sample_src(request.ioctl_events_sample, request.do_kernel);
             }
 
+            // Create perf.data only when all sampling inputs are valid, so errors above do not leave a truncated file
+            PerfDataWriter perfDataWriter;
             if (request.do_export_perf_data)
             {
+                perfDataWriter.WriteCommandLine(argc, argv);
+                perfDataWriter.WriteCpuInfo(hardwareInformation.m_fullProcessorCount, hardwareInformation.m_fullProcessorCount, pmu_device.get_product_name_ext());
+                perfDataWriter.Open();
+
                 for (auto& events_sample : request.ioctl_events_sample)
                 {
-                    perfDataWriter.RegisterSampleEvent(events_sample.index);
+                    perfDataWriter.RegisterSampleEvent(events_sample.index, events_sample.interval,
+                        pmu_events::get_event_name(static_cast<uint16_t>(events_sample.index)));
                 }
             }
 
@@ -560,7 +751,8 @@ wmain(
                 pid = GetProcessId(pi.hProcess);
                 process_handle = pi.hProcess;
 
-                if (!SetAffinity(hardwareInformation, pid, request.cores_idx[0]))
+                // Pin workload only when sampling one core, with more cores let the scheduler place it
+                if (request.cores_idx.size() == 1 && !SetAffinity(hardwareInformation, pid, request.cores_idx[0]))
                 {
                     TerminateProcess(pi.hProcess, 0);
                     CloseHandle(pi.hThread);
@@ -731,6 +923,7 @@ wmain(
             SYSTEMTIME timestamp_b;
             
             std::vector<FrameChain> raw_samples;
+            std::vector<std::pair<size_t, UINT64>> raw_sample_times;   // (end of batch in `raw_samples`, time batch was read), perf.data time of frames without `timestamp`
             {
                 DWORD image_exit_code = 0;
 
@@ -770,6 +963,7 @@ wmain(
                                 m_out.GetOutputStream() << L".";
                             else
                                 m_out.GetOutputStream() << L"e";
+                            raw_sample_times.push_back(std::make_pair(raw_samples.size(), PerfDataWriter::GetTimestamp()));
                         }
                     }
 
@@ -811,6 +1005,7 @@ wmain(
             CloseHandle(process_handle);
 
             std::map<UINT64, std::wstring> spe_event_map;
+            std::vector<struct spe_record> spe_records;
 
             if(request.m_sampling_with_spe && pmu_device.m_has_spe)
             {
@@ -828,102 +1023,96 @@ wmain(
                     m_out.GetErrorOutputStream() << "Error trying to open spe.data file!" << std::endl;
                 }
 
-                spe_device::get_samples(pmu_device.m_spe_buffer, raw_samples, spe_event_map);
-            }
+                spe_device::decode_records_parallel(pmu_device.m_spe_buffer.data(), pmu_device.m_spe_buffer.size(), spe_records);
+                spe_device::get_samples(spe_records, raw_samples, spe_event_map);
+                for (auto& frame : raw_samples)
+                    frame.cpu = request.cores_idx[0];
 
-            std::vector<SampleDesc> resolved_samples;
+                if (request.do_export_perf_data)
+                    for (const auto& [spe_event, spe_event_name] : spe_event_map)
+                        perfDataWriter.RegisterSampleEvent(spe_event, 1, spe_event_name);
+            }
 
-            for (const auto& a : raw_samples)
+            // SPE buffer is decoded after sampling, its samples have no `timestamp` and get time of last read
+            raw_sample_times.push_back(std::make_pair(raw_samples.size(), PerfDataWriter::GetTimestamp()));
+
+            std::map<uint32_t, uint32_t> sample_periods;    // [event_src] -> sampling interval
+            for (const auto& events_sample : request.ioctl_events_sample)
+                sample_periods[events_sample.index] = events_sample.interval;
+            size_t raw_sample_batch = 0;
+
+            // Index image symbols and symbols of modules loaded with image (such as DLLs) once.
+            // Note: at this point:
+            //  `dll_metadata` contains names of all modules loaded with image (executable)
+            //  `modules_metadata` contains e.g. symbols of image modules loaded which had
+            //                     PDB files present and we were able to load them.
+            symbol_resolver resolver;
+            resolver.add_image(sym_info, sec_info, image_base + runtime_vaddr_delta);
+            for (const auto& [key, value] : dll_metadata)
+                if (modules_metadata.count(key))
+                    resolver.add_module(key, modules_metadata[key], value.sec_info);
+            resolver.build();
+
+            // SPE memory access profile, records are grouped by location of their PC
+            spe_memory_profile spe_profile;
+            if (spe_records.size() && request.do_spe_memory)
             {
-                bool found = false;
-                SampleDesc sd;
-                uint64_t sec_base = 0;
-
-                // Search in symbol table for image (executable)
-                for (const auto& b : sym_info)
+                std::unordered_map<UINT64, std::pair<std::wstring, std::wstring>> locations;   // [pc] -> (symbol, source line)
+                for (const auto& rec : spe_records)
                 {
-                    for (const auto& c : sec_info)
+                    auto loc = locations.find(rec.pc);
+                    if (loc == locations.end())
                     {
-                        assert(b.sec_idx);
-                        if (c.idx == (b.sec_idx - 1))
+                        const symbol_resolver::symbol* sym = resolver.resolve(rec.pc);
+                        std::wstring symbol = sym ? sym->proto.desc.name : L"unknown";
+                        std::wstring source_line = symbol;
+                        if (sym)
                         {
-                            sec_base = image_base + c.offset + runtime_vaddr_delta;
-                            break;
+                            // Source lines are image relative, `delta` is the runtime base of image containing `rec.pc`
+                            const UINT64 delta = sym->proto.module ? (UINT64)sym->proto.module->handle : image_base + runtime_vaddr_delta;
+                            const ULONGLONG addr = rec.pc - delta;
+                            for (const auto& line : sym->proto.desc.lines)
+                                if (line.virtualAddress <= addr && line.virtualAddress + line.length > addr)
+                                {
+                                    source_line = line.source_file + L":" + std::to_wstring(line.lineNum);
+                                    break;
+                                }
                         }
+                        loc = locations.emplace(rec.pc, std::make_pair(symbol, source_line)).first;
                     }
-
-                    if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                    {
-                        sd.desc = b;
-                        sd.module = 0;
-                        found = true;
-                        if (request.do_verbose)
-                            m_out.GetOutputStream() << "symbol found:\t"
-                                << std::hex
-                                    << L"\t" << L"0x" << (b.offset + sec_base)
-                                    << L"\t" << L"0x" << sd.desc.sec_idx
-                                    << L"\t" << L"0x" << sd.desc.offset
-                                    << L"\t" << L"0x" << sd.desc.size
-                            << L"\t" << sd.desc.sname << L"\t" << sd.desc.name
-                            << std::endl;
-                        break;
-                    }
+                    spe_profile.add(rec, loc->second.first, loc->second.second);
                 }
+                build_spe_memory_tables(spe_profile, request.sample_display_row);
+            }
 
-                // Nothing was found in base images, let's search inside modules loaded with
-                // images (such as DLLs).
-                // Note: at this point:
-                //  `dll_metadata` contains names of all modules loaded with image (executable)
-                //  `modules_metadata` contains e.g. symbols of image modules loaded which had
-                //                     PDB files present and we were able to load them.
-                if (!found)
-                {
-                    sec_base = 0;
-
-                    for (const auto& [key, value] : dll_metadata)
-                    {
-                        if (modules_metadata.count(key))
-                        {
-                            ModuleMetaData& mmd = modules_metadata[key];
+            sample_aggregator aggregator;
+            SampleDesc unknown_sd;
+            unknown_sd.desc.name = L"unknown";
 
-                            for (auto& b : mmd.sym_info)
-                                for (const auto& c : value.sec_info)
-                                    {
-                                        if (!b.sec_idx) // We may not be able to decode all symbols at this time, so we skip
-                                            continue;
+            for (const auto& a : raw_samples)
+            {
+                const size_t raw_sample_idx = &a - raw_samples.data();
+                while (raw_sample_times[raw_sample_batch].first <= raw_sample_idx)
+                    raw_sample_batch++;
 
-                                        if (c.idx == (b.sec_idx - 1))
-                                        {
-                                            sec_base = (UINT64)mmd.handle + c.offset;
-                                            break;
-                                        }
-                                    }
+                const symbol_resolver::symbol* sym = resolver.resolve(a.pc);
+                const SampleDesc& sd = sym ? sym->proto : unknown_sd;
 
-                            for (const auto& b : mmd.sym_info)
-                                if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                                {
-                                    sd.desc = b;
-                                    sd.desc.name = b.name + L":" + key;
-                                    sd.desc.sname = b.name;
-                                    sd.module = &mmd;
-                                    found = true;
-                                    if (request.do_verbose)
-                                        m_out.GetOutputStream() << "symbol found:\t"
-                                            << std::hex
-                                                << L"\t" << L"0x" << (b.offset + sec_base)
-                                                << L"\t" << L"0x" << sd.desc.sec_idx
-                                                << L"\t" << L"0x" << sd.desc.offset
-                                                << L"\t" << L"0x" << sd.desc.size
-                                        << L"\t" << sd.desc.sname << L"\t" << sd.desc.name
-                                        << L"\t" << sd.module->mod_name << std::endl;
-                                    break;
-                                }
-                        }
-                    }
+                if (sym && request.do_verbose)
+                {
+                    m_out.GetOutputStream() << "symbol found:\t"
+                        << std::hex
+                            << L"\t" << L"0x" << sym->start
+                            << L"\t" << L"0x" << sd.desc.sec_idx
+                            << L"\t" << L"0x" << sd.desc.offset
+                            << L"\t" << L"0x" << sd.desc.size
+                        << L"\t" << sd.desc.sname << L"\t" << sd.desc.name;
+                    if (sd.module)
+                        m_out.GetOutputStream() << L"\t" << sd.module->mod_name;
+                    m_out.GetOutputStream() << std::endl;
                 }
 
-                if (!found)
-                    sd.desc.name = L"unknown";
+                const uint32_t sym_id = aggregator.intern(sd);
 
                 /* `counter_idx_unmap` carries all the information we need to translate GPCs to event numbers.
                 *    We just loop through it, which represents available GPCs.
@@ -943,7 +1132,6 @@ wmain(
                         spe_gone = true;
                     }
 
-                    bool inserted = false;
                     uint32_t event_src;
                     if(!request.m_sampling_with_spe)
                     {
@@ -955,41 +1143,22 @@ wmain(
                         event_src = a.spe_event_idx;
                     }
 
-                    for (auto& c : resolved_samples)
-                    {
-                        if (c.desc.name == sd.desc.name && c.event_src == event_src)
-                        {
-                            c.freq++;
-                            bool pc_found = false;
-                            for (int i = 0; i < c.pc.size(); i++)
-                            {
-                                if (c.pc[i].first == a.pc)
-                                {
-                                    c.pc[i].second += 1;
-                                    pc_found = true;
-                                    break;
-                                }
-                            }
-
-                            if (!pc_found)
-                                c.pc.push_back(std::make_pair(a.pc, 1));
-
-                            inserted = true;
-                            break;
-                        }
-                    }
+                    aggregator.add(sym_id, event_src, a.pc, a.cpu);
 
-                    if (!inserted)
+                    if (request.do_export_perf_data)
                     {
-                        sd.freq = 1;
-                        sd.event_src = event_src;
-                        sd.pc.clear();
-                        sd.pc.push_back(std::make_pair(a.pc, 1));
-                        resolved_samples.push_back(sd);
+                        // Driver stamps every PMI with generic timer, all PMU samples share that clock
+                        const UINT64 timer_freq = pmu_device.sample_summary.timer_freq;
+                        const UINT64 time = a.timestamp && timer_freq ? PerfDataWriter::TicksToTimestamp(a.timestamp, timer_freq)
+                                                                      : raw_sample_times[raw_sample_batch].second;
+                        const auto period = sample_periods.find(event_src);
+                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, a.pc, a.lr, a.cpu, static_cast<UINT64>(event_src),
+                            time, static_cast<UINT64>(period != sample_periods.end() ? period->second : 1));
                     }
                 }
             }
 
+            std::vector<SampleDesc> resolved_samples = aggregator.get_resolved_samples();
             std::sort(resolved_samples.begin(), resolved_samples.end(), sort_samples);
 
             uint32_t prev_evt_src = 0;
@@ -1011,6 +1180,24 @@ wmain(
             }
             total_samples.push_back(acc);
 
+            // Sampled symbols are disassembled once, cache files next to PDB files are reused by following runs.
+            // Code is decoded in-process from image sections, `--disassemble-llvm` runs llvm-objdump instead.
+            disassembly_cache dasm_cache(disasm_llvm ? disassembly_cache::backend::llvm_objdump : disassembly_cache::backend::builtin,
+                [&disassembler, disasm_llvm](const std::wstring& target, uint64_t base, uint64_t from, uint64_t to, std::vector<DisassembledInstruction>& out) {
+                if (disasm_llvm)
+                {
+                    disassembler.Disassemble(from, to, target);
+                    disassembler.ParseOutput(out);
+                    return !out.empty();
+                }
+
+                if (A64Disassembler::Disassemble(target, from - base, to - base, out))
+                    return true;
+
+                m_out.GetErrorOutputStream() << L"warning: can't read code of " << target << L" at 0x" << std::hex << from << std::dec << std::endl;
+                return false;
+            });
+
             int32_t group_idx = -1;
             prev_evt_src = CYCLE_EVT_IDX - 1;
             uint64_t printed_sample_num = 0, printed_sample_freq = 0;
@@ -1023,6 +1210,7 @@ wmain(
                              TableOutput<SamplingAnnotateOutputTraitsL<true>, GlobalCharType>>>> annotateTables;
             std::vector<uint64_t> col_pcs, col_pcs_count;
             std::vector<std::wstring> col_pcs_in_symbol;
+            std::map<uint32_t, uint64_t> event_cpus;    // [cpu] -> count, for all samples of current event
             for (auto &a : resolved_samples)
             {
                 if (a.event_src != prev_evt_src)
@@ -1044,7 +1232,9 @@ wmain(
                         TableOutput<SamplingPCOutputTraits<GlobalCharType>, GlobalCharType> pcs_table(m_outputType);
                         pcs_table.PresetHeaders();
                         pcs_table.Insert(col_pcs, col_pcs_count, col_pcs_in_symbol);
-                        m_globalSamplingJSON.m_map[table.m_event] = std::make_tuple(table, annotateTables, pcs_table);
+                        auto cpus_table = build_cpus_table(event_cpus);
+                        m_globalSamplingJSON.m_map[table.m_event] = std::make_tuple(table, annotateTables, pcs_table, cpus_table);
+                        event_cpus.clear();
                         col_overhead.clear();
                         col_count.clear();
                         col_symbol.clear();
@@ -1079,6 +1269,9 @@ wmain(
                     group_idx++;
                 }
 
+                for (const auto& [pc_cpu, count] : a.pc_cpu)
+                    event_cpus[pc_cpu.second] += count;
+
                 if (printed_sample_num == request.sample_display_row)
                 {
                     const int total_width = PrettyTable<wchar_t>::m_LEFT_MARGIN + PrettyTable<wchar_t>::m_COLUMN_SEPARATOR + static_cast<int>(strlen("overhead"));
@@ -1112,22 +1305,6 @@ wmain(
                     }
                 }
 
-                if (request.do_export_perf_data)
-                {
-                    for (const auto& sample : a.pc)
-                    {
-                        ULONGLONG addr;
-                        if (a.module == NULL)
-                            addr = (sample.first - runtime_vaddr_delta) & 0xFFFFFF;
-                        else
-                        {
-                            UINT64 mod_vaddr_delta = (UINT64)a.module->handle;
-                            addr = (sample.first - mod_vaddr_delta) & 0xFFFFFF;
-                        }
-                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, sample.first, request.cores_idx[0], a.event_src);
-                    }
-                }
-
                 if (request.do_annotate)
                 {
 
@@ -1139,6 +1316,15 @@ wmain(
                     if(a.desc.name != L"unknown")
                     {
                         m_out.GetOutputStream() << a.desc.name << std::endl;
+
+                        // Range of all source lines of symbol, disassembled on first cache miss
+                        uint64_t sym_lines_from = UINT64_MAX, sym_lines_to = 0;
+                        for (const auto& line : a.desc.lines)
+                        {
+                            sym_lines_from = (std::min)(sym_lines_from, static_cast<uint64_t>(line.virtualAddress));
+                            sym_lines_to = (std::max)(sym_lines_to, static_cast<uint64_t>(line.virtualAddress) + line.length);
+                        }
+
                         for (const auto& sample : a.pc)
                         {
                             bool found_line = false;
@@ -1171,8 +1357,12 @@ wmain(
 
                                         if (disassemble_map.find(std::make_tuple(line.virtualAddress, base)) == disassemble_map.end())
                                         {
-                                            disassembler.Disassemble(line.virtualAddress + base, line.virtualAddress + line.length + base, target);
-                                            disassembler.ParseOutput(lineAsm);
+                                            const std::wstring pdb_file = a.module == NULL ? request.sample_pdb_file
+                                                : (dll_metadata.count(a.module->mod_name) ? dll_metadata[a.module->mod_name].pdb_file : L"");
+                                            if (pdb_file.size())
+                                                dasm_cache.attach(target, pdb_file + L".dasm", get_pe_timestamp(target));
+
+                                            lineAsm = dasm_cache.get(target, base, line.virtualAddress, line.virtualAddress + line.length, sym_lines_from, sym_lines_to);
 
                                             for (const auto& inst : lineAsm)
                                             {
@@ -1265,8 +1455,10 @@ wmain(
                 printed_sample_num++;
             }
             
+            dasm_cache.save();
+
             if (request.do_export_perf_data)
-                perfDataWriter.Write();
+                perfDataWriter.Close();
 
             TableOutput<SamplingOutputTraitsL, GlobalCharType> table(m_outputType);
             table.PresetHeaders();
@@ -1284,7 +1476,9 @@ wmain(
             TableOutput<SamplingPCOutputTraits<GlobalCharType>, GlobalCharType> pcs_table(m_outputType);
             pcs_table.PresetHeaders();
             pcs_table.Insert(col_pcs, col_pcs_count, col_pcs_in_symbol);
-            m_globalSamplingJSON.m_map[table.m_event] = std::make_tuple(table, annotateTables, pcs_table);
+
+            auto cpus_table = build_cpus_table(event_cpus);
+            m_globalSamplingJSON.m_map[table.m_event] = std::make_tuple(table, annotateTables, pcs_table, cpus_table);
             m_globalSamplingJSON.m_sample_display_row = request.sample_display_row;
 
             if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
@@ -1304,6 +1498,9 @@ wmain(
                     << std::wstring(PrettyTable<wchar_t>::m_COLUMN_SEPARATOR, L' ') <<  L"top " << std::dec << printed_sample_num << L" in total" << std::endl;
             }
 
+            if (m_globalSamplingJSON.m_has_spe_memory)
+                print_spe_memory_tables(spe_profile);
+
             const double  duration = timestamps_to_duration(timestamp_a, timestamp_b);
             m_globalJSON.m_duration = duration;
 
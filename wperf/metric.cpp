@@ -37,6 +37,11 @@
 #include <sstream>
 #include <vector>
 
+#include <windows.h>
+#include "events.h"
+#include "exception.h"
+#include "metric.h"
+
 
 // Predefined simple metrics
 static std::vector<std::wstring> imix = { L"inst_spec", L"dp_spec", L"vfp_spec", L"ase_spec", L"ld_spec", L"st_spec" };
@@ -143,3 +148,149 @@ double metric_calculate_shunting_yard_expression(const std::map<std::wstring, do
 
     return stack.top();
 }
+
+int metric_program::get_slot(const std::wstring& name) const
+{
+    for (size_t i = 0; i < vars.size(); i++)
+        if (vars[i] == name)
+            return static_cast<int>(i);
+    return -1;
+}
+
+metric_program metric_compile_shunting_yard_expression(const std::wstring& formula_sy)
+{
+    metric_program program;
+    std::wstring token;
+    std::wistringstream ss(formula_sy);
+    size_t depth = 0;
+
+    while (std::getline(ss, token, L' '))
+    {
+        struct metric_program::instr ins = { metric_program::OP_CONST, 0, 0.0 };
+
+        if (metris_token_is_operator(token))
+        {
+            switch (token[0])
+            {
+            case L'*': ins.op = metric_program::OP_MUL; break;
+            case L'/': ins.op = metric_program::OP_DIV; break;
+            case L'+': ins.op = metric_program::OP_ADD; break;
+            case L'-': ins.op = metric_program::OP_SUB; break;
+            }
+
+            if (depth < 2)
+                throw fatal_exception("Invalid metric formula");
+            depth--;
+        }
+        else
+        {
+            if (token.empty())
+                continue;
+
+            if (iswdigit(token[0]) || token[0] == L'.')
+            {
+                ins.value = _wtof(token.c_str());
+            }
+            else
+            {
+                int slot = program.get_slot(token);
+                if (slot < 0)
+                {
+                    slot = static_cast<int>(program.vars.size());
+                    program.vars.push_back(token);
+                }
+
+                ins.op = metric_program::OP_VAR;
+                ins.slot = static_cast<uint32_t>(slot);
+            }
+
+            if (++depth > METRIC_STACK_MAX)
+                throw fatal_exception("Invalid metric formula");
+            program.stack_depth = (std::max)(program.stack_depth, depth);
+        }
+
+        program.code.push_back(ins);
+    }
+
+    if (depth != 1)
+        throw fatal_exception("Invalid metric formula");
+
+    return program;
+}
+
+double metric_evaluate(const metric_program& program, const double* slots)
+{
+    double stack[METRIC_STACK_MAX];
+    size_t top = 0;
+
+    for (const auto& ins : program.code)
+    {
+        switch (ins.op)
+        {
+        case metric_program::OP_CONST: stack[top++] = ins.value; break;
+        case metric_program::OP_VAR: stack[top++] = slots[ins.slot]; break;
+        case metric_program::OP_ADD: top--; stack[top - 1] += stack[top]; break;
+        case metric_program::OP_SUB: top--; stack[top - 1] -= stack[top]; break;
+        case metric_program::OP_MUL: top--; stack[top - 1] *= stack[top]; break;
+        case metric_program::OP_DIV:
+            top--;
+            if (stack[top] == 0)    // To avoid division by zero we return 0
+                return 0;
+            stack[top - 1] /= stack[top];
+            break;
+        }
+    }
+
+    return stack[0];
+}
+
+void metric_evaluate_batch(const metric_program& program, const double* slots, size_t n, double* out, std::vector<double>& scratch)
+{
+    // Stack of `n` wide rows followed by per core "divide by zero" flags
+    scratch.resize((program.stack_depth + 1) * n);
+    double* zero = scratch.data() + program.stack_depth * n;
+    std::fill(zero, zero + n, 0.0);
+
+    double* stack = scratch.data();
+    size_t top = 0;                     // Number of rows on the stack
+
+    for (const auto& ins : program.code)
+    {
+        if (ins.op == metric_program::OP_CONST)
+        {
+            std::fill(stack + top * n, stack + (top + 1) * n, ins.value);
+            top++;
+            continue;
+        }
+
+        if (ins.op == metric_program::OP_VAR)
+        {
+            std::copy(slots + ins.slot * n, slots + (ins.slot + 1) * n, stack + top * n);
+            top++;
+            continue;
+        }
+
+        top--;
+        double* x = stack + (top - 1) * n;
+        const double* y = stack + top * n;
+
+        switch (ins.op)
+        {
+        case metric_program::OP_ADD: for (size_t i = 0; i < n; i++) x[i] += y[i]; break;
+        case metric_program::OP_SUB: for (size_t i = 0; i < n; i++) x[i] -= y[i]; break;
+        case metric_program::OP_MUL: for (size_t i = 0; i < n; i++) x[i] *= y[i]; break;
+        case metric_program::OP_DIV:
+            // Branchless so the loop vectorizes, cores which divided by zero are masked at the end
+            for (size_t i = 0; i < n; i++)
+            {
+                const bool z = y[i] == 0;
+                zero[i] = z ? 1.0 : zero[i];
+                x[i] /= z ? 1.0 : y[i];
+            }
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = zero[i] != 0 ? 0.0 : stack[i];    // To avoid division by zero we return 0
+}
@@ -43,6 +43,7 @@ struct evt_noted
     std::wstring note;          // Human readable string describing event
     int group;                  // Event group number (-1 if not in group)
     std::wstring metric;        // Name of metric, if event is part of metric
+    uint16_t weight = 1;        // Multiplexing share relative to other events, see --event-weight
 };
 
 struct metric_desc
@@ -58,3 +59,31 @@ std::wstring metric_gen_metric_based_on_gpc_num(std::wstring name, uint8_t gpc_n
 // Shunting Yard Algorithm calculation
 bool metris_token_is_operator(const std::wstring op);
 double metric_calculate_shunting_yard_expression(const std::map<std::wstring, double>& vars, const std::wstring& formula_sy);
+
+#define METRIC_STACK_MAX    32      // Max evaluation stack depth of compiled metric formula
+
+// Metric formula (RPN) compiled once to flat bytecode. Variables (event names) are
+// resolved to slots at compile time, evaluation reads slot values from flat array.
+struct metric_program
+{
+    enum op_code : uint8_t { OP_CONST, OP_VAR, OP_ADD, OP_SUB, OP_MUL, OP_DIV };
+
+    struct instr
+    {
+        enum op_code op;
+        uint32_t slot;                  // OP_VAR: index in `vars`
+        double value;                   // OP_CONST: literal value
+    };
+
+    std::vector<struct instr> code;
+    std::vector<std::wstring> vars;     // [slot] -> variable (event) name
+    size_t stack_depth = 0;             // Max evaluation stack depth
+
+    int get_slot(const std::wstring& name) const;   // Returns -1 if `name` is not used by formula
+};
+
+metric_program metric_compile_shunting_yard_expression(const std::wstring& formula_sy);
+double metric_evaluate(const metric_program& program, const double* slots);
+// Evaluate `program` for `n` cores at once. `slots` is [slot][core] matrix (vars.size() rows of `n` values),
+// results are stored in `out[n]`. `scratch` is reused evaluation stack storage.
+void metric_evaluate_batch(const metric_program& program, const double* slots, size_t n, double* out, std::vector<double>& scratch);
@@ -0,0 +1,130 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdio>
+#include <sstream>
+#include <stringapiset.h>
+
+#include "json.h"
+#include "ndjson.h"
+#include "utils.h"
+
+std::wstring ndjson_format(const ndjson_core_record& record)
+{
+    std::wstringstream os;
+    JSONWriter<wchar_t> writer(os, true);
+
+    writer.BeginObject();
+    writer.Member(L"interval", record.interval);
+    writer.Member(L"duration", record.duration);
+    writer.Member(L"core", record.core);
+    writer.Member(L"multiplexing", record.multiplexing);
+    writer.Member(L"kernel_mode", record.kernel_mode);
+    writer.Member(L"round", record.round);
+
+    writer.Key(L"events");
+    writer.BeginArray();
+    for (const auto& event : record.events)
+    {
+        writer.BeginObject();
+        writer.Member(L"event_name", event.name);
+        writer.Member(L"event_idx", event.index);
+        writer.Member(L"event_note", event.note);
+        writer.Member(L"counter_value", event.value);
+        writer.Member(L"scheduled", event.scheduled);
+        writer.Member(L"scaled_value", event.scaled);
+        writer.Member(L"scaled_min", event.scaled_min);
+        writer.Member(L"scaled_max", event.scaled_max);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.Key(L"metrics");
+    writer.BeginArray();
+    for (const auto& metric : record.metrics)
+    {
+        writer.BeginObject();
+        writer.Member(L"metric_name", metric.name);
+        writer.Member(L"value", metric.value);
+        writer.Member(L"unit", metric.unit);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    return os.str();
+}
+
+bool ndjson_stream::open(const std::wstring& filename)
+{
+    close();
+
+    if (filename == L"-")
+    {
+        m_stdout = true;
+        return true;
+    }
+
+    m_file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    return m_file.is_open();
+}
+
+void ndjson_stream::close()
+{
+    if (m_file.is_open())
+        m_file.close();
+    m_stdout = false;
+}
+
+void ndjson_stream::write(const ndjson_core_record& record)
+{
+    // JSON text is UTF-8, names and notes must not go through the ANSI code page
+    const std::wstring json = ndjson_format(record);
+    std::string line;
+    if (json.size())
+    {
+        const int json_size = static_cast<int>(json.size());
+        const int size = WideCharToMultiByte(CP_UTF8, 0, json.data(), json_size, NULL, 0, NULL, NULL);
+        line.resize(size);
+        WideCharToMultiByte(CP_UTF8, 0, json.data(), json_size, line.data(), size, NULL, NULL);
+    }
+    line += '\n';
+
+    if (m_stdout)
+    {
+        fwrite(line.data(), 1, line.size(), stdout);
+        fflush(stdout);
+    }
+    else if (m_file.is_open())
+    {
+        m_file.write(line.data(), line.size());
+        m_file.flush();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* NDJSON (newline delimited JSON) live counting output, see `--output-ndjson`.
+
+   In timeline mode each counting interval emits one self-contained JSON
+   object per core, on its own line, as soon as core counters are read.
+   Every line is flushed so log pipelines can ingest
+   counters while `wperf` is still running.
+*/
+struct ndjson_event
+{
+    std::wstring name;
+    std::wstring index;         // Event index, e.g. "0x1b" or "fixed"
+    std::wstring note;
+    uint64_t value = 0;         // Raw counter value
+    uint64_t scheduled = 0;     // Rounds event was scheduled on hardware counter
+    uint64_t scaled = 0;        // `value` scaled to all rounds
+    uint64_t scaled_min = 0;    // Bounds of real count, see `mpx_scale_range()`
+    uint64_t scaled_max = 0;
+};
+
+struct ndjson_metric
+{
+    std::wstring name;
+    double value = 0.0;
+    std::wstring unit;
+};
+
+struct ndjson_core_record
+{
+    uint64_t interval = 0;      // Counting interval number, starting from 1
+    double duration = 0.0;      // Seconds counted in this interval
+    uint32_t core = 0;
+    bool multiplexing = false;
+    bool kernel_mode = false;
+    uint64_t round = 0;         // Multiplexing rounds in this interval
+    std::vector<ndjson_event> events;
+    std::vector<ndjson_metric> metrics;
+};
+
+// One line JSON object (without new line) of `record`
+std::wstring ndjson_format(const ndjson_core_record& record);
+
+class ndjson_stream
+{
+public:
+    ~ndjson_stream() { close(); }
+
+    // Open (and truncate) `filename`, "-" is the standard output
+    bool open(const std::wstring& filename);
+    bool is_open() const { return m_stdout || m_file.is_open(); }
+    void close();
+
+    // Write `record` as one line and flush it
+    void write(const ndjson_core_record& record);
+
+private:
+    std::ofstream m_file;
+    bool m_stdout = false;
+};
@@ -29,6 +29,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <memory>
 #include <variant>
 #include "prettytable.h"
 #include "json.h"
@@ -299,6 +300,81 @@ struct SamplingPCOutputTraits : public TableOutputTraits<CharType>
     inline const static CharType* key = LITERALCONSTANTS_GET("pcs");
 };
 
+template <typename CharType>
+struct SamplingCPUOutputTraits : public TableOutputTraits<CharType>
+{
+    inline const static std::tuple<uint32_t, uint64_t> columns;
+    inline const static std::tuple<CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("cpu"),
+            LITERALCONSTANTS_GET("count"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("cpus");
+};
+
+// Row key of SpeMemoryLatencyOutputTraits tables
+enum SpeMemoryLatencyBy
+{
+    SPE_MEMORY_BY_SYMBOL = 0,
+    SPE_MEMORY_BY_SOURCE_LINE,
+    SPE_MEMORY_BY_DATA_PAGE,
+    SPE_MEMORY_BY_DATA_SOURCE
+};
+
+template <typename CharType, int By>
+struct SpeMemoryLatencyOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, uint64_t, double, uint32_t, uint32_t, uint32_t, uint32_t, double, double> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(std::get<By>(std::make_tuple(LITERALCONSTANTS_GET("symbol"),
+                LITERALCONSTANTS_GET("source_line"),
+                LITERALCONSTANTS_GET("data_page"),
+                LITERALCONSTANTS_GET("data_source"))),
+            LITERALCONSTANTS_GET("samples"),
+            LITERALCONSTANTS_GET("avg_latency"),
+            LITERALCONSTANTS_GET("p50"),
+            LITERALCONSTANTS_GET("p90"),
+            LITERALCONSTANTS_GET("p99"),
+            LITERALCONSTANTS_GET("max_latency"),
+            LITERALCONSTANTS_GET("l1d_miss_pct"),
+            LITERALCONSTANTS_GET("llc_miss_pct"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = std::get<By>(std::make_tuple(LITERALCONSTANTS_GET("latency_by_symbol"),
+        LITERALCONSTANTS_GET("latency_by_source_line"),
+        LITERALCONSTANTS_GET("latency_by_data_page"),
+        LITERALCONSTANTS_GET("latency_by_data_source")));
+};
+
+template <typename CharType>
+struct SpeMemoryHistogramOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, uint64_t, double> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("latency"),
+            LITERALCONSTANTS_GET("samples"),
+            LITERALCONSTANTS_GET("percent"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("latency_histogram");
+};
+
+template <typename CharType>
+struct SpeMemoryCacheLineOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, uint64_t, uint64_t, double, uint32_t, uint64_t, uint32_t> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("cache_line"),
+            LITERALCONSTANTS_GET("samples"),
+            LITERALCONSTANTS_GET("total_latency"),
+            LITERALCONSTANTS_GET("avg_latency"),
+            LITERALCONSTANTS_GET("max_latency"),
+            LITERALCONSTANTS_GET("peer_hits"),
+            LITERALCONSTANTS_GET("pcs"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("contended_cache_lines");
+};
+
 template <typename CharType>
 struct SamplingModuleInfoOutputTraits : public TableOutputTraits<CharType>
 {
@@ -483,87 +559,69 @@ struct WPerfStatJSON
     bool m_kernel = false;
     double m_duration = 0.f;
 
-    StringStream Print()
+    void Write(JSONWriter<CharType>& writer)
     {
-        StringStream os;
-        enum TableType jsonType = TableType::JSON;
-        os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
+        writer.BeginObject();
         {
-            os << LITERALCONSTANTS_GET("\"core\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            os << LITERALCONSTANTS_GET("\"Multiplexing\": ");
-            if (m_multiplexing)
-                os << LITERALCONSTANTS_GET("true");
-            else
-                os << LITERALCONSTANTS_GET("false");
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"Kernel_mode\": ");
-            if (m_kernel)
-                os << LITERALCONSTANTS_GET("true");
-            else
-                os << LITERALCONSTANTS_GET("false");
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            bool isFirst = true;
-            os << LiteralConstants<CharType>::m_quotes << LITERALCONSTANTS_GET("cores") << LiteralConstants<CharType>::m_quotes;
-            os << LiteralConstants<CharType>::m_colon << LiteralConstants<CharType>::m_bracket_open;
+            writer.Key(LITERALCONSTANTS_GET("core"));
+            writer.BeginObject();
+            writer.Member(LITERALCONSTANTS_GET("Multiplexing"), m_multiplexing);
+            writer.Member(LITERALCONSTANTS_GET("Kernel_mode"), m_kernel);
+            writer.Key(LITERALCONSTANTS_GET("cores"));
+            writer.BeginArray();
             for (auto& table : m_corePerformanceTables)
             {
-                if (!isFirst)
-                {
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
-                }
-                else {
-                    isFirst = false;
-                }
-                std::visit([&os, &jsonType](auto&& arg) {
+                std::visit([&writer](auto&& arg) {
                     arg.m_tableJSON.m_isEmbedded = true;
-                    os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-                    os << LiteralConstants<CharType>::m_quotes << LITERALCONSTANTS_GET("core_number") <<  LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon << arg.m_core;
-                    os << LiteralConstants<CharType>::m_comma << arg.Print(jsonType).str() << std::endl;
-                    os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
-                }, table);                
+                    writer.BeginObject();
+                    writer.Key(LITERALCONSTANTS_GET("core_number"));
+                    writer.Raw(arg.m_core);
+                    writer.Raw(arg.m_tableJSON);
+                    writer.EndObject();
+                }, table);
             }
-            os << LiteralConstants<CharType>::m_bracket_close << std::endl;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
+            writer.EndArray();
 
-            std::visit([&os, &jsonType](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg.Print(jsonType).str() << std::endl; }, m_coreOverall);
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"ts_metric\": ") << m_TSmetric.Print(jsonType).str() << std::endl;
-            os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
+            writer.Key(LITERALCONSTANTS_GET("overall"));
+            std::visit([&writer](auto&& arg) { writer.Raw(arg.m_tableJSON); }, m_coreOverall);
+            writer.Key(LITERALCONSTANTS_GET("ts_metric"));
+            writer.Raw(m_TSmetric.m_tableJSON);
+            writer.EndObject();
         }
-        os << LiteralConstants<CharType>::m_comma << std::endl;
         {
-            os << LITERALCONSTANTS_GET("\"dsu\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            bool isFirst = true;
+            writer.Key(LITERALCONSTANTS_GET("dsu"));
+            writer.BeginObject();
             for (auto& table : m_DSUPerformanceTables)
             {
-                if (!isFirst)
-                {
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
-                }
-                else {
-                    isFirst = false;
-                }
-                std::visit([&os, &jsonType](auto&& arg) {
-                    os << LiteralConstants<CharType>::m_quotes << arg.m_core << LiteralConstants<CharType>::m_quotes;
-                    os << LiteralConstants<CharType>::m_colon << arg.Print(jsonType).str() << std::endl;
+                std::visit([&writer](auto&& arg) {
+                    writer.Key(arg.m_core);
+                    writer.Raw(arg.m_tableJSON);
                 }, table);
             }
-            if (!m_DSUPerformanceTables.empty())
-                os << LiteralConstants<CharType>::m_comma << std::endl;
-
-            os << LITERALCONSTANTS_GET("\"l3metric\": ") << m_DSUL3metric.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            std::visit([&os, &jsonType](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg.Print(jsonType).str() << std::endl; }, m_DSUOverall);
-            os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
+            writer.Key(LITERALCONSTANTS_GET("l3metric"));
+            writer.Raw(m_DSUL3metric.m_tableJSON);
+            writer.Key(LITERALCONSTANTS_GET("overall"));
+            std::visit([&writer](auto&& arg) { writer.Raw(arg.m_tableJSON); }, m_DSUOverall);
+            writer.EndObject();
         }
-        os << LiteralConstants<CharType>::m_comma << std::endl;
         {
-            os << LITERALCONSTANTS_GET("\"dmc\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            os << LITERALCONSTANTS_GET("\"pmu\": ") << m_pmu.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"ddr\": ") << m_DMCDDDR.Print(jsonType).str() << std::endl;
-            os << LiteralConstants<CharType>::m_cbracket_close << LiteralConstants<CharType>::m_comma << std::endl;
+            writer.Key(LITERALCONSTANTS_GET("dmc"));
+            writer.BeginObject();
+            writer.Key(LITERALCONSTANTS_GET("pmu"));
+            writer.Raw(m_pmu.m_tableJSON);
+            writer.Key(LITERALCONSTANTS_GET("ddr"));
+            writer.Raw(m_DMCDDDR.m_tableJSON);
+            writer.EndObject();
         }
-        os << LITERALCONSTANTS_GET("\"Time_elapsed\": ") << m_duration << std::endl;
-        os << LiteralConstants<CharType>::m_cbracket_close;
+        writer.Member(LITERALCONSTANTS_GET("Time_elapsed"), m_duration);
+        writer.EndObject();
+    }
+
+    StringStream Print()
+    {
+        StringStream os;
+        JSONWriter<CharType> writer(os);
+        Write(writer);
         return os;
     }
 };
@@ -588,38 +646,31 @@ struct WPerfListJSON
     std::variant<GroupsOfMetricOutputTraitsTO, VerboseGroupsOfMetricOutputTraitsTO> m_GroupsOfMetrics;
     bool isVerbose = false;
 
-    StringStream Print()
+    void Write(JSONWriter<CharType>& writer)
     {
-        StringStream os;
-        enum TableType jsonType = TableType::JSON;
-
-        std::visit([](auto&& arg) {
+        writer.BeginObject();
+        std::visit([&writer](auto&& arg) {
             arg.m_tableJSON.m_isEmbedded = true;
+            writer.Raw(arg.m_tableJSON);
             }, m_Events);
 
-        std::visit([](auto&& arg) {
+        std::visit([&writer](auto&& arg) {
             arg.m_tableJSON.m_isEmbedded = true;
+            writer.Raw(arg.m_tableJSON);
             }, m_Metrics);
 
-        std::visit([](auto&& arg) {
+        std::visit([&writer](auto&& arg) {
             arg.m_tableJSON.m_isEmbedded = true;
+            writer.Raw(arg.m_tableJSON);
             }, m_GroupsOfMetrics);
+        writer.EndObject();
+    }
 
-        os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            }, m_Events);
-
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            }, m_Metrics);
-
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << std::endl;
-            }, m_GroupsOfMetrics);
-
-        os << LiteralConstants<CharType>::m_cbracket_close;
+    StringStream Print()
+    {
+        StringStream os;
+        JSONWriter<CharType> writer(os);
+        Write(writer);
         return os;
     }
 };
@@ -634,11 +685,21 @@ struct WPerfSamplingJSON
     using Samples = TableOutput<SamplingOutputTraits<CharType>, CharType>;
     using Modules = TableOutput<SamplingModulesOutputTraits<CharType>, CharType>;
     using PCs = TableOutput<SamplingPCOutputTraits<CharType>, CharType>;
+    using CPUs = TableOutput<SamplingCPUOutputTraits<CharType>, CharType>;
     using AnnotateVector = std::vector<std::pair<StringType,
         std::variant<TableOutput<SamplingAnnotateOutputTraits<CharType>, CharType>,
                      TableOutput<SamplingAnnotateOutputTraits<CharType, true>, CharType>>>>;
     using ModulesInfo = std::vector<TableOutput<SamplingModuleInfoOutputTraits<CharType>, CharType>>;
-    std::map<StringType, std::tuple<Samples, AnnotateVector, PCs>> m_map;
+    std::map<StringType, std::tuple<Samples, AnnotateVector, PCs, CPUs>> m_map;
+
+    // SPE memory access profile, see `--spe-memory`
+    bool m_has_spe_memory = false;
+    TableOutput<SpeMemoryHistogramOutputTraits<CharType>, CharType> m_spe_memory_histogram;
+    TableOutput<SpeMemoryLatencyOutputTraits<CharType, SPE_MEMORY_BY_SYMBOL>, CharType> m_spe_memory_symbols;
+    TableOutput<SpeMemoryLatencyOutputTraits<CharType, SPE_MEMORY_BY_SOURCE_LINE>, CharType> m_spe_memory_lines;
+    TableOutput<SpeMemoryLatencyOutputTraits<CharType, SPE_MEMORY_BY_DATA_PAGE>, CharType> m_spe_memory_pages;
+    TableOutput<SpeMemoryLatencyOutputTraits<CharType, SPE_MEMORY_BY_DATA_SOURCE>, CharType> m_spe_memory_sources;
+    TableOutput<SpeMemoryCacheLineOutputTraits<CharType>, CharType> m_spe_memory_cache_lines;
     
     Modules m_modules_table;
     ModulesInfo m_modules_info_vector;
@@ -654,106 +715,93 @@ struct WPerfSamplingJSON
 
     bool m_verbose = false;
 
-    StringStream Print()
+    void Write(JSONWriter<CharType>& writer)
     {
-        StringStream os{};
-        enum TableType jsonType = TableType::JSON;
-        os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
+        writer.BeginObject();
         {
-            os << LITERALCONSTANTS_GET("\"sampling\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            os << LITERALCONSTANTS_GET("\"pe_file\": ") << LiteralConstants<CharType>::m_quotes <<  m_pe_file << LiteralConstants<CharType>::m_quotes;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"pdb_file\": ") << LiteralConstants<CharType>::m_quotes << m_pdb_file << LiteralConstants<CharType>::m_quotes;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"sample_display_row\": ") << m_sample_display_row;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"samples_generated\": ") << m_samples_generated;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"samples_dropped\": ") << m_samples_dropped;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"base_address\": ") << m_base_address;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"runtime_delta\": ") << m_runtime_delta;
-            os << LiteralConstants<CharType>::m_comma << std::endl;
-            
+            writer.Key(LITERALCONSTANTS_GET("sampling"));
+            writer.BeginObject();
+            writer.Member(LITERALCONSTANTS_GET("pe_file"), m_pe_file);
+            writer.Member(LITERALCONSTANTS_GET("pdb_file"), m_pdb_file);
+            writer.Member(LITERALCONSTANTS_GET("sample_display_row"), m_sample_display_row);
+            writer.Member(LITERALCONSTANTS_GET("samples_generated"), m_samples_generated);
+            writer.Member(LITERALCONSTANTS_GET("samples_dropped"), m_samples_dropped);
+            writer.Member(LITERALCONSTANTS_GET("base_address"), m_base_address);
+            writer.Member(LITERALCONSTANTS_GET("runtime_delta"), m_runtime_delta);
+
+            if (m_has_spe_memory)
+            {
+                m_spe_memory_histogram.m_tableJSON.m_isEmbedded = true;
+                m_spe_memory_symbols.m_tableJSON.m_isEmbedded = true;
+                m_spe_memory_lines.m_tableJSON.m_isEmbedded = true;
+                m_spe_memory_pages.m_tableJSON.m_isEmbedded = true;
+                m_spe_memory_sources.m_tableJSON.m_isEmbedded = true;
+                m_spe_memory_cache_lines.m_tableJSON.m_isEmbedded = true;
+                writer.Key(LITERALCONSTANTS_GET("spe_memory"));
+                writer.BeginObject();
+                writer.Raw(m_spe_memory_histogram.m_tableJSON);
+                writer.Raw(m_spe_memory_symbols.m_tableJSON);
+                writer.Raw(m_spe_memory_lines.m_tableJSON);
+                writer.Raw(m_spe_memory_pages.m_tableJSON);
+                writer.Raw(m_spe_memory_sources.m_tableJSON);
+                writer.Raw(m_spe_memory_cache_lines.m_tableJSON);
+                writer.EndObject();
+            }
+
             if (m_verbose)
             {
-                bool isFirst = true;
                 m_modules_table.m_tableJSON.m_isEmbedded = true;
-                os << m_modules_table.Print(jsonType).str();
-                os << LiteralConstants<CharType>::m_comma << std::endl;
-                os << LITERALCONSTANTS_GET("\"modules_info\": ");
-                os << LiteralConstants<CharType>::m_bracket_open;
+                writer.Raw(m_modules_table.m_tableJSON);
+                writer.Key(LITERALCONSTANTS_GET("modules_info"));
+                writer.BeginArray();
                 for (auto& value : m_modules_info_vector)
-                {
-                    if(!isFirst)
-                    {
-                        os << LiteralConstants<CharType>::m_comma << std::endl;
-                    } else {
-                        isFirst = false;
-                    }
-                    os << value.Print(jsonType).str();
-                }
-                os << LiteralConstants<CharType>::m_bracket_close;                
-                os << LiteralConstants<CharType>::m_comma << std::endl;
+                    writer.Raw(value.m_tableJSON);
+                writer.EndArray();
             }
-            
-            os << LITERALCONSTANTS_GET("\"events\": [");
 
-            bool isFirst = true;
-            for (auto& [key,value] : m_map)
+            writer.Key(LITERALCONSTANTS_GET("events"));
+            writer.BeginArray();
+            for (auto& [key, value] : m_map)
             {
-                if (!isFirst)
-                {
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
-                }
-                else {
-                    isFirst = false;
-                }
+                writer.BeginObject();
+                writer.Member(LITERALCONSTANTS_GET("type"), key);
 
-                os << LITERALCONSTANTS_GET("{\"type\":");
                 std::get<0>(value).m_tableJSON.m_isEmbedded = true;
-
-                os << LiteralConstants<CharType>::m_quotes << key << LiteralConstants<CharType>::m_quotes;
-                os << LiteralConstants<CharType>::m_comma;
-
-                os << std::get<0>(value).Print(jsonType).str();
-                os << LiteralConstants<CharType>::m_comma << std::endl;
+                writer.Raw(std::get<0>(value).m_tableJSON);
                 if (m_verbose)
                 {
                     std::get<2>(value).m_tableJSON.m_isEmbedded = true;
-                    os << std::get<2>(value).Print(jsonType).str();
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
+                    writer.Raw(std::get<2>(value).m_tableJSON);
                 }
-                os << LITERALCONSTANTS_GET("\"annotate\": ");    
-                os << LiteralConstants<CharType>::m_bracket_open;
-                bool isFirstInside = true;
-                for(auto &[function_name, table] : std::get<1>(value))
+                std::get<3>(value).m_tableJSON.m_isEmbedded = true;
+                writer.Raw(std::get<3>(value).m_tableJSON);
+
+                writer.Key(LITERALCONSTANTS_GET("annotate"));
+                writer.BeginArray();
+                for (auto& [function_name, table] : std::get<1>(value))
                 {
-                    std::visit([&os, &jsonType](auto&& arg) { arg.m_tableJSON.m_isEmbedded = true; }, table);
-
-                    if(!isFirstInside)
-                    {
-                        os << LiteralConstants<CharType>::m_comma << std::endl;
-                    }
-                    else {
-                        isFirstInside = false;
-                    }
-                    os << LiteralConstants<CharType>::m_cbracket_open;
-                    os << LITERALCONSTANTS_GET("\"function_name\": ");
-                    os << LiteralConstants<CharType>::m_quotes << function_name << LiteralConstants<CharType>::m_quotes;
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
-                    std::visit([&os, &jsonType](auto&& arg) { os << arg.Print(jsonType).str(); }, table);
-                    os << LiteralConstants<CharType>::m_cbracket_close;
-                    
+                    writer.BeginObject();
+                    writer.Member(LITERALCONSTANTS_GET("function_name"), function_name);
+                    std::visit([&writer](auto&& arg) {
+                        arg.m_tableJSON.m_isEmbedded = true;
+                        writer.Raw(arg.m_tableJSON);
+                        }, table);
+                    writer.EndObject();
                 }
-                os << LiteralConstants<CharType>::m_bracket_close;
-                os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
+                writer.EndArray();
+                writer.EndObject();
             }
-            os << LiteralConstants<CharType>::m_bracket_close;
-            os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
+            writer.EndArray();
+            writer.EndObject();
         }
-        os << LiteralConstants<CharType>::m_cbracket_close;
+        writer.EndObject();
+    }
+
+    StringStream Print()
+    {
+        StringStream os{};
+        JSONWriter<CharType> writer(os);
+        Write(writer);
         return os;
     }
 };
@@ -764,48 +812,34 @@ struct WPerfTimelineJSON
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::stringstream, std::wstringstream> StringStream;
 
-    using WPerfStatJSONTrait = WPerfStatJSON<CharType>;
-    std::vector <WPerfStatJSONTrait> m_timelineWperfStat;
-
     double m_count_duration = 0.f;  //  --timeout <sec> | sleep <sec>
     double m_count_interval = 0.f;  //  -i <sec>
     int m_count_timeline = 0;       //  -n N
 
-    StringStream Print()
+    // Opens the document, intervals are written with `WriteInterval()` as they complete
+    void WriteBegin(JSONWriter<CharType>& writer)
     {
-        StringStream os;
-        os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-        {
-            os << LITERALCONSTANTS_GET("\"count_duration\": ")
-                << std::fixed << std::setprecision(2) << m_count_duration
-                << LiteralConstants<CharType>::m_comma << std::endl;;
-
-            os << LITERALCONSTANTS_GET("\"count_interval\": ")
-               << std::fixed << std::setprecision(2) << m_count_interval
-               << LiteralConstants<CharType>::m_comma << std::endl;;
-
-            os << LITERALCONSTANTS_GET("\"count_timeline\": ")
-                << std::fixed << std::setprecision(2) << m_count_timeline
-                << LiteralConstants<CharType>::m_comma << std::endl;;
-
-            os << LITERALCONSTANTS_GET("\"timeline\": ");
-            os << LiteralConstants<CharType>::m_bracket_open << std::endl;
-
-            bool isFirst = true;
-            for (auto& table : m_timelineWperfStat)
-            {
-                if (!isFirst)
-                    os << LiteralConstants<CharType>::m_comma << std::endl;
-                else
-                    isFirst = false;
+        writer.BeginObject();
+        writer.Key(LITERALCONSTANTS_GET("count_duration"));
+        writer.Number(m_count_duration, 2);
+        writer.Key(LITERALCONSTANTS_GET("count_interval"));
+        writer.Number(m_count_interval, 2);
+        writer.Member(LITERALCONSTANTS_GET("count_timeline"), m_count_timeline);
+        writer.Key(LITERALCONSTANTS_GET("timeline"));
+        writer.BeginArray();
+    }
 
-                os << table.Print().str();
-            }
-            os << LiteralConstants<CharType>::m_bracket_close << std::endl;
-        }
+    void WriteInterval(JSONWriter<CharType>& writer, WPerfStatJSON<CharType>& interval)
+    {
+        interval.Write(writer);
+        writer.Flush();
+    }
 
-        os << LiteralConstants<CharType>::m_cbracket_close;
-        return os;
+    void WriteEnd(JSONWriter<CharType>& writer)
+    {
+        writer.EndArray();
+        writer.EndObject();
+        writer.Flush();
     }
 };
 
@@ -860,54 +894,38 @@ struct OutputControl
         }
     }
 
-    StringType EscapeStr(StringType& str)
+    // JSON output goes straight to the file requested with `--output` or to the standard output. Quiet mode
+    // (e.g. `--json`) is lifted while JSON is written.
+    template <typename F>
+    void WriteJSON(F write)
     {
-        StringType res = LITERALCONSTANTS_GET("");
-        StringType::size_type n = str.find('\\');
-        StringType::size_type lastn = 0;
-
-        while (n != StringType::npos)
+        if (m_shouldWriteToFile)
         {
-            res += str.substr(lastn, n - lastn) + LITERALCONSTANTS_GET("\\");
-            lastn = n;
-            n = str.find(L'\\', lastn + 1);
+            FileStream file;
+            file.open(m_filename, std::fstream::out | std::fstream::trunc);
+            if (!file.is_open())
+            {
+                GetErrorOutputStream() << LITERALCONSTANTS_GET("Unable to open ") << m_filename << std::endl;
+                return;
+            }
+            JSONWriter<CharType> writer(file);
+            write(writer);
+            file.close();
         }
-        res += str.substr(lastn, str.size() - lastn);
-        return res;
-    }
-
-    void Print_(StringType& str)
-    {
-        StringType eStr = str;
-        bool curIsQuiet = m_isQuiet;
-        //If the user requested to be quiet but to output JSON results we disable quiet mode just
-        //to output the JSON tables and then reenable it afterwards.
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && m_isQuiet)
-        {
+        else {
+            bool curIsQuiet = m_isQuiet;
             m_isQuiet = false;
-            eStr = EscapeStr(str);
-        }
-
-        GetOutputStream() << eStr;
-
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && curIsQuiet)
-        {
-            m_isQuiet = true;
+            JSONWriter<CharType> writer(GetOutputStream());
+            write(writer);
+            writer.Flush();
+            m_isQuiet = curIsQuiet;
+            GetOutputStream();
         }
     }
 
-    void OutputToFile(StringType& str)
+    bool IsJSONOutput()
     {
-        FileStream file;
-        file.open(m_filename, std::fstream::out | std::fstream::trunc);
-        if (file.is_open())
-        {
-            file << EscapeStr(str);
-            file.close();
-        }
-        else {
-            GetErrorOutputStream() << LITERALCONSTANTS_GET("Unable to open ") << m_filename << std::endl;
-        }
+        return m_outputType == TableType::JSON || m_outputType == TableType::ALL;
     }
 
     template <typename T>
@@ -921,95 +939,101 @@ struct OutputControl
             StringType s = table.Print(TableType::PRETTY).str();
             GetOutputStream() << s;
         }
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && printJson)
-        {
-            StringType sj = table.Print(TableType::JSON).str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(sj);
-            }
-            else {
-                OutputToFile(sj);
-            }
-        }
+        if (IsJSONOutput() && printJson)
+            WriteJSON([&table](JSONWriter<CharType>& writer) { writer.Raw(table.m_tableJSON); });
     }
 
     void Print(WPerfStatJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONOutput())
+            WriteJSON([&table](JSONWriter<CharType>& writer) { table.Write(writer); });
     }
 
     void Print(WPerfListJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONOutput())
+            WriteJSON([&table](JSONWriter<CharType>& writer) { table.Write(writer); });
     }
 
     void Print(WPerfSamplingJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONOutput())
+            WriteJSON([&table](JSONWriter<CharType>& writer) { table.Write(writer); });
     }
 
     /* When SPE is used we also enable the PMU to gather diagnosticis data. 
     Here we print a special sampling/counting output keeping each one of them still compatible with the sample/count schema. */
     void Print(WPerfSamplingJSON<CharType>& tableSampling, WPerfStatJSON<CharType>& tableStat)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
+        if (IsJSONOutput())
         {
-            StringType sSampling = tableSampling.Print().str();
-            StringType sStat = tableStat.Print().str();
+            WriteJSON([&tableSampling, &tableStat](JSONWriter<CharType>& writer) {
+                writer.BeginObject();
+                writer.Key(LITERALCONSTANTS_GET("sampling"));
+                tableSampling.Write(writer);
+                writer.Key(LITERALCONSTANTS_GET("counting"));
+                tableStat.Write(writer);
+                writer.EndObject();
+            });
+        }
+    }
 
-            StringType s = L"{\"sampling\":" + sSampling + L",\n\"counting\":" + sStat + L"}";
+    /* Timeline JSON is streamed: the document is opened with `BeginTimeline()`, each counting interval is written
+    and flushed with `PrintTimelineInterval()` as soon as it completes and `EndTimeline()` closes the document. */
+    FileStream m_timelineFile;
+    std::unique_ptr<JSONWriter<CharType>> m_timelineWriter;
 
-            if (!m_shouldWriteToFile)
+    void BeginTimeline(WPerfTimelineJSON<CharType>& timeline)
+    {
+        if (!IsJSONOutput())
+            return;
+
+        if (m_shouldWriteToFile)
+        {
+            m_timelineFile.open(m_filename, std::fstream::out | std::fstream::trunc);
+            if (!m_timelineFile.is_open())
             {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
+                GetErrorOutputStream() << LITERALCONSTANTS_GET("Unable to open ") << m_filename << std::endl;
+                return;
             }
+            m_timelineWriter = std::make_unique<JSONWriter<CharType>>(m_timelineFile);
+        }
+        else {
+            m_timelineWriter = std::make_unique<JSONWriter<CharType>>(GetOutputStream());
         }
+        WriteTimeline([&timeline](JSONWriter<CharType>& writer) { timeline.WriteBegin(writer); });
     }
 
-    void Print(WPerfTimelineJSON<CharType>& table)
+    void PrintTimelineInterval(WPerfTimelineJSON<CharType>& timeline, WPerfStatJSON<CharType>& interval)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
+        WriteTimeline([&timeline, &interval](JSONWriter<CharType>& writer) { timeline.WriteInterval(writer, interval); });
+    }
+
+    void EndTimeline(WPerfTimelineJSON<CharType>& timeline)
+    {
+        WriteTimeline([&timeline](JSONWriter<CharType>& writer) { timeline.WriteEnd(writer); });
+        m_timelineWriter.reset();
+        if (m_timelineFile.is_open())
+            m_timelineFile.close();
+    }
+
+    // Counting tables are printed to the standard output between timeline intervals, so quiet mode is lifted only
+    // while timeline JSON is written.
+    template <typename F>
+    void WriteTimeline(F write)
+    {
+        if (!m_timelineWriter)
+            return;
+
+        bool curIsQuiet = m_isQuiet;
+        if (!m_shouldWriteToFile)
         {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-                Print_(s);
-            else
-                OutputToFile(s);
+            m_isQuiet = false;
+            GetOutputStream();
         }
+        write(*m_timelineWriter);
+        m_isQuiet = curIsQuiet;
+        GetOutputStream();
     }
 };
 
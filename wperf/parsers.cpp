@@ -41,6 +41,7 @@
 #include "events.h"
 #include "output.h"
 #include "utils.h"
+#include "wperf-common/mpxsched.h"
 
 
 static bool sort_ioctl_events_sample(const struct evt_sample_src& a, const struct evt_sample_src& b)
@@ -91,7 +92,7 @@ static void push_raw_extra_event(uint16_t raw_event, enum evt_class e_class)
         return;
 
     std::wstring name = L"r" + IntToHexWideStringNoPrefix(raw_event, 1);
-    struct extra_event e = { e_class, raw_event, name };
+    struct extra_event e = { { e_class, raw_event }, name };
     pmu_events::extra_events[e_class].push_back(e);
 }
 
@@ -163,7 +164,7 @@ void parse_events_extra(std::wstring events_str, std::map<enum evt_class, std::v
             if (std::any_of(events[e_class].begin(),
                 events[e_class].end(),
                 [event_num](const auto& e) { return e.hdr.num == event_num; }) == false)
-                events[e_class].push_back( { e_class, event_num, WStringToLower(event_name)} );
+                events[e_class].push_back( { { e_class, event_num }, WStringToLower(event_name)} );
         }
     }
 }
@@ -220,6 +221,76 @@ bool parse_events_str_for_feat_spe(std::wstring events_str, std::map<std::wstrin
     return false;
 }
 
+void parse_events_weight(std::wstring weights_str, std::map<enum evt_class, std::map<uint16_t, uint16_t>>& weights)
+{
+    std::wistringstream event_stream(weights_str);
+    std::wstring event;
+
+    while (std::getline(event_stream, event, L','))
+    {
+        enum evt_class e_class = EVT_CORE;
+        uint16_t raw_event;
+        unsigned long weight;
+        size_t delim_pos = event.find(L":");
+
+        if (delim_pos == std::string::npos)
+        {
+            m_out.GetErrorOutputStream() << L"event weight: " << event << L" is missing ':<weight>'" << std::endl;
+            throw fatal_exception("ERROR_EVENT_WEIGHT");
+        }
+
+        std::wstring str1 = event.substr(0, delim_pos);
+        std::wstring weight_str(event.substr(delim_pos + 1, std::string::npos));
+        try
+        {
+            weight = std::stoul(weight_str, NULL, 0);
+        }
+        catch (std::exception const& ex)
+        {
+            m_out.GetErrorOutputStream() << L"event weight: " << weight_str << L" is invalid!" << std::endl;
+            m_out.GetErrorOutputStream() << L"note: " << ex.what() << std::endl;
+            throw fatal_exception("ERROR_EVENT_WEIGHT");
+        }
+
+        if (weight < 1 || weight > MPX_SCHED_MAX_WEIGHT)
+        {
+            m_out.GetErrorOutputStream() << L"event weight: " << weight_str << L" is out of range, use 1-"
+                << MPX_SCHED_MAX_WEIGHT << std::endl;
+            throw fatal_exception("ERROR_EVENT_WEIGHT");
+        }
+
+        // Only core and DSU events are multiplexed
+        std::wstring dsu_prefix = pmu_events::get_evt_name_prefix(EVT_DSU);
+        if (CaseInsensitiveWStringStartsWith(str1, dsu_prefix))
+        {
+            e_class = EVT_DSU;
+            str1.erase(0, dsu_prefix.size());
+        }
+
+        if (std::iswdigit(str1[0]))
+        {
+            raw_event = get_raw_event_index(str1, 0);
+        }
+        else if (is_raw_event(str1))
+        {
+            raw_event = get_raw_event_index(str1.substr(1, std::string::npos), 16);
+        }
+        else
+        {
+            int idx = pmu_events::get_event_index(str1, e_class);
+            if (idx < 0)
+            {
+                m_out.GetErrorOutputStream() << L"unknown event name: " << str1 << std::endl;
+                throw fatal_exception("ERROR_EVENT_WEIGHT");
+            }
+
+            raw_event = static_cast<uint16_t>(idx);
+        }
+
+        weights[e_class][raw_event] = static_cast<uint16_t>(weight);
+    }
+}
+
 void parse_events_str_for_sample(std::wstring events_str, std::vector<struct evt_sample_src> &ioctl_events_sample,
     std::map<uint32_t, uint32_t>& sampling_inverval)
 {
@@ -42,6 +42,8 @@ void parse_events_extra(std::wstring events_str, std::map<enum evt_class, std::v
 
 bool parse_events_str_for_feat_spe(std::wstring events_str, std::map<std::wstring, uint64_t>& flags);
 
+void parse_events_weight(std::wstring weights_str, std::map<enum evt_class, std::map<uint16_t, uint16_t>>& weights);
+
 void parse_events_str_for_sample(std::wstring events_str,
     std::vector<struct evt_sample_src>& ioctl_events_sample,
     std::map<uint32_t, uint32_t>& sampling_inverval);
@@ -28,6 +28,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -88,6 +89,66 @@ void parse_pe_file(const std::wstring& pe_file, uint64_t& image_base)
     pe_file_stream.close();
 }
 
+uint32_t get_pe_timestamp(const std::wstring& pe_file)
+{
+    std::ifstream pe_file_stream(pe_file, std::ios::binary);
+    IMAGE_DOS_HEADER dos_hdr{};
+    IMAGE_NT_HEADERS nt_hdr{};
+
+    pe_file_stream.read(reinterpret_cast<char*>(&dos_hdr), sizeof(dos_hdr));
+    if (!pe_file_stream || dos_hdr.e_magic != IMAGE_DOS_SIGNATURE)
+        return 0;
+
+    pe_file_stream.seekg(dos_hdr.e_lfanew);
+    pe_file_stream.read(reinterpret_cast<char*>(&nt_hdr), sizeof(nt_hdr));
+    if (!pe_file_stream || nt_hdr.Signature != IMAGE_NT_SIGNATURE)
+        return 0;
+
+    return nt_hdr.FileHeader.TimeDateStamp;
+}
+
+bool read_pe_section_data(const std::wstring& pe_file, uint64_t from, uint64_t to, std::vector<uint8_t>& data)
+{
+    std::ifstream pe_file_stream(pe_file, std::ios::binary);
+    IMAGE_DOS_HEADER dos_hdr{};
+    IMAGE_NT_HEADERS nt_hdr{};
+
+    pe_file_stream.read(reinterpret_cast<char*>(&dos_hdr), sizeof(dos_hdr));
+    if (!pe_file_stream || dos_hdr.e_magic != IMAGE_DOS_SIGNATURE)
+        return false;
+
+    pe_file_stream.seekg(dos_hdr.e_lfanew);
+    pe_file_stream.read(reinterpret_cast<char*>(&nt_hdr), sizeof(nt_hdr));
+    if (!pe_file_stream || nt_hdr.Signature != IMAGE_NT_SIGNATURE || from > to)
+        return false;
+
+    std::vector<IMAGE_SECTION_HEADER> sections(nt_hdr.FileHeader.NumberOfSections);
+    pe_file_stream.seekg(dos_hdr.e_lfanew + FIELD_OFFSET(IMAGE_NT_HEADERS, OptionalHeader) + nt_hdr.FileHeader.SizeOfOptionalHeader);
+    pe_file_stream.read(reinterpret_cast<char*>(sections.data()), sizeof(IMAGE_SECTION_HEADER) * sections.size());
+    if (!pe_file_stream)
+        return false;
+
+    for (const auto& section : sections)
+    {
+        uint64_t sec_from = section.VirtualAddress;
+        uint64_t sec_to = sec_from + (std::max)(section.Misc.VirtualSize, section.SizeOfRawData);
+        if (from < sec_from || to > sec_to)
+            continue;
+
+        // Part of the section past its raw data is zero filled by the loader
+        data.assign(static_cast<size_t>(to - from), 0);
+        uint64_t raw_to = (std::min)(to, sec_from + section.SizeOfRawData);
+        if (raw_to > from)
+        {
+            pe_file_stream.seekg(static_cast<std::streamoff>(section.PointerToRawData + (from - sec_from)));
+            pe_file_stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(raw_to - from));
+        }
+        return static_cast<bool>(pe_file_stream);
+    }
+
+    return false;
+}
+
 void parse_pe_file(std::wstring pe_file, uint64_t& static_entry_point, uint64_t& image_base, std::vector<SectionDesc>& sec_info, std::vector<std::wstring>& sec_import)
 {
     std::ifstream pe_file_stream(pe_file, std::ios::binary);
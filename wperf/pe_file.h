@@ -30,6 +30,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <windows.h>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -82,6 +83,7 @@ typedef struct _SampleDesc
     ModuleMetaData* module{};
     uint32_t event_src{};
     std::vector<std::pair<uint64_t, uint64_t>> pc;
+    std::map<std::pair<uint64_t, uint32_t>, uint64_t> pc_cpu;  // [pc, cpu] -> count
 } SampleDesc;
 
 typedef struct _PeFileMetaData
@@ -97,6 +99,8 @@ typedef struct _PeFileMetaData
 std::wstring gen_pdb_name(std::wstring str);
 void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, bool sample_display_short);
 void parse_pe_file(const std::wstring& pe_file, uint64_t& image_base);
+uint32_t get_pe_timestamp(const std::wstring& pe_file);     // IMAGE_FILE_HEADER.TimeDateStamp, 0 if not available
+bool read_pe_section_data(const std::wstring& pe_file, uint64_t from, uint64_t to, std::vector<uint8_t>& data);    // Bytes of image relative range [from, to), false if not in one section
 void parse_pe_file(std::wstring pe_file, uint64_t& static_entry_point, uint64_t& image_base, std::vector<SectionDesc>& sec_info, std::vector<std::wstring>& sec_import);
 void parse_pe_file(std::wstring pe_file, PeFileMetaData& pefile_metadata);
 bool sort_samples(const SampleDesc& a, const SampleDesc& b);
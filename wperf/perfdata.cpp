@@ -29,27 +29,90 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "perfdata.h"
+#include "exception.h"
 #include <fstream>
 
 #define GET_64ALIGNED_SIZE(X) static_cast<UINT16>((std::ceil(static_cast<double>(X) / sizeof(UINT64)))*sizeof(UINT64))
 
+void PerfDataWriter::append_u32(std::vector<char>& out, UINT32 value)
+{
+	const char* bytes = reinterpret_cast<const char*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// Same as perf's do_write_string(): length (with terminator and padding) followed by padded string
+void PerfDataWriter::append_string(std::vector<char>& out, const std::string& str)
+{
+	const UINT32 len = static_cast<UINT32>(str.length() + 1 + perfdata::PERF_DATA_NAME_ALIGN - 1) / perfdata::PERF_DATA_NAME_ALIGN * perfdata::PERF_DATA_NAME_ALIGN;
+	append_u32(out, len);
+	out.insert(out.end(), str.begin(), str.end());
+	out.insert(out.end(), len - str.length(), '\0');
+}
+
 void PerfDataWriter::WriteCommandLine(const int argc, const wchar_t* argv[])
 {
-	m_cmdline.count = argc;
-	m_cmdline.data = new perfdata::perf_data_string[argc];
+	std::vector<char>& section = m_features[perfdata::HEADER_CMDLINE];
+	section.clear();
 
+	append_u32(section, argc);
 	for (auto i = 0; i < argc; i++)
+		append_string(section, MultiByteFromWideString(argv[i]));
+
+	set_feature(perfdata::HEADER_CMDLINE);
+}
+
+void PerfDataWriter::WriteCpuInfo(UINT32 nr_cpus_available, UINT32 nr_cpus_online, const std::wstring& cpu_desc)
+{
+	std::vector<char>& nrcpus = m_features[perfdata::HEADER_NRCPUS];
+	nrcpus.clear();
+	append_u32(nrcpus, nr_cpus_available);
+	append_u32(nrcpus, nr_cpus_online);
+	set_feature(perfdata::HEADER_NRCPUS);
+
+	std::vector<char>& cpudesc = m_features[perfdata::HEADER_CPUDESC];
+	cpudesc.clear();
+	append_string(cpudesc, MultiByteFromWideString(cpu_desc.c_str()));
+	set_feature(perfdata::HEADER_CPUDESC);
+}
+
+size_t PerfDataWriter::find_sampling_event(UINT64 perf_sampling_event) const
+{
+	for (size_t i = 0; i < m_sampling_events.size(); i++)
+		if (m_sampling_events[i] == perf_sampling_event)
+			return i;
+	return m_sampling_events.size();
+}
+
+void PerfDataWriter::RegisterSampleEvent(UINT64 perf_sampling_event, UINT64 period, const std::wstring& name)
+{
+	const size_t idx = find_sampling_event(perf_sampling_event);
+	if (idx < m_sampling_events.size())
 	{
-		std::string str = MultiByteFromWideString(argv[i]);
-		str += '\0';
-		m_cmdline_size += sizeof(UINT32) + sizeof(char) * str.length();
-		m_cmdline.data[i].size = static_cast<UINT32>(str.length());
-		m_cmdline.data[i].data = new char[m_cmdline.data[i].size];
-		memcpy(m_cmdline.data[i].data, str.c_str(), sizeof(char) * str.length());
+		if (m_sampling_event_names[idx].empty())
+			m_sampling_event_names[idx] = MultiByteFromWideString(name.c_str());
+		return;
 	}
-	m_feature_count++;
-	m_has_cmdline = true;
-	set_feature(perfdata::HEADER_CMDLINE);
+
+	perfdata::perf_file_attr fattr{ 0 };
+	fattr.attr.size = sizeof(perfdata::perf_event_attr);
+	fattr.attr.sample_type = perfdata::PERF_DATA_SAMPLE_TYPE;
+	fattr.attr.sample_period = period;
+	// We just need to disable flags as all are enabled by default on perf_event_attr
+	fattr.attr.disabled = 0;
+	fattr.attr.inherit = 0;
+	fattr.attr.pinned = 0;
+	fattr.attr.exclude_user = 0;
+	fattr.attr.exclude_kernel = 0;
+	fattr.attr.precise_ip = 0;
+	fattr.attr.exclude_host = 0;
+	fattr.attr.type = perfdata::PERF_TYPE_RAW;
+	fattr.attr.config = perf_sampling_event;
+
+	fattr.ids.offset = 0;
+	fattr.ids.size = sizeof(UINT64);
+	m_attributes.push_back(fattr);
+	m_sampling_events.push_back(perf_sampling_event);
+	m_sampling_event_names.push_back(MultiByteFromWideString(name.c_str()));
 }
 
 size_t PerfDataWriter::WriteAttributeSection(size_t data_offset)
@@ -65,33 +128,27 @@ size_t PerfDataWriter::WriteAttributeSection(size_t data_offset)
 	return written;
 }
 
-size_t PerfDataWriter::WriteFeatures(size_t file_section_offset, size_t data_offset)
+// Feature sections table (one perf_file_section per set feature bit, in bit order) followed by section payloads
+size_t PerfDataWriter::WriteFeatures(size_t file_section_offset)
 {
 	size_t written = 0;
-	if (m_has_cmdline)
+	size_t data_offset = file_section_offset + m_features.size() * sizeof(perfdata::perf_file_section);
+
+	for (const auto& [feature, payload] : m_features)
 	{
 		perfdata::perf_file_section section{0};
 		section.offset = data_offset;
-		section.size = m_cmdline_size + sizeof(UINT32); // Data + count
+		section.size = payload.size();
 
-		m_file.seekp(file_section_offset);
+		m_file.seekp(file_section_offset + written);
 		m_file.write(reinterpret_cast<char*>(&section), sizeof(perfdata::perf_file_section));
 		written += sizeof(perfdata::perf_file_section);
 
 		m_file.seekp(data_offset);
-		m_file.write(reinterpret_cast<char*>(&m_cmdline.count), sizeof(UINT32));
-		written += sizeof(UINT32);
-
-		for (UINT32 i = 0; i < m_cmdline.count; i++)
-		{
-			size_t size_to_write = sizeof(char) * m_cmdline.data[i].size;
-			m_file.write(reinterpret_cast<char*>(&m_cmdline.data[i].size), sizeof(UINT32));
-			written += sizeof(UINT32);
-			m_file.write(m_cmdline.data[i].data, size_to_write);
-			written += size_to_write;
-		}
+		m_file.write(payload.data(), payload.size());
+		data_offset += payload.size();
 	}
-	return written;
+	return data_offset - file_section_offset;
 }
 
 size_t PerfDataWriter::WriteIDs(size_t data_offset)
@@ -109,24 +166,33 @@ size_t PerfDataWriter::WriteIDs(size_t data_offset)
 	return written;
 }
 
-size_t PerfDataWriter::WriteDataSection(size_t offset)
+void PerfDataWriter::WriteRecord(const void* record, size_t size)
 {
-	m_file.seekp(offset);
-	size_t written = 0;
-	for (auto& el : m_events)
-	{
-		std::visit([&](auto&& arg)
-		{
-			m_file.write(reinterpret_cast<char*>(&arg), arg.header.size);
-			written += arg.header.size;
-		}, el);
-	}
-	return written;
+	if (!m_file.is_open())
+		throw fatal_exception("perf.data file is not open");
+
+	if (m_buffer.size() + size > PERF_DATA_BUFFER_SIZE)
+		FlushRecords();
+
+	const char* bytes = static_cast<const char*>(record);
+	m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+void PerfDataWriter::FlushRecords()
+{
+	if (m_buffer.empty())
+		return;
+
+	m_file.write(m_buffer.data(), m_buffer.size());
+	if (!m_file)
+		throw fatal_exception("Failed to write perf.data file");
+
+	m_data_size += m_buffer.size();
+	m_buffer.clear();
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command)
+void PerfDataWriter::write_comm_event(DWORD pid, std::wstring& command)
 {
-	PerfDataWriter::PerfEvent var;
 	perfdata::perf_data_comm_event event { 0 };
 	event.header.size = sizeof(event);
 	event.header.type = perfdata::PERF_RECORD_COMM;
@@ -137,35 +203,50 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring
 	std::string token = MultiByteFromWideString(command.c_str());
 	memcpy(event.comm, token.c_str(), sizeof(char) * min(token.length(), 16));
 
-	var = event;
-	return var;
+	WriteRecord(&event, event.header.size);
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type)
+void PerfDataWriter::write_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type)
 {
-	PerfDataWriter::PerfEvent var;
+	const size_t idx = find_sampling_event(event_type);
+	const UINT64 period = idx < m_attributes.size() ? m_attributes[idx].attr.sample_period : 1;
+	write_sample_event(pid, ip, 0, cpu, event_type, 0, period);
+}
+
+void PerfDataWriter::write_sample_event(DWORD pid, UINT64 ip, UINT64 lr, UINT32 cpu, UINT64 event_type, UINT64 time, UINT64 period)
+{
+	// Each sample ID must have its attribute, e.g. SPE events known only after decoding
+	if (find_sampling_event(event_type) == m_sampling_events.size())
+		RegisterSampleEvent(event_type, period);
+
 	perfdata::perf_data_sample_event event {0};
-	event.header.size = sizeof(event);
 	event.header.type = perfdata::PERF_RECORD_SAMPLE;
 	event.header.misc = PERF_RECORD_MISC_USER;
 	event.pid = pid;
 	event.tid = pid;
 	event.cpu = cpu;
 	event.ip = ip;
+	event.time = time;
 	event.id = event_type;
+	event.period = period;
+
+	// Two frame callchain: sampled PC and its caller from link register
+	event.ips[event.nr++] = ip;
+	if (lr)
+		event.ips[event.nr++] = lr;
 
-	var = event;
-	return var;
+	event.header.size = static_cast<UINT16>(sizeof(event) - sizeof(event.ips) + event.nr * sizeof(UINT64));
+	WriteRecord(&event, event.header.size);
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff)
+void PerfDataWriter::write_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff)
 {
-	PerfDataWriter::PerfEvent var;
 	perfdata::perf_data_mmap_event event{ 0 };
 
 	std::string token = MultiByteFromWideString(filename.c_str());
+	const size_t filename_size = min(token.size() + 1, PATH_MAX);
 
-	event.header.size = sizeof(event) - sizeof(event.filename) + static_cast<UINT16>(GET_64ALIGNED_SIZE(token.size()+1));
+	event.header.size = sizeof(event) - sizeof(event.filename) + static_cast<UINT16>(GET_64ALIGNED_SIZE(filename_size));
 	event.header.type = perfdata::PERF_RECORD_MMAP;
 	event.header.misc = PERF_RECORD_MISC_USER;
 	event.pid = pid;
@@ -174,34 +255,82 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr,
 	event.len = len;
 	event.pgoff = pgoff;
 
-	memset(event.filename, 0, sizeof(char) * PATH_MAX);
-	memcpy(event.filename, token.c_str(), sizeof(char) * min(token.size()+1, PATH_MAX));
-	
-	var = event;
-	return var;
+	memcpy(event.filename, token.c_str(), sizeof(char) * filename_size);
+	event.filename[filename_size - 1] = '\0';
+
+	// Only `header.size` bytes are stored, not whole PATH_MAX filename
+	WriteRecord(&event, event.header.size);
+}
+
+UINT64 PerfDataWriter::GetTimestamp()
+{
+	static LARGE_INTEGER frequency = []() { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f; }();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return TicksToTimestamp(static_cast<UINT64>(counter.QuadPart), static_cast<UINT64>(frequency.QuadPart));
 }
 
-void PerfDataWriter::Write(std::string filename)
+UINT64 PerfDataWriter::TicksToTimestamp(UINT64 ticks, UINT64 freq)
 {
-	size_t offset = 0;
-	m_file.open(filename.c_str(), std::ios::binary);
-	
-	offset += sizeof(perfdata::perf_file_header);
+	// Split so `ticks * 1000000000` does not overflow for long uptimes
+	return ticks / freq * 1000000000ULL + ticks % freq * 1000000000ULL / freq;
+}
+
+void PerfDataWriter::Open(std::string filename)
+{
+	m_file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open())
+		throw fatal_exception("Failed to open perf.data file");
+
+	m_buffer.reserve(PERF_DATA_BUFFER_SIZE);
+	m_data_size = 0;
+
+	// Header is patched by Close(), data section follows it and grows as records are flushed
+	m_file.write(reinterpret_cast<char*>(&m_file_header), sizeof(perfdata::perf_file_header));
+	m_file_header.data.offset = sizeof(perfdata::perf_file_header);
+}
+
+void PerfDataWriter::Close()
+{
+	if (!m_file.is_open())
+		return;
+
+	FlushRecords();
+
+	m_file_header.data.size = m_data_size;
+	size_t offset = static_cast<size_t>(m_file_header.data.offset + m_file_header.data.size);
+
+	// HEADER_EVENT_DESC: attribute, its IDs and name of each sampled event
+	if (m_attributes.size())
+	{
+		std::vector<char>& section = m_features[perfdata::HEADER_EVENT_DESC];
+		section.clear();
+		append_u32(section, static_cast<UINT32>(m_attributes.size()));
+		append_u32(section, sizeof(perfdata::perf_event_attr));
+		for (size_t i = 0; i < m_attributes.size(); i++)
+		{
+			const char* attr = reinterpret_cast<const char*>(&m_attributes[i].attr);
+			section.insert(section.end(), attr, attr + sizeof(perfdata::perf_event_attr));
+			append_u32(section, 1);
+			append_string(section, m_sampling_event_names[i].empty() ? "raw " + MultiByteFromWideString(IntToHexWideString(m_sampling_events[i]).c_str()) : m_sampling_event_names[i]);
+			const char* id = reinterpret_cast<const char*>(&m_sampling_events[i]);
+			section.insert(section.end(), id, id + sizeof(UINT64));
+		}
+		set_feature(perfdata::HEADER_EVENT_DESC);
+	}
+
+	// perf looks for feature sections table right after data section
+	offset += WriteFeatures(offset);
+
 	offset += WriteIDs(offset);
 
 	m_file_header.attrs.offset = offset;
 	m_file_header.attrs.size = sizeof(perfdata::perf_file_attr) * m_attributes.size();
 
 	offset += WriteAttributeSection(offset);
-	
-	m_file_header.data.offset = offset;	
-	m_file_header.data.size = WriteDataSection(offset);
-
-	offset += m_file_header.data.size;
-
-	offset += WriteFeatures(offset, offset + get_features_section_size());
 
 	m_file.seekp(0);
 	m_file.write(reinterpret_cast<char*>(&m_file_header), sizeof(perfdata::perf_file_header));
 	m_file.close();
-}
\ No newline at end of file
+}
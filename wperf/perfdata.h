@@ -29,6 +29,8 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <Windows.h>
+#include <fstream>
+#include <map>
 
 #define PATH_MAX 4096
 
@@ -650,17 +652,8 @@ namespace perfdata
 	/********* LOCAL *****************/
 	const UINT64 PERF_FILE_MAGIC = 0x32454c4946524550LL;
 
-	struct perf_data_string
-	{
-		UINT32 size;
-		char* data; // data[size] string
-	};
-
-	struct perf_data_multi_string
-	{
-		UINT32 count;
-		perf_data_string* data;
-	};
+	const UINT32 PERF_DATA_NAME_ALIGN = 64;		// Strings in feature sections are padded to this size
+	const UINT32 PERF_DATA_CALLCHAIN_MAX = 2;		// Sampled PC and link register
 
 	struct perf_data_comm_event {
 		struct perf_event_header header;
@@ -668,14 +661,23 @@ namespace perfdata
 		char comm[16];
 	};
 
+	// Layout follows PERF_SAMPLE_IP | TID | TIME | ID | CPU | PERIOD | CALLCHAIN,
+	// record holds only `nr` entries of `ips`
 	struct perf_data_sample_event {
 		struct perf_event_header header;
 		UINT64 ip; // Instruction point
 		UINT32 pid, tid;
+		UINT64 time;
 		UINT64 id;
 		UINT32 cpu, res;
+		UINT64 period;
+		UINT64 nr;
+		UINT64 ips[PERF_DATA_CALLCHAIN_MAX];
 	};
 
+	const UINT64 PERF_DATA_SAMPLE_TYPE = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_ID
+		| PERF_SAMPLE_CPU | PERF_SAMPLE_PERIOD | PERF_SAMPLE_CALLCHAIN;
+
 	struct perf_data_mmap_event {
 		struct perf_event_header header;
 		UINT32 pid, tid;
@@ -689,43 +691,48 @@ namespace perfdata
 #include "user_request.h"
 #include "utils.h"
 
+#define PERF_DATA_BUFFER_SIZE	(64 * 1024)	// Bytes of records kept in memory before they are written to data section
+
+/// <summary>
+/// Streams perf.data records to file. Records are stored compactly (only
+/// `header.size` bytes each) in a bounded buffer and written to the data
+/// section as soon as buffer fills up. IDs, attributes, features and file
+/// header are written by Close() when data section size is known.
+/// </summary>
 class PerfDataWriter
 {
-public:
-	typedef std::variant<perfdata::perf_data_comm_event, perfdata::perf_data_sample_event, perfdata::perf_data_mmap_event> PerfEvent;
-
 private:
 	std::ofstream m_file;
 	perfdata::perf_file_header m_file_header { 0 };
 	std::vector<perfdata::perf_file_attr> m_attributes;
 	std::vector<UINT64> m_sampling_events;
+	std::vector<std::string> m_sampling_event_names;		// HEADER_EVENT_DESC names, same order as `m_attributes`
 
-	std::vector<PerfEvent> m_events;
+	std::vector<char> m_buffer;		// Records not yet written to data section
+	UINT64 m_data_size = 0;			// Bytes of records already written to data section
 
-	perfdata::perf_data_multi_string m_cmdline { 0 };
-	size_t m_cmdline_size = 0;
-	bool m_has_cmdline = false;
-
-	short m_feature_count = 0;
+	std::map<UINT64, std::vector<char>> m_features;		// [HEADER_*] -> feature section payload
 
 	inline void set_feature(UINT64 feature)
 	{
 		m_file_header.features[feature / 64] |= (1ULL << (feature % 64));
 	}
 
-	inline size_t get_features_section_size()
-	{
-		return m_feature_count * sizeof(perfdata::perf_file_section);
-	}
+	static void append_u32(std::vector<char>& out, UINT32 value);
+	static void append_string(std::vector<char>& out, const std::string& str);
 
 	size_t WriteAttributeSection(size_t data_offset);
 	size_t WriteIDs(size_t offset);
-	size_t WriteFeatures(size_t file_section_offset, size_t data_offset);
-	size_t WriteDataSection(size_t offset);
+	size_t WriteFeatures(size_t file_section_offset);
+	void WriteRecord(const void* record, size_t size);
+	void FlushRecords();
+
+	size_t find_sampling_event(UINT64 perf_sampling_event) const;
 
-	PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command);
-	PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type);
-	PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff);
+	void write_comm_event(DWORD pid, std::wstring& command);
+	void write_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type);
+	void write_sample_event(DWORD pid, UINT64 ip, UINT64 lr, UINT32 cpu, UINT64 event_type, UINT64 time, UINT64 period);
+	void write_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff);
 	
 public:
 	enum PerfSupportedEventTypes
@@ -741,70 +748,40 @@ public:
 		m_file_header.size = sizeof(perfdata::perf_file_header);
 		m_file_header.attr_size = sizeof(perfdata::perf_file_attr);
 		m_file_header.attrs.offset = sizeof(perfdata::perf_file_header);
-		m_file_header.data.offset = 0;
+		m_file_header.data.offset = sizeof(perfdata::perf_file_header);
 		m_file_header.data.size = 0;
 		m_file_header.event_types.offset = 0;
 		m_file_header.event_types.size = 0;
-
-		m_cmdline.count = 0;
-		m_cmdline.data = NULL;
-	}
-
-	~PerfDataWriter()
-	{
-		if (m_cmdline.data)
-		{
-			for (UINT32 i = 0; i < m_cmdline.count; i++)
-			{
-				if (m_cmdline.data[i].data) delete[] m_cmdline.data[i].data;
-			}
-			delete[] m_cmdline.data;
-		}
 	}
 
 	void WriteCommandLine(const int argc, const wchar_t* argv[]);
 
-	void RegisterSampleEvent(UINT64 perf_sampling_event)
-	{
-		perfdata::perf_file_attr fattr{ 0 };
-		fattr.attr.size = sizeof(perfdata::perf_event_attr);
-		fattr.attr.sample_type = perfdata::PERF_SAMPLE_IP | perfdata::PERF_SAMPLE_TID | perfdata::PERF_SAMPLE_CPU | perfdata::PERF_SAMPLE_ID;
-		// We just need to disable flags as all are enabled by default on perf_event_attr
-		fattr.attr.disabled = 0;
-		fattr.attr.inherit = 0;
-		fattr.attr.pinned = 0;
-		fattr.attr.exclude_user = 0;
-		fattr.attr.exclude_kernel = 0;
-		fattr.attr.precise_ip = 0;
-		fattr.attr.exclude_host = 0;
-		fattr.attr.type = perfdata::PERF_TYPE_RAW;
-		fattr.attr.config = perf_sampling_event;
-
-		fattr.ids.offset = 0;
-		fattr.ids.size = sizeof(UINT64);
-		m_attributes.push_back(fattr);
-		m_sampling_events.push_back(perf_sampling_event);
-	}
+	// HEADER_NRCPUS and HEADER_CPUDESC features
+	void WriteCpuInfo(UINT32 nr_cpus_available, UINT32 nr_cpus_online, const std::wstring& cpu_desc);
 
+	// Add attribute for `perf_sampling_event` sampled every `period` events, repeated calls only update missing name
+	void RegisterSampleEvent(UINT64 perf_sampling_event, UINT64 period = 1, const std::wstring& name = L"");
+
+	// SAMPLE takes (pid, ip, cpu, event) or (pid, ip, lr, cpu, event, time, period), with
+	// first form `time` is 0, `period` is the one registered and callchain holds only `ip`
 	template <typename... Ts>
 	void RegisterEvent(PerfSupportedEventTypes type, Ts... args)
 	{
-		PerfEvent event;
 		switch (type)
 		{
 		case COMM:
 		{
 			if constexpr (sizeof...(Ts) == 2)
 			{
-				event = get_comm_event(args...);
+				write_comm_event(args...);
 			}
 			break;
 		}
 		case SAMPLE:
 		{
-			if constexpr (sizeof...(Ts) == 4)
+			if constexpr (sizeof...(Ts) == 4 || sizeof...(Ts) == 7)
 			{
-				event = get_sample_event(args...);
+				write_sample_event(args...);
 			}
 			break;
 		}
@@ -812,13 +789,25 @@ public:
 		{
 			if constexpr (sizeof...(Ts) == 5)
 			{
-				event = get_mmap_event(args...);
+				write_mmap_event(args...);
 			}
 			break;
 		}
 		}
-		m_events.push_back(event);
 	}
 
-	void Write(std::string filename = "perf.data");
+	// Bytes of records registered so far, written or still buffered
+	UINT64 GetDataSize() const { return m_data_size + m_buffer.size(); }
+
+	// Bytes of records waiting in memory, never more than PERF_DATA_BUFFER_SIZE
+	size_t GetBufferedSize() const { return m_buffer.size(); }
+
+	// Monotonic PERF_SAMPLE_TIME value in nanoseconds
+	static UINT64 GetTimestamp();
+
+	// PERF_SAMPLE_TIME value in nanoseconds of `ticks` of counter running at `freq` Hz
+	static UINT64 TicksToTimestamp(UINT64 ticks, UINT64 freq);
+
+	void Open(std::string filename = "perf.data");
+	void Close();
 };
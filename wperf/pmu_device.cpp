@@ -30,6 +30,7 @@
 
 
 #include <numeric>
+#include <memory>
 #include <assert.h>
 #include "wperf-common/gitver.h"
 #include "pmu_device.h"
@@ -39,6 +40,9 @@
 #include "utils.h"
 #include "parsers.h"
 #include "wperf-common/public.h"
+#include "wperf-common/samplering.h"
+#include "wperf-common/snapshot.h"
+#include "wperf-common/mpxsched.h"
 #include "wperf.h"
 #include "config.h"
 #include "timeline.h"
@@ -711,6 +715,16 @@ void pmu_device::timeline_init()
             ReplaceTokenInString(timeline_filename, "{core}", std::to_string(cores_idx[0]));           // 1st core designation
         }
 
+        if (timeline_binary)
+        {
+            // Binary timeline keeps CSV filename (also templated one) but with its own extension
+            size_t dot = timeline_filename.find_last_of('.');
+            if (dot != std::string::npos && timeline_filename.substr(dot) == ".csv")
+                timeline_filename.erase(dot);
+            timeline_filename += TIMELINE_BIN_EXT;
+            timeline::timeline_headers[static_cast<enum evt_class>(e)].binary = true;
+        }
+
         if (do_verbose)
             m_out.GetOutputStream() << L"timeline file: " << L"'"
                                     << std::wstring(timeline_filename.begin(), timeline_filename.end())
@@ -792,34 +806,81 @@ void pmu_device::set_sample_src(std::vector<struct evt_sample_src>& sample_sourc
         ctl->sources[0].filter_bits = sample_kernel ? 0 : FILTER_BIT_EXCL_EL1;
     }
 
-    ctl->core_idx = cores_idx[0];   // Only one core for sampling!
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_SET_SRC, ctl, (DWORD)sz, NULL, 0, &res_len);
+    // Driver resizes rings only before overflow interrupts are enabled by PMU_CTL_SAMPLE_SET_SRC
+    if (sample_mapped)
+        for (auto core : cores_idx)
+            sample_ring_map(core);
+
+    for (auto core : cores_idx)
+    {
+        ctl->core_idx = core;
+        BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_SET_SRC, ctl, (DWORD)sz, NULL, 0, &res_len);
+        if (!status)
+        {
+            delete[] ctl;
+            throw fatal_exception("PMU_CTL_SAMPLE_SET_SRC failed");
+        }
+    }
     delete[] ctl;
-    if (!status)
-        throw fatal_exception("PMU_CTL_SAMPLE_SET_SRC failed");
 }
 
-// Return false if sample buffer was empty
+// Return false if sample buffers of all sampled cores were empty
 bool pmu_device::get_sample(std::vector<FrameChain>& sample_info)
+{
+    bool got_samples = false;
+
+    for (auto core : cores_idx)
+    {
+        size_t first = sample_info.size();
+
+        auto ring = m_sample_rings.find(core);
+        if (ring != m_sample_rings.end())
+            get_sample_mapped(ring->second, sample_info);
+        else
+            get_sample_ioctl(core, sample_info);
+
+        // Tag each frame with its core so per-core drains merge into one stream
+        for (size_t i = first; i < sample_info.size(); i++)
+            sample_info[i].cpu = core;
+
+        got_samples |= sample_info.size() > first;
+    }
+
+    return got_samples;
+}
+
+void pmu_device::get_sample_mapped(struct sample_ring_shared* ring, std::vector<FrameChain>& sample_info)
+{
+    // Zero-copy: read frames in place and just advance consumer index
+    const FrameChain* frames = nullptr;
+    UINT64 n;
+    while ((n = sample_ring_shared_peek(ring, &frames)) > 0)
+    {
+        sample_info.insert(sample_info.end(), frames, frames + n);
+        sample_ring_shared_consume(ring, n);
+    }
+}
+
+void pmu_device::get_sample_ioctl(uint32_t core, std::vector<FrameChain>& sample_info)
 {
     struct PMUCtlGetSampleHdr hdr;
-    hdr.core_idx = cores_idx[0];
+    hdr.core_idx = core;
     DWORD res_len;
 
-    PMUSamplePayload framesPayload = { 0 };
-
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_GET, &hdr, sizeof(struct PMUCtlGetSampleHdr), &framesPayload, sizeof(PMUSamplePayload), &res_len);
-    if (!status)
-        throw fatal_exception("PMU_CTL_SAMPLE_GET failed");
+    // Payload is too big for the stack, drain per-core ring in batches until it is empty
+    auto framesPayload = std::make_unique<PMUSamplePayload>();
 
-    if (framesPayload.size == 0)
-        return false;
+    do
+    {
+        BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_GET, &hdr, sizeof(struct PMUCtlGetSampleHdr), framesPayload.get(), sizeof(PMUSamplePayload), &res_len);
+        if (!status)
+            throw fatal_exception("PMU_CTL_SAMPLE_GET failed");
 
-    FrameChain* frames = (FrameChain*)framesPayload.payload;
-    for (int i = 0; i < (res_len / sizeof(FrameChain)); i++)
-        sample_info.push_back(frames[i]);
+        if (framesPayload->size == 0)
+            break;
 
-    return true;
+        sample_info.insert(sample_info.end(), framesPayload->payload, framesPayload->payload + framesPayload->size);
+    } while (framesPayload->size == SAMPLE_CHAIN_BUFFER_SIZE);
 }
 
 void pmu_device::start_sample()
@@ -827,13 +888,65 @@ void pmu_device::start_sample()
     struct pmu_ctl_hdr ctl;
     DWORD res_len;
 
-    ctl.cores_idx.cores_count = 1;
-    ctl.cores_idx.cores_no[0] = cores_idx[0];
-    ctl.flags = CTL_FLAG_CORE;
+    // PMU_CTL_SAMPLE_START operates on one core at a time
+    for (auto core : cores_idx)
+    {
+        ctl.cores_idx.cores_count = 1;
+        ctl.cores_idx.cores_no[0] = core;
+        ctl.flags = CTL_FLAG_CORE;
+
+        BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_START, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
+        if (!status)
+            throw fatal_exception("PMU_CTL_SAMPLE_START failed");
+    }
+
+    // Rings are normally mapped by set_sample_src(), here only those unmapped since
+    if (sample_mapped)
+        for (auto core : cores_idx)
+            sample_ring_map(core);
+}
+
+void pmu_device::sample_ring_map(uint32_t core)
+{
+    struct PMUCtlSampleMapHdr hdr;
+    struct PMUSampleRingMap ring_map = { 0 };
+    DWORD res_len;
+
+    if (m_sample_rings.count(core))
+        return;
+
+    hdr.core_idx = core;
+    hdr.capacity = sample_ring_size;
 
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_START, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_MAP, &hdr, sizeof(struct PMUCtlSampleMapHdr), &ring_map, sizeof(struct PMUSampleRingMap), &res_len);
+    if (!status || res_len != sizeof(struct PMUSampleRingMap))
+    {
+        warning(L"PMU_CTL_SAMPLE_MAP failed for core " + std::to_wstring(core) + L", using PMU_CTL_SAMPLE_GET to read samples");
+        return;
+    }
+
+    struct sample_ring_shared* ring = reinterpret_cast<struct sample_ring_shared*>(ring_map.address);
+    m_sample_rings[core] = ring;
+    if (!sample_ring_shared_valid(ring))
+    {
+        sample_ring_unmap(core);
+        throw fatal_exception("PMU_CTL_SAMPLE_MAP returned invalid sample ring");
+    }
+}
+
+void pmu_device::sample_ring_unmap(uint32_t core)
+{
+    struct PMUCtlGetSampleHdr hdr;
+    DWORD res_len;
+
+    if (m_sample_rings.erase(core) == 0)
+        return;
+
+    hdr.core_idx = core;
+
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_UNMAP, &hdr, sizeof(struct PMUCtlGetSampleHdr), NULL, 0, &res_len);
     if (!status)
-        throw fatal_exception("PMU_CTL_SAMPLE_START failed");
+        throw fatal_exception("PMU_CTL_SAMPLE_UNMAP failed");
 }
 
 struct pmu_sample_summary
@@ -901,16 +1014,27 @@ void pmu_device::unlock()
 void pmu_device::stop_sample()
 {
     struct pmu_ctl_hdr ctl;
-    struct pmu_sample_summary summary;
+    struct pmu_sample_summary summary = { 0 };
     DWORD res_len;
 
-    ctl.cores_idx.cores_count = 1;
-    ctl.cores_idx.cores_no[0] = cores_idx[0];
-    ctl.flags = CTL_FLAG_CORE;
+    for (auto core : cores_idx)
+    {
+        struct pmu_sample_summary core_summary;
 
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_STOP, &ctl, sizeof(struct pmu_ctl_hdr), &summary, sizeof(struct pmu_sample_summary), &res_len);
-    if (!status)
-        throw fatal_exception("PMU_CTL_SAMPLE_STOP failed");
+        ctl.cores_idx.cores_count = 1;
+        ctl.cores_idx.cores_no[0] = core;
+        ctl.flags = CTL_FLAG_CORE;
+
+        BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_STOP, &ctl, sizeof(struct pmu_ctl_hdr), &core_summary, sizeof(struct pmu_sample_summary), &res_len);
+        if (!status)
+            throw fatal_exception("PMU_CTL_SAMPLE_STOP failed");
+
+        summary.sample_generated += core_summary.sample_generated;
+        summary.sample_dropped += core_summary.sample_dropped;
+        summary.timer_freq = core_summary.timer_freq;
+
+        sample_ring_unmap(core);
+    }
 
     if (do_verbose)
     {
@@ -925,6 +1049,7 @@ void pmu_device::stop_sample()
 
     sample_summary.sample_generated = summary.sample_generated;
     sample_summary.sample_dropped = summary.sample_dropped;
+    sample_summary.timer_freq = summary.timer_freq;
     m_globalSamplingJSON.m_samples_generated = summary.sample_generated;
     m_globalSamplingJSON.m_samples_dropped = summary.sample_dropped;
 }
@@ -962,10 +1087,23 @@ void pmu_device::start(uint32_t flags = CTL_FLAG_CORE)
     ctl.dmc_idx = dmc_idx;
     ctl.flags = flags;
     drvconfig::get(L"count.period", ctl.period);
+    LONG adaptive = 0;
+    drvconfig::get(L"count.period_adaptive", adaptive);
+    ctl.period_flags = adaptive ? CTL_PERIOD_ADAPTIVE : 0;
 
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_START, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
+    m_start_out = {};
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_START, &ctl, sizeof(struct pmu_ctl_hdr), &m_start_out, sizeof(struct pmu_ctl_out), &res_len);
     if (!status)
         throw fatal_exception("PMU_CTL_START failed");
+
+    if (res_len != sizeof(struct pmu_ctl_out))
+        m_start_out = {};   // Older driver, no start skew reported
+
+    if (do_verbose && m_start_out.timer_freq)
+        m_out.GetOutputStream() << L"start skew: " << DoubleToWideString(((double)m_start_out.skew * 1000000.0) / (double)m_start_out.timer_freq)
+                                << L" us across " << std::dec << m_start_out.cores_count << L" cores"
+                                << (m_start_out.timeouts ? L" (" + std::to_wstring(m_start_out.timeouts) + L" cores did not wait)" : L"")
+                                << std::endl;
 }
 
 void pmu_device::stop(uint32_t flags = CTL_FLAG_CORE)
@@ -978,9 +1116,23 @@ void pmu_device::stop(uint32_t flags = CTL_FLAG_CORE)
     ctl.dmc_idx = dmc_idx;
     ctl.flags = flags;
 
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_STOP, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
+    m_stop_out = {};
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_STOP, &ctl, sizeof(struct pmu_ctl_hdr), &m_stop_out, sizeof(struct pmu_ctl_out), &res_len);
     if (!status)
         throw fatal_exception("PMU_CTL_STOP failed");
+
+    if (res_len != sizeof(struct pmu_ctl_out))
+        m_stop_out = {};    // Older driver, no timer overhead reported
+
+    if (do_verbose && m_stop_out.timer_freq && m_stop_out.dpc_count)
+    {
+        const double us_per_tick = 1000000.0 / (double)m_stop_out.timer_freq;
+        m_out.GetOutputStream() << L"timer DPC overhead: " << std::dec << m_stop_out.dpc_count << L" DPCs, avg "
+                                << DoubleToWideString((double)m_stop_out.dpc_ticks * us_per_tick / (double)m_stop_out.dpc_count)
+                                << L" us, max " << DoubleToWideString((double)m_stop_out.dpc_max_ticks * us_per_tick)
+                                << L" us, period " << m_stop_out.period_min << L"-" << m_stop_out.period_max << L" ms"
+                                << std::endl;
+    }
 }
 
 void pmu_device::reset(uint32_t flags = CTL_FLAG_CORE)
@@ -995,6 +1147,9 @@ void pmu_device::reset(uint32_t flags = CTL_FLAG_CORE)
     BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_RESET, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
     if (!status)
         throw fatal_exception("PMU_CTL_RESET failed");
+
+    if (flags & CTL_FLAG_CORE)
+        m_live_base.clear();
 }
 
 void pmu_device::timeline_params(const std::map<enum evt_class, std::vector<struct evt_noted>>& events, double count_interval, bool include_kernel)
@@ -1147,6 +1302,8 @@ void pmu_device::timeline_header(const std::map<enum evt_class, std::vector<stru
 void pmu_device::events_assign(uint32_t core_idx, std::map<enum evt_class, std::vector<struct evt_noted>> events, bool include_kernel)
 {
     size_t acc_sz = 0;
+    // Only core and DSU events are multiplexed by the driver
+    auto sched_class = [](enum evt_class e_class) { return e_class == EVT_CORE || e_class == EVT_DSU; };
 
     for (const auto& a : events)
     {
@@ -1154,6 +1311,8 @@ void pmu_device::events_assign(uint32_t core_idx, std::map<enum evt_class, std::
         size_t e_num = a.second.size();
 
         acc_sz += sizeof(struct evt_hdr) + e_num * sizeof(uint16_t);
+        if (sched_class(e_class))
+            acc_sz += e_num * sizeof(struct evt_sched_attr);
         multiplexings[e_class] = !!(e_num > gpc_nums[e_class]);
     }
 
@@ -1187,6 +1346,24 @@ void pmu_device::events_assign(uint32_t core_idx, std::map<enum evt_class, std::
         for (const auto& b : a.second)
             *payload++ = b.index;
 
+        if (sched_class(e_class))
+        {
+            // Group and weight of each event for the driver multiplexing scheduler, see mpxsched.h.
+            // Padding stays in the list so counter indexes don't change, but is never scheduled.
+            hdr->flags |= EVT_HDR_FLAG_SCHED;
+            struct evt_sched_attr* attrs = reinterpret_cast<struct evt_sched_attr*>(payload);
+
+            for (const auto& b : a.second)
+            {
+                bool grouped = b.type == EVT_GROUPED || b.type == EVT_METRIC_GROUPED;
+                attrs->group = grouped ? static_cast<UINT16>(b.group + 1) : 0;
+                attrs->weight = b.type == EVT_PADDING ? 0 : b.weight;
+                attrs++;
+            }
+
+            payload = reinterpret_cast<uint16_t*>(attrs);
+        }
+
         ctl2 = payload;
     }
 
@@ -1195,52 +1372,99 @@ void pmu_device::events_assign(uint32_t core_idx, std::map<enum evt_class, std::
         throw fatal_exception("PMU_CTL_ASSIGN_EVENTS failed");
 }
 
-void pmu_device::core_events_read_nth(uint8_t core_no)
+void pmu_device::core_events_read()
 {
-    struct pmu_ctl_hdr ctl;
-    DWORD res_len;
+    events_read_batch(CTL_FLAG_CORE);
+}
+
+bool pmu_device::core_events_live_probe()
+{
+    if (cores_idx.empty())
+        return false;
+
+    struct pmu_ctl_hdr ctl { 0 };
+    DWORD res_len = 0;
 
     ctl.cores_idx.cores_count = 1;
-    ctl.cores_idx.cores_no[0] = core_no;
-    ctl.flags = CTL_FLAG_CORE;
+    ctl.cores_idx.cores_no[0] = cores_idx[0];
+    ctl.flags = CTL_FLAG_CORE | CTL_FLAG_LIVE;
 
-    LPVOID out_buf = core_outs.get() + core_no;
-    size_t out_buf_len = sizeof(ReadOut);
-    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_READ_COUNTING, &ctl, (DWORD)sizeof(struct pmu_ctl_hdr), out_buf, (DWORD)out_buf_len, &res_len);
-    if (!status)
-        throw fatal_exception("PMU_CTL_READ_COUNTING failed");
+    // Older drivers reject CTL_FLAG_LIVE
+    const size_t out_buf_len = COUNTING_SNAPSHOT_MAX_SIZE(1, MAX_MANAGED_CORE_EVENTS);
+    if (m_snapshot_buf.size() < out_buf_len)
+        m_snapshot_buf.resize(out_buf_len);
+
+    return DeviceAsyncIoControl(m_device_handle, PMU_CTL_READ_COUNTING_BATCH, &ctl, (DWORD)sizeof(struct pmu_ctl_hdr), m_snapshot_buf.data(), (DWORD)out_buf_len, &res_len);
 }
 
-void pmu_device::core_events_read()
+void pmu_device::core_events_read_live()
 {
-    for (uint8_t core_no : cores_idx)
+    events_read_batch(CTL_FLAG_CORE | CTL_FLAG_LIVE);
+
+    const bool first = m_live_base.empty();
+    if (first)
+        m_live_base.resize(core_num);
+
+    // Keep this reading as the start of the next interval, so no counts are lost between intervals
+    for (auto i : cores_idx)
     {
-        core_events_read_nth(core_no);
+        ReadOut reading = core_outs[i];
+        if (!first)
+        {
+            const ReadOut& base = m_live_base[i];
+            counting_snapshot_diff(core_outs[i].evts, core_outs[i].evt_num, &core_outs[i].round, base.evts, base.evt_num, base.round);
+        }
+        m_live_base[i] = reading;
     }
 }
 
-void pmu_device::dsu_events_read_nth(uint8_t core_no)
+void pmu_device::events_read_batch(uint32_t flags)
 {
-    struct pmu_ctl_hdr ctl;
-    DWORD res_len;
+    // Driver accepts up to MAX_PMU_CTL_CORES_COUNT - 1 cores per request, see check_cores_in_pmu_ctl_hdr_p()
+    const size_t batch_max = MAX_PMU_CTL_CORES_COUNT - 1;
+    const size_t max_evt_num = flags == CTL_FLAG_DSU ? MAX_MANAGED_DSU_EVENTS : MAX_MANAGED_CORE_EVENTS;
 
-    ctl.cores_idx.cores_count = 1;
-    ctl.cores_idx.cores_no[0] = core_no;
-    ctl.flags = CTL_FLAG_DSU;
+    for (size_t first = 0; first < cores_idx.size(); first += batch_max)
+    {
+        struct pmu_ctl_hdr ctl { 0 };
+        DWORD res_len = 0;
 
-    LPVOID out_buf = dsu_outs.get() + (core_no / dsu_cluster_size);
-    size_t out_buf_len = sizeof(DSUReadOut);
-    BOOL status = DeviceAsyncIoControl(m_device_handle, DSU_CTL_READ_COUNTING, &ctl, (DWORD)sizeof(struct pmu_ctl_hdr), out_buf, (DWORD)out_buf_len, &res_len);
-    if (!status)
-        throw fatal_exception("DSU_CTL_READ_COUNTING failed");
+        const size_t count = (std::min)(batch_max, cores_idx.size() - first);
+        ctl.cores_idx.cores_count = count;
+        std::copy(cores_idx.begin() + first, cores_idx.begin() + first + count, ctl.cores_idx.cores_no);
+        ctl.flags = flags;
+
+        const size_t out_buf_len = COUNTING_SNAPSHOT_MAX_SIZE(count, max_evt_num);
+        if (m_snapshot_buf.size() < out_buf_len)
+            m_snapshot_buf.resize(out_buf_len);
+
+        BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_READ_COUNTING_BATCH, &ctl, (DWORD)sizeof(struct pmu_ctl_hdr), m_snapshot_buf.data(), (DWORD)out_buf_len, &res_len);
+        if (!status)
+            throw fatal_exception("PMU_CTL_READ_COUNTING_BATCH failed");
+
+        const struct counting_snapshot_hdr* snapshot = reinterpret_cast<const struct counting_snapshot_hdr*>(m_snapshot_buf.data());
+        if (!counting_snapshot_check(snapshot, res_len, core_num, (UINT32)max_evt_num))
+            throw fatal_exception("PMU_CTL_READ_COUNTING_BATCH returned malformed snapshot");
+
+        for (auto entry = counting_snapshot_next(snapshot, nullptr); entry; entry = counting_snapshot_next(snapshot, entry))
+        {
+            if (flags == CTL_FLAG_DSU)
+            {
+                DSUReadOut& out = dsu_outs[entry->core_idx / dsu_cluster_size];
+                counting_snapshot_copy(entry, &out.evt_num, &out.round, out.evts);
+            }
+            else
+            {
+                ReadOut& out = core_outs[entry->core_idx];
+                counting_snapshot_copy(entry, &out.evt_num, &out.round, out.evts);
+            }
+        }
+    }
 }
 
 void pmu_device::dsu_events_read(void)
 {
-    for (uint8_t core_no : cores_idx)
-    {
-        dsu_events_read_nth(core_no);
-    }
+    events_read_batch(CTL_FLAG_DSU);
 }
 
 void pmu_device::dmc_events_read(void)
@@ -1373,7 +1597,7 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
 
     uint32_t core_base = cores_idx[0];
     std::unique_ptr<agg_entry[]> overall;
-    std::vector<std::wstring> timeline_event_values;
+    std::vector<uint64_t> timeline_event_values;
 
     if (all_cores_p())
     {
@@ -1430,8 +1654,8 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
 
             if (multiplexing)
             {
-                timeline_event_values.push_back(std::to_wstring(evt->value));
-                timeline_event_values.push_back(std::to_wstring(evt->scheduled));
+                timeline_event_values.push_back(evt->value);
+                timeline_event_values.push_back(evt->scheduled);
 
                 if (evt->event_idx == CYCLE_EVT_IDX) {
                     col_counter_value.push_back(evt->value);
@@ -1458,7 +1682,7 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
             }
             else
             {
-                timeline_event_values.push_back(std::to_wstring(evt->value));
+                timeline_event_values.push_back(evt->value);
                 if (evt->event_idx == CYCLE_EVT_IDX) {
                     col_counter_value.push_back(evt->value);
                     col_event_name.push_back(pmu_events_get_event_name((uint16_t)evt->event_idx));
@@ -1507,7 +1731,7 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
     }
 
     if (timeline_mode)
-        timeline::timeline_header_event_values[e_class].push_back(timeline_event_values);
+        timeline::push_event_values(e_class, timeline_event_values);
 
     if (!overall)
         return;
@@ -1587,69 +1811,130 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
     }
 }
 
-void pmu_device::print_core_metrics(std::vector<struct evt_noted>& events)
+const metric_program& pmu_device::get_metric_program(const struct product_metric& metric)
 {
-    const enum evt_class e_class = EVT_CORE;
-    std::vector<std::wstring> col_core, col_product_name, col_metric_name, col_metric_value, metric_unit;
+    auto it = m_metric_programs.find(metric.name);
+    if (it == m_metric_programs.end())
+        it = m_metric_programs.emplace(metric.name, metric_compile_shunting_yard_expression(metric.metric_formula_sy)).first;
+    return it->second;
+}
 
-    for (uint32_t i : cores_idx)
+void pmu_device::core_metrics_evaluate(std::vector<struct evt_noted>& events, std::vector<const struct product_metric*>& metrics,
+    std::vector<double>& metric_values)
+{
+    // Metric (formula) bound to event slots, same for all cores
+    struct metric_binding
     {
-        const uint32_t evt_num = core_outs[i].evt_num;
-        struct pmu_event_usr* evts = core_outs[i].evts;
+        const struct product_metric* metric;
+        const metric_program* program;
+        std::vector<std::pair<size_t, uint32_t>> slots;     // [event index in `evts`, metric program slot]
+    };
+    std::vector<struct metric_binding> bindings;
 
+    if (cores_idx.size() && m_product_name.size() && m_product_metrics.count(m_product_name))
+    {
         std::map<std::wstring, std::set<int>> event_metrics;        // [metric_name] -> set of groups
 
         for (const struct evt_noted& event : events)
             if (event.metric.size())
                 event_metrics[event.metric].insert(event.group);
 
+        // All cores are programmed with the same events, take event indexes from the first one
+        const uint32_t evt_num = core_outs[cores_idx[0]].evt_num;
+        struct pmu_event_usr* evts = core_outs[cores_idx[0]].evts;
+
         // Seach if we have metric we can calculate with the formula
         for (const auto& [metric, groups] : event_metrics)
         {
-            for (const auto group : groups)
-            {
-                if (m_product_name.empty())
-                    break;
-
-                if (m_product_metrics.count(m_product_name) == 0)
-                    break;
-
-                if (m_product_metrics[m_product_name].count(metric) == 0)
-                    break;
+            if (m_product_metrics[m_product_name].count(metric) == 0)
+                continue;
 
-                const auto& product_metric = m_product_metrics[m_product_name][metric];
+            const auto& product_metric = m_product_metrics[m_product_name][metric];
+            const metric_program& program = get_metric_program(product_metric);
 
-                std::map<std::wstring, double> vars;
-                const std::wstring& formula_sy = product_metric.metric_formula_sy;
+            for (const auto group : groups)
+            {
+                struct metric_binding binding = { &product_metric, &program, {} };
 
                 for (auto it = events.begin(); it != events.end(); it++)
                 {
                     const auto& event = *it;
                     const auto index = it - events.begin() + 1;
                     assert(index < evt_num);
-                    struct pmu_event_usr* evt = &evts[index];
 
                     if (event.metric == metric && event.group == group)
                     {
-                        std::wstring event_name = pmu_events_get_event_name((uint16_t)evt->event_idx);
-                        vars[event_name] = static_cast<double>(evt->value);
+                        std::wstring event_name = pmu_events_get_event_name((uint16_t)evts[index].event_idx);
+                        int slot = program.get_slot(event_name);
+                        if (slot >= 0)
+                            binding.slots.push_back({ index, static_cast<uint32_t>(slot) });
                     }
                 }
 
-                double metric_value = metric_calculate_shunting_yard_expression(vars, formula_sy);
-
-                col_core.push_back(std::to_wstring(i));
-                col_product_name.push_back(m_product_name);
-                col_metric_name.push_back(product_metric.name);
-                col_metric_value.push_back(DoubleToWideString(metric_value, 3));
-                metric_unit.push_back(product_metric.metric_unit);
+                bindings.push_back(binding);
             }
         }
     }
 
+    // Evaluate each metric for all cores at once, `slot_values` is [slot][core] matrix
+    const size_t cores_num = cores_idx.size();
+    std::vector<double> slot_values, scratch;
+    metric_values.assign(bindings.size() * cores_num, 0.0);
+    for (size_t b = 0; b < bindings.size(); b++)
+    {
+        const auto& binding = bindings[b];
+
+        slot_values.assign(binding.program->vars.size() * cores_num, 0.0);
+        for (size_t c = 0; c < cores_num; c++)
+        {
+            struct pmu_event_usr* evts = core_outs[cores_idx[c]].evts;
+            for (const auto& [index, slot] : binding.slots)
+                slot_values[slot * cores_num + c] = static_cast<double>(evts[index].value);
+        }
+
+        metric_evaluate_batch(*binding.program, slot_values.data(), cores_num, &metric_values[b * cores_num], scratch);
+    }
+
+    metrics.clear();
+    for (const auto& binding : bindings)
+        metrics.push_back(binding.metric);
+}
+
+void pmu_device::print_core_metrics(std::vector<struct evt_noted>& events)
+{
+    std::vector<const struct product_metric*> metrics;
+    std::vector<double> metric_values;
+    core_metrics_evaluate(events, metrics, metric_values);
+    print_core_metrics(metrics, metric_values);
+}
+
+void pmu_device::print_core_metrics(const std::vector<const struct product_metric*>& metrics, const std::vector<double>& metric_values)
+{
+    const enum evt_class e_class = EVT_CORE;
+    std::vector<std::wstring> col_core, col_product_name, col_metric_name, col_metric_value, metric_unit;
+    std::vector<double> timeline_metric_values;
+
+    const size_t cores_num = cores_idx.size();
+    for (size_t c = 0; c < cores_num; c++)
+    {
+        const uint32_t i = cores_idx[c];
+
+        for (size_t b = 0; b < metrics.size(); b++)
+        {
+            const double metric_value = metric_values[b * cores_num + c];
+
+            col_core.push_back(std::to_wstring(i));
+            col_product_name.push_back(m_product_name);
+            col_metric_name.push_back(metrics[b]->name);
+            col_metric_value.push_back(DoubleToWideString(metric_value, 3));
+            timeline_metric_values.push_back(metric_value);
+            metric_unit.push_back(metrics[b]->metric_unit);
+        }
+    }
+
     if (timeline_mode && col_metric_name.size())    // Only add metrics to timeline when metric were calculated
     {
-        timeline::timeline_header_metric_values[e_class].push_back(col_metric_value);
+        timeline::push_metric_values(e_class, timeline_metric_values);
         if (timeline::timeline_header_metric_names[e_class].empty())
         {
             // Calulate how many metrics were speciffied per core
@@ -1692,6 +1977,64 @@ void pmu_device::print_core_metrics(std::vector<struct evt_noted>& events)
     }
 }
 
+void pmu_device::print_core_ndjson(std::vector<struct evt_noted>& events, const std::vector<const struct product_metric*>& metrics,
+    const std::vector<double>& metric_values, ndjson_stream& stream, uint64_t interval, double duration)
+{
+    const bool multiplexing = multiplexings[EVT_CORE];
+
+    const size_t cores_num = cores_idx.size();
+    for (size_t c = 0; c < cores_num; c++)
+    {
+        const uint32_t i = cores_idx[c];
+        const ReadOut& out = core_outs[i];
+
+        struct ndjson_core_record record;
+        record.interval = interval;
+        record.duration = duration;
+        record.core = i;
+        record.multiplexing = multiplexing;
+        record.kernel_mode = count_kernel;
+        record.round = out.round;
+
+        for (size_t j = 0; j < out.evt_num; j++)
+        {
+            if (j >= 1 && (events[j - 1].type == EVT_PADDING))
+                continue;
+
+            const struct pmu_event_usr* evt = &out.evts[j];
+            struct ndjson_event event;
+
+            event.name = pmu_events_get_event_name((uint16_t)evt->event_idx);
+            if (evt->event_idx == CYCLE_EVT_IDX)
+            {
+                event.index = L"fixed";
+                event.note = L"e";
+            }
+            else {
+                event.index = IntToHexWideString(evt->event_idx, 2);
+                event.note = events[j - 1].note;
+            }
+            event.value = evt->value;
+            event.scheduled = evt->scheduled;
+            event.scaled = evt->value;
+            event.scaled_min = event.scaled_max = evt->value;
+            if (multiplexing && evt->scheduled)
+            {
+                event.scaled = mpx_scale(evt->value, evt->scheduled, out.round);
+                if (evt->event_idx != CYCLE_EVT_IDX)
+                    mpx_scale_range(evt->value, evt->scheduled, out.round, evt->delta_min, evt->delta_max, &event.scaled_min, &event.scaled_max);
+            }
+
+            record.events.push_back(event);
+        }
+
+        for (size_t b = 0; b < metrics.size(); b++)
+            record.metrics.push_back({ metrics[b]->name, metric_values[b * cores_num + c], metrics[b]->metric_unit });
+
+        stream.write(record);
+    }
+}
+
 void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool report_l3_metric)
 {
     const enum evt_class e_class = EVT_DSU;
@@ -1716,7 +2059,7 @@ void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool repo
     };
 
     std::unique_ptr<agg_entry[]> overall;
-    std::vector<std::wstring > event_values;
+    std::vector<uint64_t> event_values;
 
     if (all_cores_p())
     {
@@ -1768,8 +2111,8 @@ void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool repo
             {
                 if (timeline_mode)
                 {
-                    event_values.push_back(std::to_wstring(evt->value));
-                    event_values.push_back(std::to_wstring(evt->scheduled));
+                    event_values.push_back(evt->value);
+                    event_values.push_back(evt->scheduled);
                 }
                 else
                 {
@@ -1802,7 +2145,7 @@ void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool repo
             {
                 if (timeline_mode)
                 {
-                    event_values.push_back(std::to_wstring(evt->value));
+                    event_values.push_back(evt->value);
                 }
                 else
                 {
@@ -1857,7 +2200,7 @@ void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool repo
 
     if (timeline_mode)
     {
-        timeline::timeline_header_event_values[e_class].push_back(event_values);
+        timeline::push_event_values(e_class, event_values);
     }
 
     if (!overall)
@@ -2099,7 +2442,7 @@ void pmu_device::print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::
     size_t clkdiv2_events_num = clkdiv2_events.size();
     size_t clk_events_num = clk_events.size();
     uint8_t ch_base = 0, ch_end = 0;
-    std::vector<std::wstring> event_values_clk, event_values_clkdiv2;
+    std::vector<uint64_t> event_values_clk, event_values_clkdiv2;
 
     if (dmc_idx == ALL_DMC_CHANNEL)
     {
@@ -2145,7 +2488,7 @@ void pmu_device::print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::
 
             if (timeline_mode)
             {
-                event_values_clk.push_back(std::to_wstring(evt->value));
+                event_values_clk.push_back(evt->value);
             }
             else
             {
@@ -2168,7 +2511,7 @@ void pmu_device::print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::
 
             if (timeline_mode)
             {
-                event_values_clkdiv2.push_back(std::to_wstring(evt->value));
+                event_values_clkdiv2.push_back(evt->value);
             }
             else
             {
@@ -2218,8 +2561,8 @@ void pmu_device::print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::
     }
     else
     {
-        timeline::timeline_header_event_values[EVT_DMC_CLK].push_back(event_values_clk);
-        timeline::timeline_header_event_values[EVT_DMC_CLKDIV2].push_back(event_values_clkdiv2);
+        timeline::push_event_values(EVT_DMC_CLK, event_values_clk);
+        timeline::push_event_values(EVT_DMC_CLKDIV2, event_values_clkdiv2);
     }
 
     if (!overall_clk && !overall_clkdiv2)
@@ -40,6 +40,7 @@
 
 #include "events.h"
 #include "metric.h"
+#include "ndjson.h"
 #include "spe_device.h"
 #include "wperf-common/iorequest.h"
 
@@ -155,12 +156,15 @@ public:
     {
         uint64_t sample_generated;
         uint64_t sample_dropped;
+        uint64_t timer_freq;        // Unit of `FrameChain::timestamp` in Hz, 0 if driver did not report it
     };
 
     void set_sample_src(std::vector<struct evt_sample_src>& sample_sources, bool sample_kernel);
-    bool get_sample(std::vector<FrameChain>& sample_info);  // Return false if sample buffer was empty
+    bool get_sample(std::vector<FrameChain>& sample_info);  // Return false if sample buffers were empty, frames are tagged with `cpu`
     void start_sample();
     void stop_sample();
+    void sample_ring_map(uint32_t core);     // Map driver sample ring of `sample_ring_size`, fall back to PMU_CTL_SAMPLE_GET on failure
+    void sample_ring_unmap(uint32_t core);
     // Sampling
 
     // Locking
@@ -175,6 +179,7 @@ public:
     void timeline_params(const std::map<enum evt_class, std::vector<struct evt_noted>>& events, double count_interval, bool include_kernel);
     void timeline_header(const std::map<enum evt_class, std::vector<struct evt_noted>>& events);
     std::wstring timeline_output_file;
+    bool timeline_binary = false;   // Write binary timeline (.wtl) instead of CSV
     // Timeline
 
     // Events
@@ -189,9 +194,10 @@ public:
     void stop(uint32_t flags);
     void reset(uint32_t flags);
     void events_assign(uint32_t core_idx, std::map<enum evt_class, std::vector<struct evt_noted>> events, bool include_kernel);
-    void core_events_read_nth(uint8_t core_no);
     void core_events_read();
-    void dsu_events_read_nth(uint8_t core_no);
+    // Live counting (CTL_FLAG_LIVE): read core counters without stopping them
+    bool core_events_live_probe();                      // False if driver can't read running counters
+    void core_events_read_live();                       // `core_outs` get counts since previous live read (or reset)
     void dsu_events_read(void);
     void dmc_events_read(void);
     void events_query(std::map<enum evt_class, std::vector<uint16_t>>& events_out);         // Query for events available to the user
@@ -203,7 +209,14 @@ public:
     void print_dsu_stat(std::vector<struct evt_noted>& events, bool report_l3_metric);
     void print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::vector<struct evt_noted>& clkdiv2_events, bool report_ddr_bw_metric);
 
+    // Evaluate metrics of `events` for all `cores_idx`, `metric_values` is [metric][core] matrix
+    void core_metrics_evaluate(std::vector<struct evt_noted>& events, std::vector<const struct product_metric*>& metrics,
+        std::vector<double>& metric_values);
+
     void print_core_metrics(std::vector<struct evt_noted>& events);
+    void print_core_metrics(const std::vector<const struct product_metric*>& metrics, const std::vector<double>& metric_values);   // Values from core_metrics_evaluate()
+    void print_core_ndjson(std::vector<struct evt_noted>& events, const std::vector<const struct product_metric*>& metrics,
+        const std::vector<double>& metric_values, ndjson_stream& stream, uint64_t interval, double duration);    // One NDJSON record per core, see `--output-ndjson`
 
     static bool do_detect_prep_detect(std::map<std::wstring, std::wstring> &device_interface_list);      // device_interface_list[device_interface] -> hardware_ids
     static void do_detect();
@@ -244,6 +257,8 @@ public:
     uint8_t counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
     std::map<uint8_t, uint8_t> counter_idx_unmap;
     bool do_verbose;
+    bool sample_mapped = true;      // Map driver sample rings into wperf, otherwise copy samples with PMU_CTL_SAMPLE_GET
+    uint32_t sample_ring_size = 0;  // Capacity of mapped sample rings, 0 for driver default
 
     // SPE
     bool m_sampling_with_spe = false;                   // SPE: User requested sampling with SPE
@@ -261,6 +276,8 @@ public:
     std::map<std::wstring, std::map<std::wstring, struct product_event>> m_product_events;       // [product] -> [event_name -> product_event]
     std::map<std::wstring, std::map<std::wstring, struct product_metric>> m_product_metrics;     // [product] -> [metrics_name -> product_metric]
     std::map<std::wstring, std::map<std::wstring, struct product_group_metrics>> m_product_groups_metrics;     // [product] -> [metrics_group_name -> product_metric_group]
+    std::map<std::wstring, metric_program> m_metric_programs;  // [metric_name] -> compiled metric formula of m_product_name
+    const metric_program& get_metric_program(const struct product_metric& metric);    // Compile metric formula on first use
     std::wstring m_product_name;     // Product name used to index Telemetry Solution data structures
     std::wstring get_product_name_ext();                // Human friendly currently selected product string
     std::wstring get_all_product_name_str();            // Human friendly list of available products comma separated string
@@ -283,7 +300,9 @@ public:
     const wchar_t* get_vendor_name(uint8_t vendor_id);
     static std::wstring get_pmu_version_name(UINT64 id_aa64dfr0_el1_value);
 
-    struct pmu_sample_summary sample_summary;
+    struct pmu_sample_summary sample_summary = {};
+    struct pmu_ctl_out m_start_out = {};                // Start skew of last `start()`, zeroed if driver did not report it
+    struct pmu_ctl_out m_stop_out = {};                 // Timer DPC overhead of last `stop()`, zeroed if driver did not report it
 
 private:
     /// <summary>
@@ -329,7 +348,15 @@ private:
     // Use this function to print to wcerr runtime warnings in verbose mode.
     void warning(const std::wstring wrn);
 
+    // Drain one core's sample ring, either mapped (zero-copy) or with PMU_CTL_SAMPLE_GET
+    void get_sample_mapped(struct sample_ring_shared* ring, std::vector<FrameChain>& sample_info);
+    void get_sample_ioctl(uint32_t core, std::vector<FrameChain>& sample_info);
+
+    // Read counters of all `cores_idx` with one PMU_CTL_READ_COUNTING_BATCH, `flags` is CTL_FLAG_CORE (optionally with CTL_FLAG_LIVE) or CTL_FLAG_DSU
+    void events_read_batch(uint32_t flags);
+
     HANDLE m_device_handle;
+    std::map<uint32_t, struct sample_ring_shared*> m_sample_rings;    // Per-core driver sample rings mapped into wperf, see `sample_mapped`
     uint32_t pmu_ver;
     const wchar_t* vendor_name;
     std::vector<uint8_t> cores_idx;                     // Cores
@@ -338,6 +365,8 @@ private:
     std::unique_ptr<ReadOut[]> core_outs;
     std::unique_ptr<DSUReadOut[]> dsu_outs;
     std::unique_ptr<DMCReadOut[]> dmc_outs;
+    std::vector<uint8_t> m_snapshot_buf;                // Output of PMU_CTL_READ_COUNTING_BATCH, see wperf-common/snapshot.h
+    std::vector<ReadOut> m_live_base;                   // Previous live read of each core, empty after reset
     bool multiplexings[EVT_CLASS_NUM];
     bool timeline_mode;
     bool count_kernel;
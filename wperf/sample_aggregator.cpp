@@ -0,0 +1,94 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "sample_aggregator.h"
+
+uint32_t sample_aggregator::intern(const SampleDesc& sd)
+{
+    auto it = m_symbol_ids.find(sd.desc.name);
+    if (it != m_symbol_ids.end())
+        return it->second;
+
+    uint32_t sym_id = static_cast<uint32_t>(m_symbols.size());
+    SampleDesc proto;
+    proto.desc = sd.desc;
+    proto.module = sd.module;
+    m_symbols.push_back(proto);
+    m_symbol_ids[sd.desc.name] = sym_id;
+    return sym_id;
+}
+
+void sample_aggregator::add(uint32_t sym_id, uint32_t event_src, uint64_t pc, uint32_t cpu)
+{
+    const uint64_t key = (static_cast<uint64_t>(sym_id) << 32) | event_src;
+
+    auto it = m_entry_idx.find(key);
+    size_t idx;
+    if (it == m_entry_idx.end())
+    {
+        idx = m_entries.size();
+        m_entries.push_back({ sym_id, event_src });
+        m_entry_idx[key] = idx;
+    }
+    else
+        idx = it->second;
+
+    entry& e = m_entries[idx];
+    e.freq++;
+    e.pc_cpu[std::make_pair(pc, cpu)]++;
+}
+
+std::vector<SampleDesc> sample_aggregator::get_resolved_samples() const
+{
+    std::vector<SampleDesc> result;
+    result.reserve(m_entries.size());
+
+    for (const auto& e : m_entries)
+    {
+        SampleDesc sd = m_symbols[e.sym_id];
+        sd.event_src = e.event_src;
+        sd.freq = static_cast<uint32_t>(e.freq);
+        sd.pc_cpu.insert(e.pc_cpu.begin(), e.pc_cpu.end());
+
+        // `pc_cpu` is ordered by pc, so per-pc totals are consecutive runs
+        for (const auto& [pc_cpu, count] : sd.pc_cpu)
+        {
+            if (!sd.pc.empty() && sd.pc.back().first == pc_cpu.first)
+                sd.pc.back().second += count;
+            else
+                sd.pc.push_back(std::make_pair(pc_cpu.first, count));
+        }
+
+        result.push_back(sd);
+    }
+
+    return result;
+}
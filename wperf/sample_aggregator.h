@@ -0,0 +1,83 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <windows.h>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+#include "pe_file.h"
+
+/* Aggregates resolved raw samples into `SampleDesc` entries.
+
+   Symbols are interned once (by symbol name, the same key the sampling report
+   groups by) and every sample is then accounted with two hash lookups:
+   (symbol id, event_src) -> entry, and (pc, cpu) -> count inside that entry.
+   This keeps post-processing linear in the number of raw samples.
+*/
+class sample_aggregator
+{
+public:
+    // Return stable id of symbol described by `sd`, first call stores `sd` as entry prototype
+    uint32_t intern(const SampleDesc& sd);
+
+    // Account one sample of `event_src` hit at `pc` on `cpu` in symbol `sym_id`
+    void add(uint32_t sym_id, uint32_t event_src, uint64_t pc, uint32_t cpu);
+
+    // Entries in order of first occurrence, with `freq`, `pc` and `pc_cpu` filled
+    std::vector<SampleDesc> get_resolved_samples() const;
+
+    size_t symbol_count() const { return m_symbols.size(); }
+    size_t entry_count() const { return m_entries.size(); }
+
+private:
+    struct pc_cpu_hash
+    {
+        size_t operator()(const std::pair<uint64_t, uint32_t>& k) const
+        {
+            return std::hash<uint64_t>()(k.first ^ (static_cast<uint64_t>(k.second) << 48));
+        }
+    };
+
+    struct entry
+    {
+        uint32_t sym_id;
+        uint32_t event_src;
+        uint64_t freq = 0;
+        std::unordered_map<std::pair<uint64_t, uint32_t>, uint64_t, pc_cpu_hash> pc_cpu;   // [pc, cpu] -> count
+    };
+
+    std::vector<SampleDesc> m_symbols;                      // [sym_id] -> prototype
+    std::unordered_map<std::wstring, uint32_t> m_symbol_ids;  // [desc.name] -> sym_id
+    std::vector<entry> m_entries;
+    std::unordered_map<uint64_t, size_t> m_entry_idx;       // [sym_id << 32 | event_src] -> index in m_entries
+};
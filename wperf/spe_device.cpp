@@ -28,6 +28,10 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
 #include "spe_device.h"
 
 namespace SPEParser
@@ -48,18 +52,9 @@ namespace SPEParser
         TIMESTAMP = 0x71,
         COUNTER = 0x98,
         ADDRESS = 0xB0,
-        ADDRESS_LONG,
-        COUNTER_LONG,
         UNKNOWN
     };
 
-    enum class ParsingState : UINT8
-    {
-        READING_HEADER,
-        READING_DATA,
-        FINISHED,
-    };
-
     enum class AdressType : UINT8
     {
         PC = 0,
@@ -68,7 +63,14 @@ namespace SPEParser
         PA,         // Physical address
         PBT         // Previous branch address
     };
-    
+
+    enum class CounterType : UINT8
+    {
+        TOTAL_LATENCY = 0,
+        ISSUE_LATENCY,
+        TRANSLATION_LATENCY
+    };
+
     enum class OperationTypeClass : UINT8
     {
         OTHER = 0,
@@ -76,331 +78,127 @@ namespace SPEParser
         BRANCH_OR_EXCEPTION
     };
 
-    static PacketType get_packet_type(UINT8 hdr)
+    constexpr UINT64 ADDRESS_MASK = 0x00FFFFFFFFFFFFFF;
+
+    constexpr PacketType get_packet_type(UINT8 hdr)
     {
-        if (hdr == static_cast<std::underlying_type_t<PacketType>>(PacketType::PADDING))                       return PacketType::PADDING;
-        if (hdr == static_cast<std::underlying_type_t<PacketType>>(PacketType::END))                           return PacketType::END;
-        if (hdr == static_cast<std::underlying_type_t<PacketType>>(PacketType::TIMESTAMP))                     return PacketType::TIMESTAMP;
-        if ((hdr & MASK_MIDDLE) == static_cast<std::underlying_type_t<PacketType>>(PacketType::EVENTS))        return PacketType::EVENTS;
-        if ((hdr & MASK_MIDDLE) == static_cast<std::underlying_type_t<PacketType>>(PacketType::DATA_SOURCE))   return PacketType::DATA_SOURCE;
-        if ((hdr & MASK_LAST2) == static_cast<std::underlying_type_t<PacketType>>(PacketType::CONTEXT))        return PacketType::CONTEXT;
-        if ((hdr & MASK_LAST2) == static_cast<std::underlying_type_t<PacketType>>(PacketType::OPERATION_TYPE)) return PacketType::OPERATION_TYPE;
-        if ((hdr & MASK_LAST2) == static_cast<std::underlying_type_t<PacketType>>(PacketType::LONG_HEADER))    return PacketType::LONG_HEADER;
-        if ((hdr & MASK_LAST3) == static_cast<std::underlying_type_t<PacketType>>(PacketType::ADDRESS))        return PacketType::ADDRESS;
-        if ((hdr & MASK_LAST3) == static_cast<std::underlying_type_t<PacketType>>(PacketType::COUNTER))        return PacketType::COUNTER;
+        if (hdr == static_cast<UINT8>(PacketType::PADDING))                       return PacketType::PADDING;
+        if (hdr == static_cast<UINT8>(PacketType::END))                           return PacketType::END;
+        if (hdr == static_cast<UINT8>(PacketType::TIMESTAMP))                     return PacketType::TIMESTAMP;
+        if ((hdr & MASK_MIDDLE) == static_cast<UINT8>(PacketType::EVENTS))        return PacketType::EVENTS;
+        if ((hdr & MASK_MIDDLE) == static_cast<UINT8>(PacketType::DATA_SOURCE))   return PacketType::DATA_SOURCE;
+        if ((hdr & MASK_LAST2) == static_cast<UINT8>(PacketType::CONTEXT))        return PacketType::CONTEXT;
+        if ((hdr & MASK_LAST2) == static_cast<UINT8>(PacketType::OPERATION_TYPE)) return PacketType::OPERATION_TYPE;
+        if ((hdr & MASK_LAST2) == static_cast<UINT8>(PacketType::LONG_HEADER))    return PacketType::LONG_HEADER;
+        if ((hdr & MASK_LAST3) == static_cast<UINT8>(PacketType::ADDRESS))        return PacketType::ADDRESS;
+        if ((hdr & MASK_LAST3) == static_cast<UINT8>(PacketType::COUNTER))        return PacketType::COUNTER;
 
         return PacketType::UNKNOWN;
     }
 
-    class Packet
+    constexpr UINT8 get_payload_size(UINT8 hdr)
     {
-    public:
-        UINT8 m_header0, m_header1;
-        size_t m_bytes_read;
-        size_t m_bytes_to_read;
-        size_t m_payload_index;
-        UINT64 m_payload;
-        PacketType m_type;
-        ParsingState m_state;
-
-        Packet() : m_header0(0), m_header1(0), m_type(PacketType::UNKNOWN), m_state(ParsingState::READING_HEADER), m_bytes_read(0), m_bytes_to_read(0), m_payload(0), m_payload_index(0) {}
-
-        void add(UINT8 byte)
+        switch (get_packet_type(hdr))
         {
-            if (m_state == ParsingState::READING_HEADER)
-            {
-                PacketType type = get_packet_type(byte);
-                switch (type)
-                {
-                case PacketType::ADDRESS:
-                case PacketType::COUNTER:
-                {
-                    if (m_bytes_read >= 1)
-                    {
-                        m_type = type == PacketType::ADDRESS ? PacketType::ADDRESS_LONG : PacketType::COUNTER_LONG;
-                        m_header1 = byte;
-                    }
-                    else {
-                        m_type = type;
-                        m_header0 = byte;
-                        m_bytes_to_read = 8;
-                    }
-                    m_bytes_to_read = type == PacketType::ADDRESS ? 8 : 2;
-                    m_state = ParsingState::READING_DATA;
-                    break;
-                }
-                case PacketType::END:
-                {
-                    m_type = type;
-                    m_header0 = byte;
-                    m_state = ParsingState::FINISHED;
-                    m_bytes_to_read = 0;
-                    break;
-                }
-                case PacketType::EVENTS:
-                case PacketType::DATA_SOURCE:
-                {
-                    m_type = type;
-                    m_header0 = byte;
-                    m_state = ParsingState::READING_DATA;
-                    m_bytes_to_read = (static_cast<size_t>((m_header0 & (~MASK_MIDDLE)) >> 4)) + 1;
-                    break;
-                }
-                case PacketType::OPERATION_TYPE:
-                {
-                    m_type = type;
-                    m_header0 = byte;
-                    m_state = ParsingState::READING_DATA;
-                    m_bytes_to_read = 1;
-                    break;
-                }
-                case PacketType::CONTEXT:
-                {
-                    m_type = type;
-                    m_header0 = byte;
-                    m_state = ParsingState::READING_DATA;
-                    m_bytes_to_read = 4;
-                    break;
-                }
-                case PacketType::TIMESTAMP:
-                {
-                    m_type = type;
-                    m_header0 = byte;
-                    m_state = ParsingState::READING_DATA;
-                    m_bytes_to_read = 8;
-                    break;
-                }
-                case PacketType::LONG_HEADER: m_header0 = byte; break;
-                }
-            }
-            else if (m_state == ParsingState::FINISHED) {
-            }
-            else {
-                m_bytes_to_read--;
-                m_payload |= (static_cast<uint64_t>(byte) << m_payload_index * 8);
-                m_payload_index++;
-                if (m_bytes_to_read == 0)
-                {
-                    m_state = ParsingState::FINISHED;
-                }
-            }
-            m_bytes_read++;
+        case PacketType::EVENTS:
+        case PacketType::DATA_SOURCE:       return static_cast<UINT8>(1 << ((hdr >> 4) & 0x3));    // 1, 2, 4 or 8 bytes
+        case PacketType::OPERATION_TYPE:    return 1;
+        case PacketType::CONTEXT:           return 4;
+        case PacketType::TIMESTAMP:         return 8;
+        case PacketType::ADDRESS:           return 8;
+        case PacketType::COUNTER:           return 2;
         }
-    };
-    class AddressPacket : public Packet
-    {
-    public:
-        UINT64 m_address;
-        UINT8 m_index;
-        AdressType m_address_type;
-
-
-        AddressPacket(const Packet& p)
-        {
-            m_payload = p.m_payload;
-            m_type = p.m_type;
-            m_header0 = p.m_header0;
-            m_header1 = p.m_header1;
-            m_address = m_payload & 0x00FFFFFFFFFFFF;
-
-            if (m_type == PacketType::ADDRESS_LONG)
-            {
-                m_index = ((m_header0 & (~MASK_LAST2)) << 3) || (m_header1 & (~MASK_LAST3));
-            }
-            else {
-                m_index = m_header0 & (~MASK_LAST3);
-            }
+        return 0;
+    }
 
-            m_address_type = static_cast<AdressType>(m_index);
-        }
+    struct PacketDesc
+    {
+        PacketType type;
+        UINT8 size;         // Payload size in bytes
     };
 
-    class EventPacket : public Packet
+    struct PacketTable
     {
-        union EventBit
-        {
-            struct BitFields
-            {
-                unsigned generated_exception : 1;
-                unsigned architecturally_executed : 1;
-                unsigned level1_data_cache_acess : 1;
-                unsigned level1_data_cache_refill : 1;
-                unsigned tlb_access : 1;
-                unsigned tlb_walk : 1;
-                unsigned not_taken : 1;
-                unsigned mispredicted : 1;
-                unsigned last_level_cache_access : 1;
-                unsigned last_level_cache_miss : 1;
-                unsigned remote_access : 1;
-                unsigned alignment : 1;
-                unsigned res0 : 4;
-                unsigned zero : 1;
-                unsigned partial_predicate : 1;
-                unsigned empty_predicate : 1;
-                unsigned res1 : 19;
-            } bitFields;
-            UINT64 val;
-        };
-
-        EventBit eb;
-    public:
-        EventPacket(const Packet& p)
-        {
-            m_payload = p.m_payload;
-            m_type = p.m_type;
-            m_header0 = p.m_header0;
-            m_header1 = p.m_header1;
-            eb.val = m_payload;
-        }
+        PacketDesc desc[256];
 
-        std::wstring get_event_desc() const
+        constexpr PacketTable() : desc()
         {
-            std::wstring desc = L"";
-            if (eb.bitFields.alignment) desc += L"alignment+";
-            if (eb.bitFields.architecturally_executed) desc += L"retired+";
-            if (eb.bitFields.empty_predicate) desc += L"sve-empty-predicate+";
-            if (eb.bitFields.generated_exception) desc += L"generated-exception+";
-            if (eb.bitFields.last_level_cache_access) desc += L"last-level-cache-access+";
-            if (eb.bitFields.last_level_cache_miss) desc += L"last-level-cache-miss+";
-            if (eb.bitFields.level1_data_cache_acess) desc += L"level1-data-cache-access+";
-            if (eb.bitFields.level1_data_cache_refill) desc += L"level1-data-cache-refill+";
-            if (eb.bitFields.mispredicted) desc += L"mispredicted+";
-            if (eb.bitFields.not_taken) desc += L"not-taken+";
-            if (eb.bitFields.partial_predicate) desc += L"sve-partial-predicate+";
-            if (eb.bitFields.remote_access) desc += L"remote-acess+";
-            if (eb.bitFields.tlb_access) desc += L"tlb_access+";
-            if (eb.bitFields.tlb_walk) desc += L"tlb-walk+";
-            return std::wstring(desc.begin(), desc.end() - 1);
+            for (int hdr = 0; hdr < 256; hdr++)
+                desc[hdr] = { get_packet_type(static_cast<UINT8>(hdr)), get_payload_size(static_cast<UINT8>(hdr)) };
         }
     };
 
-    class OperationTypePacket : public Packet
-    {
-    public:
-        OperationTypeClass m_class;
-        bool m_is_store;
+    // Header byte -> packet type and payload length
+    static constexpr PacketTable packet_table;
 
-        OperationTypePacket(const Packet& p)
-        {
-            m_payload = p.m_payload;
-            m_type = p.m_type;
-            m_header0 = p.m_header0;
-            m_header1 = p.m_header1;
-            m_class = static_cast<OperationTypeClass>(m_header0 & (~MASK_LAST2));
-            m_is_store = m_payload & 1;
-        }
+    static UINT64 read_payload(const UINT8* p, UINT8 size)
+    {
+        UINT64 payload = 0;
+        memcpy(&payload, p, size);      // Payload is little-endian, same as Arm64 and x64
+        return payload;
+    }
 
-        std::wstring get_subclass() const
-        {
-            switch (m_class)
-            {
-            case OperationTypeClass::LOAD_STORE_ATOMIC:
-            {
-                uint64_t v = m_payload >> 1;
-                std::wstring ldst = (m_payload & 1) ? L"STORE-" : L"LOAD-";
-                if (v == 0)
-                {
-                    return ldst + L"GP";
-                }
-                else if (v == 2)
-                {
-                    return ldst + L"SIMD-FP";
-                }
-                else {
-                    return ldst + L"OTHER";
-                }
-                break;
-            }
-            case OperationTypeClass::BRANCH_OR_EXCEPTION:
-                return std::wstring(((m_payload & 1) ? L"CONDITIONAL-" : L"UNCONDITIONAL-")) + std::wstring(((m_payload & 2) ? L"INDIRECT" : L"DIRECT"));
-            }
-            return L"";
-        }
+    static std::wstring get_event_desc(UINT64 events)
+    {
+        // Ordered by name
+        static const std::pair<UINT8, const wchar_t*> names[] = {
+            { 11, L"alignment" },
+            { 1,  L"retired" },
+            { 18, L"sve-empty-predicate" },
+            { 0,  L"generated-exception" },
+            { 8,  L"last-level-cache-access" },
+            { 9,  L"last-level-cache-miss" },
+            { 2,  L"level1-data-cache-access" },
+            { 3,  L"level1-data-cache-refill" },
+            { 7,  L"mispredicted" },
+            { 6,  L"not-taken" },
+            { 17, L"sve-partial-predicate" },
+            { 10, L"remote-acess" },
+            { 4,  L"tlb_access" },
+            { 5,  L"tlb-walk" },
+        };
 
-        std::wstring get_class()
-        {
-            switch (m_class)
+        std::wstring desc;
+        for (const auto& [bit, name] : names)
+            if (events & (1ULL << bit))
             {
-            case OperationTypeClass::OTHER:                return L"OTHER";
-            case OperationTypeClass::LOAD_STORE_ATOMIC:    return L"LOAD_STORE_ATOMIC";
-            case OperationTypeClass::BRANCH_OR_EXCEPTION:  return L"BRANCH_OR_EXCEPTION";
+                if (desc.size())
+                    desc += L"+";
+                desc += name;
             }
-            return L"";
-        }
+        return desc;
+    }
 
-        std::wstring get_desc()
-        {
-            return get_class() + ((m_class != OperationTypeClass::OTHER) ? L"-" : L"") + get_subclass();
-        }
-    };
+    // Event bits used by get_event_desc()
+    constexpr UINT64 EVENTS_DESC_MASK = 0x60FFF;
 
-    class Record
+    static std::wstring get_optype_desc(UINT8 optype_class, UINT8 optype)
     {
-    public:
-        std::vector<Packet> m_packets;
-        std::wstring m_event_name;
-        std::wstring m_optype_name;
-        std::wstring m_full_desc;
-        UINT64 m_pc;
-
-        Record() : m_pc(0) {}
-
-        void parse_record_data()
+        switch (static_cast<OperationTypeClass>(optype_class))
         {
-            for (const auto& packet : m_packets)
-            {
-                switch (packet.m_type)
-                {
-                case PacketType::ADDRESS:
-                case PacketType::ADDRESS_LONG:
-                {
-                    AddressPacket ap = packet;
-                    if (ap.m_address_type == AdressType::PC)
-                    {
-                        m_pc = ap.m_address;
-                    }
-                    break;
-                }
-                case PacketType::OPERATION_TYPE:
-                {
-                    OperationTypePacket op = packet;
-                    m_optype_name = op.get_desc();
-                    break;
-                }
-                case PacketType::EVENTS:
-                {
-                    EventPacket ep = packet;
-                    m_event_name = ep.get_event_desc();
-                    break;
-                }
-                }
-            }
-            m_full_desc = m_optype_name + L"/" + m_event_name;
+        case OperationTypeClass::OTHER:
+            return L"OTHER";
+        case OperationTypeClass::LOAD_STORE_ATOMIC:
+        {
+            const UINT8 v = optype >> 1;
+            std::wstring ldst = (optype & 1) ? L"STORE-" : L"LOAD-";
+            return L"LOAD_STORE_ATOMIC-" + ldst + (v == 0 ? L"GP" : v == 2 ? L"SIMD-FP" : L"OTHER");
         }
-    };
+        case OperationTypeClass::BRANCH_OR_EXCEPTION:
+            return std::wstring(L"BRANCH_OR_EXCEPTION-") + ((optype & 1) ? L"CONDITIONAL-" : L"UNCONDITIONAL-") + ((optype & 2) ? L"INDIRECT" : L"DIRECT");
+        }
+        return L"-";
+    }
 
-    static std::vector<std::pair<std::wstring, UINT64>> read_spe_buffer(const std::vector<UINT8>& buffer)
+    // Records with the same key have the same get_record_desc()
+    static UINT64 get_record_desc_key(const struct spe_record& rec)
     {
-        std::vector<std::pair<std::wstring, UINT64>> records;
-        std::vector<Packet> packets;
-        packets.resize(packets.size() + 1);
-        for (const UINT8 byte : buffer)
-        {
-            packets.back().add(byte);
-            if (packets.back().m_state == ParsingState::FINISHED)
-            {
-                if (packets.back().m_type == PacketType::END || packets.back().m_type == PacketType::TIMESTAMP)
-                {
-                    Record rec;
-                    rec.m_packets = std::vector<Packet>(packets.begin(), packets.end());
-                    rec.parse_record_data();
-                    records.push_back(std::make_pair(rec.m_full_desc, rec.m_pc));
-                    packets.clear();
-                }
-                packets.resize(packets.size() + 1);
-            }
-        }
-        return records;
+        UINT64 key = rec.flags & (SPE_RECORD_HAS_EVENTS | SPE_RECORD_HAS_OPTYPE);
+        if (rec.flags & SPE_RECORD_HAS_EVENTS)
+            key |= (rec.events & EVENTS_DESC_MASK) << 16;
+        if (rec.flags & SPE_RECORD_HAS_OPTYPE)
+            key |= (static_cast<UINT64>(rec.optype_class) << 48) | (static_cast<UINT64>(rec.optype) << 40);
+        return key;
     }
 }
 
@@ -439,24 +237,228 @@ void spe_device::init()
 
 }
 
+size_t spe_device::decode_records(const UINT8* buf, size_t size, std::vector<struct spe_record>& records)
+{
+    using namespace SPEParser;
+
+    struct spe_record rec = { 0 };
+    size_t pos = 0, consumed = 0;
+
+    while (pos < size)
+    {
+        const UINT8 hdr0 = buf[pos];
+        UINT8 hdr1 = 0;
+        PacketDesc desc = packet_table.desc[hdr0];
+        size_t hdr_len = 1;
+
+        if (desc.type == PacketType::LONG_HEADER)
+        {
+            if (pos + 1 >= size)
+                break;
+
+            hdr1 = buf[pos + 1];
+            desc = packet_table.desc[hdr1];
+            if (desc.type != PacketType::ADDRESS && desc.type != PacketType::COUNTER)
+            {
+                pos++;      // Stray long header prefix, skip it
+                continue;
+            }
+            hdr_len = 2;
+        }
+        else if (desc.type == PacketType::PADDING || desc.type == PacketType::UNKNOWN)
+        {
+            pos++;
+            continue;
+        }
+
+        if (pos + hdr_len + desc.size > size)
+            break;          // Packet truncated at the end of the buffer
+
+        const UINT64 payload = read_payload(buf + pos + hdr_len, desc.size);
+        const UINT8 index = hdr_len == 2 ? static_cast<UINT8>(((hdr0 & ~MASK_LAST2) << 3) | (hdr1 & ~MASK_LAST3))
+                                         : static_cast<UINT8>(hdr0 & ~MASK_LAST3);
+        pos += hdr_len + desc.size;
+
+        switch (desc.type)
+        {
+        case PacketType::ADDRESS:
+            switch (static_cast<AdressType>(index))
+            {
+            case AdressType::PC: rec.pc = payload & ADDRESS_MASK; rec.flags |= SPE_RECORD_HAS_PC; break;
+            case AdressType::VA: rec.data_va = payload & ADDRESS_MASK; rec.flags |= SPE_RECORD_HAS_DATA_VA; break;
+            case AdressType::PA: rec.data_pa = payload & ADDRESS_MASK; rec.flags |= SPE_RECORD_HAS_DATA_PA; break;
+            }
+            break;
+        case PacketType::COUNTER:
+            switch (static_cast<CounterType>(index))
+            {
+            case CounterType::TOTAL_LATENCY: rec.total_latency = static_cast<UINT16>(payload); rec.flags |= SPE_RECORD_HAS_TOTAL_LATENCY; break;
+            case CounterType::ISSUE_LATENCY: rec.issue_latency = static_cast<UINT16>(payload); rec.flags |= SPE_RECORD_HAS_ISSUE_LATENCY; break;
+            case CounterType::TRANSLATION_LATENCY: rec.translation_latency = static_cast<UINT16>(payload); rec.flags |= SPE_RECORD_HAS_TRANSLATION_LATENCY; break;
+            }
+            break;
+        case PacketType::EVENTS:
+            rec.events = payload;
+            rec.flags |= SPE_RECORD_HAS_EVENTS;
+            break;
+        case PacketType::DATA_SOURCE:
+            rec.data_source = static_cast<UINT16>(payload);
+            rec.flags |= SPE_RECORD_HAS_DATA_SOURCE;
+            break;
+        case PacketType::OPERATION_TYPE:
+            rec.optype_class = static_cast<UINT8>(hdr0 & ~MASK_LAST2);
+            rec.optype = static_cast<UINT8>(payload);
+            rec.flags |= SPE_RECORD_HAS_OPTYPE;
+            break;
+        case PacketType::TIMESTAMP:
+            rec.timestamp = payload;
+            rec.flags |= SPE_RECORD_HAS_TIMESTAMP;
+            [[fallthrough]];
+        case PacketType::END:
+            // End or Timestamp packet terminates the record
+            records.push_back(rec);
+            rec = { 0 };
+            consumed = pos;
+            break;
+        }
+    }
+
+    return consumed;
+}
+
+/// <summary>
+/// Find first likely record boundary at or after `from`: position just after
+/// End or Timestamp packet header byte (plus payload) which starts a valid packet.
+/// Payload bytes can mimic terminators, so result is only a candidate which
+/// decode_records_parallel() verifies while merging chunks.
+/// </summary>
+static size_t find_record_boundary(const UINT8* buf, size_t size, size_t from)
+{
+    using namespace SPEParser;
+
+    const size_t ts_len = 1 + packet_table.desc[static_cast<UINT8>(PacketType::TIMESTAMP)].size;
+
+    for (size_t p = (std::max)(from, size_t(1)); p < size; p++)
+    {
+        const bool after_end = buf[p - 1] == static_cast<UINT8>(PacketType::END);
+        const bool after_ts = p >= ts_len && buf[p - ts_len] == static_cast<UINT8>(PacketType::TIMESTAMP);
+        const PacketType next = packet_table.desc[buf[p]].type;
+
+        if ((after_end || after_ts) && next != PacketType::UNKNOWN)
+            return p;
+    }
+    return size;
+}
+
+size_t spe_device::decode_records_parallel(const UINT8* buf, size_t size, std::vector<struct spe_record>& records,
+    unsigned threads, size_t chunk_size)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+
+    if (threads <= 1 || chunk_size == 0 || size <= chunk_size)
+        return decode_records(buf, size, records);
+
+    // Split buffer at candidate record boundaries near each `chunk_size` multiple
+    std::vector<size_t> starts = { 0 };
+    for (size_t nominal = chunk_size; nominal < size; nominal += chunk_size)
+    {
+        size_t start = find_record_boundary(buf, size, (std::max)(nominal, starts.back()));
+        if (start >= size)
+            break;
+        if (start > starts.back())
+            starts.push_back(start);
+    }
+
+    const size_t chunks = starts.size();
+    starts.push_back(size);
+
+    struct chunk_result
+    {
+        std::vector<struct spe_record> records;
+        size_t consumed = 0;
+    };
+    std::vector<chunk_result> results(chunks);
+    std::atomic<size_t> next_chunk = 0;
+
+    auto worker = [&]() {
+        for (size_t k = next_chunk++; k < chunks; k = next_chunk++)
+            results[k].consumed = decode_records(buf + starts[k], starts[k + 1] - starts[k], results[k].records);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < (std::min)(static_cast<size_t>(threads), chunks); t++)
+        pool.emplace_back(worker);
+    for (auto& t : pool)
+        t.join();
+
+    // Merge in buffer order. Chunk is used as decoded only if previous data ended exactly at its
+    // start and chunk itself ends with complete record, i.e. serial decoding would see the same
+    // record boundaries. Otherwise chunk is decoded again from where previous data really ended.
+    size_t pos = 0;
+    for (size_t k = 0; k < chunks; k++)
+    {
+        const size_t end = starts[k + 1];
+
+        if (pos == starts[k] && results[k].consumed == end - starts[k])
+        {
+            records.insert(records.end(), results[k].records.begin(), results[k].records.end());
+            pos = end;
+        }
+        else
+        {
+            pos += decode_records(buf + pos, end - pos, records);
+        }
+    }
+
+    return pos;
+}
+
+std::wstring spe_device::get_record_desc(const struct spe_record& rec)
+{
+    std::wstring desc;
+    if (rec.flags & SPE_RECORD_HAS_OPTYPE)
+        desc = SPEParser::get_optype_desc(rec.optype_class, rec.optype);
+    desc += L"/";
+    if (rec.flags & SPE_RECORD_HAS_EVENTS)
+        desc += SPEParser::get_event_desc(rec.events);
+    return desc;
+}
+
 void spe_device::get_samples(const std::vector<UINT8>& spe_buffer, std::vector<FrameChain>& raw_samples, std::map<UINT64, std::wstring>& spe_events)
 {
-    std::vector<std::pair<std::wstring, UINT64>> records = SPEParser::read_spe_buffer(spe_buffer);
-    std::map<std::wstring, unsigned int> event_map;
+    std::vector<struct spe_record> records;
+    decode_records_parallel(spe_buffer.data(), spe_buffer.size(), records);
+    get_samples(records, raw_samples, spe_events);
+}
+
+void spe_device::get_samples(const std::vector<struct spe_record>& records, std::vector<FrameChain>& raw_samples, std::map<UINT64, std::wstring>& spe_events)
+{
+    // Descriptions are created only once for each distinct (operation type, events) pair
+    std::unordered_map<UINT64, UINT32> key_map;
+    std::map<std::wstring, UINT32> event_map;
     UINT32 events_idx = 0;
+
+    raw_samples.reserve(raw_samples.size() + records.size());
     for (const auto& rec : records)
     {
-        FrameChain fc{ 0 };
-        fc.pc = rec.second;
-        if (event_map.find(rec.first) != event_map.end())
+        const UINT64 key = SPEParser::get_record_desc_key(rec);
+        auto it = key_map.find(key);
+        if (it == key_map.end())
         {
-            fc.spe_event_idx = event_map[rec.first];
-        } else {
-            fc.spe_event_idx = events_idx;
-            spe_events[events_idx] = rec.first;
-            event_map[rec.first] = events_idx;
-            events_idx++;
+            std::wstring desc = get_record_desc(rec);
+            auto ev = event_map.find(desc);
+            if (ev == event_map.end())
+            {
+                spe_events[events_idx] = desc;
+                ev = event_map.emplace(desc, events_idx++).first;
+            }
+            it = key_map.emplace(key, ev->second).first;
         }
+
+        FrameChain fc{ 0 };
+        fc.pc = rec.pc;
+        fc.spe_event_idx = it->second;
         raw_samples.push_back(fc);
     }
 }
@@ -37,6 +37,37 @@
 #include "wperf-common/iorequest.h"
 #include "utils.h"
 
+// Sampled operation decoded from one SPE record, see spe_device::decode_records()
+struct spe_record
+{
+    UINT64 pc;                      // Address packet, index 0 (PC of sampled instruction)
+    UINT64 data_va;                 // Address packet, index 2 (data virtual address)
+    UINT64 data_pa;                 // Address packet, index 3 (data physical address)
+    UINT64 timestamp;               // Timestamp packet
+    UINT64 events;                  // Events packet payload
+    UINT16 total_latency;           // Counter packet, index 0
+    UINT16 issue_latency;           // Counter packet, index 1
+    UINT16 translation_latency;     // Counter packet, index 2
+    UINT16 flags;                   // SPE_RECORD_HAS_* of packets present in record
+    UINT16 data_source;             // Data source packet payload (IMPLEMENTATION DEFINED encoding)
+    UINT8 optype_class;             // Operation type packet header bits [1:0]
+    UINT8 optype;                   // Operation type packet payload
+    UINT8 reserved[4];              // Explicit padding, records can be compared with memcmp()
+};
+
+#define SPE_RECORD_HAS_PC                   (0x1 << 0)
+#define SPE_RECORD_HAS_DATA_VA              (0x1 << 1)
+#define SPE_RECORD_HAS_DATA_PA              (0x1 << 2)
+#define SPE_RECORD_HAS_TIMESTAMP            (0x1 << 3)
+#define SPE_RECORD_HAS_EVENTS               (0x1 << 4)
+#define SPE_RECORD_HAS_OPTYPE               (0x1 << 5)
+#define SPE_RECORD_HAS_TOTAL_LATENCY        (0x1 << 6)
+#define SPE_RECORD_HAS_ISSUE_LATENCY        (0x1 << 7)
+#define SPE_RECORD_HAS_TRANSLATION_LATENCY  (0x1 << 8)
+#define SPE_RECORD_HAS_DATA_SOURCE          (0x1 << 9)
+
+#define SPE_DECODE_CHUNK_SIZE               (4 * 1024 * 1024)   // Buffers larger than this are decoded in parallel
+
 
 class spe_device
 {
@@ -62,6 +93,17 @@ public:
     static std::wstring get_spe_version_name(UINT64 id_aa64dfr0_el1_value);
     static bool is_spe_supported(UINT64 id_aa64dfr0_el1_value);
     static void get_samples(const std::vector<UINT8>& spe_buffer, std::vector<FrameChain>& raw_samples, std::map<UINT64, std::wstring>& spe_events);
+    static void get_samples(const std::vector<struct spe_record>& records, std::vector<FrameChain>& raw_samples, std::map<UINT64, std::wstring>& spe_events);
+
+    // Decode complete records from `size` bytes at `buf` and append them to `records`.
+    // Returns number of bytes consumed, i.e. offset just after last complete record.
+    static size_t decode_records(const UINT8* buf, size_t size, std::vector<struct spe_record>& records);
+    // Same result as decode_records(), but buffer is split into `chunk_size` chunks which are decoded
+    // on `threads` threads (0 - one per logical processor) and merged in buffer order.
+    static size_t decode_records_parallel(const UINT8* buf, size_t size, std::vector<struct spe_record>& records,
+        unsigned threads = 0, size_t chunk_size = SPE_DECODE_CHUNK_SIZE);
+    // Human readable "OPTYPE/events" description of record, e.g. "LOAD_STORE_ATOMIC-LOAD-GP/retired+level1-data-cache-access"
+    static std::wstring get_record_desc(const struct spe_record& rec);
 
     static bool is_filter_name(std::wstring fname) {
         if (is_filter_name_alias(fname))
@@ -0,0 +1,199 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <algorithm>
+#include "spe_memory_profile.h"
+
+uint32_t spe_memory_profile::latency_stats::bucket(uint32_t latency)
+{
+    if (latency < 8)
+        return latency;
+
+    uint32_t e = 3;                         // floor(log2(latency))
+    while (e < 31 && (latency >> (e + 1)))
+        e++;
+
+    const uint32_t idx = 8 + (e - 3) * 4 + ((latency >> (e - 2)) & 0x3);
+    return (std::min)(idx, static_cast<uint32_t>(SPE_LATENCY_BUCKETS - 1));
+}
+
+uint32_t spe_memory_profile::latency_stats::bucket_min(uint32_t idx)
+{
+    if (idx < 8)
+        return idx;
+
+    const uint32_t e = (idx - 8) / 4 + 3;
+    return (4 + (idx - 8) % 4) << (e - 2);
+}
+
+uint32_t spe_memory_profile::latency_stats::bucket_max(uint32_t idx)
+{
+    if (idx < 8)
+        return idx;
+
+    const uint32_t e = (idx - 8) / 4 + 3;
+    return bucket_min(idx) + (1 << (e - 2)) - 1;
+}
+
+void spe_memory_profile::latency_stats::add(const struct spe_record& rec)
+{
+    samples++;
+
+    if (rec.flags & SPE_RECORD_HAS_TOTAL_LATENCY)
+    {
+        const uint32_t latency = rec.total_latency;
+
+        latency_samples++;
+        latency_sum += latency;
+        latency_max = (std::max)(latency_max, latency);
+        histogram[bucket(latency)]++;
+    }
+
+    if (rec.flags & SPE_RECORD_HAS_EVENTS)
+    {
+        l1d_access += (rec.events & SPE_EVENT_L1D_ACCESS) ? 1 : 0;
+        l1d_miss += (rec.events & SPE_EVENT_L1D_REFILL) ? 1 : 0;
+        llc_access += (rec.events & SPE_EVENT_LLC_ACCESS) ? 1 : 0;
+        llc_miss += (rec.events & SPE_EVENT_LLC_MISS) ? 1 : 0;
+    }
+}
+
+double spe_memory_profile::latency_stats::latency_avg() const
+{
+    return latency_samples ? static_cast<double>(latency_sum) / static_cast<double>(latency_samples) : 0.0;
+}
+
+uint32_t spe_memory_profile::latency_stats::latency_percentile(double p) const
+{
+    if (latency_samples == 0)
+        return 0;
+
+    const uint64_t rank = (std::max)(uint64_t(1), static_cast<uint64_t>(p * static_cast<double>(latency_samples) + 0.5));
+    uint64_t acc = 0;
+    for (uint32_t i = 0; i < SPE_LATENCY_BUCKETS; i++)
+    {
+        acc += histogram[i];
+        if (acc >= rank)
+            return (std::min)(bucket_max(i), latency_max);
+    }
+    return latency_max;
+}
+
+bool spe_memory_profile::is_memory_access(const struct spe_record& rec)
+{
+    if (rec.flags & SPE_RECORD_HAS_DATA_VA)
+        return true;
+    return (rec.flags & SPE_RECORD_HAS_OPTYPE) && rec.optype_class == 1;    // LOAD_STORE_ATOMIC
+}
+
+std::wstring spe_memory_profile::get_data_source_name(const struct spe_record& rec)
+{
+    if (!(rec.flags & SPE_RECORD_HAS_DATA_SOURCE))
+        return L"unknown";
+
+    switch (rec.data_source)
+    {
+    case SPE_DATA_SOURCE_L1D:           return L"L1D";
+    case SPE_DATA_SOURCE_L2:            return L"L2";
+    case SPE_DATA_SOURCE_PEER_CORE:     return L"PEER-CORE";
+    case SPE_DATA_SOURCE_LOCAL_CLUSTER: return L"LOCAL-CLUSTER";
+    case SPE_DATA_SOURCE_SYS_CACHE:     return L"SYS-CACHE";
+    case SPE_DATA_SOURCE_PEER_CLUSTER:  return L"PEER-CLUSTER";
+    case SPE_DATA_SOURCE_REMOTE:        return L"REMOTE";
+    case SPE_DATA_SOURCE_DRAM:          return L"DRAM";
+    }
+    return L"unknown";
+}
+
+void spe_memory_profile::add(const struct spe_record& rec, const std::wstring& symbol, const std::wstring& source_line)
+{
+    if (!is_memory_access(rec))
+        return;
+
+    m_total.add(rec);
+    m_by_symbol[symbol].add(rec);
+    m_by_line[source_line].add(rec);
+
+    m_by_data_source[get_data_source_name(rec)].add(rec);
+
+    if (!(rec.flags & SPE_RECORD_HAS_DATA_VA))
+        return;
+
+    m_by_page[rec.data_va >> SPE_PAGE_SHIFT].add(rec);
+
+    cache_line_stats& line = m_by_cache_line[rec.data_va >> SPE_CACHE_LINE_SHIFT];
+    line.add(rec);
+    if ((rec.flags & SPE_RECORD_HAS_DATA_SOURCE) &&
+        (rec.data_source == SPE_DATA_SOURCE_PEER_CORE || rec.data_source == SPE_DATA_SOURCE_PEER_CLUSTER))
+        line.peer_hits++;
+    if (line.pcs.size() < SPE_CACHE_LINE_MAX_PCS && std::find(line.pcs.begin(), line.pcs.end(), rec.pc) == line.pcs.end())
+        line.pcs.push_back(rec.pc);
+}
+
+template <typename K, typename V>
+std::vector<std::pair<K, V>> spe_memory_profile::sorted(const std::unordered_map<K, V>& m)
+{
+    std::vector<std::pair<K, V>> v(m.begin(), m.end());
+    std::sort(v.begin(), v.end(), [](const auto& a, const auto& b) {
+        if (a.second.latency_sum != b.second.latency_sum)
+            return a.second.latency_sum > b.second.latency_sum;
+        if (a.second.samples != b.second.samples)
+            return a.second.samples > b.second.samples;
+        return a.first < b.first;
+    });
+    return v;
+}
+
+std::vector<std::pair<std::wstring, spe_memory_profile::latency_stats>> spe_memory_profile::by_symbol() const
+{
+    return sorted(m_by_symbol);
+}
+
+std::vector<std::pair<std::wstring, spe_memory_profile::latency_stats>> spe_memory_profile::by_source_line() const
+{
+    return sorted(m_by_line);
+}
+
+std::vector<std::pair<std::wstring, spe_memory_profile::latency_stats>> spe_memory_profile::by_data_source() const
+{
+    return sorted(m_by_data_source);
+}
+
+std::vector<std::pair<uint64_t, spe_memory_profile::latency_stats>> spe_memory_profile::by_page() const
+{
+    return sorted(m_by_page);
+}
+
+std::vector<std::pair<uint64_t, spe_memory_profile::cache_line_stats>> spe_memory_profile::by_cache_line() const
+{
+    return sorted(m_by_cache_line);
+}
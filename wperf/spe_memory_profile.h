@@ -0,0 +1,129 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <windows.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "spe_device.h"
+
+#define SPE_LATENCY_BUCKETS         60      // See spe_memory_profile::latency_stats::bucket()
+#define SPE_CACHE_LINE_SHIFT        6       // 64 byte cache lines
+#define SPE_PAGE_SHIFT              12      // 4 KB data pages
+#define SPE_CACHE_LINE_MAX_PCS      16      // Distinct PCs remembered per cache line
+
+// SPE Events packet bits used by memory profile
+#define SPE_EVENT_L1D_ACCESS        (1ULL << 2)
+#define SPE_EVENT_L1D_REFILL        (1ULL << 3)
+#define SPE_EVENT_LLC_ACCESS        (1ULL << 8)
+#define SPE_EVENT_LLC_MISS          (1ULL << 9)
+
+// Data source packet payload, IMPLEMENTATION DEFINED, values used by Neoverse cores
+#define SPE_DATA_SOURCE_L1D             0x0
+#define SPE_DATA_SOURCE_L2              0x8
+#define SPE_DATA_SOURCE_PEER_CORE       0x9
+#define SPE_DATA_SOURCE_LOCAL_CLUSTER   0xA
+#define SPE_DATA_SOURCE_SYS_CACHE       0xB
+#define SPE_DATA_SOURCE_PEER_CLUSTER    0xC
+#define SPE_DATA_SOURCE_REMOTE          0xD
+#define SPE_DATA_SOURCE_DRAM            0xE
+
+/* Memory access latency profile built from decoded SPE records.
+
+   Only sampled loads and stores (records with data virtual address or
+   load/store operation type) are accounted. Each access is added to latency
+   statistics of its symbol, source line, 4 KB data page, 64 byte cache line
+   and data source. Latency histograms use 4 log-linear buckets per power of
+   two so percentiles are exact up to 7 cycles and within 25% above that.
+   Accesses without total latency counter still count towards cache events
+   but are left out of latency sum, maximum and histogram.
+*/
+class spe_memory_profile
+{
+public:
+    struct latency_stats
+    {
+        uint64_t samples = 0;
+        uint64_t latency_samples = 0;       // Samples with total latency, base of average and percentiles
+        uint64_t latency_sum = 0;           // Sum of total latencies, cycles
+        uint32_t latency_max = 0;
+        uint64_t l1d_access = 0;
+        uint64_t l1d_miss = 0;              // Level 1 data cache refills
+        uint64_t llc_access = 0;
+        uint64_t llc_miss = 0;
+        uint64_t histogram[SPE_LATENCY_BUCKETS] = {};
+
+        void add(const struct spe_record& rec);
+        double latency_avg() const;
+        // Upper bound of histogram bucket with `p` (0.0 - 1.0) of samples at or below it
+        uint32_t latency_percentile(double p) const;
+
+        static uint32_t bucket(uint32_t latency);
+        static uint32_t bucket_min(uint32_t idx);
+        static uint32_t bucket_max(uint32_t idx);
+    };
+
+    struct cache_line_stats : latency_stats
+    {
+        uint64_t peer_hits = 0;             // Accesses served from peer core or cluster cache
+        std::vector<uint64_t> pcs;          // Distinct PCs accessing this line, up to SPE_CACHE_LINE_MAX_PCS
+    };
+
+    static bool is_memory_access(const struct spe_record& rec);
+    // Data source name, e.g. "L1D", "L2", "PEER-CORE", "DRAM" or "unknown"
+    static std::wstring get_data_source_name(const struct spe_record& rec);
+
+    // Account `rec` if it is a memory access, `symbol` and `source_line` are its PC location
+    void add(const struct spe_record& rec, const std::wstring& symbol, const std::wstring& source_line);
+
+    const latency_stats& total() const { return m_total; }
+
+    // Views sorted by total latency (descending), i.e. by cycles spent waiting for memory
+    std::vector<std::pair<std::wstring, latency_stats>> by_symbol() const;
+    std::vector<std::pair<std::wstring, latency_stats>> by_source_line() const;
+    std::vector<std::pair<std::wstring, latency_stats>> by_data_source() const;
+    std::vector<std::pair<uint64_t, latency_stats>> by_page() const;            // [data_va >> SPE_PAGE_SHIFT]
+    std::vector<std::pair<uint64_t, cache_line_stats>> by_cache_line() const;   // [data_va >> SPE_CACHE_LINE_SHIFT]
+
+private:
+    template <typename K, typename V>
+    static std::vector<std::pair<K, V>> sorted(const std::unordered_map<K, V>& m);
+
+    latency_stats m_total;
+    std::unordered_map<std::wstring, latency_stats> m_by_symbol;
+    std::unordered_map<std::wstring, latency_stats> m_by_line;
+    std::unordered_map<std::wstring, latency_stats> m_by_data_source;
+    std::unordered_map<uint64_t, latency_stats> m_by_page;
+    std::unordered_map<uint64_t, cache_line_stats> m_by_cache_line;
+};
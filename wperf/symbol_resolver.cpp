@@ -0,0 +1,161 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <set>
+
+#include "symbol_resolver.h"
+
+static bool find_section_offset(const std::vector<SectionDesc>& sec_info, uint32_t sec_idx, uint64_t& offset)
+{
+    if (!sec_idx)   // We may not be able to decode all symbols, section indexes are 1-based
+        return false;
+
+    for (const auto& c : sec_info)
+        if (c.idx == (sec_idx - 1))
+        {
+            offset = c.offset;
+            return true;
+        }
+
+    return false;
+}
+
+void symbol_resolver::add(uint64_t start, uint64_t size, SampleDesc& proto)
+{
+    if (!size)
+        return;
+
+    m_pending.push_back({ start, start + size, static_cast<uint32_t>(m_symbols.size()) });
+    m_symbols.push_back({ start, proto });
+}
+
+void symbol_resolver::add_image(const std::vector<FuncSymDesc>& sym_info, const std::vector<SectionDesc>& sec_info, uint64_t base)
+{
+    for (const auto& b : sym_info)
+    {
+        uint64_t sec_offset;
+        if (!find_section_offset(sec_info, b.sec_idx, sec_offset))
+            continue;
+
+        SampleDesc proto;
+        proto.desc = b;
+        proto.module = nullptr;
+        add(base + sec_offset + b.offset, b.size, proto);
+    }
+}
+
+void symbol_resolver::add_module(const std::wstring& key, ModuleMetaData& mmd, const std::vector<SectionDesc>& sec_info)
+{
+    for (const auto& b : mmd.sym_info)
+    {
+        uint64_t sec_offset;
+        if (!find_section_offset(sec_info, b.sec_idx, sec_offset))
+            continue;
+
+        SampleDesc proto;
+        proto.desc = b;
+        proto.desc.name = b.name + L":" + key;
+        proto.desc.sname = b.name;
+        proto.module = &mmd;
+        add((UINT64)mmd.handle + sec_offset + b.offset, b.size, proto);
+    }
+}
+
+void symbol_resolver::build()
+{
+    /* Sweep over all range boundaries, at each boundary the highest priority
+       (lowest index) active range owns the address space up to next boundary.
+    */
+    struct boundary
+    {
+        uint64_t addr;
+        bool open;
+        uint32_t idx;
+    };
+
+    std::vector<boundary> boundaries;
+    boundaries.reserve(m_pending.size() * 2);
+    for (const auto& r : m_pending)
+    {
+        boundaries.push_back({ r.start, true, r.idx });
+        boundaries.push_back({ r.end, false, r.idx });
+    }
+
+    std::sort(boundaries.begin(), boundaries.end(), [](const boundary& a, const boundary& b) {
+        return a.addr < b.addr;
+    });
+
+    m_ranges.clear();
+    std::multiset<uint32_t> active;
+    for (size_t i = 0; i < boundaries.size(); )
+    {
+        const uint64_t addr = boundaries[i].addr;
+        for (; i < boundaries.size() && boundaries[i].addr == addr; i++)
+        {
+            if (boundaries[i].open)
+                active.insert(boundaries[i].idx);
+            else
+                active.erase(active.find(boundaries[i].idx));
+        }
+
+        if (active.empty() || i == boundaries.size())
+            continue;
+
+        const uint32_t owner = *active.begin();
+        const uint64_t next = boundaries[i].addr;
+
+        if (!m_ranges.empty() && m_ranges.back().idx == owner && m_ranges.back().end == addr)
+            m_ranges.back().end = next;
+        else
+            m_ranges.push_back({ addr, next, owner });
+    }
+
+    m_pending.clear();
+    m_pending.shrink_to_fit();
+}
+
+const symbol_resolver::symbol* symbol_resolver::resolve(uint64_t pc) const
+{
+    // First range which starts after `pc`, candidate is the one just before it
+    auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), pc, [](uint64_t addr, const range& r) {
+        return addr < r.start;
+    });
+
+    if (it == m_ranges.begin())
+        return nullptr;
+
+    --it;
+    if (pc >= it->end)
+        return nullptr;
+
+    return &m_symbols[it->idx];
+}
@@ -0,0 +1,83 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+#include "pe_file.h"
+
+/* Immutable PC -> symbol index for sample post-processing.
+
+   Symbol address ranges of the sampled image and of all modules with
+   symbols are added once, then `build()` flattens them into sorted,
+   non-overlapping ranges. Where ranges overlap the symbol added first wins,
+   which keeps the old "image first, then modules" lookup order.
+   After `build()` lookups are a binary search and, as nothing is mutated,
+   are safe to call from many threads.
+*/
+class symbol_resolver
+{
+public:
+    struct symbol
+    {
+        uint64_t start;         // Runtime address of the first byte of symbol
+        SampleDesc proto;       // `desc` and `module` ready to be used as sample prototype
+    };
+
+    // Add symbols of the sampled image, `base` is the runtime image base (incl. runtime delta)
+    void add_image(const std::vector<FuncSymDesc>& sym_info, const std::vector<SectionDesc>& sec_info, uint64_t base);
+    // Add symbols of module `key` loaded at `mmd.handle`, names are decorated as `symbol:key`
+    void add_module(const std::wstring& key, ModuleMetaData& mmd, const std::vector<SectionDesc>& sec_info);
+
+    void build();
+
+    // Return symbol containing `pc` or nullptr, valid until resolver is destroyed
+    const symbol* resolve(uint64_t pc) const;
+
+    size_t symbol_count() const { return m_symbols.size(); }
+    size_t range_count() const { return m_ranges.size(); }
+
+private:
+    struct range
+    {
+        uint64_t start;
+        uint64_t end;           // Exclusive
+        uint32_t idx;           // Index in `m_symbols`, lower index has priority
+    };
+
+    void add(uint64_t start, uint64_t size, SampleDesc& proto);
+
+    std::vector<symbol> m_symbols;
+    std::vector<range> m_pending;   // Ranges added before `build()`
+    std::vector<range> m_ranges;    // Sorted and non-overlapping after `build()`
+};
@@ -28,7 +28,10 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <charconv>
+#include <cstring>
 #include "timeline.h"
+#include "exception.h"
 #include "utils.h"
 
 
@@ -36,91 +39,287 @@ namespace timeline {
 
 	std::map<enum evt_class, struct timeline_header> timeline_headers;
     std::map<enum evt_class, std::vector<std::wstring>> timeline_header_cores;
-
     std::map<enum evt_class, std::vector<std::wstring>> timeline_header_event_names;
-    std::map<enum evt_class, std::vector<std::vector<std::wstring>>> timeline_header_event_values;
-
     std::map<enum evt_class, std::vector<std::wstring>> timeline_header_metric_names;
-    std::map<enum evt_class, std::vector<std::vector<std::wstring>>> timeline_header_metric_values;
 
-	void init() {
-		timeline_headers.clear();
-		timeline_header_cores.clear();
-		timeline_header_event_names.clear();
-        timeline_header_event_values.clear();
-        timeline_header_metric_names.clear();
-        timeline_header_metric_values.clear();
-	}
+    // Per event class output stream state
+    struct timeline_stream
+    {
+        std::ofstream outfile;
+        std::string buffer;                 // Formatted rows not yet written to `outfile`
+        ULONGLONG last_flush = 0;           // GetTickCount64() of last write to `outfile`
+        bool header_written = false;
+        bool pending = false;               // `events`/`metrics` hold uncommitted interval
+        std::vector<uint64_t> events;
+        std::vector<double> metrics;
+        std::vector<uint64_t> prev_events;  // Binary format: values of last committed interval
+    };
 
-    void print()
+    static std::map<enum evt_class, timeline_stream> timeline_streams;
+
+    void append_value(std::string& out, uint64_t value)
     {
-        for (auto& [e_class, header] : timeline_headers)
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, res.ptr);
+    }
+
+    void append_value(std::string& out, double value)
+    {
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 3);
+        if (res.ec == std::errc())
+            out.append(buf, res.ptr);
+        else
+            out += "nan";
+    }
+
+    void append_varint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    void append_zigzag(std::string& out, int64_t value)
+    {
+        append_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void append_f64(std::string& out, double value)
+    {
+        char buf[sizeof(double)];
+        memcpy(buf, &value, sizeof(buf));   // Arm64 and x64 are little-endian
+        out.append(buf, sizeof(buf));
+    }
+
+    static void append_u16(std::string& out, uint16_t value)
+    {
+        out += static_cast<char>(value & 0xFF);
+        out += static_cast<char>(value >> 8);
+    }
+
+    static void append_string(std::string& out, const std::wstring& str)
+    {
+        std::string mb = MultiByteFromWideString(str.c_str());
+        append_varint(out, mb.size());
+        out += mb;
+    }
+
+    static void append_binary_names(std::string& out, const std::vector<std::wstring>& names)
+    {
+        append_varint(out, names.size());
+        for (const auto& name : names)
+            append_string(out, name);
+    }
+
+    void format_csv_row(std::string& out, const std::vector<uint64_t>& events, const std::vector<double>& metrics)
+    {
+        for (const auto value : events)
+        {
+            append_value(out, value);
+            out += ',';
+        }
+
+        // Print metric values at the end of event count values line
+        for (const auto value : metrics)
+        {
+            append_value(out, value);
+            out += ',';
+        }
+
+        out += '\n';
+    }
+
+    void format_binary_row(std::string& out, const std::vector<uint64_t>& events, const std::vector<double>& metrics, std::vector<uint64_t>& prev)
+    {
+        prev.resize(events.size(), 0);
+
+        append_varint(out, events.size());
+        append_varint(out, metrics.size());
+
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            append_zigzag(out, static_cast<int64_t>(events[i] - prev[i]));
+            prev[i] = events[i];
+        }
+
+        for (const auto value : metrics)
+            append_f64(out, value);
+    }
+
+    static void append_names(std::string& out, const std::vector<std::wstring>& names, const char* prefix = "")
+    {
+        for (const auto& name : names)
         {
-            const auto& filename = timeline_headers[e_class].filename;
+            out += prefix;
+            out += MultiByteFromWideString(name.c_str());
+            out += ',';
+        }
+    }
+
+    static void flush(const enum evt_class e_class, timeline_stream& stream, bool force)
+    {
+        const ULONGLONG now = GetTickCount64();
+
+        if (!force && stream.buffer.size() < TIMELINE_BUFFER_SIZE && now - stream.last_flush < TIMELINE_FLUSH_MS)
+            return;
+
+        if (!stream.outfile.is_open())
+        {
+            auto mode = std::ios::out | std::ios::trunc;
+            if (timeline_headers[e_class].binary)
+                mode |= std::ios::binary;
+            stream.outfile.open(timeline_headers[e_class].filename, mode);
+            if (!stream.outfile.is_open())
+                throw fatal_exception("Failed to open timeline file");
+        }
+
+        stream.outfile.write(stream.buffer.data(), stream.buffer.size());
+        stream.outfile.flush();
+        stream.buffer.clear();
+        stream.last_flush = now;
+    }
+
+    static void write_binary_header(const enum evt_class e_class, timeline_stream& stream)
+    {
+        const auto& header = timeline_headers[e_class];
+        std::string& out = stream.buffer;
+
+        uint16_t flags = 0;
+        if (header.multiplexing)
+            flags |= TIMELINE_BIN_FLAG_MULTIPLEXING;
+        if (header.include_kernel)
+            flags |= TIMELINE_BIN_FLAG_KERNEL;
+
+        out.append(TIMELINE_BIN_MAGIC, 4);
+        append_u16(out, TIMELINE_BIN_VERSION);
+        append_u16(out, flags);
+        append_f64(out, header.count_interval);
+        append_string(out, header.vendor_name);
+        append_string(out, header.event_class);
+        append_binary_names(out, timeline_header_cores[e_class]);
+        append_binary_names(out, timeline_header_event_names[e_class]);
+        append_binary_names(out, timeline_header_metric_names[e_class]);
+
+        stream.header_written = true;
+    }
+
+    static void write_header(const enum evt_class e_class, timeline_stream& stream)
+    {
+        if (timeline_headers[e_class].binary)
+        {
+            write_binary_header(e_class, stream);
+            return;
+        }
 
-            std::wofstream timeline_outfile;
-            timeline_outfile.open(filename);
+        std::string& out = stream.buffer;
 
-            print_header(timeline_outfile, e_class);
+        print_header(out, e_class);
+        out += '\n';
 
-            timeline_outfile << std::endl;
+        append_names(out, timeline_header_cores[e_class]);
+        out += '\n';
 
-            for (const auto& core : timeline_header_cores[e_class])
-                timeline_outfile << core << L",";
+        append_names(out, timeline_header_event_names[e_class]);
+        // Print metric names at the end of event count values line
+        append_names(out, timeline_header_metric_names[e_class], "M@");
+        out += '\n';
 
-            timeline_outfile << std::endl;
+        stream.header_written = true;
+    }
 
-            for (const auto& event_name : timeline_header_event_names[e_class])
-                timeline_outfile << event_name << L",";
+    static void commit(const enum evt_class e_class, timeline_stream& stream)
+    {
+        if (!stream.header_written)
+            write_header(e_class, stream);
 
-            // Print metric names at the end of event count values line
-            for (const auto& metric_name : timeline_header_metric_names[e_class])
-                timeline_outfile << L"M@" << metric_name << L",";
+        if (!stream.pending)
+            return;
 
-            timeline_outfile << std::endl;
+        if (timeline_headers[e_class].binary)
+            format_binary_row(stream.buffer, stream.events, stream.metrics, stream.prev_events);
+        else
+            format_csv_row(stream.buffer, stream.events, stream.metrics);
 
-            int lineno = 0;
-            for (const auto& lines : timeline_header_event_values[e_class])
-            {
-                for (const auto& event_value : lines)
-                    timeline_outfile << event_value << L",";
+        stream.events.clear();
+        stream.metrics.clear();
+        stream.pending = false;
+    }
 
-                // Print metric values at the end of event count values line
-                if (timeline_header_metric_values.count(e_class))
-                    for (const auto& metric_value : timeline_header_metric_values[e_class][lineno])
-                        timeline_outfile << metric_value << L",";
+    void push_event_values(const enum evt_class e_class, const std::vector<uint64_t>& values)
+    {
+        auto& stream = timeline_streams[e_class];
 
-                timeline_outfile << std::endl;
-                lineno++;
-            }
+        if (stream.pending)
+        {
+            commit(e_class, stream);
+            flush(e_class, stream, false);
+        }
 
-            timeline_outfile << std::endl;
+        stream.events = values;
+        stream.pending = true;
+    }
 
-            timeline_outfile.close();
+    void push_metric_values(const enum evt_class e_class, const std::vector<double>& values)
+    {
+        auto& stream = timeline_streams[e_class];
+        stream.metrics.insert(stream.metrics.end(), values.begin(), values.end());
+    }
+
+	void init() {
+		timeline_headers.clear();
+		timeline_header_cores.clear();
+		timeline_header_event_names.clear();
+        timeline_header_metric_names.clear();
+        timeline_streams.clear();
+	}
+
+    void print()
+    {
+        for (auto& [e_class, header] : timeline_headers)
+        {
+            auto& stream = timeline_streams[e_class];
+
+            commit(e_class, stream);
+            if (!header.binary)
+                stream.buffer += '\n';
+            flush(e_class, stream, true);
+
+            stream.outfile.close();
         }
+
+        timeline_streams.clear();
     }
 
-	void print_header(std::wofstream& timeline_outfile, const enum evt_class e_class)
+	void print_header(std::string& out, const enum evt_class e_class)
 	{
-        timeline_outfile << L"Multiplexing,";
-        timeline_outfile << (timeline_headers[e_class].multiplexing ? L"TRUE" : L"FALSE");
-        timeline_outfile << std::endl;
+        const auto& header = timeline_headers[e_class];
+
+        out += "Multiplexing,";
+        out += header.multiplexing ? "TRUE" : "FALSE";
+        out += '\n';
 
         if (e_class == EVT_CORE)
         {
-            timeline_outfile << L"Kernel mode,";
-            timeline_outfile << (timeline_headers[e_class].include_kernel ? L"TRUE" : L"FALSE");
-            timeline_outfile << std::endl;
+            out += "Kernel mode,";
+            out += header.include_kernel ? "TRUE" : "FALSE";
+            out += '\n';
         }
 
-        timeline_outfile << L"Count interval,";
-        timeline_outfile << DoubleToWideString(timeline_headers[e_class].count_interval);
-        timeline_outfile << std::endl;
+        out += "Count interval,";
+        out += MultiByteFromWideString(DoubleToWideString(header.count_interval).c_str());
+        out += '\n';
 
-        timeline_outfile << L"Vendor," << timeline_headers[e_class].vendor_name;
-        timeline_outfile << std::endl;
+        out += "Vendor,";
+        out += MultiByteFromWideString(header.vendor_name.c_str());
+        out += '\n';
 
-        timeline_outfile << L"Event class," << timeline_headers[e_class].event_class;
-        timeline_outfile << std::endl;
+        out += "Event class,";
+        out += MultiByteFromWideString(header.event_class.c_str());
+        out += '\n';
 	}
-}
\ No newline at end of file
+}
@@ -45,6 +45,7 @@ struct timeline_header
 	std::wstring vendor_name;
 	std::wstring event_class;
 	std::string filename;			// Name of the timeline file (we will also show it in the header)
+	bool binary = false;			// Write binary timeline format instead of CSV, see `--timeline-binary`
 };
 
 /* Timeline file content
@@ -59,21 +60,72 @@ struct timeline_header
 +------------------------------+
 | timeline_header_event_names  | + timeline_header_metric_names
 +------------------------------+
-| timeline_header_event_values | + timeline_header_metric_values
+| event values (one interval)  | + metric values
 +------------------------------+
+| ...                          |
+
+Rows are streamed to the file: header is written together with the first
+interval (metric names are known only after first metrics are calculated)
+and formatted rows are buffered in memory up to TIMELINE_BUFFER_SIZE bytes
+or TIMELINE_FLUSH_MS milliseconds, whichever comes first.
+*/
+
+#define TIMELINE_BUFFER_SIZE    (64 * 1024)
+#define TIMELINE_FLUSH_MS       1000
+
+/* Binary timeline file (enabled with `--timeline-binary`, extension .wtl)
+
+All multi-byte values are little-endian. `varint` is LEB128 encoded unsigned
+integer, `string` is varint length followed by bytes and `names` is varint
+count followed by strings.
+
++------------------------------------------------+
+| magic "WPTL" | version u16 | flags u16         |  flags: TIMELINE_BIN_FLAG_*
+| count_interval f64                             |
+| vendor string | event class string             |
+| cores names | event names | metric names       |  Same as CSV header lines
++------------------------------------------------+
+| varint event_num | varint metric_num           |  One record per interval
+| event_num x varint zigzag(value - prev value)  |  Delta against same column of previous interval
+| metric_num x f64                               |
++------------------------------------------------+
+| ...                                            |
+
+Use wperf-scripts/timeline_convert.py to convert it to CSV or JSON.
 */
 
+#define TIMELINE_BIN_MAGIC              "WPTL"
+#define TIMELINE_BIN_VERSION            1
+#define TIMELINE_BIN_FLAG_MULTIPLEXING  0x0001
+#define TIMELINE_BIN_FLAG_KERNEL        0x0002
+#define TIMELINE_BIN_EXT                ".wtl"
+
 namespace timeline {
 
 	extern std::map<enum evt_class, struct timeline_header> timeline_headers;
 	extern std::map<enum evt_class, std::vector<std::wstring>> timeline_header_cores;
 	extern std::map<enum evt_class, std::vector<std::wstring>> timeline_header_event_names;
-	extern std::map<enum evt_class, std::vector<std::vector<std::wstring>>> timeline_header_event_values;	// [EVT_CLAS][line][event_values]
-
 	extern std::map<enum evt_class, std::vector<std::wstring>> timeline_header_metric_names;
-	extern std::map<enum evt_class, std::vector<std::vector<std::wstring>>> timeline_header_metric_values;
+
+	// Append counter values of one interval, previous interval of `e_class` is committed to file
+	void push_event_values(const enum evt_class e_class, const std::vector<uint64_t>& values);
+	// Append metric values to current interval of `e_class`
+	void push_metric_values(const enum evt_class e_class, const std::vector<double>& values);
 
 	void init();
-	void print();
-	void print_header(std::wofstream& timeline_outfile, const enum evt_class e_class);
+	void print();	// Commit pending intervals and close all timeline files
+	void print_header(std::string& out, const enum evt_class e_class);
+
+	// Formatting helpers, append to `out` without intermediate strings
+	void append_value(std::string& out, uint64_t value);
+	void append_value(std::string& out, double value);
+
+	// Row encoders, `prev` holds previous interval event values and is updated
+	void format_csv_row(std::string& out, const std::vector<uint64_t>& events, const std::vector<double>& metrics);
+	void format_binary_row(std::string& out, const std::vector<uint64_t>& events, const std::vector<double>& metrics, std::vector<uint64_t>& prev);
+
+	// Binary encoding helpers
+	void append_varint(std::string& out, uint64_t value);
+	void append_zigzag(std::string& out, int64_t value);
+	void append_f64(std::string& out, double value);
 }
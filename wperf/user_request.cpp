@@ -160,6 +160,10 @@ OPTIONS:
     --sample-display-row
         Set how many samples you want to see in the summary (50 by default).
 
+    --sample-ring-size
+        Set capacity, in samples, of each driver sample ring mapped into `wperf`.
+        Driver rounds it up to a power of two between 1024 and 65536.
+
     --symbol
         Filter results for specific symbols (for use with 'record' and 'sample' commands).
 
@@ -173,7 +177,7 @@ OPTIONS:
 
     -c, --cpu
         Specify comma separated list of CPU cores, and or ranges of CPU cores, to count
-        on, or one CPU to sample on.
+        or sample on. SPE sampling supports only one CPU.
 
     -k
         Count kernel mode as well (disabled by default).
@@ -189,6 +193,11 @@ OPTIONS:
         Provide customized config file which describes custom events or
         provide custom events from the command line.
 
+    --event-weight
+        Specify comma separated list of <event>:<weight> pairs. When events
+        are multiplexed an event with weight 2 is counted twice as often as
+        an event with default weight 1. Weight range is 1-64.
+
     --json
         Define output type as JSON.
 
@@ -198,6 +207,11 @@ OPTIONS:
     --output-csv
         Specify CSV output filename. Only with timeline `-t`.
 
+    --output-ndjson
+        Stream counting results of each interval to NDJSON file, one JSON
+        object per core and interval. Use `-` for standard output. Enables
+        timeline mode.
+
     --output-prefix, --cwd
          Set current working dir for storing output JSON and CSV file.
 
@@ -386,6 +400,7 @@ void user_request::init(wstr_vec& raw_args, const struct pmu_device_cfg& pmu_cfg
         }
 
     set_event_padding(ioctl_events, pmu_cfg, events, groups);
+    set_event_weights();
     check_events(EVT_CORE, MAX_MANAGED_CORE_EVENTS);
     check_events(EVT_DSU, MAX_MANAGED_DSU_EVENTS);
     check_events(EVT_DMC_CLK, MAX_MANAGED_DMC_CLK_EVENTS);
@@ -407,12 +422,15 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
     bool waiting_interval = false;
     bool waiting_metric_config = false;
     bool waiting_events_config = false;
+    bool waiting_event_weight = false;
     bool waiting_output_filename = false;
     bool waiting_output_csv_filename = false;
+    bool waiting_output_ndjson_filename = false;
     bool waiting_image_name = false;
     bool waiting_pe_file = false;
     bool waiting_pdb_file = false;
     bool waiting_sample_display_row = false;
+    bool waiting_sample_ring_size = false;
     bool waiting_timeline_count = false;
     bool waiting_config = false;
     bool waiting_commandline = false;
@@ -424,7 +442,7 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
     bool sample_pe_file_given = false;
 
     std::wstring waiting_duration_arg;
-    std::wstring output_filename, output_csv_filename;
+    std::wstring output_filename, output_csv_filename, output_ndjson_filename;
 
     if (raw_args.empty())
     {
@@ -582,6 +600,20 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (waiting_event_weight)
+        {
+            waiting_event_weight = false;
+            parse_events_weight(a, event_weights);
+            continue;
+        }
+
+        if (waiting_output_ndjson_filename)
+        {
+            waiting_output_ndjson_filename = false;
+            output_ndjson_filename = a;
+            continue;
+        }
+
         if (waiting_config)
         {
             waiting_config = false;
@@ -750,6 +782,13 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (waiting_sample_ring_size)
+        {
+            sample_ring_size = _wtoi(a.c_str());
+            waiting_sample_ring_size = false;
+            continue;
+        }
+
         if (waiting_man_query)
         {
             man_query_args = a;
@@ -838,12 +877,32 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--disassemble-llvm")
+        {
+            do_disassembly = true;
+            do_disassembly_llvm = true;
+            do_annotate = true;
+            continue;
+        }
+
         if (a == L"--force-lock")
         {
             do_force_lock = true;
             continue;
         }
 
+        if (a == L"--spe-memory")
+        {
+            do_spe_memory = true;
+            continue;
+        }
+
+        if (a == L"--sample-copy")
+        {
+            do_sample_copy = true;
+            continue;
+        }
+
         if (a == L"--export_perf_data")
         {
             do_export_perf_data = true;
@@ -893,6 +952,18 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--event-weight")
+        {
+            waiting_event_weight = true;
+            continue;
+        }
+
+        if (a == L"--output-ndjson")
+        {
+            waiting_output_ndjson_filename = true;
+            continue;
+        }
+
         if (a == L"--config")
         {
             waiting_config = true;
@@ -915,6 +986,12 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--timeline-binary")
+        {
+            do_timeline_binary = true;
+            continue;
+        }
+
         if (a == L"-n")
         {
             waiting_timeline_count = true;
@@ -927,6 +1004,12 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--sample-ring-size")
+        {
+            waiting_sample_ring_size = true;
+            continue;
+        }
+
         if (a == L"--sample-display-long")
         {
             sample_display_short = false;
@@ -1037,6 +1120,22 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
         output_filename_csv_full_path = GetFullFilePath(m_cwd, output_csv_filename);
     }
 
+    // --output-ndjson streams timeline intervals, "-" is the standard output
+    if (output_ndjson_filename.size())
+    {
+        do_timeline = true;
+        if (count_interval == -1.0)
+            count_interval = 60;
+        if (count_duration == -1.0)
+            count_duration = 1;
+
+        ndjson_output_file = output_ndjson_filename;
+        if (output_ndjson_filename == L"-")
+            m_out.m_isQuiet = true;     // Only NDJSON records go to the standard output
+        else if (m_cwd.size())
+            ndjson_output_file = GetFullFilePath(m_cwd, output_ndjson_filename);
+    }
+
     // Support custom outpus for --output
     if (output_filename.size())
     {
@@ -1106,6 +1205,28 @@ void user_request::check_events(enum evt_class evt, int max)
     }
 }
 
+// Apply --event-weight to counted events, padding events keep weight 0 in the driver
+void user_request::set_event_weights()
+{
+    for (const auto& [e_class, weights] : event_weights)
+        for (const auto& [index, weight] : weights)
+        {
+            bool found = false;
+
+            if (ioctl_events.count(e_class))
+                for (auto& e : ioctl_events[e_class])
+                    if (e.index == index && e.type != EVT_PADDING)
+                    {
+                        e.weight = weight;
+                        found = true;
+                    }
+
+            if (!found)
+                m_out.GetErrorOutputStream() << L"warning: event weight set for event " << IntToHexWideString(index, 4)
+                    << L" which is not counted" << std::endl;
+        }
+}
+
 // Please note that 'config_name' here is a file name or just command line with extra events
 void user_request::load_config_events(std::wstring config_name,
     std::map<enum evt_class, std::vector<struct extra_event>>& extra_events)
@@ -58,6 +58,7 @@ public:
     bool has_events();
     void show_events();
     void check_events(enum evt_class evt, int max);
+    void set_event_weights();
     void load_config_events(std::wstring config_name,
         std::map<enum evt_class, std::vector<struct extra_event>>& extra_events);
     void load_config_metrics(std::wstring config_name, const struct pmu_device_cfg& pmu_cfg);
@@ -78,6 +79,7 @@ public:
     bool do_count;
     bool do_kernel;
     bool do_timeline;
+    bool do_timeline_binary = false;    // --timeline-binary, write binary timeline instead of CSV
     bool do_sample;
     bool do_record;
     bool do_version;
@@ -86,10 +88,13 @@ public:
     bool do_test;
     bool do_annotate;
     bool do_disassembly;
+    bool do_disassembly_llvm = false;   // --disassemble-llvm, disassemble with llvm-objdump instead of built-in decoder
     bool do_man;
     bool do_symbol;
     bool do_detect = false;
     bool do_force_lock = false;     // Force lock acquire of the driver
+    bool do_sample_copy = false;    // --sample-copy, read samples with PMU_CTL_SAMPLE_GET instead of mapped ring
+    uint32_t sample_ring_size = 0;  // --sample-ring-size, capacity of mapped driver sample rings, 0 for driver default
     bool do_export_perf_data;
     bool do_cwd = false;            // Set current working dir for storing output files
     bool report_l3_cache_metric;
@@ -107,6 +112,7 @@ public:
     std::wstring sample_pdb_file;
     std::wstring record_commandline;        // <sample_pe_file> <arg> <arg> <arg> ...
     std::wstring timeline_output_file; 
+    std::wstring ndjson_output_file;        // --output-ndjson <FILENAME>, "-" is the standard output
     std::wstring m_cwd;                     // Current working dir for storing output files
     uint32_t sample_display_row;
     bool sample_display_short;
@@ -114,7 +120,9 @@ public:
     std::vector<struct evt_sample_src> ioctl_events_sample;
     std::map<std::wstring, metric_desc> metrics;
     std::map<uint32_t, uint32_t> sampling_inverval;     //!< [event_index] -> event_sampling_interval
+    std::map<enum evt_class, std::map<uint16_t, uint16_t>> event_weights;   //!< --event-weight, [event_index] -> multiplexing weight
     bool m_sampling_with_spe = false;                   // SPE: User requested sampling with SPE
+    bool do_spe_memory = false;                         // SPE: --spe-memory, print memory access latency profile
     std::map<std::wstring, uint64_t> m_sampling_flags;      // SPE: sampling flags
 
 private: